@@ -0,0 +1,76 @@
+/*
+Allocore Example: Mesh Normals Benchmark
+
+Description:
+Compares Mesh::generateNormals with Mesh::generateNormalsParallel on indexed
+triangle meshes of 1M to 10M triangles and checks that both agree.
+
+Author:
+AlloSphere Research Group
+*/
+
+#include <cmath>
+#include <cstdio>
+
+#include "al/graphics/al_Mesh.hpp"
+#include "al/system/al_Time.hpp"
+
+using namespace al;
+
+// Wavy height field with 2 * (n-1)^2 triangles
+void makeGrid(Mesh& m, int n) {
+  m.reset();
+  m.primitive(Mesh::TRIANGLES);
+  m.vertices().reserve(n * n);
+  for (int j = 0; j < n; ++j) {
+    for (int i = 0; i < n; ++i) {
+      float x = float(i) / n, y = float(j) / n;
+      m.vertex(x, y, 0.05f * std::sin(40 * x) * std::cos(30 * y));
+    }
+  }
+  m.indices().reserve(6 * (n - 1) * (n - 1));
+  for (int j = 0; j < n - 1; ++j) {
+    for (int i = 0; i < n - 1; ++i) {
+      unsigned a = j * n + i, b = a + 1, c = a + n, d = c + 1;
+      m.index(a, b, d);
+      m.index(a, d, c);
+    }
+  }
+}
+
+int main() {
+  const int sizes[] = {708, 1582, 2237};  // ~1M, 5M, 10M triangles
+
+  for (int n : sizes) {
+    Mesh ref;
+    makeGrid(ref, n);
+    Mesh par(ref);
+    printf("%zu triangles\n", ref.indices().size() / 3);
+
+    Timer timer;
+    ref.generateNormals();
+    timer.stop();
+    double tSerial = timer.elapsedSec();
+
+    timer.start();
+    par.generateNormalsParallel(Mesh::AREA_WEIGHTED);
+    timer.stop();
+    double tParallel = timer.elapsedSec();
+
+    float maxDiff = 0;
+    for (size_t i = 0; i < ref.normals().size(); ++i) {
+      maxDiff = std::max(maxDiff, (ref.normals()[i] - par.normals()[i]).mag());
+    }
+
+    timer.start();
+    par.generateNormalsParallel(Mesh::ANGLE_WEIGHTED);
+    timer.stop();
+    double tAngle = timer.elapsedSec();
+
+    printf("  generateNormals          %8.2f ms\n", tSerial * 1000);
+    printf("  generateNormalsParallel  %8.2f ms (x%.1f), max diff %g\n",
+           tParallel * 1000, tSerial / tParallel, maxDiff);
+    printf("  angle weighted           %8.2f ms\n", tAngle * 1000);
+  }
+  return 0;
+}
@@ -0,0 +1,84 @@
+/*
+Allocore Example: Batch Random Numbers Benchmark
+
+Description:
+Compares filling 1M values one call at a time with rnd::Random against
+rnd::RandomBatch, for uniform, normal, ball and sphere variates, and fills
+a larger array from several threads with one stream each.
+
+Author:
+AlloSphere Research Group
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+#include "al/math/al_RandomBatch.hpp"
+#include "al/system/al_ParallelFor.hpp"
+#include "al/system/al_Time.hpp"
+
+using namespace al;
+
+double timeMs(const std::function<void()>& f) {
+  // best of a few runs
+  double best = 1e30;
+  for (int run = 0; run < 5; ++run) {
+    Timer timer;
+    f();
+    timer.stop();
+    best = std::min(best, timer.elapsedSec() * 1000);
+  }
+  return best;
+}
+
+void report(const char* name, double scalar, double batch) {
+  printf("  %-8s %8.2f ms %8.2f ms (x%.1f)\n", name, scalar, batch,
+         scalar / batch);
+}
+
+int main() {
+  const size_t n = 1000000;
+  rnd::Random<> rng(1);
+  rnd::RandomBatch batch(1);
+  std::vector<float> x(n);
+  std::vector<Vec3f> p(n);
+
+  printf("%zu values       Random   RandomBatch\n", n);
+  report("uniform", timeMs([&]() {
+           for (size_t i = 0; i < n; ++i) x[i] = rng.uniform();
+         }),
+         timeMs([&]() { batch.uniform(x.data(), n); }));
+  report("normal", timeMs([&]() {
+           for (size_t i = 0; i < n; i += 2) rng.normal(x[i], x[i + 1]);
+         }),
+         timeMs([&]() { batch.normal(x.data(), n); }));
+  report("ball", timeMs([&]() {
+           for (size_t i = 0; i < n; ++i) rng.ball(p[i]);
+         }),
+         timeMs([&]() { batch.ball(p.data(), n); }));
+  report("sphere", timeMs([&]() {
+           for (size_t i = 0; i < n; ++i) p[i] = rng.ball<Vec3f>().normalize();
+         }),
+         timeMs([&]() { batch.sphere(p.data(), n); }));
+
+  // Chunks get their own stream, so the result does not depend on the
+  // number of threads
+  const size_t chunk = 1 << 16, numChunks = 64;
+  std::vector<float> big(chunk * numChunks);
+  double t = timeMs([&]() {
+    parallelFor(
+        numChunks,
+        [&](size_t begin, size_t end) {
+          for (size_t c = begin; c < end; ++c) {
+            rnd::RandomBatch stream(1, uint32_t(c));
+            stream.normal(&big[c * chunk], chunk);
+          }
+        },
+        0, 1);
+  });
+  printf("%zu normals in %zu streams, all threads  %8.2f ms\n", big.size(),
+         numChunks, t);
+  return 0;
+}
@@ -0,0 +1,122 @@
+/*
+Allocore Example: Batch Vector Kernels Benchmark
+
+Description:
+Compares the array kernels of al_VecBatch with per-element loops over Vec,
+Matrix4 and Quat on 1M vectors, and reports the largest difference between
+the two.
+
+Author:
+AlloSphere Research Group
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+#include "al/math/al_Random.hpp"
+#include "al/math/al_VecBatch.hpp"
+#include "al/system/al_Time.hpp"
+
+using namespace al;
+
+double timeMs(const std::function<void()>& f) {
+  // best of a few runs
+  double best = 1e30;
+  for (int run = 0; run < 5; ++run) {
+    Timer timer;
+    f();
+    timer.stop();
+    best = std::min(best, timer.elapsedSec() * 1000);
+  }
+  return best;
+}
+
+template <class T>
+double maxDiff(const std::vector<Vec<3, T>>& a,
+               const std::vector<Vec<3, T>>& b) {
+  double d = 0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    for (int c = 0; c < 3; ++c) {
+      d = std::max(d, double(std::abs(a[i][c] - b[i][c])));
+    }
+  }
+  return d;
+}
+
+void report(const char* name, double scalar, double kernel, double diff) {
+  printf("  %-18s %8.2f ms %8.2f ms (x%.1f)  max diff %.1e\n", name, scalar,
+         kernel, scalar / kernel, diff);
+}
+
+template <class T>
+void run(const char* type) {
+  typedef Vec<3, T> V;
+  const size_t n = 1000000;
+  rnd::Random<> rng;
+  std::vector<V> a(n), b(n), ref(n), out(n);
+  for (size_t i = 0; i < n; ++i) {
+    a[i] = V(rng.uniformS(), rng.uniformS(), rng.uniformS());
+    b[i] = V(rng.uniformS(), rng.uniformS(), rng.uniformS());
+  }
+  Matrix4<T> m = Matrix4<T>::translation(V(1, 2, 3)) *
+                 Matrix4<T>::rotate(0.5, V(0, 1, 1).normalize());
+  Quat<T> q = Quat<T>().fromAxisAngle(0.5, V(1, 1, 0).normalize());
+
+  printf("%zu %s vectors      scalar      kernel\n", n, type);
+
+  double ts = timeMs([&] {
+    for (size_t i = 0; i < n; ++i) {
+      Vec<4, T> p = m * Vec<4, T>(a[i], 1);
+      ref[i] = V(p.x, p.y, p.z);
+    }
+  });
+  double tk = timeMs([&] { transformPoints(m, a.data(), out.data(), n); });
+  report("transformPoints", ts, tk, maxDiff(ref, out));
+
+  ts = timeMs([&] {
+    for (size_t i = 0; i < n; ++i) {
+      Vec<4, T> p = m * Vec<4, T>(a[i], 0);
+      ref[i] = V(p.x, p.y, p.z);
+    }
+  });
+  tk = timeMs([&] { transformVectors(m, a.data(), out.data(), n); });
+  report("transformVectors", ts, tk, maxDiff(ref, out));
+
+  ts = timeMs([&] {
+    for (size_t i = 0; i < n; ++i) ref[i] = q.rotate(a[i]);
+  });
+  tk = timeMs([&] { rotate(q, a.data(), out.data(), n); });
+  report("rotate", ts, tk, maxDiff(ref, out));
+
+  ts = timeMs([&] {
+    for (size_t i = 0; i < n; ++i) ref[i] = a[i].normalized();
+  });
+  tk = timeMs([&] { normalize(a.data(), out.data(), n); });
+  report("normalize", ts, tk, maxDiff(ref, out));
+
+  ts = timeMs([&] {
+    for (size_t i = 0; i < n; ++i) ref[i] = a[i].cross(b[i]);
+  });
+  tk = timeMs([&] { cross(a.data(), b.data(), out.data(), n); });
+  report("cross", ts, tk, maxDiff(ref, out));
+
+  std::vector<T> dotRef(n), dotOut(n);
+  ts = timeMs([&] {
+    for (size_t i = 0; i < n; ++i) dotRef[i] = a[i].dot(b[i]);
+  });
+  tk = timeMs([&] { dot(a.data(), b.data(), dotOut.data(), n); });
+  double diff = 0;
+  for (size_t i = 0; i < n; ++i) {
+    diff = std::max(diff, double(std::abs(dotRef[i] - dotOut[i])));
+  }
+  report("dot", ts, tk, diff);
+}
+
+int main() {
+  run<float>("float");
+  run<double>("double");
+  return 0;
+}
@@ -0,0 +1,85 @@
+/*
+Allocore Example: HashSpace Neighbour Benchmark
+
+Description:
+Times finding the neighbours of every agent at 10k, 100k and 1M agents:
+one HashSpace::Query per agent on the voxel lists, against rebuild() and
+the batched neighborsWithin() / nearestNeighbors() queries.
+
+Author:
+AlloSphere Research Group
+*/
+
+#include <cstdio>
+#include <vector>
+
+#include "al/math/al_Random.hpp"
+#include "al/spatial/al_HashSpace.hpp"
+#include "al/system/al_Time.hpp"
+
+using namespace al;
+
+int main() {
+  const uint32_t counts[] = {10000, 100000, 1000000};
+  const double radius = 1.5;
+  const uint32_t maxNeighbors = 32;
+  rnd::Random<> rng;
+
+  for (uint32_t n : counts) {
+    // a third to a half of an agent per voxel
+    uint32_t resolution = n > 500000 ? 7 : (n > 50000 ? 6 : 5);
+    HashSpace space(resolution, n);
+    float dim = float(space.dim());
+    std::vector<Vec3f> positions(n);
+    for (auto& p : positions) {
+      p = Vec3f(rng.uniform(dim), rng.uniform(dim), rng.uniform(dim));
+    }
+    printf("%u agents, %u voxels per side\n", n, space.dim());
+
+    Timer timer;
+    for (uint32_t i = 0; i < n; i++) {
+      space.move(i, positions[i]);
+    }
+    timer.stop();
+    double tMove = timer.elapsedSec();
+
+    HashSpace::Query query(maxNeighbors);
+    size_t found = 0;
+    timer.start();
+    for (uint32_t i = 0; i < n; i++) {
+      query.clear();
+      found += query(space, &space.object(i), radius);
+    }
+    timer.stop();
+    double tQuery = timer.elapsedSec();
+
+    timer.start();
+    space.rebuild(positions);
+    timer.stop();
+    double tRebuild = timer.elapsedSec();
+
+    HashSpace::Neighbors neighbors;
+    // once to grow the buffers, as they would be after the first frame
+    space.neighborsWithin(neighbors, radius, maxNeighbors);
+    timer.start();
+    space.neighborsWithin(neighbors, radius, maxNeighbors);
+    timer.stop();
+    double tWithin = timer.elapsedSec();
+    size_t foundBatch = neighbors.ids.size();
+
+    space.nearestNeighbors(neighbors, 8, radius);
+    timer.start();
+    space.nearestNeighbors(neighbors, 8, radius);
+    timer.stop();
+    double tNearest = timer.elapsedSec();
+
+    printf("  move() each agent       %8.2f ms\n", tMove * 1000);
+    printf("  rebuild()               %8.2f ms\n", tRebuild * 1000);
+    printf("  Query per agent         %8.2f ms, %zu neighbours\n",
+           tQuery * 1000, found);
+    printf("  neighborsWithin()       %8.2f ms, %zu neighbours (x%.1f)\n",
+           tWithin * 1000, foundBatch, tQuery / tWithin);
+    printf("  nearestNeighbors(k=8)   %8.2f ms\n", tNearest * 1000);
+  }
+  return 0;
+}
@@ -0,0 +1,88 @@
+/*
+Allocore Example: Trajectory Sampling Benchmark
+
+Description:
+Times animating 500 keyframed sources: per-object Pose::lerp between keys
+at every frame, against Trajectories evaluating all objects at once, for
+one graphics frame and for every sample of a 512 frame audio block.
+
+Author:
+AlloSphere Research Group
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "al/math/al_Random.hpp"
+#include "al/spatial/al_Trajectory.hpp"
+#include "al/system/al_Time.hpp"
+
+using namespace al;
+
+int main() {
+  const uint32_t numObjects = 500, numKeys = 16, blockFrames = 512;
+  const double keyInterval = 0.5, sampleRate = 44100;
+  rnd::Random<> rng;
+
+  // the keys as they would be kept per object
+  std::vector<std::vector<Pose>> keys(numObjects);
+  Trajectories paths(numObjects);
+  for (uint32_t i = 0; i < numObjects; ++i) {
+    for (uint32_t k = 0; k < numKeys; ++k) {
+      Pose p(Vec3d(rng.uniformS(), rng.uniformS(), rng.uniformS()) * 10,
+             Quatd().fromEuler(rng.uniformS() * 3, rng.uniformS(), 0.));
+      keys[i].push_back(p);
+      paths.addKey(i, k * keyInterval, p);
+    }
+  }
+
+  // per object, per sample
+  auto lerpAll = [&](double t, std::vector<Pose>& out) {
+    for (uint32_t i = 0; i < numObjects; ++i) {
+      uint32_t k = std::min(uint32_t(t / keyInterval), numKeys - 2);
+      double amt = t / keyInterval - k;
+      out[i] = keys[i][k].lerp(keys[i][k + 1], amt);
+    }
+  };
+
+  const double t0 = 3.3;
+  std::vector<Pose> poses(numObjects);
+  Timer timer;
+  for (uint32_t f = 0; f < blockFrames; ++f) {
+    lerpAll(t0 + f / sampleRate, poses);
+  }
+  timer.stop();
+  double tLerp = timer.elapsedSec();
+
+  std::vector<Vec3f> pos(numObjects * blockFrames);
+  std::vector<Quatf> quat(numObjects * blockFrames);
+  printf("%u objects, %u keys each, %u frame block\n", numObjects, numKeys,
+         blockFrames);
+  printf("  Pose::lerp per object per frame  %8.3f ms\n", tLerp * 1000);
+
+  const Trajectories::PositionMode positionModes[] = {
+      Trajectories::LINEAR, Trajectories::CATMULL_ROM};
+  const char* positionNames[] = {"linear", "Catmull-Rom"};
+  const Trajectories::OrientationMode orientationModes[] = {
+      Trajectories::SLERP, Trajectories::SQUAD};
+  const char* orientationNames[] = {"slerp", "squad"};
+  for (int p = 0; p < 2; ++p) {
+    for (int o = 0; o < 2; ++o) {
+      paths.positionMode(positionModes[p]);
+      paths.orientationMode(orientationModes[o]);
+      timer.start();
+      paths.sample(t0, 1 / sampleRate, blockFrames, pos.data(), quat.data());
+      timer.stop();
+      double tBlock = timer.elapsedSec();
+      timer.start();
+      paths.evaluate(t0, pos.data(), quat.data());
+      timer.stop();
+      double tFrame = timer.elapsedSec();
+      printf("  %-11s %-5s block %8.3f ms (x%.1f), one frame %6.1f us\n",
+             positionNames[p], orientationNames[o], tBlock * 1000,
+             tLerp / tBlock, tFrame * 1e6);
+    }
+  }
+  return 0;
+}
@@ -41,6 +41,7 @@ public:
  *
 @code
 broadcastAddress = "192.168.10.255"
+multicastGroup = "239.255.10.1"
 [[node]]
   host = "ar01.1g"
   rank = 0
@@ -61,7 +62,9 @@ broadcastAddress = "192.168.10.255"
 
   * The broadcast address is used for state sending and the node list sets the
   * role and capabilities of the application if the hostname matches one of the
-  * nodes listed.
+  * nodes listed. If a multicast group is given, state is sent to it instead,
+  * falling back to the broadcast address if the group can't be opened or
+  * sending to it keeps failing.
   *
   * By default, if no configuration file is found, the application will be
   * primary if the primary port is available. if it is not, it will become a
@@ -154,6 +157,9 @@ public:
         auto sender =
             distDomain->addStateSender("state", distDomain->statePtr());
         sender->configure(10101, "state", additionalConfig["broadcastAddress"]);
+        if (additionalConfig.count("multicastGroup") > 0) {
+          sender->setMulticastGroup(additionalConfig["multicastGroup"]);
+        }
       } else {
         std::cout << "Not enabling state sending for primary." << std::endl;
       }
@@ -162,6 +168,9 @@ public:
       auto receiver =
           distDomain->addStateReceiver("state", distDomain->statePtr());
       receiver->configure(10101);
+      if (additionalConfig.count("multicastGroup") > 0) {
+        receiver->setMulticastGroup(additionalConfig["multicastGroup"]);
+      }
     }
     DistributedApp::start();
   }
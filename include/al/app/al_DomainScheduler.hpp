@@ -0,0 +1,119 @@
+#ifndef DOMAINSCHEDULER_H
+#define DOMAINSCHEDULER_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "al/app/al_ComputationDomain.hpp"
+
+namespace al {
+
+/**
+ * @brief Domain running its subdomains at fixed rates of their own
+ * @ingroup App
+ *
+ * Each scheduled subdomain declares a rate, such as simulation at 240 Hz,
+ * network at 60 Hz and statistics at 1 Hz. Every tick the scheduler moves
+ * its clock forward by timeDelta(), as set by the parent domain, and runs
+ * every step that fell due in the order of their times, so a subdomain
+ * always ticks with a timeDelta() of exactly one period whatever the frame
+ * rate. Steps at the same time run by decreasing priority, then in the
+ * order the subdomains were scheduled.
+ *
+ * When the parent stalls, each subdomain catches up by at most
+ * maxCatchUp() steps per tick and the steps left are dropped, so one slow
+ * frame does not cause a spiral of ever longer ones.
+ *
+ * alpha() gives how far the clock is between the last step of a subdomain
+ * and its next, for rendering between the last two states.
+ *
+ * Subdomains added with newSubDomain() still tick once per tick, as in
+ * SynchronousDomain.
+@code
+    auto scheduler =
+        app.graphicsDomain()->newSubDomain<DomainScheduler>();
+    auto sim = scheduler->newScheduledDomain<SimulationDomain>(240);
+    sim->simulationFunction = [&](double dt) { world.step(dt); };
+    ...
+    // in onDraw()
+    world.draw(g, scheduler->alpha(sim));
+@endcode
+ */
+class DomainScheduler : public SynchronousDomain {
+public:
+  bool init(ComputationDomain *parent = nullptr) override;
+  bool cleanup(ComputationDomain *parent = nullptr) override;
+
+  /// Advance by timeDelta() and run the steps that fell due
+  bool tick() override;
+
+  /**
+   * @brief Create a subdomain run rate times per second
+   * @param rate in Hz, must be positive
+   * @param priority steps at the same time run from high to low priority
+   * @return the created domain, or null if rate is not positive
+   */
+  template <class DomainType>
+  std::shared_ptr<DomainType> newScheduledDomain(double rate,
+                                                 int priority = 0);
+
+  /// Schedule an existing domain, returns false if rate is not positive or
+  /// the domain is already scheduled
+  bool schedule(std::shared_ptr<SynchronousDomain> domain, double rate,
+                int priority = 0);
+
+  /// Stop running a scheduled domain and clean it up
+  void unschedule(std::shared_ptr<SynchronousDomain> domain);
+
+  /// Advance the clock by dt seconds and run the steps that fell due
+  bool advance(double dt);
+
+  /// Fraction of the period since the last step of a domain, in [0, 1]
+  double alpha(const std::shared_ptr<SynchronousDomain> &domain) const;
+
+  /// Steps run and steps dropped for a domain
+  uint64_t steps(const std::shared_ptr<SynchronousDomain> &domain) const;
+  uint64_t
+  droppedSteps(const std::shared_ptr<SynchronousDomain> &domain) const;
+
+  /// Set the most steps a domain may run in one tick to catch up
+  void maxCatchUp(unsigned int steps) { mMaxCatchUp = steps; }
+  unsigned int maxCatchUp() const { return mMaxCatchUp; }
+
+  /// Time of the scheduler clock, in seconds since it was created
+  double time() const { return mTime; }
+
+protected:
+  struct Entry {
+    std::shared_ptr<SynchronousDomain> domain;
+    double period;
+    int priority;
+    double start;  // time the domain was scheduled
+    uint64_t next; // number of the next step, due at start + next * period
+    unsigned int stepsThisTick;
+    uint64_t steps;
+    uint64_t dropped;
+  };
+
+  const Entry *find(const SynchronousDomain *domain) const;
+  static double nextTime(const Entry &e) { return e.start + e.next * e.period; }
+
+  std::vector<Entry> mEntries;
+  double mTime{0};
+  unsigned int mMaxCatchUp{8};
+};
+
+template <class DomainType>
+std::shared_ptr<DomainType> DomainScheduler::newScheduledDomain(double rate,
+                                                                int priority) {
+  auto newDomain = std::make_shared<DomainType>();
+  if (!schedule(newDomain, rate, priority)) {
+    return nullptr;
+  }
+  return newDomain;
+}
+
+} // namespace al
+
+#endif // DOMAINSCHEDULER_H
@@ -5,6 +5,7 @@
 
 #include "al/app/al_OpenGLGraphicsDomain.hpp"
 #include "al/graphics/al_Graphics.hpp"
+#include "al/graphics/al_RenderQueue.hpp"
 #include "al/sphere/al_PerProjection.hpp"
 #include "al/sphere/al_SphereUtils.hpp"
 
@@ -83,6 +84,11 @@ public:
 
   /// Set this to false to render a regular view instead of omni
   bool drawOmni{true};
+  /// Call onDraw once per frame, recording its draws, and replay them for
+  /// every projection and eye instead of calling onDraw for each. onDraw
+  /// must then draw and clear only through Graphics, see RenderQueue.
+  /// DynamicScene culls and sorts its voices per projection when replayed.
+  bool replayOmniDraw{false};
   Lens mLens;
   //  Pose mPose;
 
@@ -90,6 +96,7 @@ private:
   std::unique_ptr<Window> mWindow;
 
   std::unique_ptr<Graphics> mGraphics;
+  RenderQueue mDrawQueue;
 
   OpenGLGraphicsDomain *mParent;
 
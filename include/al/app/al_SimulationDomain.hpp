@@ -1,7 +1,9 @@
 #ifndef SIMULATIONDOMAIN_H
 #define SIMULATIONDOMAIN_H
 
+#include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <functional>
 #include <iostream>
 #include <memory>
@@ -10,6 +12,8 @@
 #include <vector>
 
 #include "al/app/al_ComputationDomain.hpp"
+#include "al/system/al_PeriodicThread.hpp"
+#include "al/types/al_TripleBuffer.hpp"
 
 namespace al {
 
@@ -46,6 +50,131 @@ protected:
   std::shared_ptr<TSharedState> mState{new TSharedState};
 };
 
+// -------------
+
+/**
+ * @brief Simulation domain stepping on a thread of its own at a fixed rate
+ * @ingroup App
+ *
+ * simulationFunction is called every step() seconds, with the step as dt,
+ * so a heavy simulation does not lower the frame rate. Subdomains are
+ * ticked around it as in SimulationDomain, on the same thread. App does not
+ * start this domain; call init() and start() from onInit() and stop() from
+ * onExit().
+ *
+ * The destructor stops a running thread, but by then the members of a
+ * subclass are gone; subclasses overriding onStep() or using their own
+ * members on the thread must call stopThread() in their destructor.
+ */
+class ThreadedSimulationDomain : public AsynchronousDomain {
+public:
+  /// Timing of the steps since start()
+  struct Stats {
+    uint64_t steps{0};      ///< steps taken
+    uint64_t overruns{0};   ///< steps that took longer than step()
+    double lastStepTime{0}; ///< duration of the last step, in seconds
+    double meanStepTime{0}; ///< mean duration of a step, in seconds
+    double maxStepTime{0};  ///< longest step, in seconds
+  };
+
+  virtual ~ThreadedSimulationDomain();
+
+  bool init(ComputationDomain *parent = nullptr) override;
+  bool start() override;
+  bool stop() override;
+  bool cleanup(ComputationDomain *parent = nullptr) override;
+
+  /// Set the time between steps in seconds, used from the next start()
+  void setStep(double seconds) { mStep = seconds; }
+  double step() const { return mStep; }
+
+  bool running() const { return mRunning; }
+
+  /// Step statistics, safe to call from any thread
+  Stats stats() const;
+
+  std::function<void(double dt)> simulationFunction = [](double) {
+  }; // function called on the simulation thread every step
+
+protected:
+  /// Called on the simulation thread after each step
+  virtual void onStep() {}
+
+  void runStep();
+
+  /// Stop the thread without calling the stop callbacks
+  void stopThread();
+
+  std::atomic<double> mStep{1.0 / 120.0};
+  std::atomic<bool> mRunning{false};
+  std::atomic<uint64_t> mSteps{0};
+  std::atomic<uint64_t> mOverruns{0};
+  std::atomic<double> mLastStepTime{0};
+  std::atomic<double> mTotalStepTime{0};
+  std::atomic<double> mMaxStepTime{0};
+
+private:
+  PeriodicThread mThread;
+};
+
+// -------------
+
+/**
+ * Threaded simulation domain with state
+ *
+ * The simulation works on state() and the domain publishes a copy after
+ * each step through a triple buffer, so one other thread, usually
+ * graphics, can read the latest complete state with latestState() without
+ * ever waiting for the simulation.
+ */
+template <class TSharedState>
+class ThreadedStateSimulationDomain : public ThreadedSimulationDomain {
+public:
+  // the thread publishes mState into mPublished, stop it before they go
+  ~ThreadedStateSimulationDomain() { stopThread(); }
+
+  /// State being simulated, for the simulation thread, or before start()
+  TSharedState &state() { return mState; }
+
+  /// Latest state published, for a single reader thread
+  ///
+  /// The reference stays valid until the next call.
+  const TSharedState &latestState() {
+    mPublished.update();
+    return mPublished.read().state;
+  }
+
+  /// Number of steps taken before the state last returned by latestState()
+  uint64_t latestStep() const { return mPublished.read().step; }
+
+  bool start() override {
+    if (running()) {
+      return false;
+    }
+    // readers see the initial state until the first step is done
+    publish(0);
+    return ThreadedSimulationDomain::start();
+  }
+
+protected:
+  struct Snapshot {
+    TSharedState state;
+    uint64_t step{0};
+  };
+
+  void onStep() override { publish(mSteps); }
+
+  void publish(uint64_t step) {
+    Snapshot &s = mPublished.write();
+    s.state = mState;
+    s.step = step;
+    mPublished.publish();
+  }
+
+  TSharedState mState;
+  TripleBuffer<Snapshot> mPublished;
+};
+
 } // namespace al
 
 #endif // SIMULATIONDOMAIN
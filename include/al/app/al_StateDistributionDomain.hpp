@@ -12,6 +12,7 @@
 
 #include "al/app/al_SimulationDomain.hpp"
 #include "al/protocol/al_OSC.hpp"
+#include "al/protocol/al_StateSync.hpp"
 #include "al/spatial/al_Pose.hpp"
 
 namespace al {
@@ -22,7 +23,8 @@ struct DefaultState {
 
 template <class TSharedState> class StateReceiveDomain;
 
-template <class TSharedState> class StateSendDomain;
+template <class TSharedState, class TSender = StateSyncSender>
+class StateSendDomain;
 
 template <class TSharedState> class StateSimulationDomain;
 
@@ -82,7 +84,7 @@ public:
 
   bool cleanup(ComputationDomain *parent = nullptr) override {
     cleanupSubdomains(true);
-    mRecv = nullptr;
+    mListener.close();
     mState = nullptr;
 
     //    std::cerr << "Not using Cuttlebone. Ignoring" << std::endl;
@@ -93,7 +95,7 @@ public:
   void configure(uint16_t port = 10100, std::string id = "state",
                  std::string address = "0.0.0.0", uint16_t packetSize = 1400) {
     mPort = port;
-    mId = id;
+    setId(id);
     mAddress = address;
     mPacketSize = packetSize;
   }
@@ -108,7 +110,21 @@ public:
 
   std::string id() const { return mId; }
 
-  void setId(const std::string &id) { mId = id; }
+  void setId(const std::string &id) {
+    mId = id;
+    mReceiver.id(id);
+  }
+
+  /// Decoder of the frames received, lock with lockState() to read its stats
+  const StateSyncReceiver &receiver() const { return mReceiver; }
+
+  /// Also receive states multicast to group, joined on the interface with IP
+  /// interfaceAddress or on the default one if empty. Set before init().
+  void setMulticastGroup(const std::string &group,
+                         const std::string &interfaceAddress = "") {
+    mMulticastGroup = group;
+    mMulticastInterface = interfaceAddress;
+  }
 
 protected:
   std::shared_ptr<TSharedState> mState;
@@ -116,6 +132,8 @@ protected:
   std::string mAddress{"localhost"};
   uint16_t mPort = 10100;
   uint16_t mPacketSize = 1400;
+  std::string mMulticastGroup;
+  std::string mMulticastInterface;
 
 private:
   std::string mId;
@@ -125,7 +143,15 @@ private:
     StateReceiveDomain *mOscDomain;
     void onMessage(osc::Message &m) override {
       //      m.print();
-      if (m.addressPattern() == "/_state" && m.typeTags() == "sb") {
+      if (m.addressPattern() == "/_statechunk") {
+        mOscDomain->mRecvLock.lock();
+        if (mOscDomain->mReceiver.handle(m)) {
+          memcpy(mOscDomain->buf.get(), mOscDomain->mReceiver.state(),
+                 sizeof(TSharedState));
+          mOscDomain->newMessages++;
+        }
+        mOscDomain->mRecvLock.unlock();
+      } else if (m.addressPattern() == "/_state" && m.typeTags() == "sb") {
         std::string id;
         m >> id;
         if (id == mOscDomain->mId) {
@@ -148,7 +174,9 @@ private:
 
   uint16_t newMessages = 0;
   std::mutex mRecvLock;
-  std::unique_ptr<osc::Recv> mRecv;
+  StateSyncReceiver mReceiver;
+  // last, so that its thread stops before the members it uses are destroyed
+  StateSyncListener mListener;
 };
 
 template <class TSharedState>
@@ -157,14 +185,20 @@ bool StateReceiveDomain<TSharedState>::init(ComputationDomain *parent) {
   assert(parent != nullptr);
 
   buf = std::make_unique<unsigned char[]>(sizeof(TSharedState));
-  mRecv = std::make_unique<osc::Recv>();
-  if (!mRecv || !mRecv->open(mPort, mAddress.c_str())) {
+  mReceiver.stateSize(sizeof(TSharedState));
+  if (!mListener.open(mPort, mAddress.c_str())) {
     std::cerr << "Error opening server" << std::endl;
     return false;
   }
+  // broadcast is still received if the group cannot be joined
+  if (!mMulticastGroup.empty() &&
+      !mListener.joinMulticast(mMulticastGroup, mMulticastInterface)) {
+    std::cerr << "Could not join multicast group " << mMulticastGroup
+              << std::endl;
+  }
   mHandler.mOscDomain = this;
-  mRecv->handler(mHandler);
-  if (!mRecv->start()) {
+  mListener.handler(mHandler);
+  if (!mListener.start()) {
     std::cerr << "Failed to start receiver. " << std::endl;
     return false;
   }
@@ -174,9 +208,20 @@ bool StateReceiveDomain<TSharedState>::init(ComputationDomain *parent) {
   return true;
 }
 
-template <class TSharedState = DefaultState>
+/**
+ * @brief Domain sending a state every tick
+ * @ingroup App
+ *
+ * The state is sent with a TSender, a StateSyncSender or a subclass of it
+ * sending through another transport.
+ */
+template <class TSharedState = DefaultState, class TSender>
 class StateSendDomain : public SynchronousDomain {
 public:
+  /// Consecutive frames that may fail on the multicast group before falling
+  /// back to the address set
+  static const int maxGroupFailures = 3;
+
   bool init(ComputationDomain *parent = nullptr) override {
     initializeSubdomains(true);
 
@@ -188,17 +233,28 @@ public:
     tickSubdomains(true);
 
     assert(mState); // State must have been set at this point
-    //    assert(mSend);
-
-    //    osc::Blob b(&mState, sizeof(mState));
-    //    mSend->send("/_state", b);
 
     mStateLock.lock();
-    osc::Blob b(mState.get(), sizeof(TSharedState));
-    osc::Send s(mPort, mAddress.c_str());
-    //    std::cout << mAddress << ":" << mPort << std::endl;
-    s.send("/_state", mId, b);
-
+    // the socket is kept open from tick to tick
+    if (!mSender.isOpen()) {
+      mSender.id(mId);
+      mGroupFailures = 0;
+      // fall back to the address set if multicast cannot be sent
+      mOnGroup = !mMulticastGroup.empty() &&
+                 mSender.open(mPort, mMulticastGroup.c_str(), mPacketSize);
+      if (!mOnGroup) {
+        mSender.open(mPort, mAddress.c_str(), mPacketSize);
+      }
+    }
+    if (mSender.send(mState.get(), sizeof(TSharedState)) > 0) {
+      mGroupFailures = 0;
+    } else if (mOnGroup && ++mGroupFailures >= maxGroupFailures) {
+      std::cerr << "Could not send to multicast group " << mMulticastGroup
+                << ", sending to " << mAddress << std::endl;
+      mOnGroup = false;
+      mSender.close();
+      mSender.open(mPort, mAddress.c_str(), mPacketSize);
+    }
     mStateLock.unlock();
 
     tickSubdomains(false);
@@ -220,6 +276,7 @@ public:
     mId = id;
     mAddress = address;
     mPacketSize = packetSize;
+    mSender.close();
   }
 
   std::shared_ptr<TSharedState> state() { return mState; }
@@ -237,9 +294,33 @@ public:
 
   std::string id() const { return mId; }
 
-  void setId(const std::string &id) { mId = id; }
+  void setId(const std::string &id) {
+    mId = id;
+    mSender.close();
+  }
 
-  void setAddress(std::string address) { mAddress = address; };
+  void setAddress(std::string address) {
+    mAddress = address;
+    mSender.close();
+  };
+
+  /// Encoder of the frames sent, to set its keyframe interval or read stats
+  TSender &sender() { return mSender; }
+
+  /// Whether states are being sent to the multicast group
+  bool sendingToGroup() const { return mOnGroup; }
+
+  /// Send to a multicast group instead of the address set, from the
+  /// interface with IP interfaceAddress or the default one if empty.
+  /// Falls back to the address set, usually a broadcast address, if the
+  /// group cannot be opened or maxGroupFailures frames in a row fail on it,
+  /// until the group or address is set again.
+  void setMulticastGroup(const std::string &group,
+                         const std::string &interfaceAddress = "") {
+    mMulticastGroup = group;
+    mSender.multicastInterface(interfaceAddress);
+    mSender.close();
+  }
 
 protected:
   std::shared_ptr<TSharedState> mState;
@@ -248,9 +329,12 @@ protected:
   uint16_t mPort = 10100;
   std::string mAddress{"localhost"};
   uint16_t mPacketSize = 1400;
+  std::string mMulticastGroup;
 
 private:
-  std::unique_ptr<osc::Send> mSend;
+  TSender mSender;
+  bool mOnGroup{false};
+  int mGroupFailures{0};
 
   std::string mId = "";
 };
@@ -20,27 +20,18 @@
       uniform float eye_sep;
       uniform float foc_len;
 
-      uniform vec4 light0_eye;
-      uniform vec4 light1_eye;
-      ...
-
   Uniforms in Fragment Shader
 
       uniform sampler2D tex0;
       uniform vec4 col0;
       uniform vec4 tint;
-      uniform vec4 light_global_ambient;
 
-      uniform vec4 light0_ambient;
-      uniform vec4 light0_diffuse;
-      uniform vec4 light0_specular;
-      uniform float light0_enabled;
-      ...
+  Uniform block shared by lighting shaders, see al_lighting_block_string()
 
-      uniform vec4 material_ambient;
-      uniform vec4 material_diffuse;
-      uniform vec4 material_specular;
-      uniform float material_shininess;
+      al_global_ambient
+      al_material_ambient, al_material_diffuse, al_material_specular
+      al_material_shininess
+      al_lights[i].ambient, .diffuse, .specular, .eye, .enabled
 
 */
 
@@ -51,37 +42,35 @@
 
 inline constexpr int al_max_num_lights() { return 8; }
 
-struct per_light_uniform_locations {
-  int ambient = -1;
-  int diffuse = -1;
-  int specular = -1;
-  int position = -1;
-  int enabled = -1;
-  int atten = -1;
-};
-
-struct material_uniform_locations {
-  int ambient = -1;
-  int diffuse = -1;
-  int specular = -1;
-  int shininess = -1;
-  int emission = -1;
-};
-
-struct lighting_shader_uniforms {
-  int global_ambient = -1;
-  int normal_matrix = -1;
-  int num_lights = 0;
-  material_uniform_locations material;
-  std::vector<per_light_uniform_locations> lights;
-  bool has_material = false;
+// uniform buffer binding point of al_LightingBlock, kept high to stay clear of
+// bindings chosen by user shaders
+inline constexpr int al_lighting_block_binding() { return 15; }
+
+// C++ side of al_LightingBlock, laid out following std140 rules
+struct lighting_block {
+  struct light {
+    float ambient[4];
+    float diffuse[4];
+    float specular[4];
+    float eye[4];  // position in eye space
+    float enabled;
+    float pad[3];
+  };
+  float global_ambient[4];
+  float material_ambient[4];
+  float material_diffuse[4];
+  float material_specular[4];
+  float material_shininess;
+  float pad[3];
+  light lights[al_max_num_lights()];
 };
 
-void al_print_lighting_uniforms(lighting_shader_uniforms const& u,
-                                std::string name = "shader");
+static_assert(sizeof(lighting_block) ==
+                  (20 + 20 * al_max_num_lights()) * sizeof(float),
+              "lighting_block must match std140 layout");
 
-lighting_shader_uniforms al_get_lighting_uniform_locations(
-    al::ShaderProgram& s, bool print_result = false);
+// light and material block declaration used by both lighting shader stages
+std::string al_lighting_block_string();
 
 inline std::string al_default_shader_version_string() {
   return R"(#version 330
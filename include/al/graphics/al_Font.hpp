@@ -44,14 +44,38 @@
     Keehong Youn, 2019, younkeehong@gmail.com
 */
 
+#include <cstdint>
 #include <map>
+#include <string>
+#include <vector>
 
+#include "al/graphics/al_GlyphAtlas.hpp"
 #include "al/graphics/al_Graphics.hpp"
 #include "al/graphics/al_Mesh.hpp"
 #include "al/graphics/al_Texture.hpp"
+#include "al/graphics/al_VAOMesh.hpp"
+#include "al/math/al_Vec.hpp"
 
 namespace al {
 
+/// Glyph quads of a string laid out by Font::layout
+
+/// Each glyph is a quad of 4 corners, in the order bottom left, bottom
+/// right, top left, top right. Positions are relative to the start of the
+/// first baseline.
+struct TextLayout {
+  std::vector<Vec3f> vertices;
+  std::vector<Vec2f> texCoords;
+  float width = 0;  ///< Advance of the widest line
+
+  size_t glyphs() const { return vertices.size() / 4; }
+  void clear() {
+    vertices.clear();
+    texCoords.clear();
+    width = 0;
+  }
+};
+
 /**
 @brief Interface for loading fonts and rendering text
 @ingroup Graphics
@@ -82,6 +106,26 @@ struct Font {
   /// \returns whether font loaded successfully
   bool load(const char *filename, int fontSize, int bitmapSize);
 
+  /// Load font whose glyphs are rasterized on first use
+
+  /// Any codepoint in the font can be drawn. Glyphs are kept in a GlyphAtlas
+  /// of bounded size; call uploadGlyphs() before drawing to update the
+  /// texture. FontRenderer and TextBatch do so when rendering.
+  /// \param[in] filename        path to font file
+  /// \param[in] fontSize        size of font
+  /// \param[in] atlasSize       width and height of glyph atlas
+  /// \returns whether font loaded successfully
+  bool loadDynamic(const char *filename, int fontSize, int atlasSize = 1024);
+
+  /// Upload glyphs rasterized since the last call to the texture
+  void uploadGlyphs();
+
+  /// Increases when glyphs move in the atlas, invalidating earlier layouts
+  unsigned long generation() const;
+
+  /// Glyph atlas of a font loaded with loadDynamic, nullptr otherwise
+  GlyphAtlas *atlas();
+
   /*! Render text geometry
       Render text into geometry for drawing a string of text using the bitmap
       returned by ascii_chars.  Render expects the vertex and texcoord buffers
@@ -101,6 +145,32 @@ struct Font {
   */
   void write(Mesh &mesh, const char *text, float worldHeight);
 
+  /// Lay out UTF-8 text as glyph quads
+
+  /// Lines are separated by '\n'. Codepoints without a glyph are drawn
+  /// as '?'. Not const, as a font loaded with loadDynamic() rasterizes
+  /// glyphs into its atlas here.
+  /// \param[out] out            layout, replaced
+  /// \param[in] text            UTF-8 string
+  /// \param[in] worldHeight     height of a line
+  void layout(TextLayout &out, const char *text, float worldHeight);
+
+  /// Append laid out text to mesh as indexed quads
+
+  /// \param[in] mesh            triangle mesh with texcoords
+  /// \param[in] layout          text to add
+  /// \param[in] position        position of the text origin
+  /// \param[in] alignFactor     fraction of width to shift by, see alignLeft
+  static void append(Mesh &mesh, const TextLayout &layout,
+                     const Vec3f &position = Vec3f(0),
+                     float alignFactor = 0.0f);
+
+  /// Decode the UTF-8 codepoint at text and advance text past it
+
+  /// Malformed sequences decode to U+FFFD, consuming one byte.
+  ///
+  static uint32_t decodeUTF8(const char *&text);
+
   /// Returns the width of a text string, in pixels
   // float width(const char* text) const;
 
@@ -136,10 +206,20 @@ struct Font {
  *
  */
 struct FontRenderer : public Font {
-  Mesh fontMesh;
+  VAOMesh fontMesh;
 
+  /// Lay out text, unless it is the text already written
   void write(const char *text, float worldHeight = 1.0f) {
+    if (mText == text && mHeight == worldHeight && mAlign == alignFactorX &&
+        mGeneration == generation()) {
+      return;
+    }
+    mText = text;
+    mHeight = worldHeight;
+    mAlign = alignFactorX;
     Font::write(fontMesh, text, worldHeight);
+    mGeneration = generation();
+    mChanged = true;
   }
 
   static void render(Graphics &g, const char *text, Vec3d position,
@@ -162,6 +242,11 @@ struct FontRenderer : public Font {
     g.blending(true);
     g.blendTrans();
     g.texture();
+    uploadGlyphs();
+    if (mChanged) {
+      fontMesh.update();
+      mChanged = false;
+    }
     tex.bind();
     g.draw(fontMesh);
     tex.unbind();
@@ -173,8 +258,88 @@ struct FontRenderer : public Font {
     render(g);
     g.popMatrix();
   }
+
+private:
+  std::string mText;
+  float mHeight = 0;
+  float mAlign = 0;
+  unsigned long mGeneration = 0;
+  bool mChanged = false;
 };  // namespace al
 
+/**
+ * @brief Many text labels drawn as one mesh
+ * @ingroup Graphics
+ *
+ * Labels are laid out when their text changes and kept. The combined mesh
+ * is only touched when labels change: in place when the number of glyphs
+ * stays the same, rebuilt otherwise. Unchanged labels cost nothing per
+ * frame and all labels are drawn with a single draw call.
+ *
+ * Example usage:
+ * <pre>
+ *     TextBatch hud(font);
+ *     size_t fps = hud.add("fps", Vec3f(-1, 0.9, 0), 0.05);
+ *     ...
+ *     hud.text(fps, std::to_string(rate));
+ *     hud.render(g);
+ * </pre>
+ */
+class TextBatch {
+public:
+  TextBatch(Font &font) : mFont(&font) {}
+
+  /// Add label and return its index
+  size_t add(const std::string &text, const Vec3f &position,
+             float worldHeight = 1.0f, float alignFactor = 0.0f);
+
+  /// Set text of label. Does nothing if the text is unchanged.
+  void text(size_t label, const std::string &text);
+  const std::string &text(size_t label) const { return mLabels[label].text; }
+
+  /// Set position of label
+  void position(size_t label, const Vec3f &position);
+
+  /// Remove all labels
+  void clear();
+
+  size_t size() const { return mLabels.size(); }
+
+  /// Bring mesh up to date with the labels. Returns whether it changed.
+  bool update();
+
+  /// Number of times labels have been laid out
+  unsigned long layouts() const { return mLayouts; }
+
+  /// Combined mesh of all labels
+  VAOMesh &mesh() { return mMesh; }
+
+  /// Update, upload if changed and draw with the font texture
+  void render(Graphics &g);
+
+private:
+  struct Label {
+    std::string text;
+    Vec3f position;
+    float height, align;
+    TextLayout layout;
+    size_t firstVertex = 0;
+    bool dirty = false;
+  };
+
+  void relayout(Label &l);
+  void writeLabel(const Label &l);
+
+  Font *mFont;
+  std::vector<Label> mLabels;
+  VAOMesh mMesh;
+  unsigned long mLayouts = 0;
+  unsigned long mGeneration = 0;
+  bool mRebuild = true;
+  bool mPatch = false;
+  bool mUpload = false;
+};
+
 }  // namespace al
 
 #endif
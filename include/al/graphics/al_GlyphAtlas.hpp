@@ -0,0 +1,131 @@
+#ifndef INCLUDE_AL_GLYPHATLAS_HPP
+#define INCLUDE_AL_GLYPHATLAS_HPP
+
+/*  Allocore --
+  Multimedia / virtual environment application class library
+
+  File description:
+  Glyph atlas filled on demand
+
+  Baking every glyph of a font up front wastes texture memory for small
+  character sets and can't work for large ones such as CJK. GlyphAtlas
+  rasterizes glyphs the first time they are needed, packs them with a
+  skyline packer and, when full, evicts the least recently used ones.
+
+  File author(s):
+  AlloSphere Research Group
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace al {
+
+/**
+ * @brief Single channel texture atlas of glyphs rasterized on first use
+ * @ingroup Graphics
+ *
+ * The atlas only deals with pixels; Font uploads them to its texture. The
+ * regions written since the last clearDirty() are listed by dirtyRects() so
+ * only those need to be uploaded.
+ *
+ * When a glyph doesn't fit, the most recently used glyphs that fill up to
+ * half of the atlas are repacked and the others evicted. Repacking moves
+ * glyphs, which is signaled by an increase of generation(): text laid out
+ * with texture coordinates from an earlier generation must be laid out
+ * again.
+ */
+class GlyphAtlas {
+public:
+  struct Rect {
+    int x = 0, y = 0, w = 0, h = 0;
+  };
+
+  /// Rasterized glyph. Metrics are in pixels with y towards down.
+  struct Bitmap {
+    int width = 0, height = 0;
+    float x0 = 0, y0 = 0;  ///< offset of bitmap from pen position
+    float xAdvance = 0;
+    std::vector<uint8_t> pixels;  ///< width * height
+  };
+
+  struct Glyph {
+    Rect rect;               ///< area in atlas
+    float x0, y0, x1, y1;    ///< quad corners relative to pen position
+    float s0, t0, s1, t1;    ///< texture coordinates
+    float xAdvance;
+    uint64_t lastUsed;
+  };
+
+  /// Fills bitmap for codepoint. Returns false if there is no such glyph.
+  typedef std::function<bool(uint32_t codepoint, Bitmap &bitmap)> Rasterizer;
+
+  /**
+   * @param width   atlas width in pixels
+   * @param height  atlas height in pixels
+   * @param padding empty pixels kept between glyphs to avoid bleeding
+   */
+  GlyphAtlas(int width = 1024, int height = 1024, int padding = 1);
+
+  void rasterizer(const Rasterizer &r) { mRasterizer = r; }
+
+  /// Get glyph, rasterizing it if needed
+
+  /// Returns nullptr if the codepoint has no glyph, or the glyph is larger
+  /// than the atlas or than the room left after evicting glyphs; any of these
+  /// is remembered and not rasterized again until clear(). The pointer is
+  /// valid until the next call.
+  const Glyph *glyph(uint32_t codepoint);
+
+  /// Remove all glyphs
+  void clear();
+
+  int width() const { return mWidth; }
+  int height() const { return mHeight; }
+  const std::vector<uint8_t> &pixels() const { return mPixels; }
+
+  /// Regions changed since the last clearDirty()
+  const std::vector<Rect> &dirtyRects() const { return mDirty; }
+  void clearDirty() { mDirty.clear(); }
+
+  /// Number of glyphs in the atlas
+  size_t size() const { return mGlyphs.size(); }
+
+  /// Increases whenever glyphs move or are evicted
+  unsigned long generation() const { return mGeneration; }
+
+  unsigned long rasterized() const { return mRasterized; }
+  unsigned long evicted() const { return mEvicted; }
+
+private:
+  struct SkylineNode {
+    int x, y, w;
+  };
+
+  bool place(int w, int h, Rect &r);
+  bool fits(size_t node, int w, int h, int &y) const;
+  void compact();
+  void markMissing(uint32_t codepoint);
+  void markDirty(const Rect &r);
+  void setTexCoords(Glyph &g);
+
+  int mWidth, mHeight, mPadding;
+  std::vector<uint8_t> mPixels;
+  std::vector<SkylineNode> mSkyline;
+  std::unordered_map<uint32_t, Glyph> mGlyphs;
+  std::unordered_set<uint32_t> mMissing;
+  std::vector<Rect> mDirty;
+  Rasterizer mRasterizer;
+  uint64_t mTick = 0;
+  unsigned long mGeneration = 0;
+  unsigned long mRasterized = 0;
+  unsigned long mEvicted = 0;
+};
+
+}  // namespace al
+
+#endif
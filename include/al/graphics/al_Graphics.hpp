@@ -45,6 +45,7 @@
 
 */
 
+#include "al/graphics/al_BufferObject.hpp"
 #include "al/graphics/al_DefaultShaders.hpp"
 #include "al/graphics/al_Light.hpp"
 #include "al/graphics/al_OpenGL.hpp"
@@ -52,6 +53,8 @@
 
 namespace al {
 
+class RenderQueue;
+
 /**
 @defgroup Graphics Graphics
 */
@@ -70,6 +73,19 @@ class Graphics : public RenderManager {
     CUSTOM
   };
 
+  /// Coloring and shader settings a draw is made with
+  struct DrawState {
+    ColoringMode coloringMode = ColoringMode::UNIFORM;
+    Color color{1, 1, 1, 1};
+    Color tint{1, 1, 1, 1};
+    Material material;
+    bool lighting = false;
+    int numLights = 1;
+    Light lights[al_max_num_lights()];
+    bool lightOn[al_max_num_lights()] = {};
+    ShaderProgram *shader = nullptr;  // for ColoringMode::CUSTOM
+  };
+
   virtual ~Graphics() {}
 
   /// buffer=[GL_NONE, GL_FRONT_LEFT, GL_FRONT_RIGHT, GL_BACK_LEFT,
@@ -148,14 +164,12 @@ class Graphics : public RenderManager {
   inline void lineWidth(float size) { gl::lineWidth(size); }
 
   // clears the default color buffer(buffer 0) with the provided color
-  inline void clearColor(float r, float g, float b, float a = 1.f) {
-    gl::clearColor(r, g, b, a);
-  }
+  void clearColor(float r, float g, float b, float a = 1.f);
   // clears color buffer using al::Color class
-  inline void clearColor(Color const &c) { gl::clearColor(c.r, c.g, c.b, c.a); }
+  inline void clearColor(Color const &c) { clearColor(c.r, c.g, c.b, c.a); }
 
   // clears the depth buffer with the provided depth value
-  inline void clearDepth(float d = 1.f) { gl::clearDepth(d); }
+  void clearDepth(float d = 1.f);
 
   // clears the specified color buffer with the provided color
   inline void clearBuffer(int buffer, float r, float g, float b,
@@ -165,13 +179,13 @@ class Graphics : public RenderManager {
 
   // clears color & depth buffer with the provided color, and depth 1
   inline void clear(float r, float g, float b, float a = 1.f) {
-    gl::clearColor(r, g, b, a);
-    gl::clearDepth(1.f);
+    clearColor(r, g, b, a);
+    clearDepth(1.f);
   }
   // clears color & depth buffer with grayscale values, and depth 1
   inline void clear(float grayscale = 0.f, float a = 1.f) {
-    gl::clearColor(grayscale, grayscale, grayscale, a);
-    gl::clearDepth(1.f);
+    clearColor(grayscale, grayscale, grayscale, a);
+    clearDepth(1.f);
   }
   // clears color & depth buffer using al::Color class, and depth 1
   inline void clear(Color const &c) { clear(c.r, c.g, c.b, c.a); }
@@ -238,8 +252,28 @@ class Graphics : public RenderManager {
                                 // accessible
   void camera(Viewpoint const &v) override;
 
-  void send_lighting_uniforms(ShaderProgram &s,
-                              lighting_shader_uniforms const &u);
+  // draws are deferred to the render queue while recording
+  void draw(VAOMesh &mesh);
+  void draw(EasyVAO &vao);
+  void draw(const Mesh &mesh);
+  void draw(Mesh &&mesh) { draw(static_cast<const Mesh &>(mesh)); }
+
+  /// Current coloring mode, colors, material, lights and custom shader
+  DrawState drawState() const;
+  /// Restore settings returned by drawState()
+  void drawState(DrawState const &s);
+
+  /// Record draws and clears into q instead of issuing them
+
+  /// Until endRecording(), draw() and clear calls are stored in q, which is
+  /// cleared first, while all other settings apply as usual. Replay the
+  /// queue with RenderQueue::replay().
+  void beginRecording(RenderQueue &q);
+  void endRecording();
+  bool recording() const { return mQueue != nullptr; }
+  /// Queue being recorded into, nullptr if not recording
+  RenderQueue *recordingQueue() const { return mQueue; }
+
   void update() override;
 
   // to pass to the shader, combined with mLens.eyeSep(),
@@ -269,65 +303,47 @@ class Graphics : public RenderManager {
   bool mUniformChanged = true;
   bool mLightingEnabled = false;
 
-  ShaderProgram mesh_shader;
-  ShaderProgram color_shader;
-  ShaderProgram tex_shader;
-
-  int color_location = 0;
-  int color_tint_location = 0;
-  int mesh_tint_location = 0;
-  int tex_tint_location = 0;
-
   Material mMaterial;
   Light mLights[al_max_num_lights()];
   bool mLightOn[al_max_num_lights()];
   int num_lights = 1;
 
-  ShaderProgram lighting_color_shader[al_max_num_lights()];
-  ShaderProgram lighting_mesh_shader[al_max_num_lights()];
-  ShaderProgram lighting_tex_shader[al_max_num_lights()];
-  ShaderProgram lighting_material_shader[al_max_num_lights()];
-
-  int lighting_color_location[al_max_num_lights()];
-  int lighting_color_tint_location[al_max_num_lights()];
-  int lighting_mesh_tint_location[al_max_num_lights()];
-  int lighting_tex_tint_location[al_max_num_lights()];
-  int lighting_material_tint_location[al_max_num_lights()];
-
-  lighting_shader_uniforms lighting_color_uniforms[al_max_num_lights()];
-  lighting_shader_uniforms lighting_mesh_uniforms[al_max_num_lights()];
-  lighting_shader_uniforms lighting_tex_uniforms[al_max_num_lights()];
-  lighting_shader_uniforms lighting_material_uniforms[al_max_num_lights()];
-
   bool is_omni = false;
 
-  ShaderProgram omni_mesh_shader;
-  ShaderProgram omni_color_shader;
-  ShaderProgram omni_tex_shader;
-
-  int omni_color_location = 0;
-  int omni_color_tint_location = 0;
-  int omni_mesh_tint_location = 0;
-  int omni_tex_tint_location = 0;
+  // uniform locations of a default shader and the values last sent to it
+  struct default_shader_uniforms {
+    int color = -1;
+    int tint = -1;
+    int eye_sep = -1;
+    int foc_len = -1;
+    int normal_matrix = -1;
+    Color color_sent;
+    Color tint_sent;
+    float eye_sep_sent = 0;
+    float foc_len_sent = 0;
+    Matrix4f normal_matrix_sent;
+    bool valid = false;
+  };
 
-  ShaderProgram omni_lighting_color_shader[al_max_num_lights()];
-  ShaderProgram omni_lighting_mesh_shader[al_max_num_lights()];
-  ShaderProgram omni_lighting_tex_shader[al_max_num_lights()];
-  ShaderProgram omni_lighting_material_shader[al_max_num_lights()];
+  // default shaders indexed by [omni][number of lights, 0 without lighting]
+  // [coloring mode]. MATERIAL without lighting uses the UNIFORM shader.
+  static constexpr int num_default_types = 4;
+  ShaderProgram default_shaders[2][al_max_num_lights() + 1][num_default_types];
+  default_shader_uniforms default_uniforms[2][al_max_num_lights() + 1]
+                                          [num_default_types];
+  default_shader_uniforms *current_uniforms = nullptr;
 
-  int omni_lighting_color_location[al_max_num_lights()];
-  int omni_lighting_color_tint_location[al_max_num_lights()];
-  int omni_lighting_mesh_tint_location[al_max_num_lights()];
-  int omni_lighting_tex_tint_location[al_max_num_lights()];
-  int omni_lighting_material_tint_location[al_max_num_lights()];
+  // light and material values shared by all lighting shaders
+  BufferObject lighting_buffer;
+  lighting_block lighting_block_sent;
+  bool lighting_block_valid = false;
 
-  lighting_shader_uniforms omni_lighting_color_uniforms[al_max_num_lights()];
-  lighting_shader_uniforms omni_lighting_mesh_uniforms[al_max_num_lights()];
-  lighting_shader_uniforms omni_lighting_tex_uniforms[al_max_num_lights()];
-  lighting_shader_uniforms omni_lighting_material_uniforms[al_max_num_lights()];
+  void update_lighting_block();
 
   Lens mLens;
   float mEye = 0.0f;
+
+  RenderQueue *mQueue = nullptr;
 };
 
 }  // namespace al
@@ -0,0 +1,114 @@
+#ifndef INCLUDE_AL_IMAGEOPS_HPP
+#define INCLUDE_AL_IMAGEOPS_HPP
+
+/*  Allocore --
+  Multimedia / virtual environment application class library
+
+  File description:
+  Pixel conversions, flips and mipmap generation for 8-bit images
+
+  The kernels work on tightly packed 8-bit pixels, such as Image::array(),
+  and modify them in place where the output is no larger than the input.
+  Large images are split by rows or pixels across threads with parallelFor
+  and the inner loops use SSE2 when available.
+
+  File author(s):
+  AlloSphere Research Group
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "al/graphics/al_Image.hpp"
+
+namespace al {
+
+/// Filter used to shrink images
+/// @ingroup Graphics
+enum class ImageFilter {
+  BOX,     ///< average of 2x2 blocks, only halves dimensions
+  LANCZOS  ///< windowed sinc with 3 lobes, any size
+};
+
+/// Flip rows of an image upside down in place
+/// @ingroup Graphics
+void flipVertical(uint8_t *pixels, unsigned width, unsigned height,
+                  unsigned channels = 4);
+void flipVertical(Image &img);
+
+/// Mirror columns of an image in place
+/// @ingroup Graphics
+void flipHorizontal(uint8_t *pixels, unsigned width, unsigned height,
+                    unsigned channels = 4);
+void flipHorizontal(Image &img);
+
+/// Multiply color of RGBA pixels by their alpha in place
+/// @ingroup Graphics
+void premultiplyAlpha(uint8_t *rgba, size_t count);
+void premultiplyAlpha(Image &img);
+
+/// Divide color of premultiplied RGBA pixels by their alpha in place
+
+/// Pixels with zero alpha become black.
+/// @ingroup Graphics
+void unpremultiplyAlpha(uint8_t *rgba, size_t count);
+void unpremultiplyAlpha(Image &img);
+
+/// Swap red and blue of 4 channel pixels, converting RGBA <-> BGRA in place
+/// @ingroup Graphics
+void swapRedBlue(uint8_t *pixels, size_t count);
+void swapRedBlue(Image &img);
+
+/// Drop alpha of count RGBA pixels
+
+/// dst may equal src to convert in place; the first 3 * count bytes then
+/// hold the result.
+/// @ingroup Graphics
+void rgbaToRGB(const uint8_t *src, uint8_t *dst, size_t count);
+
+/// Add constant alpha to count RGB pixels
+
+/// dst may equal src to convert in place if it has room for 4 * count bytes.
+/// @ingroup Graphics
+void rgbToRGBA(const uint8_t *src, uint8_t *dst, size_t count,
+               uint8_t alpha = 255);
+
+/// Convert pixels in a buffer from RGBA to RGB, shrinking it
+void rgbaToRGB(std::vector<uint8_t> &pixels);
+
+/// Convert pixels in a buffer from RGB to RGBA, growing it
+void rgbToRGBA(std::vector<uint8_t> &pixels, uint8_t alpha = 255);
+
+/// Halve width and height by averaging 2x2 blocks
+
+/// The result is max(1, width / 2) by max(1, height / 2) pixels, the sizes
+/// of the next mipmap level. With an odd width or height, the last output
+/// column or row averages the remaining 3 columns or rows.
+/// @ingroup Graphics
+void downsample2x(const uint8_t *src, unsigned width, unsigned height,
+                  uint8_t *dst, unsigned channels = 4);
+
+/// Resize with a separable Lanczos filter
+
+/// Straight alpha should be premultiplied first to avoid dark fringes.
+/// @ingroup Graphics
+void resampleLanczos(const uint8_t *src, unsigned width, unsigned height,
+                     uint8_t *dst, unsigned dstWidth, unsigned dstHeight,
+                     unsigned channels = 4);
+
+/// Resize an RGBA image with a Lanczos filter
+void resampleLanczos(const Image &src, Image &dst, unsigned width,
+                     unsigned height);
+
+/// Generate the levels of a mipmap chain below an RGBA image
+
+/// levels[0] is the level 1 of base, with half its size, and the last level
+/// is 1x1. Each level is filtered from the previous one.
+/// @ingroup Graphics
+void generateMipmaps(const Image &base, std::vector<Image> &levels,
+                     ImageFilter filter = ImageFilter::BOX);
+
+}  // namespace al
+
+#endif
@@ -126,6 +126,40 @@ public:
   /// Convert triangle strip to triangles
   void toTriangles();
 
+  /// Average cache miss ratio (ACMR) of the triangles
+
+  /// Simulates a FIFO post-transform vertex cache and returns the number of
+  /// vertex shader invocations per triangle: 3 is the worst case, about 0.5
+  /// is ideal for regular grids. Only indexed triangles are measured;
+  /// anything else returns 3.
+  ///
+  /// @param[in] cacheSize  number of entries in the simulated cache
+  float vertexCacheMissRatio(unsigned cacheSize = 16) const;
+
+  /// ACMR before and after optimizeForCache()
+  struct CacheStats {
+    float acmrBefore = 3;
+    float acmrAfter = 3;
+  };
+
+  /// Reorder triangles and vertices for the GPU vertex caches
+
+  /// Triangle strips are first converted to triangles and non-indexed meshes
+  /// are compressed. Triangles are then reordered with Forsyth's linear-speed
+  /// vertex cache algorithm. When sortOverdraw is set, runs of triangles are
+  /// then sorted so that outward-facing clusters are drawn first, which
+  /// reduces overdraw of convex-ish objects at a small cost in ACMR. Finally
+  /// vertices are renumbered in order of first use so that vertex fetch is
+  /// sequential; all populated attribute buffers are permuted to match.
+  /// Nothing is reordered if a populated attribute buffer does not have one
+  /// element per vertex, or an index is out of range.
+  ///
+  /// @param[in] sortOverdraw  whether to sort triangle clusters for overdraw
+  /// @param[in] cacheSize     cache size used to measure ACMR
+  /// \returns ACMR before and after optimization
+  CacheStats optimizeForCache(bool sortOverdraw = false,
+                              unsigned cacheSize = 16);
+
   /// Reset all buffers
   Mesh &reset();
 
@@ -172,6 +206,29 @@ public:
   ///                  based on face areas
   void generateNormals(bool normalize = true, bool equalWeightPerFace = false);
 
+  /// Weighting of face normals when averaging them into vertex normals
+  enum NormalWeighting {
+    AREA_WEIGHTED,  ///< weight by face area
+    EQUAL_WEIGHTED, ///< weight each face equally
+    ANGLE_WEIGHTED  ///< weight by the face's interior angle at the vertex
+  };
+
+  /// Generates averaged vertex normals using several threads
+
+  /// This is intended for large triangle meshes. Face normals are computed
+  /// in parallel, then each vertex sums the normals of its faces through a
+  /// vertex-to-face adjacency table, so no two threads write the same
+  /// normal. Faces are summed in index order, so area and equal weighting of
+  /// indexed triangles give the same result as generateNormals(). Triangle
+  /// strips and non-indexed meshes are weighted the same way; other
+  /// primitives fall back to generateNormals().
+  ///
+  /// @param[in] weighting    how face normals are weighted
+  /// @param[in] normalize    whether to normalize normals
+  /// @param[in] numThreads   number of threads, 0 = hardware concurrency
+  void generateNormalsParallel(NormalWeighting weighting = AREA_WEIGHTED,
+                               bool normalize = true, unsigned numThreads = 0);
+
   /// Invert direction of normals
   void invertNormals();
 
@@ -0,0 +1,144 @@
+#ifndef INCLUDE_AL_MESHFILE_HPP
+#define INCLUDE_AL_MESHFILE_HPP
+
+/*  Allocore --
+  Multimedia / virtual environment application class library
+
+  File description:
+  Compact binary container for Mesh buffers
+
+  The file starts with a MeshFileHeader, followed by one MeshFileArray per
+  populated Mesh buffer, followed by the array payloads. Payloads start on
+  16 byte boundaries so that raw arrays can be copied straight from a memory
+  mapped file into the Mesh's vectors. All values are little-endian and are
+  byte swapped when read or written on big-endian hosts.
+
+  File author(s):
+  AlloSphere Research Group
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "al/graphics/al_Mesh.hpp"
+
+namespace al {
+
+/// Header at the start of a binary mesh file
+struct MeshFileHeader {
+  char magic[4];        ///< "ALMF"
+  uint32_t version;     ///< format version, currently 1
+  uint32_t primitive;   ///< Mesh::Primitive
+  uint32_t arrayCount;  ///< number of MeshFileArray entries that follow
+};
+
+/// Description of one stored Mesh buffer
+struct MeshFileArray {
+  enum Attribute : uint32_t {
+    VERTICES = 0,
+    NORMALS,
+    COLORS,
+    TEXCOORD1S,
+    TEXCOORD2S,
+    TEXCOORD3S,
+    INDICES
+  };
+
+  enum Encoding : uint32_t {
+    RAW = 0,       ///< 32-bit floats or indices as stored in Mesh
+    UNORM16,       ///< 16-bit, value = offset + scale * q / 65535
+    SNORM16,       ///< 16-bit, value = q / 32767
+    UNORM8,        ///< 8-bit, value = q / 255
+    DELTA_VARINT   ///< zigzag delta from previous index, LEB128 varint
+  };
+
+  uint32_t attribute;   ///< which Mesh buffer
+  uint32_t encoding;    ///< how elements are stored
+  uint32_t count;       ///< number of elements
+  uint32_t components;  ///< scalars per element
+  uint64_t offset;      ///< byte offset of payload from start of file
+  uint64_t bytes;       ///< size of payload in bytes
+  float scale[4];       ///< per-component dequantization scale
+  float bias[4];        ///< per-component dequantization offset
+};
+
+/// Options for writing binary mesh files
+struct MeshFileOptions {
+  bool quantizeVertices = false;   ///< 16 bits per component within bounds
+  bool quantizeNormals = false;    ///< 16 bits per component
+  bool quantizeColors = false;     ///< 8 bits per component
+  bool quantizeTexCoords = false;  ///< 16 bits per component within bounds
+  bool compressIndices = false;    ///< delta + varint encoded indices
+};
+
+/// Save mesh to a binary mesh file
+
+/// @param[in] mesh      mesh to save
+/// @param[in] filePath  path of file to save to
+/// @param[in] options   quantization and compression options
+/// \returns true on successful save, otherwise false
+bool saveMeshFile(const Mesh &mesh, const std::string &filePath,
+                  const MeshFileOptions &options = MeshFileOptions());
+
+/// Load a binary mesh file into a mesh
+
+/// The file is memory mapped and each array is copied or decoded once into
+/// the mesh's buffers. Buffers not in the file are cleared.
+///
+/// @param[out] mesh      mesh to load into
+/// @param[in]  filePath  path of file to load
+/// \returns true on successful load, otherwise false
+bool loadMeshFile(Mesh &mesh, const std::string &filePath);
+
+/// Incremental binary mesh file loader
+
+/// Reads a mesh file a bounded number of bytes at a time so that large
+/// assets can be brought in over several frames without a staging copy of
+/// the whole file.
+///
+/// @ingroup Graphics
+class MeshFileReader {
+public:
+  MeshFileReader() {}
+  ~MeshFileReader() { close(); }
+
+  /// Open file and read its array table
+
+  /// \returns true on success, otherwise false
+  bool open(const std::string &filePath);
+
+  /// Decode up to maxBytes more of the file into mesh
+
+  /// The mesh must be the same across calls between open() and done().
+  /// \returns false once the whole file has been read or on error
+  bool readChunk(Mesh &mesh, size_t maxBytes = 1 << 20);
+
+  /// Whether all arrays have been read
+  bool done() const { return mArray >= mArrays.size(); }
+
+  /// Whether a read error occurred
+  bool failed() const { return mFailed; }
+
+  /// Close file
+  void close();
+
+  const MeshFileHeader &header() const { return mHeader; }
+  const std::vector<MeshFileArray> &arrays() const { return mArrays; }
+
+private:
+  FILE *mFile = nullptr;
+  MeshFileHeader mHeader;
+  std::vector<MeshFileArray> mArrays;
+  std::vector<uint8_t> mStaging;  // partial varints carried between chunks
+  size_t mArray = 0;              // array being read
+  uint64_t mArrayBytes = 0;       // payload bytes consumed of current array
+  size_t mElement = 0;            // scalars decoded in current array
+  int64_t mPrevIndex = 0;         // delta decoder state
+  bool mFailed = false;
+};
+
+}  // namespace al
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef INCLUDE_AL_MESHLOD_HPP
+#define INCLUDE_AL_MESHLOD_HPP
+
+/*  Allocore --
+  Multimedia / virtual environment application class library
+
+  File description:
+  Mesh simplification and level-of-detail selection
+
+  Simplification collapses edges in order of quadric error (Garland and
+  Heckbert, "Surface Simplification Using Quadric Error Metrics"). Collapses
+  move a vertex onto one of its neighbours, so every remaining vertex keeps
+  its original attributes. Vertices on attribute seams (several vertices
+  sharing one position) are kept, and open borders only shrink along
+  themselves.
+
+  File author(s):
+  AlloSphere Research Group
+*/
+
+#include <vector>
+
+#include "al/graphics/al_Mesh.hpp"
+#include "al/graphics/al_Viewpoint.hpp"
+
+namespace al {
+
+/// Simplify a triangle mesh using quadric error metrics
+
+/// Triangle strips are converted to triangles and non-indexed meshes are
+/// compressed first. Unreferenced vertices are removed afterwards.
+///
+/// @param[in,out] mesh             mesh to simplify
+/// @param[in]     targetTriangles  number of triangles to stop at
+/// \returns estimated geometric error of the result, in mesh units
+float simplifyMesh(Mesh &mesh, size_t targetTriangles);
+
+/// Chain of progressively simplified meshes
+
+/// Level 0 is the source mesh, each further level has fewer triangles. A
+/// level is chosen per view from the projected size of its error on screen.
+///
+/// @ingroup Graphics
+class MeshLOD {
+public:
+  /// Generate levels from a source mesh
+
+  /// @param[in] src     source mesh; level 0 is a copy of it
+  /// @param[in] ratios  triangle count of each further level relative to src
+  void generate(const Mesh &src,
+                const std::vector<float> &ratios = {0.5f, 0.25f, 0.125f});
+
+  /// Generate LOD chains for many meshes in parallel
+
+  /// @param[out] lods        one chain per source, resized to match
+  /// @param[in]  sources     source meshes
+  /// @param[in]  ratios      as in generate()
+  /// @param[in]  numThreads  number of threads, 0 = hardware concurrency
+  static void generate(std::vector<MeshLOD> &lods,
+                       const std::vector<const Mesh *> &sources,
+                       const std::vector<float> &ratios = {0.5f, 0.25f,
+                                                           0.125f},
+                       unsigned numThreads = 0);
+
+  /// Number of levels
+  size_t levels() const { return mLevels.size(); }
+
+  /// Get mesh of a level
+  const Mesh &level(size_t i) const { return mLevels[i]; }
+  Mesh &level(size_t i) { return mLevels[i]; }
+
+  /// Geometric error of a level, in mesh units
+  float error(size_t i) const { return mErrors[i]; }
+
+  /// Center of the source mesh's bounding sphere
+  const Vec3f &center() const { return mCenter; }
+
+  /// Radius of the source mesh's bounding sphere
+  float radius() const { return mRadius; }
+
+  /// Projected height in pixels of a length at a position
+
+  /// @param[in] length          length in world units
+  /// @param[in] position        world position of the object
+  /// @param[in] viewpoint       camera
+  /// @param[in] viewportHeight  height of the viewport in pixels
+  static float projectedSize(float length, const Vec3d &position,
+                             const Viewpoint &viewpoint,
+                             float viewportHeight);
+
+  /// Choose the coarsest level whose error is below a pixel threshold
+
+  /// @param[in] viewpoint       camera
+  /// @param[in] viewportHeight  height of the viewport in pixels
+  /// @param[in] modelPose       pose of the object in the world
+  /// @param[in] scale           uniform scale applied to the mesh
+  /// @param[in] maxPixelError   largest acceptable error on screen, pixels
+  size_t select(const Viewpoint &viewpoint, float viewportHeight,
+                const Pose &modelPose, float scale = 1,
+                float maxPixelError = 1) const;
+
+private:
+  std::vector<Mesh> mLevels;
+  std::vector<float> mErrors;
+  Vec3f mCenter{0, 0, 0};
+  float mRadius = 0;
+};
+
+}  // namespace al
+
+#endif
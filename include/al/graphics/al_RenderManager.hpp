@@ -1,6 +1,8 @@
 #ifndef INCLUDE_AL_RENDER_MANAGER_HPP
 #define INCLUDE_AL_RENDER_MANAGER_HPP
 
+#include <cstring>
+#include <type_traits>
 #include <unordered_map>
 
 #include "al/graphics/al_EasyFBO.hpp"
@@ -82,6 +84,11 @@ private:
  *  - keeps track of current shader
  *  - get & cache location and set values of uniforms for model, view,
 projection matrix
+ *  - remembers the values last sent to each program and skips binding a
+ *    program that is already bound or uploading a value it already holds.
+ *    The bound program is tracked here rather than asked of GL. Setting
+ *    those uniforms or calling glUseProgram directly, bypassing
+ *    RenderManager and ShaderProgram, leaves the cache stale
  * 4. drawing mesh
  *  - sending vertex position/color/normal/texcoord to bound shader
  *  - mesh can be regular cpu-side al::Mesh
@@ -97,6 +104,16 @@ projection matrix
 */
 class RenderManager {
 public:
+  /// Counts of GL state changes made and skipped as redundant
+  struct Stats {
+    unsigned long programBinds = 0;
+    unsigned long programBindsElided = 0;
+    unsigned long uniformUploads = 0;
+    unsigned long uniformUploadsElided = 0;
+    unsigned long blockUploads = 0;
+    unsigned long blockUploadsElided = 0;
+  };
+
   /// Multiply current matrix
   void multModelMatrix(const Matrix4f &m) {
     mModelStack.mult(m);
@@ -279,6 +296,10 @@ public:
     camera(v);
   }
 
+  /// Counts of state changes since construction or last resetStats()
+  const Stats &stats() const { return mStats; }
+  void resetStats() { mStats = Stats(); }
+
   virtual void update();
   void draw(VAOMesh &mesh);
   void draw(EasyVAO &vao);
@@ -286,10 +307,41 @@ public:
   void draw(Mesh &&mesh);
 
 protected:
+  // matrix uniform locations of a program and the values last sent to it
+  struct ProgramState {
+    unsigned long generation = 0;
+    int modelViewLoc = -1;
+    int projLoc = -1;
+    Matrix4f modelView;
+    Matrix4f proj;
+    bool valid = false;
+  };
+
+  /// Copy value into shadow if they differ, returns whether it was copied
+
+  /// Counts the upload or its elision. Pass force to copy regardless, when
+  /// the shadow does not hold a sent value yet.
+  template <class T>
+  bool uniformChanged(T &shadow,
+                      const typename std::remove_reference<T>::type &value,
+                      bool force = false) {
+    if (!force && std::memcmp(&shadow, &value, sizeof(T)) == 0) {
+      ++mStats.uniformUploadsElided;
+      return false;
+    }
+    shadow = value;
+    ++mStats.uniformUploads;
+    return true;
+  }
+
   ShaderProgram *mShaderPtr = nullptr;
-  std::unordered_map<unsigned int, int> modelviewLocs;
-  std::unordered_map<unsigned int, int> projLocs;
+  // program last bound here, and ShaderProgram::binds() right after
+  unsigned int mBoundProgram = 0;
+  unsigned long mBindCount = 0;
+  std::unordered_map<unsigned int, ProgramState> mProgramStates;
+  ProgramState *mProgramState = nullptr;
   bool mShaderChanged = false;
+  Stats mStats;
 
   // let matrix stack be local to objects
   MatrixStack mViewStack;
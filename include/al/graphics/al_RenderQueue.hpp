@@ -0,0 +1,140 @@
+#ifndef INCLUDE_AL_RENDERQUEUE_HPP
+#define INCLUDE_AL_RENDERQUEUE_HPP
+
+/*  Allocore --
+  Multimedia / virtual environment application class library
+
+  File description:
+  Recorded list of draws that can be replayed for several views
+
+  Multi-view renderers (omni cube faces, per projection rendering, stereo)
+  draw the same scene once per view. Recording the scene once per frame and
+  replaying it per view skips repeating the scene traversal, matrix math and
+  mesh uploads; only the view and projection change between replays.
+
+  File author(s):
+  AlloSphere Research Group
+*/
+
+#include <memory>
+#include <vector>
+
+#include "al/graphics/al_Graphics.hpp"
+#include "al/graphics/al_VAOMesh.hpp"
+#include "al/math/al_Matrix4.hpp"
+#include "al/math/al_Vec.hpp"
+#include "al/types/al_Color.hpp"
+
+namespace al {
+
+/**
+ * @brief Deferred draw queue recorded from Graphics
+ * @ingroup Graphics
+ *
+ * Between Graphics::beginRecording() and Graphics::endRecording() draws and
+ * clears are stored here instead of reaching GL. Each draw keeps its mesh,
+ * model matrix and Graphics::DrawState. Draws made with the view or
+ * projection matrix in effect when recording began follow the view and
+ * projection of the Graphics at replay; draws that set their own keep them.
+ *
+ * VAOMesh and EasyVAO are referenced and must outlive the replays. Mesh is
+ * copied and uploaded once, on the first replay after recording. The lights
+ * in use are part of the draw state, so the lighting block is sent again
+ * during a replay only where they differ between draws. Uniforms set
+ * directly on custom shaders, the global ambient light, bound textures and
+ * GL state changed outside Graphics are not recorded; replays see their
+ * current values.
+ *
+ * Culling and sorting depend on the view, so they cannot be done once while
+ * recording. Instead draws can be bounded by a sphere with beginBounds(),
+ * and each replay skips bounded draws outside its frustum and orders
+ * sortable ones from its own eye.
+ */
+class RenderQueue {
+public:
+  struct Command {
+    enum Type { DRAW_VAO_MESH, DRAW_EASY_VAO, DRAW_MESH, CLEAR_COLOR,
+                CLEAR_DEPTH };
+
+    Type type;
+    VAOMesh *vaoMesh = nullptr;
+    EasyVAO *easyVAO = nullptr;
+    unsigned mesh = 0;  // index of copied mesh, for DRAW_MESH
+    Matrix4f model, view, proj;
+    bool ownView = false;
+    bool ownProj = false;
+    int bounds = -1;  // index into the bounds, -1 if unbounded
+    Graphics::DrawState state;
+    Color clearColor;
+    float clearDepth = 1;
+  };
+
+  /// Remove all commands, keeping allocated meshes for reuse
+  void clear();
+
+  /// Number of recorded commands
+  size_t size() const { return mCommands.size(); }
+  bool empty() const { return mCommands.empty(); }
+
+  const std::vector<Command> &commands() const { return mCommands; }
+
+  /// Number of recorded meshes uploaded to the GPU since construction
+  unsigned long uploads() const { return mUploads; }
+
+  /// Number of commands skipped by culling in the last replay
+  size_t culledCount() const { return mCulledCount; }
+
+  /// Bound the draws recorded until endBounds() by a sphere
+
+  /// The sphere is given in the model space of g. Replays skip the draws when
+  /// their view frustum misses it. Consecutive bounded groups begun with
+  /// sortable set are drawn farthest first from the eye of each replay,
+  /// keeping their recorded order at equal distance. Bounds do not nest.
+  void beginBounds(const Graphics &g, const Vec3f &center, float radius,
+                   bool sortable = false);
+  void endBounds();
+
+  /// Issue the recorded commands with the view and projection of g
+
+  /// The model matrix stacks and draw state of g are restored afterwards.
+  ///
+  void replay(Graphics &g);
+
+  // called by Graphics while recording
+  void begin(const Graphics &g);
+  void add(const Graphics &g, VAOMesh &mesh);
+  void add(const Graphics &g, EasyVAO &vao);
+  void add(const Graphics &g, const Mesh &mesh);
+  void addClearColor(const Color &c);
+  void addClearDepth(float d);
+
+private:
+  // sphere around commands [first, end), in world space
+  struct Bounds {
+    Vec3f center;
+    float radius;
+    bool sortable;
+    unsigned first, end;
+  };
+
+  Command &addDraw(const Graphics &g, Command::Type type);
+  void issue(Graphics &g, const Command &c, const Matrix4f &view,
+             const Matrix4f &proj);
+  void cullAndSort(const Matrix4f &view, const Matrix4f &proj);
+
+  std::vector<Command> mCommands;
+  std::vector<Bounds> mBounds;
+  int mOpenBounds = -1;
+  std::vector<unsigned> mOrder, mVisible;  // scratch for replays
+  std::vector<float> mDistances;
+  size_t mCulledCount = 0;
+  std::vector<std::unique_ptr<VAOMesh>> mMeshes;
+  unsigned mMeshCount = 0;
+  bool mUploaded = false;
+  unsigned long mUploads = 0;
+  Matrix4f mBaseView, mBaseProj;
+};
+
+} // namespace al
+
+#endif
@@ -346,11 +346,24 @@ class ShaderProgram : public ShaderBase {
 
   static void use(unsigned programID);
 
+  /// Returns id of the program bound in the current GL context
+  static unsigned current();
+
+  /// Returns the number of programs bound through use(), in any context
+  static unsigned long binds();
+
+  /// Returns a number that changes every time the program is linked
+
+  /// Linking resets uniform values, so values cached for a program are only
+  /// valid while its generation stays the same.
+  unsigned long generation() const { return mGeneration; }
+
  protected:
   // Graphics::Primitive mInPrim, mOutPrim;  // IO primitives for geometry
   // shaders unsigned int mOutVertices;
   std::string mVertSource, mFragSource, mGeomSource;
   mutable std::unordered_map<std::string, int> mUniformLocs, mAttribLocs;
+  mutable unsigned long mGeneration = 0;
   // bool mActive;
 
   virtual void get(int pname, void *params) const;
@@ -45,6 +45,8 @@
   Keehong Youn, 2017, younkeehong@gmail.com
 */
 
+#include <cstddef>
+
 #include "al/graphics/al_GPUObject.hpp"
 #include "al/graphics/al_OpenGL.hpp"
 // #include "al/types/al_Color.hpp"
@@ -308,6 +310,13 @@ class Texture : public GPUObject {
   void submit(const void *pixels, unsigned int format, unsigned int type);
   void submit(const void *pixels) { submit(pixels, format(), type()); }
 
+  /// Copy texels from the buffer bound to GL_PIXEL_UNPACK_BUFFER
+
+  /// @param[in] offset   byte offset of the first texel in the bound buffer
+  /// @param[in] format   pixel format of the buffer contents
+  /// @param[in] type     pixel component type of the buffer contents
+  void submitFromBuffer(size_t offset, unsigned int format, unsigned int type);
+
   // void submit(std::vector<Colori> const& pixels) {
   //   submit(pixels.data(), Texture::RGBA, Texture::UBYTE);
   // }
@@ -348,6 +357,8 @@ class Texture : public GPUObject {
   void update_filter();
   void update_wrap();
   void update_mipmap();
+  void submit_pixels(const void *pixels, unsigned int format,
+                     unsigned int type);
 
   // Pattern for setting a variable that when changed sets a notification flag
   // if v != var, update var and set flag to true
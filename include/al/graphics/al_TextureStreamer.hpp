@@ -0,0 +1,199 @@
+#ifndef INCLUDE_AL_TEXTURESTREAMER_HPP
+#define INCLUDE_AL_TEXTURESTREAMER_HPP
+
+/*  Allocore --
+  Multimedia / virtual environment application class library
+
+  File description:
+  Asynchronous image decoding and budgeted texture uploads
+
+  Texture::submit and Image::load run on the render thread, so a frame that
+  loads a large image or receives a new video frame stalls. TextureStreamer
+  decodes images on worker threads into pooled staging memory and uploads a
+  limited number of bytes per frame through a TextureUploader, by default a
+  ring of pixel buffer objects guarded by fences.
+
+  File author(s):
+  AlloSphere Research Group
+*/
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "al/graphics/al_OpenGL.hpp"
+#include "al/graphics/al_Texture.hpp"
+
+namespace al {
+
+/// Pixels ready to be copied to a texture
+struct TextureUpload {
+  Texture *texture;
+  const void *pixels;
+  size_t bytes;
+  unsigned width, height;
+  unsigned format, type;
+};
+
+/**
+ * @brief Copies staged pixels to textures
+ * @ingroup Graphics
+ *
+ * TextureStreamer hands uploads to a TextureUploader on the render thread.
+ * Subclass to change how pixels reach the GPU, or to test scheduling without
+ * a graphics context.
+ */
+class TextureUploader {
+public:
+  virtual ~TextureUploader() {}
+
+  /// Called once per TextureStreamer::update() before any upload
+  virtual void beginFrame() {}
+
+  /// Copy pixels to the texture, creating or resizing it as needed
+
+  /// Returns false if the upload can't be started this frame; it is then
+  /// retried on the next update. The pixels are only valid during the call.
+  virtual bool upload(const TextureUpload &u) = 0;
+};
+
+/**
+ * @brief Uploads through a ring of pixel buffer objects
+ * @ingroup Graphics
+ *
+ * Pixels are copied into the next buffer of the ring, which the driver then
+ * transfers to the texture without blocking the render thread. A fence per
+ * buffer tells when it can be written again; if the next buffer is still in
+ * flight the upload is deferred instead of waiting.
+ */
+class PBOUploader : public TextureUploader {
+public:
+  PBOUploader(unsigned numBuffers = 3);
+  virtual ~PBOUploader();
+
+  virtual bool upload(const TextureUpload &u) override;
+
+  /// Release buffers and fences. Requires the graphics context; the
+  /// destructor only calls it while a window's context is current.
+  void destroy();
+
+  /// Create or resize texture to match an upload
+  static void prepare(const TextureUpload &u);
+
+private:
+  struct Slot {
+    GLuint id = 0;
+    size_t capacity = 0;
+    GLsync fence = nullptr;
+  };
+
+  std::vector<Slot> mSlots;
+  unsigned mNext = 0;
+};
+
+/**
+ * @brief Streams images to textures in the background
+ * @ingroup Graphics
+ *
+ * load() queues an image file to be decoded by a worker thread and submit()
+ * copies client pixels to staging memory right away. update(), called once
+ * per frame from the render thread, uploads staged images in the order they
+ * were queued until the per-frame byte budget is spent. A single image
+ * larger than the budget is still uploaded, alone in its frame.
+ *
+ * When an image is queued for a texture that already has one pending, the
+ * older one is dropped: only the latest image of each texture is uploaded.
+ * Textures must outlive their pending images or be passed to cancel().
+ *
+ * Decoded images are RGBA with unsigned byte components.
+ */
+class TextureStreamer {
+public:
+  /**
+   * @brief Start the decoding threads
+   * @param numThreads number of worker threads, at least one
+   */
+  TextureStreamer(unsigned numThreads = 1);
+  ~TextureStreamer();
+
+  /// Set uploader. A PBOUploader is created on the first update otherwise.
+  void uploader(std::shared_ptr<TextureUploader> u) { mUploader = u; }
+
+  /// Set maximum number of bytes uploaded per update, 64 MB by default
+  void budget(size_t bytes) { mBudget = bytes; }
+  size_t budget() const { return mBudget; }
+
+  /// Decode image file on a worker thread and upload it to tex
+  void load(Texture &tex, const std::string &path);
+
+  /// Copy pixels to staging memory and upload them to tex
+  void submit(Texture &tex, const void *pixels, unsigned width,
+              unsigned height, unsigned format = Texture::RGBA,
+              unsigned type = Texture::UBYTE);
+
+  /// Drop images pending for tex
+  void cancel(Texture &tex);
+
+  /// Upload staged images within the budget. Returns bytes uploaded.
+  size_t update();
+
+  /// Block until all queued files have been decoded
+  void waitDecoded();
+
+  /// Number of images queued, decoding or waiting for upload
+  size_t pending();
+
+  /// Total bytes uploaded
+  uint64_t uploadedBytes() const { return mUploadedBytes; }
+
+  /// Number of files that failed to decode
+  unsigned failed();
+
+private:
+  struct Job {
+    Texture *texture;
+    std::string path;
+    uint64_t seq;
+  };
+
+  struct Staged {
+    Texture *texture;
+    std::vector<uint8_t> data;
+    unsigned width, height;
+    unsigned format, type;
+    uint64_t seq;
+  };
+
+  void work();
+  // the following require mMutex to be locked
+  bool superseded(const Texture *tex, uint64_t seq) const;
+  std::vector<uint8_t> acquire(size_t bytes);
+  void release(std::vector<uint8_t> &buffer);
+
+  std::shared_ptr<TextureUploader> mUploader;
+  size_t mBudget = 64 * 1024 * 1024;
+  uint64_t mUploadedBytes = 0;
+
+  std::mutex mMutex;
+  std::condition_variable mJobsChanged;
+  std::condition_variable mDecodeDone;
+  std::deque<Job> mJobs;
+  std::deque<Staged> mStaged;
+  std::unordered_map<const Texture *, uint64_t> mLatest;
+  std::vector<std::vector<uint8_t>> mPool;
+  uint64_t mSeq = 0;
+  unsigned mDecoding = 0;
+  unsigned mFailed = 0;
+  bool mStop = false;
+  std::vector<std::thread> mThreads;
+};
+
+} // namespace al
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef INCLUDE_AL_MAPPEDFILE_HPP
+#define INCLUDE_AL_MAPPEDFILE_HPP
+
+/*  Allocore --
+  Multimedia / virtual environment application class library
+
+  File description:
+  Read-only memory mapping of a whole file
+
+  File author(s):
+  AlloSphere Research Group
+*/
+
+#include <cstdint>
+#include <string>
+
+namespace al {
+
+/**
+ * @brief Read-only memory map of a whole file
+ * @ingroup IO
+ *
+ * Mapping lets large binary files be read without copying them through
+ * stream buffers; pages are loaded on first access.
+ */
+class MappedFile {
+public:
+  MappedFile() {}
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile() { close(); }
+
+  /// Map file. Returns false if it can't be opened or is empty.
+  bool open(const std::string &path);
+
+  /// Unmap file
+  void close();
+
+  const uint8_t *data() const { return mData; }
+  size_t size() const { return mSize; }
+
+  /// Last modification time in nanoseconds since 1970, at the resolution
+  /// of the file system
+  int64_t modified() const { return mModified; }
+
+  /// Identity of the file on its volume (inode or file index). A file
+  /// replaced by renaming another over it gets a new one.
+  uint64_t fileId() const { return mFileId; }
+
+private:
+  const uint8_t *mData = nullptr;
+  size_t mSize = 0;
+  int64_t mModified = 0;
+  uint64_t mFileId = 0;
+  void *mFile = nullptr;     // Windows file handle
+  void *mMapping = nullptr;  // Windows mapping handle
+};
+
+}  // namespace al
+
+#endif
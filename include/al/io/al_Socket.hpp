@@ -133,6 +133,43 @@ public:
   /// will close and re-open the socket.
   void timeout(al_sec t);
 
+  /// Allow other sockets to bind to the same port
+  ///
+  /// Set before opening a server socket, so that several processes on one
+  /// host can receive the same broadcast or multicast datagrams.
+  void reuseAddress(bool enable);
+
+  /// Allow sending to broadcast addresses
+  void broadcast(bool enable);
+
+  /// Set the size in bytes of the buffer holding datagrams not yet received
+  ///
+  /// The system may grant less than asked for, up to a limit of its own;
+  /// receiveBufferSize() returns the size in effect.
+  void receiveBufferSize(int bytes);
+
+  /// Get the size in bytes of the receive buffer, 0 if not open
+  int receiveBufferSize() const;
+
+  /// Set the local interface, by its IP address, for multicast
+  ///
+  /// Set before opening a client socket to send multicast from this
+  /// interface. Groups joined afterwards are joined on this interface.
+  void multicastInterface(const std::string &address);
+
+  /// Set how many routers multicast datagrams sent may pass through
+  void multicastTTL(int hops);
+
+  /// Set whether multicast datagrams sent are also received on this host
+  void multicastLoop(bool enable);
+
+  /// Join a multicast group, called on an open server socket
+  bool joinMulticast(const std::string &group);
+
+  /// Whether address is an IPv4 multicast address, 224.0.0.0 to
+  /// 239.255.255.255
+  static bool isMulticast(const std::string &address);
+
   /// Read data from a network
 
   /// @param[in] buffer	A buffer to copy the received data into
@@ -511,6 +511,8 @@ inline Window::DisplayMode operator&(const Window::DisplayMode &a,
 void initializeWindowManager();
 void terminateWindowManager();
 float getCurrentWindowPixelDensity();
+/// Whether a window's graphics context is current on the calling thread
+bool hasCurrentWindowContext();
 
 }  // namespace al
 
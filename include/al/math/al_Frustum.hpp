@@ -42,6 +42,7 @@
   Lance Putnam, 2011, putnam.lance@gmail.com
 */
 
+#include "al/math/al_Mat.hpp"
 #include "al/math/al_Plane.hpp"
 #include "al/math/al_Vec.hpp"
 
@@ -120,6 +121,14 @@ class Frustum {
   ///
   void computePlanes();
 
+  /// Set corners and planes from a combined projection and view matrix
+
+  /// The frustum is the volume that the matrix maps onto the OpenGL clip
+  /// cube [-1, 1]^3. Passing projection * view * model gives the frustum in
+  /// model space.
+  template <class U>
+  void fromMatrix(const Mat<4, U>& projView);
+
  private:
   template <class Tf, class Tv>
   static Tv lerp(Tf f, const Tv& x, const Tv& y) {
@@ -153,6 +162,20 @@ void Frustum<T>::computePlanes() {
   pl[FARP].from3Points(ftr, ftl, fbl);
 }
 
+template <class T>
+template <class U>
+void Frustum<T>::fromMatrix(const Mat<4, U>& projView) {
+  Mat<4, T> inv(projView);
+  invert(inv);
+  for (int i = 0; i < 8; ++i) {
+    // corner order is ntl, ntr, nbl, nbr, ftl, ftr, fbl, fbr
+    Vec<4, T> ndc(i & 1 ? 1 : -1, i & 2 ? -1 : 1, i & 4 ? 1 : -1, 1);
+    Vec<4, T> p = inv * ndc;
+    (&ntl)[i] = p.template sub<3>() / p[3];
+  }
+  computePlanes();
+}
+
 template <class T>
 int Frustum<T>::testPoint(const Vec<3, T>& p) const {
   for (int i = 0; i < 6; ++i) {
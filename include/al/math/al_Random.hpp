@@ -61,6 +61,7 @@ namespace rnd {
 class LinCon;
 class MulLinCon;
 class Tausworthe;
+class Xoshiro128;
 template <class RNG>
 class Random;
 
@@ -318,6 +319,67 @@ class Tausworthe {
   void iterate();
 };
 
+/// xoshiro128** uniform pseudo-random number generator.
+
+/// This generator is about as fast as Tausworthe and of high quality. Its
+/// sequence can be advanced by 2^64 or 2^96 numbers at little cost, which
+/// splits it into streams that do not overlap, for instance one per thread.
+/// It is based on
+/// D. Blackman and S. Vigna, "Scrambled Linear Pseudorandom Number
+/// Generators", ACM Transactions on Mathematical Software, 47, 4 (2021).
+/// http://prng.di.unimi.it/
+///
+/// @ingroup allocore
+class Xoshiro128 {
+ public:
+  /// Default constructor uses a randomly generated seed
+  Xoshiro128() { seed(al::rnd::seed()); }
+
+  /// @param[in] seed    Initial seed value
+  Xoshiro128(uint32_t seed) { this->seed(seed); }
+
+  /// Generate next uniform random integer in [0, 2^32)
+  uint32_t operator()() {
+    uint32_t r = rotl(s[1] * 5, 7) * 9;
+    iterate();
+    return r;
+  }
+
+  /// Set seed
+  void seed(uint32_t v);
+
+  /// Set seed; the four values must not all be zero
+  void seed(uint32_t v1, uint32_t v2, uint32_t v3, uint32_t v4) {
+    s[0] = v1;
+    s[1] = v2;
+    s[2] = v3;
+    s[3] = v4;
+  }
+
+  /// Advance by 2^64 numbers
+  void jump() {
+    static const uint32_t poly[] = {0x8764000b, 0xf542d2d3, 0x6fa035c3,
+                                    0x77f2db5b};
+    jump(poly);
+  }
+
+  /// Advance by 2^96 numbers
+  void longJump() {
+    static const uint32_t poly[] = {0xb523952e, 0x0b6f099f, 0xccf5a0ef,
+                                    0x1c580662};
+    jump(poly);
+  }
+
+  /// Get state
+  const uint32_t* state() const { return s; }
+
+ private:
+  uint32_t s[4];
+  static uint32_t rotl(uint32_t x, int k) { return (x << k) | (x >> (32 - k)); }
+  void iterate();
+  void jump(const uint32_t* poly);
+};
+
 // Implementation_______________________________________________________________
 
 inline Tausworthe::Tausworthe() { seed(al::rnd::seed()); }
@@ -350,6 +412,45 @@ inline void Tausworthe::iterate() {
   s4 = ((s4 & 0xffffff80) << 13) ^ (((s4 << 3) ^ s4) >> 12);
 }
 
+inline void Xoshiro128::seed(uint32_t v) {
+  // SplitMix64 spreads the bits of the seed over the state
+  uint64_t x = v;
+  for (int i = 0; i < 4; i += 2) {
+    uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    s[i] = uint32_t(z);
+    s[i + 1] = uint32_t(z >> 32);
+  }
+  if (!(s[0] | s[1] | s[2] | s[3])) s[0] = 1;
+}
+
+inline void Xoshiro128::iterate() {
+  uint32_t t = s[1] << 9;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 11);
+}
+
+// The state after 2^k steps is a polynomial in the step applied to the
+// current state, so it is a sum of the states the next 128 steps pass by.
+inline void Xoshiro128::jump(const uint32_t* poly) {
+  uint32_t r[4] = {0, 0, 0, 0};
+  for (int i = 0; i < 4; ++i) {
+    for (int b = 0; b < 32; ++b) {
+      if (poly[i] & (1u << b)) {
+        for (int j = 0; j < 4; ++j) r[j] ^= s[j];
+      }
+      iterate();
+    }
+  }
+  seed(r[0], r[1], r[2], r[3]);
+}
+
 template <class RNG>
 template <int N, class T>
 void Random<RNG>::ball(T* point) {
@@ -0,0 +1,126 @@
+#ifndef INCLUDE_AL_RANDOM_BATCH_HPP
+#define INCLUDE_AL_RANDOM_BATCH_HPP
+
+/*  Allocore --
+  Multimedia / virtual environment application class library
+
+  File description:
+  Random numbers generated in bulk into arrays
+
+  RandomBatch runs eight xoshiro128** generators side by side, stepping
+  them together with SSE2, AVX2 or NEON integer instructions, and fills
+  whole arrays with uniform, normal, ball and sphere variates. The lanes
+  start 2^64 numbers apart, and a stream index moves all of them by
+  multiples of 2^96, so that each thread can own a generator whose
+  sequence does not overlap the others and does not depend on how the
+  work was scheduled.
+
+  File author(s):
+  AlloSphere Research Group
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+#include "al/math/al_Random.hpp"
+#include "al/math/al_Vec.hpp"
+
+namespace al {
+namespace rnd {
+
+/**
+ * @brief Fills arrays with random variates
+ * @ingroup Math
+ *
+ * Numbers come from one sequence, whatever the sizes of the arrays
+ * requested, so filling 100 then 28 values gives the same as filling 128
+ * at once. The sequence is the same with or without SIMD.
+@code
+    // one generator per thread, reproducible for a given seed
+    parallelFor(numChunks, [&](size_t begin, size_t end) {
+      for (size_t c = begin; c < end; ++c) {
+        rnd::RandomBatch rng(seed, c);
+        rng.normal(&data[c * chunkSize], chunkSize);
+      }
+    });
+@endcode
+ */
+class RandomBatch {
+ public:
+  /// Number of generators stepped together
+  static const int lanes = 8;
+
+  /// Default constructor uses a randomly generated seed
+  RandomBatch() { seed(al::rnd::seed()); }
+
+  /// @param[in] seed    Initial seed value
+  /// @param[in] stream  Index of an independent stream from the seed
+  RandomBatch(uint32_t seed, uint32_t stream = 0) { this->seed(seed, stream); }
+
+  /// Set seed and stream
+  RandomBatch &seed(uint32_t seed, uint32_t stream = 0);
+
+  /// Fills with uniform random integers in [0, 2^32)
+  void bits(uint32_t *out, size_t count);
+
+  /// Fills with uniform random in [0, 1), as Random::uniform
+  void uniform(float *out, size_t count) { uniform(out, count, 0.f, 1.f); }
+
+  /// Fills with uniform random in [lo, hi)
+  void uniform(float *out, size_t count, float lo, float hi);
+
+  /// Fills with uniform random in [-lim, lim)
+  void uniformS(float *out, size_t count, float lim = 1.f) {
+    uniform(out, count, -lim, lim);
+  }
+
+  /// Fills with normal variates
+  void normal(float *out, size_t count, float mean = 0.f,
+              float stddev = 1.f);
+
+  /// Fills with points within a ball
+  void ball(Vec3f *out, size_t count, float radius = 1.f);
+
+  /// Fills with points on a sphere
+  void sphere(Vec3f *out, size_t count, float radius = 1.f);
+
+  /// Randomly shuffles elements in array
+  template <class T>
+  void shuffle(T *arr, uint32_t len);
+
+ protected:
+  static const int bufferSize = 32 * lanes;
+
+  // next number of the sequence
+  uint32_t next() {
+    if (mPos == bufferSize) refill();
+    return mBuffer[mPos++];
+  }
+  // generates numSteps * lanes numbers into out
+  void generate(uint32_t *out, size_t numSteps);
+  void refill();
+  // slow path of the ziggurat, from a number that missed the fast one
+  float normalTail(uint32_t r);
+
+  // state of lane i is mState[0..3][i]
+  uint32_t mState[4][lanes];
+  uint32_t mBuffer[bufferSize];
+  int mPos;
+};
+
+// Fisher-Yates shuffle, indices scaled from 32 bits by multiplying
+template <class T>
+void RandomBatch::shuffle(T *arr, uint32_t len) {
+  if (len < 2) return;
+  for (uint32_t i = len - 1; i > 0; --i) {
+    uint32_t j = uint32_t((uint64_t(next()) * (i + 1)) >> 32);
+    T t = arr[i];
+    arr[i] = arr[j];
+    arr[j] = t;
+  }
+}
+
+}  // namespace rnd
+}  // namespace al
+
+#endif
@@ -0,0 +1,312 @@
+#ifndef INCLUDE_AL_SIMD_HPP
+#define INCLUDE_AL_SIMD_HPP
+
+/*  Allocore --
+  Multimedia / virtual environment application class library
+
+  File description:
+  Thin wrappers over SSE, AVX and NEON registers for writing array kernels
+
+  simd::Lanes<T> holds several values of T, as many as the instruction set
+  enabled when compiling handles at once, and provides the arithmetic on
+  them as static functions. Kernels written against it compile to SSE2,
+  AVX or aarch64 NEON, or to plain scalar code otherwise. ScalarLanes<T>
+  has the same interface with a single value, for remainders.
+
+  As the choice depends on compiler flags, this header is meant to be used
+  from translation units of the library rather than from public headers.
+
+  File author(s):
+  AlloSphere Research Group
+*/
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace al {
+namespace simd {
+
+// Each Lanes type holds 'size' values of T in a V and provides the
+// arithmetic used by the kernels. load3 splits 'size' consecutive
+// 3-vectors into their x, y and z components and store3 joins them again.
+
+template <typename T>
+struct ScalarLanes {
+  typedef T V;
+  typedef bool Mask;
+  static const int size = 1;
+  static V set1(T a) { return a; }
+  static V add(V a, V b) { return a + b; }
+  static V sub(V a, V b) { return a - b; }
+  static V mul(V a, V b) { return a * b; }
+  static V div(V a, V b) { return a / b; }
+  static V sqrt(V a) { return std::sqrt(a); }
+  static V min(V a, V b) { return b < a ? b : a; }
+  static V max(V a, V b) { return a < b ? b : a; }
+  static Mask greater(V a, V b) { return a > b; }
+  static V select(Mask m, V a, V b) { return m ? a : b; }
+  static V load(const T *p) { return *p; }
+  static void store(T *p, V a) { *p = a; }
+  static void load3(const T *p, V &x, V &y, V &z) {
+    x = p[0];
+    y = p[1];
+    z = p[2];
+  }
+  static void store3(T *p, V x, V y, V z) {
+    p[0] = x;
+    p[1] = y;
+    p[2] = z;
+  }
+};
+
+#if defined(__SSE2__)
+struct SSEFloat {
+  typedef __m128 V;
+  typedef __m128 Mask;
+  static const int size = 4;
+  static V set1(float a) { return _mm_set1_ps(a); }
+  static V add(V a, V b) { return _mm_add_ps(a, b); }
+  static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+  static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+  static V div(V a, V b) { return _mm_div_ps(a, b); }
+  static V sqrt(V a) { return _mm_sqrt_ps(a); }
+  static V min(V a, V b) { return _mm_min_ps(a, b); }
+  static V max(V a, V b) { return _mm_max_ps(a, b); }
+  static Mask greater(V a, V b) { return _mm_cmpgt_ps(a, b); }
+  static V select(Mask m, V a, V b) {
+    return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+  }
+  static V load(const float *p) { return _mm_loadu_ps(p); }
+  static void store(float *p, V a) { _mm_storeu_ps(p, a); }
+  static void load3(const float *p, V &x, V &y, V &z) {
+    // a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+    __m128 a = _mm_loadu_ps(p);
+    __m128 b = _mm_loadu_ps(p + 4);
+    __m128 c = _mm_loadu_ps(p + 8);
+    __m128 xy23 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));
+    __m128 yz01 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));
+    x = _mm_shuffle_ps(a, xy23, _MM_SHUFFLE(2, 0, 3, 0));
+    y = _mm_shuffle_ps(yz01, xy23, _MM_SHUFFLE(3, 1, 2, 0));
+    z = _mm_shuffle_ps(yz01, c, _MM_SHUFFLE(3, 0, 3, 1));
+  }
+  static void store3(float *p, V x, V y, V z) {
+    __m128 xy02 = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 zx = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));
+    __m128 yz = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));
+    _mm_storeu_ps(p, _mm_shuffle_ps(xy02, zx, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(p + 4, _mm_shuffle_ps(yz, xy02, _MM_SHUFFLE(3, 1, 2, 0)));
+    _mm_storeu_ps(p + 8, _mm_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 1, 3, 1)));
+  }
+};
+
+struct SSEDouble {
+  typedef __m128d V;
+  typedef __m128d Mask;
+  static const int size = 2;
+  static V set1(double a) { return _mm_set1_pd(a); }
+  static V add(V a, V b) { return _mm_add_pd(a, b); }
+  static V sub(V a, V b) { return _mm_sub_pd(a, b); }
+  static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+  static V div(V a, V b) { return _mm_div_pd(a, b); }
+  static V sqrt(V a) { return _mm_sqrt_pd(a); }
+  static V min(V a, V b) { return _mm_min_pd(a, b); }
+  static V max(V a, V b) { return _mm_max_pd(a, b); }
+  static Mask greater(V a, V b) { return _mm_cmpgt_pd(a, b); }
+  static V select(Mask m, V a, V b) {
+    return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b));
+  }
+  static V load(const double *p) { return _mm_loadu_pd(p); }
+  static void store(double *p, V a) { _mm_storeu_pd(p, a); }
+  static void load3(const double *p, V &x, V &y, V &z) {
+    // a = x0 y0, b = z0 x1, c = y1 z1
+    __m128d a = _mm_loadu_pd(p);
+    __m128d b = _mm_loadu_pd(p + 2);
+    __m128d c = _mm_loadu_pd(p + 4);
+    x = _mm_shuffle_pd(a, b, 2);
+    y = _mm_shuffle_pd(a, c, 1);
+    z = _mm_shuffle_pd(b, c, 2);
+  }
+  static void store3(double *p, V x, V y, V z) {
+    _mm_storeu_pd(p, _mm_shuffle_pd(x, y, 0));
+    _mm_storeu_pd(p + 2, _mm_shuffle_pd(z, x, 2));
+    _mm_storeu_pd(p + 4, _mm_shuffle_pd(y, z, 3));
+  }
+};
+#endif
+
+#if defined(__AVX__)
+// The arithmetic is twice as wide as SSE. Loads and stores deinterleave
+// each half with the SSE shuffles, as AVX can't shuffle across halves.
+struct AVXFloat {
+  typedef __m256 V;
+  typedef __m256 Mask;
+  static const int size = 8;
+  static V set1(float a) { return _mm256_set1_ps(a); }
+  static V add(V a, V b) { return _mm256_add_ps(a, b); }
+  static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+  static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+  static V div(V a, V b) { return _mm256_div_ps(a, b); }
+  static V sqrt(V a) { return _mm256_sqrt_ps(a); }
+  static V min(V a, V b) { return _mm256_min_ps(a, b); }
+  static V max(V a, V b) { return _mm256_max_ps(a, b); }
+  static Mask greater(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+  static V select(Mask m, V a, V b) { return _mm256_blendv_ps(b, a, m); }
+  static V load(const float *p) { return _mm256_loadu_ps(p); }
+  static void store(float *p, V a) { _mm256_storeu_ps(p, a); }
+  static V join(__m128 lo, __m128 hi) {
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+  }
+  static void load3(const float *p, V &x, V &y, V &z) {
+    __m128 x0, y0, z0, x1, y1, z1;
+    SSEFloat::load3(p, x0, y0, z0);
+    SSEFloat::load3(p + 12, x1, y1, z1);
+    x = join(x0, x1);
+    y = join(y0, y1);
+    z = join(z0, z1);
+  }
+  static void store3(float *p, V x, V y, V z) {
+    SSEFloat::store3(p, _mm256_castps256_ps128(x), _mm256_castps256_ps128(y),
+                     _mm256_castps256_ps128(z));
+    SSEFloat::store3(p + 12, _mm256_extractf128_ps(x, 1),
+                     _mm256_extractf128_ps(y, 1),
+                     _mm256_extractf128_ps(z, 1));
+  }
+};
+
+struct AVXDouble {
+  typedef __m256d V;
+  typedef __m256d Mask;
+  static const int size = 4;
+  static V set1(double a) { return _mm256_set1_pd(a); }
+  static V add(V a, V b) { return _mm256_add_pd(a, b); }
+  static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+  static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+  static V div(V a, V b) { return _mm256_div_pd(a, b); }
+  static V sqrt(V a) { return _mm256_sqrt_pd(a); }
+  static V min(V a, V b) { return _mm256_min_pd(a, b); }
+  static V max(V a, V b) { return _mm256_max_pd(a, b); }
+  static Mask greater(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+  static V select(Mask m, V a, V b) { return _mm256_blendv_pd(b, a, m); }
+  static V load(const double *p) { return _mm256_loadu_pd(p); }
+  static void store(double *p, V a) { _mm256_storeu_pd(p, a); }
+  static V join(__m128d lo, __m128d hi) {
+    return _mm256_insertf128_pd(_mm256_castpd128_pd256(lo), hi, 1);
+  }
+  static void load3(const double *p, V &x, V &y, V &z) {
+    __m128d x0, y0, z0, x1, y1, z1;
+    SSEDouble::load3(p, x0, y0, z0);
+    SSEDouble::load3(p + 6, x1, y1, z1);
+    x = join(x0, x1);
+    y = join(y0, y1);
+    z = join(z0, z1);
+  }
+  static void store3(double *p, V x, V y, V z) {
+    SSEDouble::store3(p, _mm256_castpd256_pd128(x), _mm256_castpd256_pd128(y),
+                      _mm256_castpd256_pd128(z));
+    SSEDouble::store3(p + 6, _mm256_extractf128_pd(x, 1),
+                      _mm256_extractf128_pd(y, 1),
+                      _mm256_extractf128_pd(z, 1));
+  }
+};
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+// vld3/vst3 deinterleave 3-vectors directly. Division and square roots of
+// vectors need aarch64, so 32-bit ARM uses the scalar code.
+struct NEONFloat {
+  typedef float32x4_t V;
+  typedef uint32x4_t Mask;
+  static const int size = 4;
+  static V set1(float a) { return vdupq_n_f32(a); }
+  static V add(V a, V b) { return vaddq_f32(a, b); }
+  static V sub(V a, V b) { return vsubq_f32(a, b); }
+  static V mul(V a, V b) { return vmulq_f32(a, b); }
+  static V div(V a, V b) { return vdivq_f32(a, b); }
+  static V sqrt(V a) { return vsqrtq_f32(a); }
+  static V min(V a, V b) { return vminq_f32(a, b); }
+  static V max(V a, V b) { return vmaxq_f32(a, b); }
+  static Mask greater(V a, V b) { return vcgtq_f32(a, b); }
+  static V select(Mask m, V a, V b) { return vbslq_f32(m, a, b); }
+  static V load(const float *p) { return vld1q_f32(p); }
+  static void store(float *p, V a) { vst1q_f32(p, a); }
+  static void load3(const float *p, V &x, V &y, V &z) {
+    float32x4x3_t v = vld3q_f32(p);
+    x = v.val[0];
+    y = v.val[1];
+    z = v.val[2];
+  }
+  static void store3(float *p, V x, V y, V z) {
+    float32x4x3_t v;
+    v.val[0] = x;
+    v.val[1] = y;
+    v.val[2] = z;
+    vst3q_f32(p, v);
+  }
+};
+
+struct NEONDouble {
+  typedef float64x2_t V;
+  typedef uint64x2_t Mask;
+  static const int size = 2;
+  static V set1(double a) { return vdupq_n_f64(a); }
+  static V add(V a, V b) { return vaddq_f64(a, b); }
+  static V sub(V a, V b) { return vsubq_f64(a, b); }
+  static V mul(V a, V b) { return vmulq_f64(a, b); }
+  static V div(V a, V b) { return vdivq_f64(a, b); }
+  static V sqrt(V a) { return vsqrtq_f64(a); }
+  static V min(V a, V b) { return vminq_f64(a, b); }
+  static V max(V a, V b) { return vmaxq_f64(a, b); }
+  static Mask greater(V a, V b) { return vcgtq_f64(a, b); }
+  static V select(Mask m, V a, V b) { return vbslq_f64(m, a, b); }
+  static V load(const double *p) { return vld1q_f64(p); }
+  static void store(double *p, V a) { vst1q_f64(p, a); }
+  static void load3(const double *p, V &x, V &y, V &z) {
+    float64x2x3_t v = vld3q_f64(p);
+    x = v.val[0];
+    y = v.val[1];
+    z = v.val[2];
+  }
+  static void store3(double *p, V x, V y, V z) {
+    float64x2x3_t v;
+    v.val[0] = x;
+    v.val[1] = y;
+    v.val[2] = z;
+    vst3q_f64(p, v);
+  }
+};
+#endif
+
+template <typename T>
+struct Lanes;
+
+#if defined(__AVX__)
+template <>
+struct Lanes<float> : AVXFloat {};
+template <>
+struct Lanes<double> : AVXDouble {};
+#elif defined(__SSE2__)
+template <>
+struct Lanes<float> : SSEFloat {};
+template <>
+struct Lanes<double> : SSEDouble {};
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+template <>
+struct Lanes<float> : NEONFloat {};
+template <>
+struct Lanes<double> : NEONDouble {};
+#else
+template <typename T>
+struct Lanes : ScalarLanes<T> {};
+#endif
+
+}  // namespace simd
+}  // namespace al
+
+#endif
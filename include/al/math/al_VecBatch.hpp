@@ -0,0 +1,68 @@
+#ifndef INCLUDE_AL_VECBATCH_HPP
+#define INCLUDE_AL_VECBATCH_HPP
+
+/*  Allocore --
+  Multimedia / virtual environment application class library
+
+  File description:
+  Transforms, rotations and products over arrays of 3-vectors
+
+  Vec, Mat and Quat operate on one value at a time. These functions apply
+  the same operations to whole arrays, such as particle positions, several
+  vectors at once using SSE, AVX or NEON (aarch64) as chosen when compiling,
+  with a scalar fallback otherwise. Large arrays are also split across
+  threads with parallelFor. Results match the scalar operations up to
+  rounding.
+
+  Outputs may be the same array as an input, but must not otherwise
+  overlap them.
+
+  File author(s):
+  AlloSphere Research Group
+*/
+
+#include <cstddef>
+
+#include "al/math/al_Matrix4.hpp"
+#include "al/math/al_Quat.hpp"
+#include "al/math/al_Vec.hpp"
+
+namespace al {
+
+/// Transform points by a matrix, out[i] = (m * Vec4(in[i], 1)).xyz
+/// @ingroup Math
+void transformPoints(const Matrix4f &m, const Vec3f *in, Vec3f *out,
+                     size_t count);
+void transformPoints(const Matrix4d &m, const Vec3d *in, Vec3d *out,
+                     size_t count);
+
+/// Transform directions by a matrix, out[i] = (m * Vec4(in[i], 0)).xyz
+/// @ingroup Math
+void transformVectors(const Matrix4f &m, const Vec3f *in, Vec3f *out,
+                      size_t count);
+void transformVectors(const Matrix4d &m, const Vec3d *in, Vec3d *out,
+                      size_t count);
+
+/// Rotate vectors by a unit quaternion, out[i] = q.rotate(in[i])
+/// @ingroup Math
+void rotate(const Quatf &q, const Vec3f *in, Vec3f *out, size_t count);
+void rotate(const Quatd &q, const Vec3d *in, Vec3d *out, size_t count);
+
+/// Normalize vectors, out[i] = in[i].normalized(scale)
+/// @ingroup Math
+void normalize(const Vec3f *in, Vec3f *out, size_t count, float scale = 1);
+void normalize(const Vec3d *in, Vec3d *out, size_t count, double scale = 1);
+
+/// Dot products of pairs of vectors, out[i] = a[i].dot(b[i])
+/// @ingroup Math
+void dot(const Vec3f *a, const Vec3f *b, float *out, size_t count);
+void dot(const Vec3d *a, const Vec3d *b, double *out, size_t count);
+
+/// Cross products of pairs of vectors, out[i] = a[i].cross(b[i])
+/// @ingroup Math
+void cross(const Vec3f *a, const Vec3f *b, Vec3f *out, size_t count);
+void cross(const Vec3d *a, const Vec3d *b, Vec3d *out, size_t count);
+
+}  // namespace al
+
+#endif
@@ -0,0 +1,282 @@
+#ifndef INCLUDE_AL_STATE_SYNC_HPP
+#define INCLUDE_AL_STATE_SYNC_HPP
+
+/*  Allocore --
+  Multimedia / virtual environment application class library
+
+  File description:
+  Sending blocks of state over OSC in datagram sized chunks, as keyframes
+  and as deltas against the last keyframe
+
+  File author(s):
+  AlloSphere Research Group
+*/
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "al/io/al_Socket.hpp"
+#include "al/protocol/al_OSC.hpp"
+
+namespace al {
+
+/**
+ * @brief Sends frames of a block of state as chunked, delta compressed OSC
+ * messages
+ * @ingroup allocore
+ *
+ * Each call to send() is a frame with a number one higher than the last.
+ * A frame is either a keyframe holding the whole state, or a delta: the
+ * state XORed with the last keyframe, with runs of zeros (the bytes that did
+ * not change) left out. A keyframe is sent every keyframeInterval() frames,
+ * when the size of the state changes, when forceKeyframe() was called, and
+ * whenever the delta would not be smaller than the state itself.
+ *
+ * The encoded frame is split into chunks that fit in packetSize() bytes, so
+ * that states larger than one datagram can be sent. Each chunk is an OSC
+ * message "/_statechunk" with arguments:
+ *   id, session, frame, keyframe the delta is against, encoding
+ *   (0 keyframe, 1 delta), state size, encoded size, chunk size,
+ *   chunk index, data
+ *
+ * The session is a random number picked by each sender, so that receivers
+ * can tell a restarted sender, numbering its frames from 1 again, from
+ * chunks of old frames.
+ *
+ * The socket is opened once in open() and kept until close(). The address
+ * may be a single host, a broadcast address or a multicast group, so that
+ * each packet is sent once however many receivers there are.
+ *
+ * Frames larger than a burst of 64 kB are paced to sendRate(), pausing
+ * between bursts, so that receivers can drain their socket buffers before
+ * the chunks of a large keyframe overflow them.
+ */
+class StateSyncSender {
+public:
+  struct Stats {
+    uint64_t frames{0};
+    uint64_t keyframes{0};
+    uint64_t chunks{0};
+    uint64_t bytes{0};        ///< bytes of all packets sent
+    size_t lastEncodedSize{0}; ///< bytes of the last frame before chunking
+  };
+
+  /// Packets are never made larger than this, as receivers read datagrams
+  /// into buffers of about 4 kB
+  static const uint16_t maxPacketSize = 4096;
+
+  StateSyncSender();
+  virtual ~StateSyncSender() {}
+
+  /// Open the socket to send to a host, broadcast address or multicast group
+  bool open(uint16_t port, const char *address = "localhost",
+            uint16_t packetSize = 1400);
+  void close() { mSocket.close(); }
+  bool isOpen() const { return mSocket.opened(); }
+
+  /// Set the interface, by its IP address, to send multicast from, before
+  /// open(). Empty uses the system's default.
+  void multicastInterface(const std::string &address) {
+    mMulticastInterface = address;
+  }
+
+  /// Set how many routers multicast may pass through, before open()
+  void multicastTTL(int hops) { mMulticastTTL = hops; }
+
+  /// Set the largest packet to send, clamped to maxPacketSize
+  void packetSize(uint16_t size);
+  uint16_t packetSize() const { return mPacketSize; }
+
+  void id(const std::string &id) { mId = id; }
+  const std::string &id() const { return mId; }
+
+  /// Send a keyframe at least every frames frames, 1 sends only keyframes
+  void keyframeInterval(unsigned int frames) { mKeyframeInterval = frames; }
+  unsigned int keyframeInterval() const { return mKeyframeInterval; }
+
+  /// Make the next frame a keyframe
+  void forceKeyframe() { mForceKeyframe = true; }
+
+  /// Set the bytes per second frames larger than a burst are paced to, 0
+  /// sends every chunk without pausing
+  void sendRate(double bytesPerSecond) { mSendRate = bytesPerSecond; }
+  double sendRate() const { return mSendRate; }
+
+  /// Send a frame of size bytes from state
+  /// @return the number of bytes sent, 0 on failure
+  size_t send(const void *state, size_t size);
+
+  /// Number of the last frame sent
+  uint32_t frame() const { return mFrame; }
+
+  /// Number sent with every chunk that tells this sender from earlier ones
+  uint32_t session() const { return mSession; }
+
+  /// Whether the last frame sent was a keyframe
+  bool lastWasKeyframe() const { return mKeyframeFrame == mFrame; }
+
+  const Stats &stats() const { return mStats; }
+
+  /// Bytes of data carried by each chunk for the current id and packet size
+  size_t chunkSize() const;
+
+protected:
+  /// Send one packet, can be overridden to send through other transports
+  virtual size_t transmit(const osc::Packet &packet);
+
+  SocketClient mSocket;
+  std::string mMulticastInterface;
+  int mMulticastTTL{1};
+  std::unique_ptr<osc::Packet> mPacket;
+  std::string mId;
+  uint16_t mPacketSize{1400};
+  unsigned int mKeyframeInterval{60};
+  bool mForceKeyframe{false};
+  double mSendRate{100e6}; // a little under gigabit ethernet
+  uint32_t mSession{0};
+  uint32_t mFrame{0};
+  uint32_t mKeyframeFrame{0};
+  unsigned int mFramesSinceKeyframe{0};
+  std::vector<unsigned char> mKeyframe;
+  std::vector<unsigned char> mEncoded;
+  Stats mStats;
+};
+
+/**
+ * @brief Reassembles and decodes frames sent by StateSyncSender
+ * @ingroup allocore
+ *
+ * Pass every received message to handle(). Chunks of frames older than the
+ * last state decoded are ignored. A frame still incomplete when a chunk of a
+ * newer frame arrives is dropped, as is a delta whose keyframe was never
+ * received; the state then stays at the last frame decoded until the next
+ * frame that can be decoded.
+ *
+ * A chunk of another session than the last one, as sent once the sender
+ * restarted, makes the receiver start over with the frames of the new
+ * session, keeping the last state until one of them is decoded.
+ */
+class StateSyncReceiver {
+public:
+  struct Stats {
+    uint64_t frames{0};   ///< frames decoded
+    uint64_t dropped{0};  ///< frames partly received but not decoded
+    uint64_t lost{0};     ///< frames numbered between decoded ones and missed
+    uint64_t stale{0};    ///< chunks ignored for being older than the state
+    uint64_t invalid{0};  ///< chunks ignored for malformed headers
+    uint64_t restarts{0}; ///< times a new session of the sender was seen
+  };
+
+  void id(const std::string &id) { mId = id; }
+  const std::string &id() const { return mId; }
+
+  /// Set the size of the state expected, 0 accepts any size
+  void stateSize(size_t size) { mExpectedSize = size; }
+
+  /// Handle a message, returns true if it completed a new state
+  bool handle(osc::Message &m);
+
+  /// Forget the frames received
+  void reset();
+
+  bool hasState() const { return mHasState; }
+  const unsigned char *state() const { return mState.data(); }
+  size_t size() const { return mState.size(); }
+
+  /// Number of the last frame decoded
+  uint32_t frame() const { return mFrame; }
+
+  const Stats &stats() const { return mStats; }
+
+protected:
+  bool decode();
+
+  std::string mId;
+  size_t mExpectedSize{0};
+
+  // frame being reassembled
+  bool mAssembling{false};
+  uint32_t mPartFrame{0};
+  uint32_t mPartBase{0};
+  int mPartEncoding{0};
+  size_t mPartStateSize{0};
+  size_t mPartChunkSize{0};
+  size_t mChunksLeft{0};
+  std::vector<unsigned char> mPart;
+  std::vector<bool> mChunkReceived;
+
+  bool mHasState{false};
+  uint32_t mSession{0};
+  bool mHasFrame{false}; ///< whether mFrame is a frame of mSession
+  uint32_t mFrame{0};
+  std::vector<unsigned char> mState;
+  bool mHasKeyframe{false};
+  uint32_t mKeyframeFrame{0};
+  std::vector<unsigned char> mKeyframe;
+  std::vector<unsigned char> mDecoded;
+  Stats mStats;
+};
+
+/**
+ * @brief Receives packets sent by StateSyncSender on a thread of its own
+ * @ingroup allocore
+ *
+ * The port is bound with its address reusable, so that several listeners,
+ * in one process or in several on the same host, all receive the packets
+ * broadcast or multicast to it. Packets broadcast or sent directly to the
+ * port are received whether a multicast group was joined or not, so
+ * listeners keep receiving when a sender falls back to broadcast.
+ *
+ * The socket's receive buffer is enlarged to receiveBufferSize() so that it
+ * can hold the bursts of chunks of large keyframes while the thread catches
+ * up. Systems cap the size granted, on Linux to net.core.rmem_max, and
+ * open() warns when it got less than asked for.
+ *
+ * Messages are passed to the handler from the listening thread.
+ */
+class StateSyncListener {
+public:
+  ~StateSyncListener() { stop(); }
+
+  /// Set the receive buffer size in bytes to ask for, before open()
+  void receiveBufferSize(int bytes) { mReceiveBufferSize = bytes; }
+  int receiveBufferSize() const { return mReceiveBufferSize; }
+
+  /// Bind to port on the local address, "0.0.0.0" for all interfaces
+  bool open(uint16_t port, const char *address = "0.0.0.0");
+  bool isOpen() const { return mSocket.opened(); }
+
+  /// Stop and release the port
+  void close() {
+    stop();
+    mSocket.close();
+  }
+
+  /// Join a multicast group on the interface with IP interfaceAddress,
+  /// empty for the system's default, after open()
+  bool joinMulticast(const std::string &group,
+                     const std::string &interfaceAddress = "");
+
+  void handler(osc::PacketHandler &handler) { mHandler = &handler; }
+
+  /// Start and stop the thread receiving packets
+  bool start();
+  void stop();
+
+protected:
+  void loop();
+
+  SocketServer mSocket;
+  int mReceiveBufferSize{4 << 20};
+  osc::PacketHandler *mHandler{nullptr};
+  std::thread mThread;
+  std::atomic<bool> mRunning{false};
+};
+
+} // namespace al
+
+#endif
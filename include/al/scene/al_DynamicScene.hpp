@@ -44,17 +44,22 @@
         Andrés Cabrera mantaraya36@gmail.com
 */
 
+#include <atomic>
 #include <condition_variable>
+#include <map>
 #include <memory>
 #include <queue>
 #include <thread>
+#include <typeindex>
 
 #include "al/math/al_Vec.hpp"
+#include "al/scene/al_InstanceRenderer.hpp"
 #include "al/scene/al_SynthSequencer.hpp"
 #include "al/sound/al_Speaker.hpp"
 #include "al/sound/al_StereoPanner.hpp"
 #include "al/spatial/al_DistAtten.hpp"
 #include "al/spatial/al_Pose.hpp"
+#include "al/spatial/al_SphereTree.hpp"
 
 namespace al {
 /**
@@ -100,6 +105,16 @@ public:
    */
   virtual void preProcess(Graphics & /*g*/) {}
 
+  /**
+   * @brief Override to set the per-instance data when this voice is drawn in
+   * a batch
+   *
+   * Called instead of preProcess() and onProcess(Graphics &) when the voice's
+   * class has an InstanceRenderer in the DynamicScene. The instance has been
+   * filled with the voice's pose and size, and a white color.
+   */
+  virtual void onInstance(VoiceInstance & /*instance*/) {}
+
   /**
    * @brief For PositionedVoice, the pose (7 floats) and the size are appended
    * to the pfields
@@ -272,9 +287,82 @@ public:
   void showWorldMarker(bool show = true) { mDrawWorldMarker = show; }
 
   /**
-   * @brief Enables/disables sorting by distance to listener on graphics render
+   * @brief Enables/disables sorting by distance on graphics render
+   * @param sort true to draw voices from farthest to nearest
+   * @param perView measure distance from the eye of each render() call (taken
+   * from the Graphics view and model matrices) instead of the listener pose
+   *
+   * Voice positions are captured together with the culling bounds (see
+   * cullDrawingByFrustum()) and sorted with a stable radix sort on squared
+   * distance, so voices at equal distance keep their relative order. Use
+   * perView for multi-projection rendering, where each projection has its own
+   * eye. When the Graphics is recording into a RenderQueue, per view sorting
+   * is left to each replay.
+   */
+  void sortDrawingByDistance(bool sort = true, bool perView = false);
+
+  /**
+   * @brief Enables/disables view frustum culling on graphics render
+   * @param cull true to skip voices outside the current view
+   * @param radius radius of a voice of size 1, in voice units
+   *
+   * A voice is considered to occupy a sphere of radius size() * radius around
+   * its pose position. The frustum is taken from the projection, view and
+   * model matrices of the Graphics object at the time of render(), so each
+   * view of a multi-projection render is culled separately. Voices that move
+   * themselves in preProcess() should use a radius that covers that offset.
+   *
+   * Bounds are read from the voice poses once per frame, on the first
+   * render() after update() or after voices were added or removed, and
+   * gathered into a SphereTree that all views of the frame share. The tree
+   * is only rebuilt when one of the bounds changed. Call update() once per
+   * frame, even with a dt of 0, so voices moved with setPose() are seen.
+   *
+   * When the Graphics is recording into a RenderQueue, nothing is culled
+   * while recording; the draws of each voice are bounded by its sphere and
+   * culled by each replay against its own view (see
+   * RenderQueue::beginBounds()). Voices drawn in instanced batches are not
+   * culled then.
+   */
+  void cullDrawingByFrustum(bool cull = true, float radius = 1.0f) {
+    mCullDrawingByFrustum = cull;
+    mCullingRadius = radius;
+    mDrawListVersion = ~0u;
+  }
+
+  /**
+   * @brief Draw all voices of a class as one batch
+   * @param renderer renderer for the batch, nullptr to draw voices of this
+   * class one by one again
+   *
+   * Voices of class TPositionedVoice (exactly, not subclasses) are gathered
+   * into VoiceInstance entries after culling and sorting, and drawn by the
+   * renderer after the other voices. Sorting applies within a batch only.
+   */
+  template <class TPositionedVoice>
+  void setInstanceRenderer(std::shared_ptr<InstanceRenderer> renderer) {
+    setInstanceRenderer(std::type_index(typeid(TPositionedVoice)), renderer);
+  }
+
+  void setInstanceRenderer(std::type_index voiceType,
+                           std::shared_ptr<InstanceRenderer> renderer);
+
+  /**
+   * @brief Number of voices drawn by the last render(Graphics &) call
+   */
+  size_t drawnCount() const { return mDrawnCount; }
+
+  /**
+   * @brief Number of voices skipped by frustum culling in the last
+   * render(Graphics &) call
+   */
+  size_t culledCount() const { return mCulledCount; }
+
+  /**
+   * @brief Number of instance batches drawn by the last render(Graphics &)
+   * call
    */
-  void sortDrawingByDistance(bool sort = true);
+  size_t batchCount() const { return mBatchCount; }
 
   /**
    * @brief Stop all audio threads. No processing is possible after calling this
@@ -301,6 +389,31 @@ private:
   DistAtten<> mDistAtten;
 
   bool mSortDrawingByDistance{false};
+  bool mSortPerView{false};
+
+  // Drawing list, frustum culling and depth sorting
+  void updateDrawList();
+  void updateDrawBounds(bool listChanged);
+  void sortDrawOrder(const Vec3f &eye);
+
+  bool mCullDrawingByFrustum{false};
+  float mCullingRadius{1.0f};
+  std::vector<PositionedVoice *> mDrawVoices;     // Positioned active voices
+  std::vector<InstanceRenderer *> mDrawRenderers; // Batch of each voice
+  std::vector<SynthVoice *> mUnboundedVoices;     // Drawn without culling
+  std::vector<unsigned> mDrawOrder;               // Indices into mDrawVoices
+  std::vector<Vec3f> mVoiceCenters;
+  std::vector<float> mVoiceRadii;
+  std::vector<uint32_t> mSortKeys, mSortKeysTmp;
+  std::vector<unsigned> mSortOrderTmp;
+  SphereTree mVoiceTree;
+  unsigned mDrawListVersion{~0u};
+  std::atomic<bool> mDrawBoundsStale{true}; // Set by update() every frame
+  size_t mDrawnCount{0};
+  size_t mCulledCount{0};
+  std::map<std::type_index, std::shared_ptr<InstanceRenderer>>
+      mInstanceRenderers;
+  size_t mBatchCount{0};
   // For threaded simulation
   std::unique_ptr<ThreadPool> mWorkerThreads; // Update worker threads
   bool mThreadedUpdate{true};
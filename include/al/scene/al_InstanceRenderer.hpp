@@ -0,0 +1,118 @@
+#ifndef INCLUDE_AL_INSTANCERENDERER_HPP
+#define INCLUDE_AL_INSTANCERENDERER_HPP
+
+/*  Allocore --
+  Multimedia / virtual environment application class library
+
+  File description:
+  Batched drawing of scene voices as instances
+
+  A DynamicScene can route every voice of a class to an InstanceRenderer
+  instead of calling its onProcess(Graphics &). The scene gathers one
+  VoiceInstance per visible voice and the renderer draws the whole batch at
+  once, typically with a single instanced draw call.
+
+  File author(s):
+  AlloSphere Research Group
+*/
+
+#include <string>
+#include <vector>
+
+#include "al/graphics/al_BufferObject.hpp"
+#include "al/graphics/al_Graphics.hpp"
+#include "al/graphics/al_Shader.hpp"
+#include "al/graphics/al_VAOMesh.hpp"
+#include "al/math/al_Quat.hpp"
+#include "al/math/al_Vec.hpp"
+#include "al/types/al_Color.hpp"
+
+namespace al {
+
+/// Per-instance data of a voice drawn in a batch
+
+/// The layout is fixed (48 bytes, all floats) so it can be copied to a GPU
+/// buffer as is.
+struct VoiceInstance {
+  Vec3f position;     ///< Pose position
+  Quatf orientation;  ///< Pose orientation, components w, x, y, z
+  float size;         ///< Voice size
+  Color color;        ///< Instance color, white by default
+};
+
+static_assert(sizeof(VoiceInstance) == 12 * sizeof(float),
+              "VoiceInstance must be tightly packed");
+
+/**
+ * @brief Draws a batch of voice instances
+ * @ingroup Scene
+ *
+ * Subclass and implement draw() to render voices with a custom technique.
+ */
+class InstanceRenderer {
+public:
+  virtual ~InstanceRenderer() {}
+
+  /**
+   * @brief Draw all instances gathered for this frame
+   * @param g Graphics with the scene transform applied
+   * @param instances one entry per voice, in drawing order
+   */
+  virtual void draw(Graphics &g,
+                    const std::vector<VoiceInstance> &instances) = 0;
+
+  /**
+   * @brief Instances gathered by the scene for the current render
+   */
+  std::vector<VoiceInstance> &instances() { return mInstances; }
+
+private:
+  std::vector<VoiceInstance> mInstances;
+};
+
+/**
+ * @brief Draws all instances of a mesh with one instanced draw call
+ * @ingroup Scene
+ *
+ * Instance data is streamed into a vertex buffer every frame and read with
+ * attribute divisor 1 at the locations given by the Location enum. The
+ * default shader places the mesh by position, orientation and size and
+ * colors it with the instance color. A custom shader must declare the same
+ * instance attributes along with the al_ModelViewMatrix and
+ * al_ProjectionMatrix uniforms.
+ */
+class InstancedMeshRenderer : public InstanceRenderer {
+public:
+  enum Location : unsigned int {
+    INSTANCE_POSITION = 5,
+    INSTANCE_ORIENTATION = 6,
+    INSTANCE_SIZE = 7,
+    INSTANCE_COLOR = 8
+  };
+
+  InstancedMeshRenderer() {}
+  InstancedMeshRenderer(const Mesh &m) { mesh(m); }
+
+  /// Set mesh to draw for each instance
+  void mesh(const Mesh &m);
+
+  /// Set shader sources, replacing the default shader
+  void shaderSources(const std::string &vert, const std::string &frag);
+
+  virtual void draw(Graphics &g,
+                    const std::vector<VoiceInstance> &instances) override;
+
+private:
+  void create();
+
+  VAOMesh mMesh;
+  BufferObject mInstanceBuffer;
+  ShaderProgram mShader;
+  std::string mVertSource, mFragSource;
+  size_t mBufferCapacity{0};
+  bool mCreated{false};
+};
+
+} // namespace al
+
+#endif
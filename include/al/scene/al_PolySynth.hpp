@@ -41,6 +41,7 @@
     Andrés Cabrera mantaraya36@gmail.com
 */
 
+#include <atomic>
 #include <chrono>
 #include <cstring>
 #include <string>
@@ -816,6 +817,7 @@ public:
         } else {
           mActiveVoices = mVoicesToInsert;
         }
+        ++mActiveVoicesVersion;
         if (verbose()) {
           std::cout << "Voice on " << mVoicesToInsert->id() << std::endl;
         }
@@ -840,6 +842,7 @@ public:
               mFreeVoices; // Connect last active voice to first free voice
           mFreeVoices = mActiveVoices; // Move all voices to free voices
           mActiveVoices = nullptr;     // No active voices left
+          ++mActiveVoicesVersion;
         }
         mFreeVoiceLock.unlock();
       }
@@ -922,6 +925,7 @@ public:
             voice->onFree();
             voice = voice->next; // prepare next iteration
           }
+          ++mActiveVoicesVersion;
           for (auto cbNode : mFreeCallbacks) {
             cbNode.first(id, cbNode.second);
           }
@@ -961,6 +965,8 @@ protected:
   /// Dynamic voices that are currently active. Only modified
   /// within the master domain (set by mMasterMode)
   SynthVoice *mActiveVoices{nullptr};
+  /// Incremented whenever voices are added to or removed from mActiveVoices
+  std::atomic<unsigned> mActiveVoicesVersion{0};
   std::mutex mVoiceToInsertLock;
   std::mutex mFreeVoiceLock;
   std::mutex mGraphicsLock; // TODO: remove this lock?
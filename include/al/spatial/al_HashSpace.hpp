@@ -2,6 +2,7 @@
 #define INCLUDE_AL_HASHSPACE_HPP
 
 #include <algorithm>
+#include <utility>
 #include <vector>
 
 #include "al/math/al_Vec.hpp"
@@ -210,10 +211,44 @@ public:
     Results &results() { return mObjects; }
 
   protected:
+    // scan voxels of the sorted arrays instead of the voxel lists
+    unsigned scanSorted(const HashSpace &space, const Vec3d &center,
+                        const Object *skip, double minr2, double maxr2,
+                        uint32_t cellstart, uint32_t cellend);
+
     uint32_t mMaxResults;
     Results mObjects;
   };
 
+  /**
+    Neighbours of every object, as compressed sparse rows
+
+    Filled by neighborsWithin() and nearestNeighbors(). The neighbours of
+    object i are ids[offsets[i]] .. ids[offsets[i + 1] - 1]. Re-using the
+    same Neighbors for every frame avoids allocating once it has grown.
+  @ingroup Spatial
+  */
+  struct Neighbors {
+    std::vector<uint32_t> offsets;         ///< numObjects() + 1 entries
+    std::vector<uint32_t> ids;             ///< neighbour object ids
+    std::vector<float> distancesSquared;   ///< matching ids
+
+    /// number of neighbours of object i
+    uint32_t count(uint32_t i) const { return offsets[i + 1] - offsets[i]; }
+    /// first neighbour id of object i
+    const uint32_t *begin(uint32_t i) const { return &ids[offsets[i]]; }
+    const uint32_t *end(uint32_t i) const { return &ids[offsets[i + 1]]; }
+
+    // results of each thread, before being gathered into the rows
+    struct Chunk {
+      std::vector<uint32_t> ids;
+      std::vector<float> distancesSquared;
+      std::vector<std::pair<float, uint32_t>> heap;
+    };
+    std::vector<Chunk> mChunks;
+    std::vector<uint32_t> mStart, mChunkOf;
+  };
+
   /**
     Construct a HashSpace
     locations will range from [0..2^resolution)
@@ -252,6 +287,70 @@ public:
   /// the objectId can be reused later via move()
   HashSpace &remove(uint32_t objectId);
 
+  /**
+    Move all objects at once
+
+    Object i moves to positions[i] and the number of objects becomes count.
+    Voxel hashes are computed in parallel and the objects counting sorted
+    by voxel into contiguous arrays of float positions, which queries then
+    scan instead of following the voxel lists. The voxel lists are kept up
+    to date too, so move() and remove() may still be used afterwards; they
+    make queries go back to the lists until the next rebuild().
+
+    Once rebuilt, any number of threads may query the space concurrently,
+    each with its own Query.
+
+    @param positions  object positions, wrapped into the space
+    @param count      number of objects
+    @param numThreads maximum number of threads, 0 = hardware concurrency
+  */
+  void rebuild(const Vec3f *positions, uint32_t count, unsigned numThreads = 0);
+  void rebuild(const std::vector<Vec3f> &positions, unsigned numThreads = 0) {
+    rebuild(positions.data(), uint32_t(positions.size()), numThreads);
+  }
+
+  /**
+    Find the neighbours of all objects within a radius
+
+    Runs one query per object across threads, in voxel order, using the
+    arrays made by rebuild(). Unlike Query, every object within radius is
+    found, up to maxNeighbors per object; which ones are kept when there
+    are more is unspecified.
+
+    @param out          receives the neighbours of each object
+    @param radius       search radius, at most maxRadius()
+    @param maxNeighbors maximum number of neighbours per object
+    @param numThreads   maximum number of threads, 0 = hardware concurrency
+    @return false if the space is not sorted()
+  */
+  bool neighborsWithin(Neighbors &out, double radius,
+                       uint32_t maxNeighbors = 64,
+                       unsigned numThreads = 0) const;
+
+  /**
+    Find the k nearest neighbours of all objects
+
+    Neighbours of each object are sorted by increasing distance. Objects
+    with fewer than k others within maxRadius get fewer neighbours.
+
+    @return false if the space is not sorted()
+  */
+  bool nearestNeighbors(Neighbors &out, uint32_t k, double maxRadius,
+                        unsigned numThreads = 0) const;
+
+  /// whether objects are sorted by voxel since the last rebuild():
+  bool sorted() const { return mSorted; }
+
+  /// offsets into the sorted arrays, of size dim()^3 + 1
+  /// the objects of voxel h are at [cellStart()[h], cellStart()[h + 1])
+  const std::vector<uint32_t> &cellStart() const { return mCellStart; }
+  /// object ids in voxel order
+  const std::vector<uint32_t> &sortedIds() const { return mSortedIds; }
+  /// wrapped object positions in voxel order
+  const std::vector<float> &sortedX() const { return mSortedX; }
+  const std::vector<float> &sortedY() const { return mSortedY; }
+  const std::vector<float> &sortedZ() const { return mSortedZ; }
+
   /// wrap an absolute position within the space:
   double wrap(double x) const { return wrap(x, dim()); }
   template <typename T> Vec<3, T> wrap(Vec<3, T> v) const {
@@ -305,6 +404,16 @@ protected:
   inline uint32_t unhashy(uint32_t h) const { return (h >> mShift) & mWrap; }
   inline uint32_t unhashz(uint32_t h) const { return (h >> mShift2) & mWrap; }
 
+  // runs search(sortedIndex, chunk) for every object in parallel and
+  // gathers what it appends to chunk into out
+  template <typename Search>
+  void batchQuery(Neighbors &out, unsigned numThreads,
+                  const Search &search) const;
+  // calls visit(sortedIndex) for objects in voxels within r of a point,
+  // until it returns false
+  template <typename Visit>
+  void visitBox(float x, float y, float z, float r, const Visit &visit) const;
+
   // safe floating-point wrapping
   static double wrap(double x, double mod);
   static double wrap(double x, double lo, double hi);
@@ -324,6 +433,14 @@ protected:
   /// a baked array mapping distance to mVoxelIndices offsets
   std::vector<uint32_t> mDistanceToVoxelIndices;
   std::vector<uint32_t> mVoxelIndicesToDistance;
+
+  /// objects sorted by voxel, made by rebuild()
+  std::vector<uint32_t> mCellStart;
+  std::vector<uint32_t> mSortedIds;
+  std::vector<float> mSortedX, mSortedY, mSortedZ;
+  bool mSorted = false;
+  // per chunk voxel counts of rebuild(), kept to reuse the allocation
+  std::vector<uint32_t> mChunkCounts;
 };
 
 // this is definitely not thread-safe.
@@ -382,6 +499,10 @@ inline int HashSpace::Query ::operator()(const HashSpace &space, Vec3d center,
   if (iminr2 < imaxr2) {
     uint32_t cellstart = space.mDistanceToVoxelIndices[iminr2];
     uint32_t cellend = space.mDistanceToVoxelIndices[imaxr2];
+    if (space.mSorted) {
+      return scanSorted(space, center, nullptr, minr2, maxr2, cellstart,
+                        cellend);
+    }
     for (uint32_t i = cellstart; i < cellend; i++) {
       uint32_t index = space.hash(center, space.mVoxelIndices[i]);
       const Voxel &voxel = space.mVoxels[index];
@@ -428,6 +549,9 @@ inline int HashSpace::Query ::operator()(const HashSpace &space,
   if (iminr2 < imaxr2) {
     uint32_t cellstart = space.mDistanceToVoxelIndices[iminr2];
     uint32_t cellend = space.mDistanceToVoxelIndices[imaxr2];
+    if (space.mSorted) {
+      return scanSorted(space, center, obj, minr2, maxr2, cellstart, cellend);
+    }
     for (uint32_t i = cellstart; i < cellend; i++) {
       uint32_t index = space.hash(center, space.mVoxelIndices[i]);
       const Voxel &voxel = space.mVoxels[index];
@@ -460,6 +584,47 @@ inline int HashSpace::Query ::operator()(const HashSpace &space,
   return nres;
 }
 
+// the sorted arrays hold positions as float; distances are computed in
+// float too and wrapped by a single period, as positions are in [0, dim).
+// The centre may lie anywhere, so it is wrapped into the space first.
+inline unsigned HashSpace::Query ::scanSorted(const HashSpace &space,
+                                              const Vec3d &queryCenter,
+                                              const Object *skip, double minr2,
+                                              double maxr2, uint32_t cellstart,
+                                              uint32_t cellend) {
+  unsigned nres = 0;
+  const Vec3d center = space.wrap(queryCenter);
+  const float dim = float(space.mDim), half = float(space.mDimHalf);
+  const float cx = float(center.x), cy = float(center.y), cz = float(center.z);
+  const uint32_t skipId =
+      skip ? uint32_t(skip - space.mObjects.data()) : invalidHash();
+  const uint32_t *starts = space.mCellStart.data();
+  const uint32_t *ids = space.mSortedIds.data();
+  const float *xs = space.mSortedX.data();
+  const float *ys = space.mSortedY.data();
+  const float *zs = space.mSortedZ.data();
+  for (uint32_t i = cellstart; i < cellend && nres < mMaxResults; i++) {
+    uint32_t index = space.hash(center, space.mVoxelIndices[i]);
+    for (uint32_t j = starts[index]; j < starts[index + 1]; j++) {
+      float dx = xs[j] - cx, dy = ys[j] - cy, dz = zs[j] - cz;
+      dx += dx > half ? -dim : (dx < -half ? dim : 0.f);
+      dy += dy > half ? -dim : (dy < -half ? dim : 0.f);
+      dz += dz > half ? -dim : (dz < -half ? dim : 0.f);
+      double d2 = dx * dx + dy * dy + dz * dz;
+      if (d2 >= minr2 && d2 <= maxr2 && ids[j] != skipId) {
+        Result r;
+        r.object = const_cast<Object *>(&space.mObjects[ids[j]]);
+        r.distanceSquared = d2;
+        mObjects.push_back(r);
+        if (++nres == mMaxResults) {
+          break;
+        }
+      }
+    }
+  }
+  return nres;
+}
+
 // of the matches, return the best:
 inline HashSpace::Object *HashSpace::Query ::nearest(const HashSpace &space,
                                                      const Object *src) {
@@ -482,6 +647,7 @@ inline HashSpace::Object *HashSpace::Query ::nearest(const HashSpace &space,
 }
 
 inline void HashSpace ::numObjects(int numObjects) {
+  mSorted = false;
   mObjects.clear();
   mObjects.resize(numObjects);
   // clear all voxels:
@@ -494,6 +660,7 @@ template <typename T>
 inline HashSpace &HashSpace ::move(uint32_t objectId, Vec<3, T> pos) {
   Object &o = mObjects[objectId];
   o.pos.set(wrap(pos));
+  mSorted = false;
   uint32_t newhash = hash(o.pos);
   if (newhash != o.hash) {
     if (o.hash != invalidHash())
@@ -506,6 +673,7 @@ inline HashSpace &HashSpace ::move(uint32_t objectId, Vec<3, T> pos) {
 
 inline HashSpace &HashSpace ::remove(uint32_t objectId) {
   Object &o = mObjects[objectId];
+  mSorted = false;
   if (o.hash != invalidHash())
     mVoxels[o.hash].remove(&o);
   o.hash = invalidHash();
@@ -0,0 +1,224 @@
+#ifndef INCLUDE_AL_SPARSEHASHSPACE_HPP
+#define INCLUDE_AL_SPARSEHASHSPACE_HPP
+
+/*  Allocore --
+  Multimedia / virtual environment application class library
+
+  File description:
+  Spatial hash of cells stored only where objects are
+
+  HashSpace allocates every voxel of a cube of power of two side, plus
+  tables sized by it, and always wraps around. SparseHashSpace keeps only
+  the occupied cells in a hash table, so memory grows with the number of
+  objects rather than with the size of the world. Each axis can wrap with
+  its own period or be unbounded.
+
+  File author(s):
+  AlloSphere Research Group
+*/
+
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "al/math/al_Vec.hpp"
+
+namespace al {
+
+/**
+ * @brief Sparse spatial hash for neighbour queries in large worlds
+ * @ingroup Spatial
+ *
+ * Objects are binned into cubic cells of a given size. Only cells holding
+ * objects are stored, keyed by their integer coordinates, which are
+ * limited to +/- 2^20 cells per axis; cells further apart than that share
+ * storage, which slows queries down but doesn't change their results.
+ *
+ * The interface follows HashSpace: objects are moved by id and found with
+ * a re-usable Query.
+@code
+    SparseHashSpace space(0.5);  // 0.5 units per cell, unbounded
+    space.numObjects(1000);
+    space.move(0, Vec3d(5000, 2, -3000));
+    SparseHashSpace::Query query(16);
+    query.clear();
+    query(space, Vec3d(5000, 2, -3000), 1.5);
+@endcode
+ */
+class SparseHashSpace {
+public:
+  /// container for registered spatial elements
+  struct Object {
+    Object() : cell(0), next(nullptr), prev(nullptr), userdata(nullptr) {}
+
+    Vec3d pos;
+    uint64_t cell;        ///< key of the cell it is in, if next is set
+    Object *next, *prev;  ///< neighbors in the same cell
+    union {               ///< a way to attach user-defined payloads:
+      uint32_t id;
+      void *userdata;
+    };
+  };
+
+  /**
+    Query functor, used as HashSpace::Query
+
+    Unlike HashSpace::Query, every object within the radius is considered
+    and, when there are more than maxResults(), the nearest are kept.
+  @ingroup Spatial
+  */
+  struct Query {
+    struct Result {
+      Object *object;
+      double distanceSquared;
+
+      static bool compare(const Result &x, const Result &y) {
+        return x.distanceSquared > y.distanceSquared;
+      }
+
+      Result() : object(0), distanceSquared(0) {}
+    };
+
+    typedef std::vector<Result> Results;
+    typedef Results::iterator Iterator;
+
+    /// @param maxResults the maximum number of results to find
+    Query(uint32_t maxResults = 128) : mMaxResults(maxResults) {
+      mObjects.reserve(maxResults);
+    }
+
+    /**
+      Find the objects near a point or an object
+
+      @param space the space to search in
+      @param center finds objects near to this point
+      @param obj finds objects near to this object, excluding it
+      @param maxRadius finds objects if they are nearer this distance
+      @param minRadius finds objects if they are beyond this distance
+      @return the number of results found
+    */
+    int operator()(const SparseHashSpace &space, Vec3d center,
+                   double maxRadius, double minRadius = 0.);
+    int operator()(const SparseHashSpace &space, const Object *obj,
+                   double maxRadius, double minRadius = 0.);
+
+    /// find the nearest objects, up to maxResults()
+    int operator()(const SparseHashSpace &space, Vec3d center) {
+      return (*this)(space, center, space.maxRadius());
+    }
+    int operator()(const SparseHashSpace &space, const Object *obj) {
+      return (*this)(space, obj, space.maxRadius());
+    }
+
+    /// find the nearest neighbor of an object, or nullptr if it is alone
+    Object *nearest(const SparseHashSpace &space, const Object *obj);
+
+    /// get number of results:
+    unsigned size() const { return mObjects.size(); }
+    /// get each result:
+    Object *operator[](unsigned i) const { return mObjects[i].object; }
+    double distanceSquared(unsigned i) const {
+      return mObjects[i].distanceSquared;
+    }
+    double distance(unsigned i) const { return sqrt(distanceSquared(i)); }
+
+    /// clear results, queries otherwise add to the previous ones
+    Query &clear() {
+      mObjects.clear();
+      return *this;
+    }
+
+    /// set the maximum number of desired results
+    Query &maxResults(uint32_t i) {
+      mMaxResults = i;
+      return *this;
+    }
+    /// get the maximum number of desired results
+    uint32_t maxResults() const { return mMaxResults; }
+
+    /// std::vector interface:
+    Iterator begin() { return mObjects.begin(); }
+    Iterator end() { return mObjects.end(); }
+    Results &results() { return mObjects; }
+
+  protected:
+    int find(const SparseHashSpace &space, const Vec3d &center,
+             const Object *skip, double maxRadius, double minRadius);
+
+    uint32_t mMaxResults;
+    Results mObjects;
+  };
+
+  /**
+    @param cellSize   side of the cells; queries are fastest with radii of
+                      one or two cells
+    @param period     size of the world along each axis, in which positions
+                      wrap around; 0 leaves the axis unbounded
+    @param numObjects number of Object slots to allocate
+  */
+  SparseHashSpace(double cellSize = 1., const Vec3d &period = Vec3d(0.),
+                  uint32_t numObjects = 0);
+
+  double cellSize() const { return mCellSize; }
+  const Vec3d &period() const { return mPeriod; }
+
+  /// the largest radius for which wrapping gives unique distances
+  double maxRadius() const;
+
+  /// get/set the number of objects, which removes them all from the space
+  void numObjects(uint32_t numObjects);
+  uint32_t numObjects() const { return mObjects.size(); }
+
+  /// get the object at a given index:
+  Object &object(uint32_t i) { return mObjects[i]; }
+  const Object &object(uint32_t i) const { return mObjects[i]; }
+
+  /// set the position of an object:
+  SparseHashSpace &move(uint32_t objectId, double x, double y, double z) {
+    return move(objectId, Vec3d(x, y, z));
+  }
+  template <typename T>
+  SparseHashSpace &move(uint32_t objectId, const Vec<3, T> &pos) {
+    return moveTo(objectId, Vec3d(pos));
+  }
+
+  /// removes the object from the space without destroying it
+  SparseHashSpace &remove(uint32_t objectId);
+
+  /// number of cells holding objects
+  size_t numCells() const { return mCells.size(); }
+
+  /// wrap a position along the axes that have a period
+  Vec3d wrap(const Vec3d &v) const;
+
+  /// wrap a vector between two positions to its shortest equivalent
+  Vec3d wrapRelative(const Vec3d &v) const;
+
+protected:
+  SparseHashSpace &moveTo(uint32_t objectId, const Vec3d &pos);
+
+  int cellIndex(double x, int axis) const;
+  static uint64_t key(int x, int y, int z) {
+    const uint64_t mask = (1 << 21) - 1;
+    return ((uint64_t(x) & mask) << 42) | ((uint64_t(y) & mask) << 21) |
+           (uint64_t(z) & mask);
+  }
+
+  // calls visit(head) for the object list of each cell that may hold
+  // objects within radius of center
+  template <typename Visit>
+  void visitCells(const Vec3d &center, double radius,
+                  const Visit &visit) const;
+
+  double mCellSize;
+  Vec3d mPeriod;
+  int mCellsPerPeriod[3];  ///< 0 for unbounded axes
+  std::vector<Object> mObjects;
+  /// first object of each occupied cell
+  std::unordered_map<uint64_t, Object *> mCells;
+};
+
+}  // namespace al
+
+#endif
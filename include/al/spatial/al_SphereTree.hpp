@@ -0,0 +1,72 @@
+#ifndef INCLUDE_AL_SPHERETREE_HPP
+#define INCLUDE_AL_SPHERETREE_HPP
+
+/*  Allocore --
+  Multimedia / virtual environment application class library
+
+  File description:
+  Bounding volume hierarchy over spheres for visibility queries
+
+  The tree is built top-down by splitting at the median center along the
+  longest axis. Nodes are axis-aligned boxes stored depth-first, so the
+  spheres below a node are a contiguous range and a node found entirely
+  inside a frustum is accepted without visiting its children.
+
+  File author(s):
+  AlloSphere Research Group
+*/
+
+#include <vector>
+
+#include "al/math/al_Frustum.hpp"
+#include "al/math/al_Vec.hpp"
+
+namespace al {
+
+/**
+ * @brief Bounding volume hierarchy of spheres
+ * @ingroup Spatial
+ *
+ * Build once when the spheres change, then query as many views as needed.
+ */
+class SphereTree {
+public:
+  /// Build tree from sphere centers and radii
+
+  /// @param[in] centers  sphere centers
+  /// @param[in] radii    sphere radii, same size as centers
+  /// @param[in] leafSize largest number of spheres in a leaf
+  void build(const std::vector<Vec3f> &centers,
+             const std::vector<float> &radii, unsigned leafSize = 4);
+
+  /// Remove all spheres
+  void clear();
+
+  /// Number of spheres in the tree
+  size_t size() const { return mCenters.size(); }
+
+  /// Find spheres inside or intersecting a frustum
+
+  /// @param[in]  frustum  frustum with planes computed
+  /// @param[out] result   indices of visible spheres are appended here, in
+  ///                      tree order
+  void query(const Frustumd &frustum, std::vector<unsigned> &result) const;
+
+private:
+  struct Node {
+    Vec3f min, max;
+    unsigned first, count;  // range in mItems
+    unsigned right;         // second child, first child follows; 0 for leaf
+  };
+
+  unsigned buildNode(unsigned first, unsigned count, unsigned leafSize);
+
+  std::vector<Node> mNodes;
+  std::vector<unsigned> mItems;  // sphere indices in tree order
+  std::vector<Vec3f> mCenters;
+  std::vector<float> mRadii;
+};
+
+} // namespace al
+
+#endif
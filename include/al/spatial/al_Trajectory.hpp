@@ -0,0 +1,170 @@
+#ifndef INCLUDE_AL_TRAJECTORY_HPP
+#define INCLUDE_AL_TRAJECTORY_HPP
+
+/*  Allocore --
+  Multimedia / virtual environment application class library
+
+  File description:
+  Keyframed pose trajectories for many objects, evaluated together
+
+  Each object follows its own list of timed key poses. Keys of all objects
+  are kept in flat arrays per component, and evaluating gathers the
+  segments that apply into blocks of objects whose splines and slerps are
+  computed several at a time with SIMD. There are no per-object calls, so
+  sampling hundreds of sources at audio block rate is cheap.
+
+  File author(s):
+  AlloSphere Research Group
+*/
+
+#include <cstdint>
+#include <vector>
+
+#include "al/math/al_Quat.hpp"
+#include "al/math/al_Vec.hpp"
+#include "al/spatial/al_Pose.hpp"
+
+namespace al {
+
+/**
+ * @brief Keyframed trajectories of a set of objects
+ * @ingroup Spatial
+ *
+ * Positions are interpolated linearly, with Catmull-Rom splines, or with
+ * Hermite splines through velocities given with the keys. Orientations
+ * use slerp between keys or squad, which keeps angular velocity continuous
+ * across keys. Before its first key and after its last an object holds
+ * still; objects without keys stay at the origin with no rotation.
+ *
+ * Key times are double, to stay exact over long running clocks, while
+ * interpolation is done in single precision.
+@code
+    Trajectories paths(100);
+    paths.positionMode(Trajectories::CATMULL_ROM);
+    paths.addKey(0, 0.0, Pose(Vec3d(0, 0, -4)));
+    paths.addKey(0, 2.0, Pose(Vec3d(4, 0, 0), Quatd().fromEuler(1.5, 0, 0)));
+    ...
+    std::vector<Vec3f> pos(100 * 64);
+    paths.sample(t, 1. / 44100, 64, pos.data(), nullptr);
+@endcode
+ */
+class Trajectories {
+public:
+  enum PositionMode {
+    LINEAR,       ///< straight lines between keys
+    CATMULL_ROM,  ///< cubic through the keys, tangents from neighbours
+    HERMITE       ///< cubic through the keys with the velocities given
+  };
+
+  enum OrientationMode {
+    SLERP,  ///< constant angular velocity between keys
+    SQUAD   ///< smooth spherical cubic through the keys
+  };
+
+  Trajectories(uint32_t numObjects = 0);
+
+  /// set the number of objects, which removes all keys
+  void numObjects(uint32_t n);
+  uint32_t numObjects() const { return uint32_t(mKeyStart.size()) - 1; }
+
+  Trajectories &positionMode(PositionMode m) {
+    mPositionMode = m;
+    return *this;
+  }
+  PositionMode positionMode() const { return mPositionMode; }
+
+  Trajectories &orientationMode(OrientationMode m) {
+    mOrientationMode = m;
+    return *this;
+  }
+  OrientationMode orientationMode() const { return mOrientationMode; }
+
+  /**
+    Replace the keys of an object
+
+    @param object     index of the object
+    @param times      time of each key, increasing
+    @param poses      pose at each key
+    @param count      number of keys
+    @param velocities velocity at each key, used by HERMITE; zero if null
+    @return false if times do not increase, leaving the keys unchanged
+  */
+  bool setKeys(uint32_t object, const double *times, const Pose *poses,
+               uint32_t count, const Vec3d *velocities = nullptr);
+
+  /// Add a key after the last one of an object, returns false if it is not
+  /// later
+  bool addKey(uint32_t object, double time, const Pose &pose,
+              const Vec3d &velocity = Vec3d(0));
+
+  /// Remove all keys of an object
+  void clearKeys(uint32_t object) { setKeys(object, nullptr, nullptr, 0); }
+
+  uint32_t numKeys(uint32_t object) const {
+    return mKeyStart[object + 1] - mKeyStart[object];
+  }
+  uint32_t numKeys() const { return mKeyStart.back(); }
+
+  /// time of the first and last key of an object, 0 without keys
+  double startTime(uint32_t object) const;
+  double endTime(uint32_t object) const;
+
+  /**
+    Evaluate all objects at a time
+
+    @param time         time to evaluate at
+    @param positions    numObjects() positions out, or null
+    @param orientations numObjects() orientations out, or null
+  */
+  void evaluate(double time, Vec3f *positions, Quatf *orientations) const;
+  void evaluate(double time, Pose *poses) const;
+
+  /**
+    Evaluate all objects at regularly spaced times, as for one block of
+    audio
+
+    Results are stored by object, so those of object i, frame j are at
+    [i * numFrames + j].
+
+    @param start        time of the first frame
+    @param step         time between frames, such as 1 / sample rate
+    @param numFrames    number of frames
+    @param positions    numObjects() * numFrames positions out, or null
+    @param orientations numObjects() * numFrames orientations out, or null
+  */
+  void sample(double start, double step, uint32_t numFrames,
+              Vec3f *positions, Quatf *orientations) const;
+
+protected:
+  // evaluates objects [begin, end) at time start + frame * step for each
+  // frame, writing object i, frame j to [(i - begin) * stride + j]
+  void evaluateRange(uint32_t begin, uint32_t end, double start, double step,
+                     uint32_t numFrames, Vec3f *positions,
+                     Quatf *orientations, size_t stride) const;
+  // makes room for count keys of an object, keeping the first ones
+  void resizeKeys(uint32_t object, uint32_t count);
+  // stores key k from a pose, in the hemisphere of the previous key
+  void storeKey(uint32_t k, double time, const Pose &pose,
+                const Vec3d &velocity, bool first);
+  // updates the spline velocities, angles and control points of an object
+  void prepare(uint32_t object);
+
+  PositionMode mPositionMode = CATMULL_ROM;
+  OrientationMode mOrientationMode = SLERP;
+
+  // keys of object i are at [mKeyStart[i], mKeyStart[i + 1])
+  std::vector<uint32_t> mKeyStart;
+  std::vector<double> mTime;
+  // positions and velocities given, and velocities for Catmull-Rom
+  std::vector<float> mPos[3], mVel[3], mSplineVel[3];
+  // orientations, each in the hemisphere of the previous one
+  std::vector<float> mQuat[4];
+  // squad control points
+  std::vector<float> mCtrl[4];
+  // angle between the orientations from each key to the next
+  std::vector<float> mAngle;
+};
+
+}  // namespace al
+
+#endif
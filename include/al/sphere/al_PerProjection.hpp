@@ -2,6 +2,7 @@
 #define INLCUDE_AL_PERPROJECTION_HPP
 
 #include <cmath>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <vector>
@@ -88,13 +89,34 @@ public:
   // std::vector<Vec3f> warp_data;
   // std::vector<float> blend_data;
   std::vector<Vec4f> warp_and_blend_data;
+
+  // derived from warp_and_blend_data, see WarpBlendData::compute_derived_data
+  Vec3f direction{0, 0, -1}; // central direction of the projection
+  float fov = 0;             // angle spanned around direction, in radians
+  bool derived_from_cache = false;
+
+  // size, modification time (ns) and file id of filepath when it was loaded
+  uint64_t file_size = 0;
+  int64_t file_modified = 0;
+  uint64_t file_id = 0;
 };
 
 class WarpBlendData {
 public:
   std::vector<ProjectionViewport> viewports;
+
+  // Loads the viewports listed in path/hostname.txt. Warp/blend files are
+  // read in parallel and their derived data is cached in path/hostname.cache,
+  // which is reused as long as the warp/blend files are unchanged.
   void load_allosphere_calibration(const char *path, const char *hostname);
   void load_desktop_mode_calibration();
+
+  // Computes direction and fov of a viewport from its warp data
+  static void compute_derived_data(ProjectionViewport &vp);
+
+  // Returns number of viewports whose derived data was found in the cache
+  int load_cache(const std::string &cache_file);
+  bool save_cache(const std::string &cache_file) const;
 };
 
 class PerProjectionRender {
@@ -0,0 +1,42 @@
+#ifndef INCLUDE_AL_PARALLEL_FOR_HPP
+#define INCLUDE_AL_PARALLEL_FOR_HPP
+
+/*	Allocore --
+        Multimedia / virtual environment application class library
+
+        File description:
+        Split a loop over an index range across threads
+
+        File author(s):
+        AlloSphere Research Group
+*/
+
+#include <cstddef>
+#include <functional>
+
+namespace al {
+
+/// Run a loop over [0, count) on several threads
+
+/// The range is split into contiguous chunks, one per thread, and
+/// func(begin, end) is called once for each chunk. The calling thread
+/// processes the last chunk itself and the call returns once all chunks are
+/// done. Small ranges run entirely on the calling thread.
+///
+/// @param[in] count       number of items
+/// @param[in] func        function called with each chunk's [begin, end)
+/// @param[in] numThreads  maximum number of threads, 0 = hardware concurrency
+/// @param[in] minChunk    minimum number of items given to a thread
+///
+/// @ingroup System
+void parallelFor(size_t count,
+                 const std::function<void(size_t begin, size_t end)> &func,
+                 unsigned numThreads = 0, size_t minChunk = 1024);
+
+/// Number of chunks parallelFor will split a range into
+unsigned parallelForChunks(size_t count, unsigned numThreads = 0,
+                           size_t minChunk = 1024);
+
+}  // namespace al
+
+#endif
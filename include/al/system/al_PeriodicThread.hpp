@@ -43,6 +43,7 @@
         File author(s):
         Lance Putnam, 2013, putnam.lance@gmail.com
 */
+#include <atomic>
 #include <functional>
 
 #include "al/system/al_Thread.hpp"
@@ -118,7 +119,7 @@ class PeriodicThread : public Thread {
   ThreadFunction* mUserFunc;
   void* mUserData;
   std::function<void(void* data)> mFunction;
-  bool mRun;
+  std::atomic<bool> mRun;
 };
 
 }  // namespace al
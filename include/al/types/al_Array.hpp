@@ -0,0 +1,187 @@
+#ifndef INCLUDE_AL_ARRAY_HPP
+#define INCLUDE_AL_ARRAY_HPP
+
+/*  Allocore --
+  Multimedia / virtual environment application class library
+
+  File description:
+  Dynamically typed, multi-component grids of up to four dimensions
+
+  File author(s):
+  AlloSphere Research Group
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "al/math/al_Vec.hpp"
+
+namespace al {
+
+/// Element types of an Array
+typedef uint8_t AlloTy;
+
+enum {
+  AlloVoidTy = 0,
+  AlloFloat32Ty,
+  AlloFloat64Ty,
+  AlloSInt8Ty,
+  AlloSInt16Ty,
+  AlloSInt32Ty,
+  AlloSInt64Ty,
+  AlloUInt8Ty,
+  AlloUInt16Ty,
+  AlloUInt32Ty,
+  AlloUInt64Ty
+};
+
+#define ALLO_ARRAY_MAX_DIMS 4
+
+/// Layout of an Array, as written to files
+struct AlloArrayHeader {
+  AlloTy type{AlloVoidTy};
+  uint8_t components{0};
+  uint8_t dimcount{0};
+  uint32_t dim[ALLO_ARRAY_MAX_DIMS]{0, 0, 0, 0};
+  /// bytes between neighbouring cells along each dimension
+  size_t stride[ALLO_ARRAY_MAX_DIMS]{0, 0, 0, 0};
+};
+
+/// Size in bytes of an element of type ty
+size_t allo_type_size(AlloTy ty);
+
+/**
+ * @brief Grid of cells of one or more components of a type set at run time
+ * @ingroup Types
+ *
+ * Cells are stored with the first dimension varying fastest. Arrays of up
+ * to three dimensions can be formatted here; headers of four are kept when
+ * read from files. Rows may be padded to an alignment with formatAligned().
+ */
+class Array {
+public:
+  Array() { data.ptr = nullptr; }
+
+  /// Array of components elements of type ty per cell, dimensions of 0 unused
+  Array(int components, AlloTy ty, uint32_t dimx, uint32_t dimy = 0,
+        uint32_t dimz = 0)
+      : Array() {
+    format(components, ty, dimx, dimy, dimz);
+  }
+
+  Array(const Array &other);
+  Array &operator=(const Array &other);
+
+  virtual ~Array() {}
+
+  /// Element type for a C++ type
+  template <typename T> static AlloTy type();
+
+  /// Set the layout and allocate zeroed cells for it
+  void format(const AlloArrayHeader &h);
+
+  void format(int components, AlloTy ty, uint32_t dimx, uint32_t dimy = 0,
+              uint32_t dimz = 0) {
+    formatAligned(components, ty, dimx, dimy, dimz, 1);
+  }
+
+  /// Set a layout of up to three dimensions with rows padded to align bytes,
+  /// 0 or 1 for no padding
+  void formatAligned(int components, AlloTy ty, uint32_t dimx, uint32_t dimy,
+                     uint32_t dimz, size_t align);
+
+  /// Set all bytes to zero
+  void zero() {
+    if (!mStorage.empty()) std::memset(data.ptr, 0, mStorage.size());
+  }
+
+  AlloTy type() const { return header.type; }
+  int components() const { return header.components; }
+  int dimcount() const { return header.dimcount; }
+  uint32_t dim(int i) const { return header.dim[i]; }
+  uint32_t width() const { return header.dim[0]; }
+  uint32_t height() const { return header.dim[1]; }
+  uint32_t depth() const { return header.dim[2]; }
+
+  /// Number of cells
+  size_t cells() const;
+
+  /// Size of the cell data in bytes
+  size_t size() const { return mStorage.size(); }
+
+  /// Pointer to the first element of a cell
+  char *cell(uint32_t x, uint32_t y = 0, uint32_t z = 0, uint32_t w = 0) {
+    return data.ptr + x * header.stride[0] + y * header.stride[1] +
+           z * header.stride[2] + w * header.stride[3];
+  }
+  const char *cell(uint32_t x, uint32_t y = 0, uint32_t z = 0,
+                   uint32_t w = 0) const {
+    return const_cast<Array *>(this)->cell(x, y, z, w);
+  }
+
+  /// Component of a cell, T must match the element type
+  template <typename T>
+  T &elem(int component, uint32_t x, uint32_t y = 0, uint32_t z = 0) {
+    return reinterpret_cast<T *>(cell(x, y, z))[component];
+  }
+
+  /// Read the components of a cell, converted to T
+  template <typename T>
+  void read(T *vals, uint32_t x, uint32_t y = 0, uint32_t z = 0) const {
+    const char *p = cell(x, y, z);
+    for (int c = 0; c < components(); c++) {
+      vals[c] = T(get(p, c));
+    }
+  }
+
+  /// Write the components of a cell, converted from T
+  template <typename T>
+  void write(const T *vals, uint32_t x, uint32_t y = 0, uint32_t z = 0) {
+    char *p = cell(x, y, z);
+    for (int c = 0; c < components(); c++) {
+      set(p, c, double(vals[c]));
+    }
+  }
+
+  /// Read the components at a position in cell units of a 3D array,
+  /// interpolated trilinearly and clamped to the edge cells
+  template <typename T> void read_interp(T *vals, const Vec3f &pos) const {
+    double tmp[256];
+    readInterp(tmp, pos);
+    for (int c = 0; c < components(); c++) {
+      vals[c] = T(tmp[c]);
+    }
+  }
+
+  void print(FILE *fp = stdout) const;
+
+  struct {
+    char *ptr;
+  } data;
+  AlloArrayHeader header;
+
+protected:
+  double get(const char *cell, int component) const;
+  void set(char *cell, int component, double value);
+  void readInterp(double *vals, const Vec3f &pos) const;
+
+  std::vector<char> mStorage;
+};
+
+template <> inline AlloTy Array::type<float>() { return AlloFloat32Ty; }
+template <> inline AlloTy Array::type<double>() { return AlloFloat64Ty; }
+template <> inline AlloTy Array::type<int8_t>() { return AlloSInt8Ty; }
+template <> inline AlloTy Array::type<char>() { return AlloSInt8Ty; }
+template <> inline AlloTy Array::type<int16_t>() { return AlloSInt16Ty; }
+template <> inline AlloTy Array::type<int32_t>() { return AlloSInt32Ty; }
+template <> inline AlloTy Array::type<int64_t>() { return AlloSInt64Ty; }
+template <> inline AlloTy Array::type<uint8_t>() { return AlloUInt8Ty; }
+template <> inline AlloTy Array::type<uint16_t>() { return AlloUInt16Ty; }
+template <> inline AlloTy Array::type<uint32_t>() { return AlloUInt32Ty; }
+template <> inline AlloTy Array::type<uint64_t>() { return AlloUInt64Ty; }
+
+} // namespace al
+
+#endif
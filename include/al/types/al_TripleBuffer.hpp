@@ -0,0 +1,93 @@
+#ifndef INCLUDE_AL_TRIPLE_BUFFER_HPP
+#define INCLUDE_AL_TRIPLE_BUFFER_HPP
+
+/*  Allocore --
+  Multimedia / virtual environment application class library
+
+  File description:
+  Handing the latest of a stream of values from one thread to another
+  without locking
+
+  File author(s):
+  AlloSphere Research Group
+*/
+
+#include <atomic>
+
+namespace al {
+
+/**
+ * @brief Lock free exchange of the latest value between two threads
+ * @ingroup Types
+ *
+ * The writer fills the value returned by write() and publishes it; the
+ * reader calls update() and then uses read(). Of the three copies kept, one
+ * belongs to each side and the third holds the newest published value, so
+ * neither side ever waits and the reader always sees a complete value.
+ * Values published while the reader is busy replace each other, so it only
+ * gets the latest one.
+@code
+    TripleBuffer<State> buffer;
+    // writer thread
+    buffer.write() = simulatedState;
+    buffer.publish();
+    // reader thread
+    buffer.update();
+    draw(buffer.read());
+@endcode
+ */
+template <class T>
+class TripleBuffer {
+public:
+  TripleBuffer() {}
+
+  /// @param[in] initial  value of all copies, and so of read() at first
+  TripleBuffer(const T &initial) {
+    for (auto &b : mBuffers) {
+      b = initial;
+    }
+  }
+
+  /// Value to fill before publish(), for the writer thread only
+  T &write() { return mBuffers[mWrite]; }
+
+  /// Make the value written the latest, for the writer thread only
+  ///
+  /// The value returned by write() afterwards holds older contents.
+  void publish() {
+    mWrite = mMiddle.exchange(mWrite | kNew, std::memory_order_acq_rel) &
+             kIndex;
+  }
+
+  /// Whether a value was published since the last update()
+  bool hasNew() const {
+    return mMiddle.load(std::memory_order_relaxed) & kNew;
+  }
+
+  /// Take the latest published value, for the reader thread only
+  /// @return false if there was none since the last call
+  bool update() {
+    if (!hasNew()) {
+      return false;
+    }
+    mRead = mMiddle.exchange(mRead, std::memory_order_acq_rel) & kIndex;
+    return true;
+  }
+
+  /// Latest value taken by update(), for the reader thread only
+  const T &read() const { return mBuffers[mRead]; }
+
+private:
+  // mMiddle holds the index of the shared copy, and kNew if it has not
+  // been read yet
+  static const int kIndex = 3, kNew = 4;
+
+  T mBuffers[3];
+  int mWrite{0};
+  std::atomic<int> mMiddle{1};
+  int mRead{2};
+};
+
+} // namespace al
+
+#endif
@@ -53,8 +53,9 @@
 #include <sstream>
 #include <string>
 #include <vector>
-#include "al/core/types/al_Conversion.hpp"
-#include "al/util/al_Array.hpp"
+#include "al/math/al_Vec.hpp"
+#include "al/types/al_Array.hpp"
+#include "al/types/al_Conversion.hpp"
 
 namespace al {
 
@@ -261,6 +262,27 @@ class Voxels : public Array {
   Array slice(Vec3f planeCenter, Vec3f planeNormal,
               std::vector<Vec3f> &finalPointList);
 
+  /// Resample an arbitrary plane through the volume into a float buffer
+
+  /// The plane/volume intersection polygon is rasterized directly, stretched
+  /// over its bounding rectangle on the plane. Samples are trilinearly
+  /// interpolated in voxel index space and pixels outside the polygon are
+  /// set to 0. Rows are split over several threads.
+  ///
+  /// @param[in]  planeCenter  point on the plane, in world units
+  /// @param[in]  planeNormal  plane normal (need not be normalized)
+  /// @param[out] out          caller-provided outWidth x outHeight buffer
+  /// @param[in]  outWidth     number of columns in out
+  /// @param[in]  outHeight    number of rows in out
+  /// @param[out] corners      if non-null, receives world positions of
+  ///                          out's corners (0,0), (w,0), (w,h), (0,h)
+  /// @param[in]  numThreads   maximum number of threads, 0 = hardware
+  ///                          concurrency
+  /// \returns false if the plane does not cross the volume
+  bool sliceInto(const Vec3f &planeCenter, const Vec3f &planeNormal,
+                 float *out, int outWidth, int outHeight,
+                 Vec3f *corners = nullptr, unsigned numThreads = 0);
+
   // mostly for saving partial changes into mrc header.
   bool writeToMRC(std::string filename, MRCHeader &header);
 
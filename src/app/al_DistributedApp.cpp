@@ -132,6 +132,9 @@ void DistributedApp::prepare() {
   } else {
     additionalConfig["broadcastAddress"] = "127.0.0.1";
   }
+  if (mFoundHost && appConfig.hasKey<std::string>("multicastGroup")) {
+    additionalConfig["multicastGroup"] = appConfig.gets("multicastGroup");
+  }
 
   osc::Recv testServer;
   // probe to check if first port available, this will determine if this
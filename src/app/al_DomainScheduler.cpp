@@ -0,0 +1,143 @@
+#include "al/app/al_DomainScheduler.hpp"
+
+#include <algorithm>
+
+using namespace al;
+
+// steps due within this many seconds are taken as due at the same time, so
+// that rounding neither delays steps nor reorders those of equal priority
+static const double timeTolerance = 1e-9;
+
+bool DomainScheduler::init(ComputationDomain *parent) {
+  bool ret = ComputationDomain::init(parent);
+  for (auto &entry : mEntries) {
+    ret &= entry.domain->init(this);
+  }
+  return ret;
+}
+
+bool DomainScheduler::cleanup(ComputationDomain *parent) {
+  bool ret = true;
+  for (auto &entry : mEntries) {
+    ret &= entry.domain->cleanup(this);
+  }
+  ret &= ComputationDomain::cleanup(parent);
+  return ret;
+}
+
+bool DomainScheduler::tick() {
+  bool ret = tickSubdomains(true);
+  ret &= advance(timeDelta());
+  ret &= tickSubdomains(false);
+  return ret;
+}
+
+bool DomainScheduler::schedule(std::shared_ptr<SynchronousDomain> domain,
+                               double rate, int priority) {
+  if (!domain || !(rate > 0) || find(domain.get())) {
+    return false;
+  }
+  Entry entry;
+  entry.domain = domain;
+  entry.period = 1.0 / rate;
+  entry.priority = priority;
+  // the first step is due one period from now
+  entry.start = mTime;
+  entry.next = 1;
+  entry.stepsThisTick = 0;
+  entry.steps = 0;
+  entry.dropped = 0;
+  mEntries.push_back(entry);
+  return true;
+}
+
+void DomainScheduler::unschedule(std::shared_ptr<SynchronousDomain> domain) {
+  for (auto entry = mEntries.begin(); entry != mEntries.end(); entry++) {
+    if (entry->domain == domain) {
+      entry->domain->cleanup(this);
+      mEntries.erase(entry);
+      break;
+    }
+  }
+}
+
+bool DomainScheduler::advance(double dt) {
+  mTime += dt;
+  auto due = [this](const Entry &e) {
+    return nextTime(e) <= mTime + timeTolerance;
+  };
+
+  for (auto &entry : mEntries) {
+    entry.stepsThisTick = 0;
+  }
+  bool ret = true;
+  while (true) {
+    // earliest step due, by priority when at the same time
+    Entry *next = nullptr;
+    for (auto &entry : mEntries) {
+      if (!due(entry) || entry.stepsThisTick >= mMaxCatchUp) {
+        continue;
+      }
+      if (!next) {
+        next = &entry;
+        continue;
+      }
+      double t = nextTime(entry), tNext = nextTime(*next);
+      if (t < tNext - timeTolerance ||
+          (t <= tNext + timeTolerance && entry.priority > next->priority)) {
+        next = &entry;
+      }
+    }
+    if (!next) {
+      break;
+    }
+    next->domain->setTimeDelta(next->period);
+    ret &= next->domain->tick();
+    next->next++;
+    next->stepsThisTick++;
+    next->steps++;
+  }
+
+  // drop the steps that could not be caught up
+  for (auto &entry : mEntries) {
+    if (due(entry)) {
+      uint64_t behind =
+          uint64_t((mTime - nextTime(entry)) / entry.period) + 1;
+      entry.next += behind;
+      entry.dropped += behind;
+    }
+  }
+  return ret;
+}
+
+const DomainScheduler::Entry *
+DomainScheduler::find(const SynchronousDomain *domain) const {
+  for (auto &entry : mEntries) {
+    if (entry.domain.get() == domain) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+double
+DomainScheduler::alpha(const std::shared_ptr<SynchronousDomain> &domain) const {
+  auto entry = find(domain.get());
+  if (!entry) {
+    return 0;
+  }
+  double a = (mTime - nextTime(*entry)) / entry->period + 1;
+  return std::min(std::max(a, 0.0), 1.0);
+}
+
+uint64_t
+DomainScheduler::steps(const std::shared_ptr<SynchronousDomain> &domain) const {
+  auto entry = find(domain.get());
+  return entry ? entry->steps : 0;
+}
+
+uint64_t DomainScheduler::droppedSteps(
+    const std::shared_ptr<SynchronousDomain> &domain) const {
+  auto entry = find(domain.get());
+  return entry ? entry->dropped : 0;
+}
@@ -141,6 +141,22 @@ void GLFWOpenGLOmniRendererDomain::drawUsingPerProjectionCapture() {
   // begin also pushes fbo, viewport, viewmat, projmat, lens, shader
   pp_render.begin(*mGraphics, mGraphics->lens(), mView.pose());
   glDrawBuffer(GL_COLOR_ATTACHMENT0);  // for fbo's output
+  if (replayOmniDraw) {
+    // projections differ only in projection matrix and eye, so one recording
+    // made with the view set by begin serves all of them. Nothing recorded
+    // depends on the projection: draws that need culling or sorting are
+    // bounded and culled and sorted again by each replay.
+    mGraphics->beginRecording(mDrawQueue);
+    onDraw(*mGraphics);
+    mGraphics->endRecording();
+  }
+  auto drawProjection = [this]() {
+    if (replayOmniDraw) {
+      mDrawQueue.replay(*mGraphics);
+    } else {
+      onDraw(*mGraphics);
+    }
+  };
   if (render_stereo) {
     for (int eye = 0; eye < 2; eye += 1) {
       pp_render.set_eye(eye);
@@ -149,7 +165,7 @@ void GLFWOpenGLOmniRendererDomain::drawUsingPerProjectionCapture() {
         gl::depthTesting(true);
         gl::depthMask(true);
         gl::blending(false);
-        onDraw(*mGraphics);
+        drawProjection();
       }
     }
   } else {
@@ -160,7 +176,7 @@ void GLFWOpenGLOmniRendererDomain::drawUsingPerProjectionCapture() {
       gl::depthTesting(true);
       gl::depthMask(true);
       gl::blending(false);
-      onDraw(*mGraphics);
+      drawProjection();
     }
   }
   pp_render.end();  // pops everything pushed before
@@ -12,3 +12,87 @@ bool SimulationDomain::tick() {
 }
 
 void SimulationDomain::disableProcessingCallback() { mUseCallback = false; }
+
+ThreadedSimulationDomain::~ThreadedSimulationDomain() { stopThread(); }
+
+bool ThreadedSimulationDomain::init(ComputationDomain *parent) {
+  (void)parent;
+  bool ret = initializeSubdomains(true);
+  ret &= initializeSubdomains(false);
+  callInitializeCallbacks();
+  return ret;
+}
+
+bool ThreadedSimulationDomain::start() {
+  if (mRunning || mStep <= 0) {
+    return false;
+  }
+  mSteps = 0;
+  mOverruns = 0;
+  mLastStepTime = 0;
+  mTotalStepTime = 0;
+  mMaxStepTime = 0;
+  setTimeDelta(mStep);
+  callStartCallbacks();
+  mRunning = true;
+  mThread.period(mStep);
+  mThread.start([this](void *) { runStep(); });
+  return true;
+}
+
+bool ThreadedSimulationDomain::stop() {
+  if (!mRunning) {
+    return true;
+  }
+  callStopCallbacks();
+  stopThread();
+  return true;
+}
+
+void ThreadedSimulationDomain::stopThread() {
+  if (mRunning) {
+    mThread.stop();
+    mRunning = false;
+  }
+}
+
+bool ThreadedSimulationDomain::cleanup(ComputationDomain *parent) {
+  (void)parent;
+  bool ret = stop();
+  callCleanupCallbacks();
+  ret &= cleanupSubdomains(true);
+  ret &= cleanupSubdomains(false);
+  return ret;
+}
+
+ThreadedSimulationDomain::Stats ThreadedSimulationDomain::stats() const {
+  Stats s;
+  s.steps = mSteps;
+  s.overruns = mOverruns;
+  s.lastStepTime = mLastStepTime;
+  s.maxStepTime = mMaxStepTime;
+  s.meanStepTime = s.steps > 0 ? mTotalStepTime / s.steps : 0.0;
+  return s;
+}
+
+void ThreadedSimulationDomain::runStep() {
+  // the step set at start(), as setStep() may be called while running
+  const double step = timeDelta();
+  al_nsec begin = al_steady_time_nsec();
+  tickSubdomains(true);
+  simulationFunction(step);
+  tickSubdomains(false);
+  ++mSteps;
+  onStep();
+  double duration = (al_steady_time_nsec() - begin) * 1e-9;
+
+  // only this thread writes the statistics
+  mLastStepTime = duration;
+  mTotalStepTime = mTotalStepTime + duration;
+  if (duration > mMaxStepTime) {
+    mMaxStepTime = duration;
+  }
+  if (duration > step) {
+    ++mOverruns;
+  }
+}
@@ -1,81 +1,25 @@
 #include "al/graphics/al_DefaultShaders.hpp"
 
-#include <iostream>
-
-#include "al/graphics/al_OpenGL.hpp"
-
-void al_print_lighting_uniforms(lighting_shader_uniforms const& u,
-                                std::string name) {
-  std::cout << name << " locations:" << std::endl;
-  std::cout << "\tglobal ambient: " << u.global_ambient << std::endl;
-  std::cout << "\tnormal matrix: " << u.normal_matrix << std::endl;
-  std::cout << "\tnumber of lights: " << u.num_lights << std::endl;
-  for (int i = 0; i < u.num_lights; i += 1) {
-    auto const& l = u.lights[i];
-    std::cout << "\t\tlight " << i << std::endl;
-    std::cout << "\t\t\tambient " << l.ambient << std::endl;
-    std::cout << "\t\t\tdiffuse " << l.diffuse << std::endl;
-    std::cout << "\t\t\tspecular " << l.specular << std::endl;
-    std::cout << "\t\t\tposition " << l.position << std::endl;
-    std::cout << "\t\t\tenabled " << l.enabled << std::endl;
-    // std::cout << "\t\t\tattenuation " << l.atten << std::endl;
-  }
-  std::cout << "\thas material: " << (u.has_material ? "yes" : "no")
-            << std::endl;
-  if (u.has_material) {
-    auto const& m = u.material;
-    std::cout << "\t\tambient: " << m.ambient << std::endl;
-    std::cout << "\t\tdiffuse: " << m.diffuse << std::endl;
-    std::cout << "\t\tspecular: " << m.specular << std::endl;
-    std::cout << "\t\tshininess: " << m.shininess << std::endl;
-    // std::cout << "\t\temission: " << m.emission << std::endl;
-  }
-}
-
-lighting_shader_uniforms al_get_lighting_uniform_locations(al::ShaderProgram& s,
-                                                           bool print_result) {
+std::string al_lighting_block_string() {
   using namespace std::string_literals;
-  lighting_shader_uniforms u;
-  /*
-      glGetUniformLocation
-          This function returns -1 if name does not correspond to
-          an active uniform variable in program
-          or if name starts with the reserved prefix "gl_".
-  */
-  u.global_ambient = glGetUniformLocation(s.id(), "light_global_ambient");
-  u.normal_matrix = glGetUniformLocation(s.id(), "al_NormalMatrix");
-  for (int i = 0; i < al_max_num_lights(); i += 1) {
-    per_light_uniform_locations l;
-    auto light_i = "light"s + std::to_string(i);  // light0, light1, ...
-    l.ambient = glGetUniformLocation(s.id(), (light_i + "_ambient"s).c_str());
-    l.diffuse = glGetUniformLocation(s.id(), (light_i + "_diffuse"s).c_str());
-    l.specular = glGetUniformLocation(s.id(), (light_i + "_specular"s).c_str());
-    l.position = glGetUniformLocation(s.id(), (light_i + "_eye"s).c_str());
-    l.enabled = glGetUniformLocation(s.id(), (light_i + "_enabled"s).c_str());
-    // l.atten = s.getUniformLocation("");
-    if (l.ambient != -1 && l.diffuse != -1 && l.specular != -1 &&
-        l.position != -1) {
-      u.lights.push_back(l);
-      u.num_lights = i + 1;
-    } else
-      break;
-  }
-  auto& m = u.material;
-  m.ambient = glGetUniformLocation(s.id(), "material_ambient");
-  m.diffuse = glGetUniformLocation(s.id(), "material_diffuse");
-  m.specular = glGetUniformLocation(s.id(), "material_specular");
-  m.shininess = glGetUniformLocation(s.id(), "material_shininess");
-  // m.emission = s.getUniformLocation("");
-  if (m.ambient != -1 && m.diffuse != -1 && m.specular != -1 &&
-      m.shininess != -1) {
-    u.has_material = true;
-  }
-
-  if (print_result) {
-    al_print_lighting_uniforms(u);
-  }
-
-  return u;
+  return R"(
+struct al_Light {
+  vec4 ambient;
+  vec4 diffuse;
+  vec4 specular;
+  vec4 eye; // position in eye space
+  float enabled;
+};
+layout (std140) uniform al_LightingBlock {
+  vec4 al_global_ambient;
+  vec4 al_material_ambient;
+  vec4 al_material_diffuse;
+  vec4 al_material_specular;
+  float al_material_shininess;
+  al_Light al_lights[)"s +
+         std::to_string(al_max_num_lights()) + R"(];
+};
+)"s;
 }
 
 namespace al {
@@ -124,7 +68,7 @@ layout (location = 0) in vec3 position;
 layout (location = 3) in vec3 normal;
 out vec3 normal_eye;
 out vec3 eye_dir;
-)";
+)" + al_lighting_block_string();
 }
 
 std::string multilight_vert_header_pertype(ShaderType type) {
@@ -155,7 +99,6 @@ std::string multilight_vert_header_perlight(int num_lights) {
   std::string s = "\n";
   for (int i = 0; i < num_lights; i += 1) {
     auto light_i = "light"s + std::to_string(i);  // light0, light1, ...
-    s += "uniform vec4 "s + light_i + "_eye;\n"s;
     s += "out vec3 "s + light_i + "_dir;\n"s;
     // s += "out float "s + light_i + "_dist;\n"s;
   }
@@ -204,9 +147,10 @@ std::string multilight_vert_body_perlight(int num_lights) {
   std::string s = "\n";
   for (int i = 0; i < num_lights; i += 1) {
     auto li = "light"s + std::to_string(i);  // light0, light1, ...
-    // light0_dir = light0_eye.xyz - vert_eye.xyz * light0_eye.a;
-    s += "    "s + li + "_dir = "s + li + "_eye.xyz - vert_eye.xyz * "s + li +
-         "_eye.a;\n"s;
+    auto eye = "al_lights["s + std::to_string(i) + "].eye"s;
+    // light0_dir = al_lights[0].eye.xyz - vert_eye.xyz * al_lights[0].eye.a;
+    s += "    "s + li + "_dir = "s + eye + ".xyz - vert_eye.xyz * "s + eye +
+         ".a;\n"s;
     // light0_dist = length(light0_dir);
     // s += "    "s + li + "_dist = length("s + li + "_dir);\n"s;
   }
@@ -220,9 +164,8 @@ std::string multilight_frag_header_common() {
 in vec3 normal_eye;
 in vec3 eye_dir;
 out vec4 frag_color;
-uniform vec4 light_global_ambient;
 uniform vec4 tint;
-)";
+)" + al_lighting_block_string();
 }
 
 std::string multilight_frag_header_pertype(ShaderType type) {
@@ -244,12 +187,7 @@ in vec2 texcoord_;
 uniform sampler2D tex0;
 )";
     case ShaderType::LIGHTING_MATERIAL:
-      return R"(
-uniform vec4 material_ambient;
-uniform vec4 material_diffuse;
-uniform vec4 material_specular;
-uniform float material_shininess;
-)";
+      return "";
   }
   return "";
 }
@@ -261,10 +199,6 @@ std::string multilight_frag_header_perlight(int num_lights) {
     auto light_i = "light"s + std::to_string(i);  // light0, light1, ...
     s += "in vec3 "s + light_i + "_dir;\n"s;
     // s += "in float "s + light_i + "_dist;\n"s;
-    s += "uniform vec4 "s + light_i + "_ambient;\n"s;
-    s += "uniform vec4 "s + light_i + "_diffuse;\n"s;
-    s += "uniform vec4 "s + light_i + "_specular;\n"s;
-    s += "uniform float "s + light_i + "_enabled;\n"s;
     // TODO: atten
   }
   return s;
@@ -309,10 +243,10 @@ std::string multilight_frag_body_pertype(ShaderType type) {
 )";
     case ShaderType::LIGHTING_MATERIAL:
       return R"(
-    vec3 ambient = material_ambient.rgb * material_ambient.a;
-    vec3 diffuse = material_diffuse.rgb * material_diffuse.a;
-    vec3 specular = material_specular.rgb * material_specular.a;
-    float shininess = material_shininess;
+    vec3 ambient = al_material_ambient.rgb * al_material_ambient.a;
+    vec3 diffuse = al_material_diffuse.rgb * al_material_diffuse.a;
+    vec3 specular = al_material_specular.rgb * al_material_specular.a;
+    float shininess = al_material_shininess;
 )";
   }
   return "";
@@ -328,15 +262,15 @@ std::string multilight_frag_body_perlight(int num_lights) {
 )";
   for (int i = 0; i < num_lights; i += 1) {
     auto light_i = "light"s + std::to_string(i);  // light0, light1, ...
+    auto l = "al_lights["s + std::to_string(i) + "]"s;
     s += "\n"s;
     s += "    d = normalize("s + light_i + "_dir);\n"s;
     s += "    r = -reflect(d, n);\n"s;
     s += "    n_d = max(dot(n, d), 0.0);\n"s;
     s += "    e_r = max(dot(e, r), 0.0);\n"s;
-    s += "    lighting += "s + light_i + "_enabled * ("s + "ambient * "s +
-         light_i + "_ambient.rgb + "s + "diffuse * "s + light_i +
-         "_diffuse.rgb * n_d + "s + "specular * "s + light_i +
-         "_specular.rgb * pow(e_r, shininess));\n"s;
+    s += "    lighting += "s + l + ".enabled * ("s + "ambient * "s + l +
+         ".ambient.rgb + "s + "diffuse * "s + l + ".diffuse.rgb * n_d + "s +
+         "specular * "s + l + ".specular.rgb * pow(e_r, shininess));\n"s;
     // TODO: atten
   }
   return s;
@@ -344,7 +278,7 @@ std::string multilight_frag_body_perlight(int num_lights) {
 
 std::string multilight_frag_body_end() {
   return R"(
-    lighting += ambient * light_global_ambient.rgb;
+    lighting += ambient * al_global_ambient.rgb;
     frag_color = tint * vec4(lighting, 1.0);
 }
 )";
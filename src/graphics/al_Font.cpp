@@ -1,20 +1,56 @@
 #include "al/graphics/al_Font.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
 #include <iostream>
-#include <unordered_map>
+#include <memory>
 #include <vector>
 
 #include "al_stb_font.hpp"
 
 namespace al {
 
+namespace {
+// glyphs baked by al_stb::loadFont
+const uint32_t firstGlyph = 32;
+const uint32_t lastGlyph = 126;
+const uint32_t replacementChar = 0xFFFD;
+}  // namespace
+
 struct Font::Impl {
   al_stb::FontData fontData;
-  std::unordered_map<int, al_stb::CharData> cachedData;
+  // flat table indexed by codepoint, filled on load
+  std::vector<al_stb::CharData> glyphs;
+  std::vector<bool> present;
+  TextLayout scratch;
+
+  // glyphs rasterized on first use, see Font::loadDynamic
+  al_stb::FaceData face;
+  std::unique_ptr<GlyphAtlas> atlas;
+  al_stb::CharData atlasGlyph;
+
+  const al_stb::CharData &glyph(uint32_t c) {
+    if (atlas) {
+      const GlyphAtlas::Glyph *g = atlas->glyph(c);
+      if (!g) {
+        g = atlas->glyph('?');
+      }
+      if (!g) {
+        atlasGlyph = al_stb::CharData{0, 0, 0, 0, 0, 0, 0, 0, 0};
+      } else {
+        atlasGlyph = al_stb::CharData{g->x0, g->y0, g->x1, g->y1, g->s0,
+                                      g->t0, g->s1, g->t1, g->xAdvance};
+      }
+      return atlasGlyph;
+    }
+    if (c < glyphs.size() && present[c]) {
+      return glyphs[c];
+    }
+    return glyphs['?'];
+  }
 };
 
 Font::Font() {
@@ -41,6 +77,14 @@ bool Font::load(const char* filename, int fontSize, int bitmapSize) {
   if (impl->fontData.charData.size() == 0) {
     return false;
   }
+  impl->atlas.reset();
+  impl->face = al_stb::FaceData();
+  impl->glyphs.assign(lastGlyph + 1, al_stb::CharData());
+  impl->present.assign(lastGlyph + 1, false);
+  for (uint32_t c = firstGlyph; c <= lastGlyph; ++c) {
+    impl->glyphs[c] = al_stb::getCharData(&impl->fontData, c);
+    impl->present[c] = true;
+  }
   tex.create2D(impl->fontData.width, impl->fontData.height, GL_R8, GL_RED,
                GL_UNSIGNED_BYTE);
   tex.submit(impl->fontData.bitmap.data());
@@ -53,58 +97,181 @@ bool Font::load(const char* filename, int fontSize, int bitmapSize) {
   return true;
 }
 
-void Font::write(Mesh& mesh, const char* text, float worldHeight) {
-  assert(impl->fontData.charData.size() > 0 && "Error - font not loaded.");
-  mesh.reset();
+bool Font::loadDynamic(const char* filename, int fontSize, int atlasSize) {
+  impl->face = al_stb::loadFace(filename, (float)fontSize);
+  if (impl->face.file.empty()) {
+    return false;
+  }
+  impl->fontData = al_stb::FontData();
+  impl->fontData.pixelHeight = (float)fontSize;
+  impl->glyphs.clear();
+  impl->present.clear();
+  impl->atlas.reset(new GlyphAtlas(atlasSize, atlasSize));
+  al_stb::FaceData* face = &impl->face;
+  impl->atlas->rasterizer([face](uint32_t c, GlyphAtlas::Bitmap& b) {
+    al_stb::GlyphData d;
+    if (!al_stb::rasterizeGlyph(face, int(c), &d)) {
+      return false;
+    }
+    b.width = d.width;
+    b.height = d.height;
+    b.x0 = d.x0;
+    b.y0 = d.y0;
+    b.xAdvance = d.xAdvance;
+    b.pixels.swap(d.bitmap);
+    return true;
+  });
+
+  // contents are uploaded by uploadGlyphs
+  tex.create2D(atlasSize, atlasSize, GL_R8, GL_RED, GL_UNSIGNED_BYTE);
+  tex.filter(GL_LINEAR);
+  tex.bind_temp();
+  GLint swizzleMask[] = {GL_ONE, GL_ONE, GL_ONE, GL_RED};
+  glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzleMask);
+  tex.unbind_temp();
+  return true;
+}
+
+void Font::uploadGlyphs() {
+  if (!impl->atlas || impl->atlas->dirtyRects().empty()) {
+    return;
+  }
+  GlyphAtlas& atlas = *impl->atlas;
+  tex.bind_temp();
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, atlas.width());
+  for (auto& r : atlas.dirtyRects()) {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, r.x, r.y, r.w, r.h, GL_RED,
+                    GL_UNSIGNED_BYTE,
+                    atlas.pixels().data() + size_t(r.y) * atlas.width() + r.x);
+  }
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  tex.unbind_temp();
+  atlas.clearDirty();
+}
 
-  float xpos = 0;
-  float scale = worldHeight / impl->fontData.pixelHeight;
-
-  auto* cache = &(impl->cachedData);
-  auto* fontData = &(impl->fontData);
-
-  auto cdata = [cache, fontData](int c) -> const al_stb::CharData& {
-    auto search = cache->find(c);
-    if (search != cache->end())
-      return search->second;
-    else
-      return ((*cache)[c] = al_stb::getCharData(fontData, c));
-  };
-
-  while (*text) {
-    int c = *text;
-    auto d = cdata(c);
-
-    float x0 = xpos + d.x0 * scale;
-    float x1 = xpos + d.x1 * scale;
-    float y0 = -d.y0 * scale;
-    float y1 = -d.y1 * scale;
-
-    mesh.vertex(x0, y0, 0);
-    mesh.vertex(x1, y0, 0);
-    mesh.vertex(x0, y1, 0);
-    mesh.vertex(x0, y1, 0);
-    mesh.vertex(x1, y0, 0);
-    mesh.vertex(x1, y1, 0);
-
-    mesh.texCoord(d.s0, d.t0);
-    mesh.texCoord(d.s1, d.t0);
-    mesh.texCoord(d.s0, d.t1);
-    mesh.texCoord(d.s0, d.t1);
-    mesh.texCoord(d.s1, d.t0);
-    mesh.texCoord(d.s1, d.t1);
-
-    xpos += d.xAdvance * scale;
+unsigned long Font::generation() const {
+  return impl->atlas ? impl->atlas->generation() : 0;
+}
+
+GlyphAtlas* Font::atlas() { return impl->atlas.get(); }
 
+uint32_t Font::decodeUTF8(const char*& text) {
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(text);
+  uint32_t c = p[0];
+  int length;
+  uint32_t min;
+  if (c < 0x80) {
+    ++text;
+    return c;
+  } else if ((c & 0xE0) == 0xC0) {
+    length = 2;
+    c &= 0x1F;
+    min = 0x80;
+  } else if ((c & 0xF0) == 0xE0) {
+    length = 3;
+    c &= 0x0F;
+    min = 0x800;
+  } else if ((c & 0xF8) == 0xF0) {
+    length = 4;
+    c &= 0x07;
+    min = 0x10000;
+  } else {
+    ++text;
+    return replacementChar;
+  }
+  for (int i = 1; i < length; ++i) {
+    // also stops at the terminating zero
+    if ((p[i] & 0xC0) != 0x80) {
+      ++text;
+      return replacementChar;
+    }
+    c = (c << 6) | (p[i] & 0x3F);
+  }
+  // reject overlong encodings, surrogates and values past U+10FFFF
+  if (c < min || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) {
     ++text;
+    return replacementChar;
+  }
+  text += length;
+  return c;
+}
+
+void Font::layout(TextLayout& out, const char* text, float worldHeight) {
+  assert((impl->glyphs.size() > 0 || impl->atlas) &&
+         "Error - font not loaded.");
+  // a glyph atlas that fills up moves the glyphs laid out so far, in which
+  // case layout is done once more
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    unsigned long start = generation();
+    out.clear();
+
+    float xpos = 0;
+    float ypos = 0;
+    float scale = worldHeight / impl->fontData.pixelHeight;
+
+    for (const char* p = text; *p;) {
+      uint32_t c = decodeUTF8(p);
+      if (c == '\n') {
+        out.width = std::max(out.width, xpos);
+        xpos = 0;
+        ypos -= worldHeight;
+        continue;
+      }
+      const al_stb::CharData& d = impl->glyph(c);
+
+      float x0 = xpos + d.x0 * scale;
+      float x1 = xpos + d.x1 * scale;
+      float y0 = ypos - d.y0 * scale;
+      float y1 = ypos - d.y1 * scale;
+
+      out.vertices.emplace_back(x0, y0, 0);
+      out.vertices.emplace_back(x1, y0, 0);
+      out.vertices.emplace_back(x0, y1, 0);
+      out.vertices.emplace_back(x1, y1, 0);
+
+      out.texCoords.emplace_back(d.s0, d.t0);
+      out.texCoords.emplace_back(d.s1, d.t0);
+      out.texCoords.emplace_back(d.s0, d.t1);
+      out.texCoords.emplace_back(d.s1, d.t1);
+
+      xpos += d.xAdvance * scale;
+    }
+    out.width = std::max(out.width, xpos);
+    if (generation() == start) {
+      break;
+    }
+  }
+}
+
+void Font::append(Mesh& mesh, const TextLayout& layout, const Vec3f& position,
+                  float alignFactor) {
+  Vec3f offset = position + Vec3f(layout.width * alignFactor, 0, 0);
+  auto first = (unsigned int)mesh.vertices().size();
+  auto& vertices = mesh.vertices();
+  auto& texCoords = mesh.texCoord2s();
+  vertices.reserve(vertices.size() + layout.vertices.size());
+  for (auto& v : layout.vertices) {
+    vertices.push_back(v + offset);
   }
+  texCoords.insert(texCoords.end(), layout.texCoords.begin(),
+                   layout.texCoords.end());
 
-  float xOffset = xpos * alignFactorX;
-  for (auto& v : mesh.vertices()) {
-    v.x = v.x + xOffset;
+  auto& indices = mesh.indices();
+  indices.reserve(indices.size() + layout.glyphs() * 6);
+  for (unsigned int i = first; i < vertices.size(); i += 4) {
+    mesh.index(i, i + 1, i + 2, i + 2, i + 1, i + 3);
   }
 }
 
+void Font::write(Mesh& mesh, const char* text, float worldHeight) {
+  mesh.reset();
+  mesh.primitive(Mesh::TRIANGLES);
+  layout(impl->scratch, text, worldHeight);
+  append(mesh, impl->scratch, Vec3f(0), alignFactorX);
+}
+
 std::string Font::defaultFont() {
 #ifdef AL_WINDOWS
   std::string fontDir = "C:/Windows/Fonts";
@@ -140,4 +307,119 @@ float Font::width(const char* text) const {
 }
 #endif
 
+size_t TextBatch::add(const std::string& text, const Vec3f& position,
+                      float worldHeight, float alignFactor) {
+  if (mLabels.empty()) {
+    mGeneration = mFont->generation();
+  }
+  mLabels.emplace_back();
+  Label& l = mLabels.back();
+  l.text = text;
+  l.position = position;
+  l.height = worldHeight;
+  l.align = alignFactor;
+  relayout(l);
+  mRebuild = true;
+  return mLabels.size() - 1;
+}
+
+void TextBatch::text(size_t label, const std::string& text) {
+  Label& l = mLabels[label];
+  if (l.text == text) {
+    return;
+  }
+  l.text = text;
+  size_t glyphs = l.layout.glyphs();
+  relayout(l);
+  if (l.layout.glyphs() == glyphs) {
+    l.dirty = true;
+    mPatch = true;
+  } else {
+    mRebuild = true;
+  }
+}
+
+void TextBatch::position(size_t label, const Vec3f& position) {
+  Label& l = mLabels[label];
+  if (l.position == position) {
+    return;
+  }
+  l.position = position;
+  l.dirty = true;
+  mPatch = true;
+}
+
+void TextBatch::clear() {
+  mLabels.clear();
+  mRebuild = true;
+}
+
+void TextBatch::relayout(Label& l) {
+  mFont->layout(l.layout, l.text.c_str(), l.height);
+  ++mLayouts;
+}
+
+void TextBatch::writeLabel(const Label& l) {
+  Vec3f offset = l.position + Vec3f(l.layout.width * l.align, 0, 0);
+  auto& vertices = mMesh.vertices();
+  auto& texCoords = mMesh.texCoord2s();
+  for (size_t i = 0; i < l.layout.vertices.size(); ++i) {
+    vertices[l.firstVertex + i] = l.layout.vertices[i] + offset;
+    texCoords[l.firstVertex + i] = l.layout.texCoords[i];
+  }
+}
+
+bool TextBatch::update() {
+  // glyphs moved in the font atlas, texture coordinates are stale
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    if (mGeneration == mFont->generation()) {
+      break;
+    }
+    mGeneration = mFont->generation();
+    for (auto& l : mLabels) {
+      relayout(l);
+    }
+    mRebuild = true;
+  }
+
+  if (mRebuild) {
+    mMesh.reset();
+    mMesh.primitive(Mesh::TRIANGLES);
+    for (auto& l : mLabels) {
+      l.firstVertex = mMesh.vertices().size();
+      l.dirty = false;
+      Font::append(mMesh, l.layout, l.position, l.align);
+    }
+  } else if (mPatch) {
+    // same glyph counts: labels keep their place in the mesh
+    for (auto& l : mLabels) {
+      if (l.dirty) {
+        writeLabel(l);
+        l.dirty = false;
+      }
+    }
+  } else {
+    return false;
+  }
+  mRebuild = false;
+  mPatch = false;
+  mUpload = true;
+  return true;
+}
+
+void TextBatch::render(Graphics& g) {
+  update();
+  mFont->uploadGlyphs();
+  if (mUpload) {
+    mMesh.update();
+    mUpload = false;
+  }
+  g.blending(true);
+  g.blendTrans();
+  g.texture();
+  mFont->tex.bind();
+  g.draw(mMesh);
+  mFont->tex.unbind();
+}
+
 }  // namespace al
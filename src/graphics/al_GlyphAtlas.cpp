@@ -0,0 +1,242 @@
+#include "al/graphics/al_GlyphAtlas.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace al {
+
+namespace {
+// past this many dirty rects, a single bounding rect is uploaded instead
+const size_t maxDirtyRects = 64;
+// unknown codepoints remembered to avoid rasterizing them again
+const size_t maxMissing = 4096;
+}  // namespace
+
+GlyphAtlas::GlyphAtlas(int width, int height, int padding)
+    : mWidth(width), mHeight(height), mPadding(padding) {
+  clear();
+}
+
+void GlyphAtlas::clear() {
+  mPixels.assign(size_t(mWidth) * mHeight, 0);
+  mSkyline.assign(1, SkylineNode{0, 0, mWidth});
+  mGlyphs.clear();
+  mMissing.clear();
+  mDirty.assign(1, Rect{0, 0, mWidth, mHeight});
+  ++mGeneration;
+}
+
+bool GlyphAtlas::fits(size_t node, int w, int h, int &y) const {
+  int x = mSkyline[node].x;
+  if (x + w > mWidth) {
+    return false;
+  }
+  // rest on the highest node under the span
+  y = 0;
+  int left = w;
+  for (size_t i = node; left > 0; ++i) {
+    y = std::max(y, mSkyline[i].y);
+    if (y + h > mHeight) {
+      return false;
+    }
+    left -= mSkyline[i].w;
+  }
+  return true;
+}
+
+bool GlyphAtlas::place(int w, int h, Rect &r) {
+  // bottom left rule: lowest top edge, then leftmost
+  size_t best = mSkyline.size();
+  int bestY = mHeight, bestX = mWidth;
+  for (size_t i = 0; i < mSkyline.size(); ++i) {
+    int y;
+    if (fits(i, w, h, y) &&
+        (y < bestY || (y == bestY && mSkyline[i].x < bestX))) {
+      best = i;
+      bestY = y;
+      bestX = mSkyline[i].x;
+    }
+  }
+  if (best == mSkyline.size()) {
+    return false;
+  }
+
+  r = Rect{bestX, bestY, w, h};
+  mSkyline.insert(mSkyline.begin() + best, SkylineNode{bestX, bestY + h, w});
+  // trim nodes now covered by the new one
+  for (size_t i = best + 1; i < mSkyline.size();) {
+    SkylineNode &prev = mSkyline[i - 1];
+    SkylineNode &n = mSkyline[i];
+    int overlap = prev.x + prev.w - n.x;
+    if (overlap <= 0) {
+      break;
+    }
+    if (overlap < n.w) {
+      n.x += overlap;
+      n.w -= overlap;
+      break;
+    }
+    mSkyline.erase(mSkyline.begin() + i);
+  }
+  // merge neighbours at the same height
+  for (size_t i = 1; i < mSkyline.size();) {
+    if (mSkyline[i - 1].y == mSkyline[i].y) {
+      mSkyline[i - 1].w += mSkyline[i].w;
+      mSkyline.erase(mSkyline.begin() + i);
+    } else {
+      ++i;
+    }
+  }
+  return true;
+}
+
+void GlyphAtlas::markDirty(const Rect &r) {
+  if (mDirty.size() < maxDirtyRects) {
+    mDirty.push_back(r);
+    return;
+  }
+  Rect &b = mDirty[0];
+  for (size_t i = 1; i < mDirty.size(); ++i) {
+    const Rect &d = mDirty[i];
+    int x1 = std::max(b.x + b.w, d.x + d.w);
+    int y1 = std::max(b.y + b.h, d.y + d.h);
+    b.x = std::min(b.x, d.x);
+    b.y = std::min(b.y, d.y);
+    b.w = x1 - b.x;
+    b.h = y1 - b.y;
+  }
+  mDirty.resize(1);
+  int x1 = std::max(b.x + b.w, r.x + r.w);
+  int y1 = std::max(b.y + b.h, r.y + r.h);
+  b.x = std::min(b.x, r.x);
+  b.y = std::min(b.y, r.y);
+  b.w = x1 - b.x;
+  b.h = y1 - b.y;
+}
+
+void GlyphAtlas::setTexCoords(Glyph &g) {
+  g.s0 = float(g.rect.x) / mWidth;
+  g.t0 = float(g.rect.y) / mHeight;
+  g.s1 = float(g.rect.x + g.rect.w) / mWidth;
+  g.t1 = float(g.rect.y + g.rect.h) / mHeight;
+}
+
+const GlyphAtlas::Glyph *GlyphAtlas::glyph(uint32_t codepoint) {
+  auto it = mGlyphs.find(codepoint);
+  if (it != mGlyphs.end()) {
+    it->second.lastUsed = ++mTick;
+    return &it->second;
+  }
+  if (!mRasterizer || mMissing.count(codepoint)) {
+    return nullptr;
+  }
+
+  Bitmap b;
+  bool rasterized = mRasterizer(codepoint, b);
+  if (rasterized) {
+    ++mRasterized;
+  }
+  // glyphs larger than the atlas will never fit, so they count as missing
+  if (!rasterized || b.width + mPadding > mWidth ||
+      b.height + mPadding > mHeight) {
+    markMissing(codepoint);
+    return nullptr;
+  }
+
+  Glyph g;
+  g.x0 = b.x0;
+  g.y0 = b.y0;
+  g.x1 = b.x0 + b.width;
+  g.y1 = b.y0 + b.height;
+  g.xAdvance = b.xAdvance;
+  g.lastUsed = ++mTick;
+  // empty glyphs such as space take no room
+  if (b.width > 0 && b.height > 0) {
+    Rect padded;
+    if (!place(b.width + mPadding, b.height + mPadding, padded)) {
+      compact();
+      if (!place(b.width + mPadding, b.height + mPadding, padded)) {
+        // too large for the room compact() leaves
+        markMissing(codepoint);
+        return nullptr;
+      }
+    }
+    g.rect = Rect{padded.x, padded.y, b.width, b.height};
+    for (int row = 0; row < b.height; ++row) {
+      std::memcpy(&mPixels[size_t(g.rect.y + row) * mWidth + g.rect.x],
+                  &b.pixels[size_t(row) * b.width], b.width);
+    }
+    markDirty(g.rect);
+  }
+  setTexCoords(g);
+  return &(mGlyphs[codepoint] = g);
+}
+
+void GlyphAtlas::markMissing(uint32_t codepoint) {
+  if (mMissing.size() >= maxMissing) {
+    mMissing.clear();
+  }
+  mMissing.insert(codepoint);
+}
+
+void GlyphAtlas::compact() {
+  // most recently used first
+  std::vector<std::pair<uint64_t, uint32_t>> order;
+  order.reserve(mGlyphs.size());
+  for (auto &entry : mGlyphs) {
+    order.emplace_back(entry.second.lastUsed, entry.first);
+  }
+  std::sort(order.begin(), order.end(),
+            [](const std::pair<uint64_t, uint32_t> &a,
+               const std::pair<uint64_t, uint32_t> &b) {
+              return a.first > b.first;
+            });
+
+  // keep up to half the area, so the next misses don't compact again
+  size_t budget = size_t(mWidth) * mHeight / 2;
+  size_t used = 0;
+  std::vector<uint32_t> keep;
+  for (auto &o : order) {
+    Glyph &g = mGlyphs[o.second];
+    size_t area = size_t(g.rect.w + mPadding) * (g.rect.h + mPadding);
+    if (g.rect.w == 0 || used + area <= budget) {
+      used += g.rect.w ? area : 0;
+      keep.push_back(o.second);
+    } else {
+      mGlyphs.erase(o.second);
+      ++mEvicted;
+    }
+  }
+  // tallest first packs tighter
+  std::sort(keep.begin(), keep.end(), [this](uint32_t a, uint32_t b) {
+    return mGlyphs[a].rect.h > mGlyphs[b].rect.h;
+  });
+
+  std::vector<uint8_t> old(size_t(mWidth) * mHeight, 0);
+  old.swap(mPixels);
+  mSkyline.assign(1, SkylineNode{0, 0, mWidth});
+  for (uint32_t c : keep) {
+    Glyph &g = mGlyphs[c];
+    if (g.rect.w == 0) {
+      continue;
+    }
+    Rect padded;
+    if (!place(g.rect.w + mPadding, g.rect.h + mPadding, padded)) {
+      mGlyphs.erase(c);
+      ++mEvicted;
+      continue;
+    }
+    for (int row = 0; row < g.rect.h; ++row) {
+      std::memcpy(&mPixels[size_t(padded.y + row) * mWidth + padded.x],
+                  &old[size_t(g.rect.y + row) * mWidth + g.rect.x],
+                  g.rect.w);
+    }
+    g.rect.x = padded.x;
+    g.rect.y = padded.y;
+    setTexCoords(g);
+  }
+  mDirty.assign(1, Rect{0, 0, mWidth, mHeight});
+  ++mGeneration;
+}
+
+}  // namespace al
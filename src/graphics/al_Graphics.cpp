@@ -1,5 +1,9 @@
 #include "al/graphics/al_Graphics.hpp"
 
+#include <cstring>
+
+#include "al/graphics/al_RenderQueue.hpp"
+
 // #include <stdio.h>
 // #include <iostream>
 
@@ -12,101 +16,50 @@ const float Graphics::MONO_EYE = 0.0f;
 void Graphics::init() {
   if (initialized) return;
 
-  compileDefaultShader(color_shader, ShaderType::COLOR);
-  compileDefaultShader(mesh_shader, ShaderType::MESH);
-  compileDefaultShader(tex_shader, ShaderType::TEXTURE);
-
-  color_location = color_shader.getUniformLocation("col0");
-  color_tint_location = color_shader.getUniformLocation("tint");
-  tex_tint_location = tex_shader.getUniformLocation("tint");
-  mesh_tint_location = mesh_shader.getUniformLocation("tint");
-
-  tex_shader.begin();
-  tex_shader.uniform("tex0", 0);
-  tex_shader.end();
+  const ShaderType types[] = {ShaderType::COLOR, ShaderType::MESH,
+                              ShaderType::TEXTURE};
+  const ShaderType lighting_types[] = {
+      ShaderType::LIGHTING_COLOR, ShaderType::LIGHTING_MESH,
+      ShaderType::LIGHTING_TEXTURE, ShaderType::LIGHTING_MATERIAL};
+
+  for (int omni = 0; omni < 2; omni += 1) {
+    for (int l = 0; l <= al_max_num_lights(); l += 1) {
+      for (int t = 0; t < num_default_types; t += 1) {
+        auto& s = default_shaders[omni][l][t];
+        if (l == 0) {
+          // unlit MATERIAL draws with the UNIFORM shader
+          if (t == int(ColoringMode::MATERIAL)) continue;
+          compileDefaultShader(s, types[t], omni);
+        } else {
+          compileMultiLightShader(s, lighting_types[t], l, omni);
+          unsigned block = glGetUniformBlockIndex(s.id(), "al_LightingBlock");
+          if (block != GL_INVALID_INDEX) {
+            glUniformBlockBinding(s.id(), block, al_lighting_block_binding());
+          }
+        }
 
-  for (int i = 0; i < al_max_num_lights(); i += 1) {
-    compileMultiLightShader(lighting_color_shader[i],
-                            ShaderType::LIGHTING_COLOR, i + 1);
-    compileMultiLightShader(lighting_mesh_shader[i], ShaderType::LIGHTING_MESH,
-                            i + 1);
-    compileMultiLightShader(lighting_tex_shader[i],
-                            ShaderType::LIGHTING_TEXTURE, i + 1);
-    compileMultiLightShader(lighting_material_shader[i],
-                            ShaderType::LIGHTING_MATERIAL, i + 1);
-
-    lighting_color_location[i] =
-        lighting_color_shader[i].getUniformLocation("col0");
-    lighting_color_tint_location[i] =
-        lighting_color_shader[i].getUniformLocation("tint");
-    lighting_mesh_tint_location[i] =
-        lighting_mesh_shader[i].getUniformLocation("tint");
-    lighting_tex_tint_location[i] =
-        lighting_tex_shader[i].getUniformLocation("tint");
-    lighting_material_tint_location[i] =
-        lighting_material_shader[i].getUniformLocation("tint");
-
-    lighting_color_uniforms[i] =
-        al_get_lighting_uniform_locations(lighting_color_shader[i]);
-    lighting_mesh_uniforms[i] =
-        al_get_lighting_uniform_locations(lighting_mesh_shader[i]);
-    lighting_tex_uniforms[i] =
-        al_get_lighting_uniform_locations(lighting_tex_shader[i]);
-    lighting_material_uniforms[i] =
-        al_get_lighting_uniform_locations(lighting_material_shader[i]);
-
-    lighting_tex_shader[i].begin();
-    lighting_tex_shader[i].uniform("tex0", 0);
-    lighting_tex_shader[i].end();
+        // glGetUniformLocation returns -1 for uniforms a shader lacks
+        auto& u = default_uniforms[omni][l][t];
+        u.color = glGetUniformLocation(s.id(), "col0");
+        u.tint = glGetUniformLocation(s.id(), "tint");
+        u.eye_sep = glGetUniformLocation(s.id(), "eye_sep");
+        u.foc_len = glGetUniformLocation(s.id(), "foc_len");
+        u.normal_matrix = glGetUniformLocation(s.id(), "al_NormalMatrix");
+
+        if (t == int(ColoringMode::TEXTURE)) {
+          s.begin();
+          s.uniform("tex0", 0);
+          s.end();
+        }
+      }
+    }
   }
 
-  compileDefaultShader(omni_color_shader, ShaderType::COLOR, true);
-  compileDefaultShader(omni_mesh_shader, ShaderType::MESH, true);
-  compileDefaultShader(omni_tex_shader, ShaderType::TEXTURE, true);
-
-  omni_color_location = omni_color_shader.getUniformLocation("col0");
-  omni_color_tint_location = omni_color_shader.getUniformLocation("tint");
-  omni_tex_tint_location = omni_tex_shader.getUniformLocation("tint");
-  omni_mesh_tint_location = omni_mesh_shader.getUniformLocation("tint");
-
-  omni_tex_shader.begin();
-  omni_tex_shader.uniform("tex0", 0);
-  omni_tex_shader.end();
-
-  for (int i = 0; i < al_max_num_lights(); i += 1) {
-    compileMultiLightShader(omni_lighting_color_shader[i],
-                            ShaderType::LIGHTING_COLOR, i + 1, true);
-    compileMultiLightShader(omni_lighting_mesh_shader[i],
-                            ShaderType::LIGHTING_MESH, i + 1, true);
-    compileMultiLightShader(omni_lighting_tex_shader[i],
-                            ShaderType::LIGHTING_TEXTURE, i + 1, true);
-    compileMultiLightShader(omni_lighting_material_shader[i],
-                            ShaderType::LIGHTING_MATERIAL, i + 1, true);
-
-    omni_lighting_color_location[i] =
-        omni_lighting_color_shader[i].getUniformLocation("col0");
-    omni_lighting_color_tint_location[i] =
-        omni_lighting_color_shader[i].getUniformLocation("tint");
-    omni_lighting_mesh_tint_location[i] =
-        omni_lighting_mesh_shader[i].getUniformLocation("tint");
-    omni_lighting_tex_tint_location[i] =
-        omni_lighting_tex_shader[i].getUniformLocation("tint");
-    omni_lighting_material_tint_location[i] =
-        omni_lighting_material_shader[i].getUniformLocation("tint");
-
-    omni_lighting_color_uniforms[i] =
-        al_get_lighting_uniform_locations(lighting_color_shader[i]);
-    omni_lighting_mesh_uniforms[i] =
-        al_get_lighting_uniform_locations(lighting_mesh_shader[i]);
-    omni_lighting_tex_uniforms[i] =
-        al_get_lighting_uniform_locations(lighting_tex_shader[i]);
-    omni_lighting_material_uniforms[i] =
-        al_get_lighting_uniform_locations(lighting_material_shader[i]);
-
-    omni_lighting_tex_shader[i].begin();
-    omni_lighting_tex_shader[i].uniform("tex0", 0);
-    omni_lighting_tex_shader[i].end();
-  }
+  lighting_buffer.bufferType(GL_UNIFORM_BUFFER);
+  lighting_buffer.create();
+  lighting_buffer.bind();
+  lighting_buffer.data(sizeof(lighting_block));
+  lighting_buffer.unbind();
 
   for (int i = 0; i < al_max_num_lights(); i += 1) {
     mLightOn[i] = true;
@@ -204,9 +157,18 @@ void Graphics::light(Light const& l, int idx) {
   if (num_lights <= idx) numLight(idx + 1);
 }
 
-void Graphics::enableLight(int idx) { mLightOn[idx] = true; }
-void Graphics::disableLight(int idx) { mLightOn[idx] = false; }
-void Graphics::toggleLight(int idx) { mLightOn[idx] = !mLightOn[idx]; }
+void Graphics::enableLight(int idx) {
+  mLightOn[idx] = true;
+  if (mLightingEnabled) mUniformChanged = true;
+}
+void Graphics::disableLight(int idx) {
+  mLightOn[idx] = false;
+  if (mLightingEnabled) mUniformChanged = true;
+}
+void Graphics::toggleLight(int idx) {
+  mLightOn[idx] = !mLightOn[idx];
+  if (mLightingEnabled) mUniformChanged = true;
+}
 
 void Graphics::quad(Texture& tex, float x, float y, float w, float h) {
   static Mesh m = []() {
@@ -244,6 +206,95 @@ void Graphics::quadViewport(Texture& tex, float x, float y, float w, float h) {
   popCamera();
 }
 
+void Graphics::clearColor(float r, float g, float b, float a) {
+  if (mQueue) {
+    mQueue->addClearColor(Color(r, g, b, a));
+    return;
+  }
+  gl::clearColor(r, g, b, a);
+}
+
+void Graphics::clearDepth(float d) {
+  if (mQueue) {
+    mQueue->addClearDepth(d);
+    return;
+  }
+  gl::clearDepth(d);
+}
+
+void Graphics::draw(VAOMesh& mesh) {
+  if (mQueue) {
+    mQueue->add(*this, mesh);
+    return;
+  }
+  RenderManager::draw(mesh);
+}
+
+void Graphics::draw(EasyVAO& vao) {
+  if (mQueue) {
+    mQueue->add(*this, vao);
+    return;
+  }
+  RenderManager::draw(vao);
+}
+
+void Graphics::draw(const Mesh& mesh) {
+  if (mQueue) {
+    mQueue->add(*this, mesh);
+    return;
+  }
+  RenderManager::draw(mesh);
+}
+
+Graphics::DrawState Graphics::drawState() const {
+  DrawState s;
+  s.coloringMode = mColoringMode;
+  s.color = mColor;
+  s.tint = mTint;
+  s.material = mMaterial;
+  s.lighting = mLightingEnabled;
+  s.numLights = num_lights;
+  for (int i = 0; i < num_lights; i += 1) {
+    s.lights[i] = mLights[i];
+    s.lightOn[i] = mLightOn[i];
+  }
+  if (mColoringMode == ColoringMode::CUSTOM) {
+    s.shader = mShaderPtr;
+  }
+  return s;
+}
+
+void Graphics::drawState(DrawState const& s) {
+  mColor = s.color;
+  mTint = s.tint;
+  mMaterial = s.material;
+  for (int i = 0; i < s.numLights; i += 1) {
+    mLights[i] = s.lights[i];
+    mLightOn[i] = s.lightOn[i];
+  }
+  mUniformChanged = true;
+  lighting(s.lighting);
+  if (num_lights != s.numLights) numLight(s.numLights);
+  if (s.coloringMode == ColoringMode::CUSTOM) {
+    if (s.shader) shader(*s.shader);
+  } else if (mColoringMode != s.coloringMode) {
+    mColoringMode = s.coloringMode;
+    mRenderModeChanged = true;
+  }
+}
+
+void Graphics::beginRecording(RenderQueue& q) {
+  mQueue = &q;
+  q.begin(*this);
+}
+
+void Graphics::endRecording() {
+  if (mQueue) {
+    mQueue->endBounds();
+  }
+  mQueue = nullptr;
+}
+
 void Graphics::shader(ShaderProgram& s) {
   mColoringMode = ColoringMode::CUSTOM;
   RenderManager::shader(s);
@@ -259,193 +310,87 @@ void Graphics::camera(const Viewpoint& v) {
   RenderManager::camera(v);
 }
 
-void Graphics::send_lighting_uniforms(ShaderProgram& s,
-                                      lighting_shader_uniforms const& u) {
-  s.uniform4v(u.global_ambient, Light::globalAmbient().components);
-  s.uniformMatrix4(
-      u.normal_matrix,
-      (viewMatrix() * modelMatrix()).inversed().transpose().elems());
-  for (int i = 0; i < u.num_lights; i += 1) {
-    s.uniform4v(u.lights[i].ambient, mLights[i].ambient().components);
-    s.uniform4v(u.lights[i].diffuse, mLights[i].diffuse().components);
-    s.uniform4v(u.lights[i].specular, mLights[i].specular().components);
-    s.uniform4v(u.lights[i].position, (viewMatrix() * Vec4f{mLights[i].pos()})
-                                          .elems());  // could be optimized...
-    s.uniform(u.lights[i].enabled,
-              (mLightOn[i] ? 1.0f : 0.0f));  // could be optimized...
-    // s.uniform4v(u.lights[i].atten, mLights[i].attenuation());
+void Graphics::update_lighting_block() {
+  lighting_block b{};
+  auto copy4 = [](float* dst, const float* src) {
+    std::memcpy(dst, src, 4 * sizeof(float));
+  };
+  copy4(b.global_ambient, Light::globalAmbient().components);
+  copy4(b.material_ambient, mMaterial.ambient().components);
+  copy4(b.material_diffuse, mMaterial.diffuse().components);
+  copy4(b.material_specular, mMaterial.specular().components);
+  b.material_shininess = mMaterial.shininess();
+  Matrix4f view = viewMatrix();
+  for (int i = 0; i < num_lights; i += 1) {
+    auto& l = b.lights[i];
+    copy4(l.ambient, mLights[i].ambient().components);
+    copy4(l.diffuse, mLights[i].diffuse().components);
+    copy4(l.specular, mLights[i].specular().components);
+    copy4(l.eye, (view * Vec4f{mLights[i].pos()}).elems());
+    l.enabled = mLightOn[i] ? 1.0f : 0.0f;
   }
 
-  if (u.has_material) {
-    s.uniform4v(u.material.ambient, mMaterial.ambient().components);
-    s.uniform4v(u.material.diffuse, mMaterial.diffuse().components);
-    s.uniform4v(u.material.specular, mMaterial.specular().components);
-    s.uniform(u.material.shininess, mMaterial.shininess());
-    // s.uniform4v(u.material.emission, mMaterial.emission().components);
+  // one buffer serves every lighting shader, so it only needs uploading when
+  // the lights, material or view actually changed
+  if (lighting_block_valid &&
+      std::memcmp(&b, &lighting_block_sent, sizeof(b)) == 0) {
+    ++mStats.blockUploadsElided;
+    return;
   }
+  lighting_block_sent = b;
+  lighting_block_valid = true;
+  glBindBufferBase(GL_UNIFORM_BUFFER, al_lighting_block_binding(),
+                   lighting_buffer.id());
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(b), &b);
+  ++mStats.blockUploads;
 }
 
 void Graphics::update() {
   if (mRenderModeChanged) {
-    switch (mColoringMode) {
-      case ColoringMode::UNIFORM:
-        if (!is_omni)
-          RenderManager::shader(mLightingEnabled
-                                    ? lighting_color_shader[num_lights - 1]
-                                    : color_shader);
-        else
-          RenderManager::shader(mLightingEnabled
-                                    ? omni_lighting_color_shader[num_lights - 1]
-                                    : omni_color_shader);
-        break;
-      case ColoringMode::MESH:
-        if (!is_omni)
-          RenderManager::shader(mLightingEnabled
-                                    ? lighting_mesh_shader[num_lights - 1]
-                                    : mesh_shader);
-        else
-          RenderManager::shader(mLightingEnabled
-                                    ? omni_lighting_mesh_shader[num_lights - 1]
-                                    : omni_mesh_shader);
-        break;
-      case ColoringMode::TEXTURE:
-        if (!is_omni)
-          RenderManager::shader(mLightingEnabled
-                                    ? lighting_tex_shader[num_lights - 1]
-                                    : tex_shader);
-        else
-          RenderManager::shader(mLightingEnabled
-                                    ? omni_lighting_tex_shader[num_lights - 1]
-                                    : omni_tex_shader);
-        break;
-      case ColoringMode::MATERIAL:
-        if (!is_omni)
-          RenderManager::shader(mLightingEnabled
-                                    ? lighting_material_shader[num_lights - 1]
-                                    : color_shader);
-        else
-          RenderManager::shader(
-              mLightingEnabled ? omni_lighting_material_shader[num_lights - 1]
-                               : omni_color_shader);
-        break;
-      case ColoringMode::CUSTOM:
-        // do nothing
-        break;
+    if (mColoringMode != ColoringMode::CUSTOM) {
+      int l = mLightingEnabled ? num_lights : 0;
+      int t = int(mColoringMode);
+      if (l == 0 && mColoringMode == ColoringMode::MATERIAL) {
+        t = int(ColoringMode::UNIFORM);
+      }
+      RenderManager::shader(default_shaders[is_omni][l][t]);
+      current_uniforms = &default_uniforms[is_omni][l][t];
     }
     mRenderModeChanged = false;
     mUniformChanged = true;  // force uniform update since shader changed
   }
 
-  /* !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-
-      BIG TODO: All uniform handling below can be simplified with uniform buffer
-     object (UBO) for now a lot of conditionals are used. Other possible
-     solution would be using index (but less preferred than UBO) ex) shader[type
-     + num_type * lighting + num_type * num_lighting * omni]
-  */
-
-  if (mUniformChanged) {
+  if (mColoringMode != ColoringMode::CUSTOM) {
     auto& s = RenderManager::shader();
-    switch (mColoringMode) {
-      case ColoringMode::UNIFORM:
-        if (mLightingEnabled) {
-          if (!is_omni) {
-            send_lighting_uniforms(s, lighting_color_uniforms[num_lights - 1]);
-            s.uniform4v(lighting_color_location[num_lights - 1],
-                        mColor.components);
-            s.uniform4v(lighting_color_tint_location[num_lights - 1],
-                        mTint.components);
-          } else {
-            send_lighting_uniforms(
-                s, omni_lighting_color_uniforms[num_lights - 1]);
-            s.uniform4v(omni_lighting_color_location[num_lights - 1],
-                        mColor.components);
-            s.uniform4v(omni_lighting_color_tint_location[num_lights - 1],
-                        mTint.components);
-          }
-        } else {
-          if (!is_omni) {
-            s.uniform4v(color_location, mColor.components);
-            s.uniform4v(color_tint_location, mTint.components);
-          } else {
-            s.uniform4v(omni_color_location, mColor.components);
-            s.uniform4v(omni_color_tint_location, mTint.components);
-          }
-        }
-        break;
-      case ColoringMode::MESH:
-        if (mLightingEnabled) {
-          if (!is_omni) {
-            send_lighting_uniforms(s, lighting_mesh_uniforms[num_lights - 1]);
-            s.uniform4v(lighting_mesh_tint_location[num_lights - 1],
-                        mTint.components);
-          } else {
-            send_lighting_uniforms(s,
-                                   omni_lighting_mesh_uniforms[num_lights - 1]);
-            s.uniform4v(omni_lighting_mesh_tint_location[num_lights - 1],
-                        mTint.components);
-          }
-        } else {
-          if (!is_omni) {
-            s.uniform4v(mesh_tint_location, mTint.components);
-          } else {
-            s.uniform4v(omni_mesh_tint_location, mTint.components);
-          }
-        }
-        break;
-      case ColoringMode::TEXTURE:
-        if (mLightingEnabled) {
-          if (!is_omni) {
-            send_lighting_uniforms(s, lighting_tex_uniforms[num_lights - 1]);
-            s.uniform4v(lighting_tex_tint_location[num_lights - 1],
-                        mTint.components);
-          } else {
-            send_lighting_uniforms(s,
-                                   omni_lighting_tex_uniforms[num_lights - 1]);
-            s.uniform4v(omni_lighting_tex_tint_location[num_lights - 1],
-                        mTint.components);
-          }
-        } else {
-          if (!is_omni)
-            s.uniform4v(tex_tint_location, mTint.components);
-          else
-            s.uniform4v(omni_tex_tint_location, mTint.components);
-        }
-        break;
-      case ColoringMode::MATERIAL:
-        if (mLightingEnabled) {
-          if (!is_omni) {
-            send_lighting_uniforms(s,
-                                   lighting_material_uniforms[num_lights - 1]);
-            s.uniform4v(lighting_material_tint_location[num_lights - 1],
-                        mTint.components);
-          } else {
-            send_lighting_uniforms(
-                s, omni_lighting_material_uniforms[num_lights - 1]);
-            s.uniform4v(omni_lighting_material_tint_location[num_lights - 1],
-                        mTint.components);
-          }
-        } else {
-          if (!is_omni) {
-            s.uniform4v(color_location, mColor.components);
-            s.uniform4v(color_tint_location, mTint.components);
-          } else {
-            s.uniform4v(omni_color_location, mColor.components);
-            s.uniform4v(omni_color_tint_location, mTint.components);
-          }
-        }
-        break;
-      case ColoringMode::CUSTOM:
-        // do nothing
-        break;
+    auto& u = *current_uniforms;
+    bool force = !u.valid;
+
+    if (mUniformChanged) {
+      if (u.color != -1 && uniformChanged(u.color_sent, mColor, force)) {
+        s.uniform4v(u.color, mColor.components);
+      }
+      if (uniformChanged(u.tint_sent, mTint, force)) {
+        s.uniform4v(u.tint, mTint.components);
+      }
+      float eye_sep = float(mLens.eyeSep() * mEye / 2.0);
+      if (uniformChanged(u.eye_sep_sent, eye_sep, force)) {
+        s.uniform(u.eye_sep, u.eye_sep_sent);
+      }
+      if (uniformChanged(u.foc_len_sent, float(mLens.focalLength()), force)) {
+        s.uniform(u.foc_len, u.foc_len_sent);
+      }
     }
 
-    // for any default shaders, needs to be cleaned up with other uniforms
-    // (using pre saved location, or possibly uniform buffer)
-    if (mColoringMode != ColoringMode::CUSTOM) {
-      s.uniform("eye_sep", mLens.eyeSep() * mEye / 2.0f);
-      s.uniform("foc_len", mLens.focalLength());
+    // normal matrix and light positions follow the model and view matrices
+    if (mLightingEnabled && (mUniformChanged || mMatChanged || force)) {
+      Matrix4f modelView = viewMatrix() * modelMatrix();
+      if (uniformChanged(u.normal_matrix_sent,
+                         modelView.inversed().transpose(), force)) {
+        s.uniform(u.normal_matrix, u.normal_matrix_sent);
+      }
+      update_lighting_block();
     }
+    u.valid = true;
     mUniformChanged = false;
   }
 
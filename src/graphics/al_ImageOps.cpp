@@ -0,0 +1,507 @@
+#include "al/graphics/al_ImageOps.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "al/system/al_ParallelFor.hpp"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace al {
+
+namespace {
+// smaller work stays on the calling thread
+const size_t minPixelsPerThread = 1 << 16;
+
+size_t minRowsPerThread(unsigned width) {
+  return std::max(size_t(1), minPixelsPerThread / std::max(width, 1u));
+}
+
+bool hasPixels(const Image &img) {
+  return img.mArray.size() >= size_t(4) * img.width() * img.height();
+}
+
+// round(x / 255) for x in [0, 255 * 255]
+inline unsigned div255(unsigned x) {
+  x += 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+// 16.16 fixed point 255 / a
+struct UnpremultiplyTable {
+  uint32_t recip[256];
+  UnpremultiplyTable() {
+    recip[0] = 0;
+    for (unsigned a = 1; a < 256; ++a) {
+      recip[a] = ((255u << 16) + a / 2) / a;
+    }
+  }
+};
+
+void premultiplyRange(uint8_t *p, size_t begin, size_t end) {
+  size_t i = begin;
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i keepColor = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+  const __m128i alphaOne = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+  const __m128i half = _mm_set1_epi16(128);
+  for (; i + 4 <= end; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(p + 4 * i));
+    __m128i out[2];
+    for (int k = 0; k < 2; ++k) {
+      __m128i c = k ? _mm_unpackhi_epi8(v, zero) : _mm_unpacklo_epi8(v, zero);
+      // broadcast alpha over each pixel, alpha itself is scaled by 255
+      __m128i a = _mm_shufflehi_epi16(
+          _mm_shufflelo_epi16(c, _MM_SHUFFLE(3, 3, 3, 3)),
+          _MM_SHUFFLE(3, 3, 3, 3));
+      a = _mm_or_si128(_mm_and_si128(a, keepColor), alphaOne);
+      __m128i x = _mm_add_epi16(_mm_mullo_epi16(c, a), half);
+      out[k] = _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+    }
+    _mm_storeu_si128((__m128i *)(p + 4 * i), _mm_packus_epi16(out[0], out[1]));
+  }
+#endif
+  for (; i < end; ++i) {
+    uint8_t *px = p + 4 * i;
+    unsigned a = px[3];
+    px[0] = uint8_t(div255(px[0] * a));
+    px[1] = uint8_t(div255(px[1] * a));
+    px[2] = uint8_t(div255(px[2] * a));
+  }
+}
+
+void swapRedBlueRange(uint8_t *p, size_t begin, size_t end) {
+  size_t i = begin;
+#ifdef __SSE2__
+  // x86 is little endian: red is the low byte of each 32 bit pixel
+  const __m128i keepGA = _mm_set1_epi32(int(0xFF00FF00));
+  const __m128i low = _mm_set1_epi32(0xFF);
+  for (; i + 4 <= end; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(p + 4 * i));
+    __m128i r = _mm_slli_epi32(_mm_and_si128(v, low), 16);
+    __m128i b = _mm_and_si128(_mm_srli_epi32(v, 16), low);
+    v = _mm_or_si128(_mm_and_si128(v, keepGA), _mm_or_si128(r, b));
+    _mm_storeu_si128((__m128i *)(p + 4 * i), v);
+  }
+#endif
+  for (; i < end; ++i) {
+    std::swap(p[4 * i], p[4 * i + 2]);
+  }
+}
+
+void rgbaToRGBRange(const uint8_t *src, uint8_t *dst, size_t begin,
+                    size_t end) {
+  for (size_t i = begin; i < end; ++i) {
+    dst[3 * i] = src[4 * i];
+    dst[3 * i + 1] = src[4 * i + 1];
+    dst[3 * i + 2] = src[4 * i + 2];
+  }
+}
+
+void rgbToRGBARange(const uint8_t *src, uint8_t *dst, size_t begin,
+                    size_t end, uint8_t alpha) {
+  for (size_t i = begin; i < end; ++i) {
+    dst[4 * i] = src[3 * i];
+    dst[4 * i + 1] = src[3 * i + 1];
+    dst[4 * i + 2] = src[3 * i + 2];
+    dst[4 * i + 3] = alpha;
+  }
+}
+
+// Averages a 2 row band of RGBA pixel pairs into count pixels
+void downsampleRow4(const uint8_t *r0, const uint8_t *r1, uint8_t *dst,
+                    unsigned count) {
+  unsigned x = 0;
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i two = _mm_set1_epi16(2);
+  for (; x + 2 <= count; x += 2) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(r0 + 8 * x));
+    __m128i b = _mm_loadu_si128((const __m128i *)(r1 + 8 * x));
+    // vertical sums of pixels 0, 1 and 2, 3
+    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                               _mm_unpacklo_epi8(b, zero));
+    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                               _mm_unpackhi_epi8(b, zero));
+    // horizontal sums land in the low half of each
+    lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+    hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+    __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), two);
+    __m128i avg = _mm_packus_epi16(_mm_srli_epi16(sum, 2), zero);
+    _mm_storel_epi64((__m128i *)(dst + 4 * x), avg);
+  }
+#endif
+  for (; x < count; ++x) {
+    for (unsigned c = 0; c < 4; ++c) {
+      unsigned s = r0[8 * x + c] + r0[8 * x + 4 + c] + r1[8 * x + c] +
+                   r1[8 * x + 4 + c];
+      dst[4 * x + c] = uint8_t((s + 2) >> 2);
+    }
+  }
+}
+
+void downsampleRows(const uint8_t *src, unsigned w, unsigned h, uint8_t *dst,
+                    unsigned ch, size_t y0, size_t y1) {
+  unsigned dw = std::max(1u, w / 2), dh = std::max(1u, h / 2);
+  size_t srcRow = size_t(w) * ch, dstRow = size_t(dw) * ch;
+  // columns averaged 2 at a time; the rest take 1 or 3
+  unsigned pairs = w == 1 ? 0 : (w % 2 ? dw - 1 : dw);
+
+  for (size_t y = y0; y < y1; ++y) {
+    unsigned rows = h == 1 ? 1 : (y == dh - 1 && h % 2 ? 3 : 2);
+    const uint8_t *r0 = src + 2 * y * srcRow;
+    uint8_t *out = dst + y * dstRow;
+    unsigned x = 0;
+    if (rows == 2) {
+      if (ch == 4) {
+        downsampleRow4(r0, r0 + srcRow, out, pairs);
+      } else {
+        for (size_t i = 0; i < size_t(pairs) * ch; ++i) {
+          size_t s = 2 * i - i % ch;
+          unsigned sum = r0[s] + r0[s + ch] + r0[s + srcRow] +
+                         r0[s + srcRow + ch];
+          out[i] = uint8_t((sum + 2) >> 2);
+        }
+      }
+      x = pairs;
+    }
+    for (; x < dw; ++x) {
+      unsigned cols = w == 1 ? 1 : (x == dw - 1 && w % 2 ? 3 : 2);
+      unsigned n = rows * cols;
+      for (unsigned c = 0; c < ch; ++c) {
+        unsigned sum = 0;
+        for (unsigned j = 0; j < rows; ++j) {
+          for (unsigned i = 0; i < cols; ++i) {
+            sum += r0[j * srcRow + (2 * x + i) * ch + c];
+          }
+        }
+        out[x * ch + c] = uint8_t((sum + n / 2) / n);
+      }
+    }
+  }
+}
+
+// acc += w * row
+void addScaled(float *acc, const float *row, float w, size_t n) {
+  size_t i = 0;
+#ifdef __SSE2__
+  const __m128 w4 = _mm_set1_ps(w);
+  for (; i + 4 <= n; i += 4) {
+    __m128 a = _mm_loadu_ps(acc + i);
+    a = _mm_add_ps(a, _mm_mul_ps(w4, _mm_loadu_ps(row + i)));
+    _mm_storeu_ps(acc + i, a);
+  }
+#endif
+  for (; i < n; ++i) {
+    acc[i] += w * row[i];
+  }
+}
+
+// Source taps of each output sample along one axis
+struct LanczosTaps {
+  std::vector<unsigned> first, count;
+  std::vector<float> weights;  // maxTaps per sample
+  unsigned maxTaps = 0;
+
+  LanczosTaps(unsigned srcSize, unsigned dstSize) {
+    const int lobes = 3;
+    const double pi = 3.14159265358979323846;
+    double scale = double(srcSize) / dstSize;
+    // widen the kernel when shrinking so it also low passes
+    double stretch = std::max(scale, 1.0);
+    double support = lobes * stretch;
+    maxTaps = unsigned(std::ceil(support)) * 2 + 1;
+    first.resize(dstSize);
+    count.resize(dstSize);
+    weights.assign(size_t(dstSize) * maxTaps, 0.f);
+
+    for (unsigned i = 0; i < dstSize; ++i) {
+      double center = (i + 0.5) * scale - 0.5;
+      int lo = std::max(0, int(std::ceil(center - support)));
+      int hi = std::min(int(srcSize) - 1, int(std::floor(center + support)));
+      hi = std::min(hi, lo + int(maxTaps) - 1);
+      float *w = &weights[size_t(i) * maxTaps];
+      double total = 0;
+      for (int s = lo; s <= hi; ++s) {
+        double x = (s - center) / stretch;
+        double v = 1;
+        if (x != 0) {
+          double px = pi * x;
+          v = std::abs(x) < lobes
+                  ? lobes * std::sin(px) * std::sin(px / lobes) / (px * px)
+                  : 0;
+        }
+        w[s - lo] = float(v);
+        total += v;
+      }
+      // taps cut by the edges are renormalized
+      for (int s = lo; s <= hi; ++s) {
+        w[s - lo] = float(w[s - lo] / total);
+      }
+      first[i] = unsigned(lo);
+      count[i] = unsigned(hi - lo + 1);
+    }
+  }
+};
+}  // namespace
+
+void flipVertical(uint8_t *pixels, unsigned width, unsigned height,
+                  unsigned channels) {
+  size_t rowBytes = size_t(width) * channels;
+  parallelFor(
+      height / 2,
+      [=](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y) {
+          uint8_t *a = pixels + y * rowBytes;
+          uint8_t *b = pixels + (height - 1 - y) * rowBytes;
+          std::swap_ranges(a, a + rowBytes, b);
+        }
+      },
+      0, minRowsPerThread(width));
+}
+
+void flipVertical(Image &img) {
+  if (hasPixels(img)) flipVertical(img.mArray.data(), img.width(), img.height());
+}
+
+void flipHorizontal(uint8_t *pixels, unsigned width, unsigned height,
+                    unsigned channels) {
+  size_t rowBytes = size_t(width) * channels;
+  parallelFor(
+      height,
+      [=](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y) {
+          uint8_t *row = pixels + y * rowBytes;
+          if (channels == 4) {
+            for (unsigned x = 0; x < width / 2; ++x) {
+              uint32_t a, b;
+              std::memcpy(&a, row + 4 * x, 4);
+              std::memcpy(&b, row + 4 * (width - 1 - x), 4);
+              std::memcpy(row + 4 * x, &b, 4);
+              std::memcpy(row + 4 * (width - 1 - x), &a, 4);
+            }
+          } else {
+            for (unsigned x = 0; x < width / 2; ++x) {
+              std::swap_ranges(row + x * channels, row + (x + 1) * channels,
+                               row + (width - 1 - x) * channels);
+            }
+          }
+        }
+      },
+      0, minRowsPerThread(width));
+}
+
+void flipHorizontal(Image &img) {
+  if (hasPixels(img)) {
+    flipHorizontal(img.mArray.data(), img.width(), img.height());
+  }
+}
+
+void premultiplyAlpha(uint8_t *rgba, size_t count) {
+  parallelFor(
+      count,
+      [=](size_t begin, size_t end) { premultiplyRange(rgba, begin, end); },
+      0, minPixelsPerThread);
+}
+
+void premultiplyAlpha(Image &img) {
+  premultiplyAlpha(img.mArray.data(), img.mArray.size() / 4);
+}
+
+void unpremultiplyAlpha(uint8_t *rgba, size_t count) {
+  static const UnpremultiplyTable table;
+  parallelFor(
+      count,
+      [=](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          uint8_t *px = rgba + 4 * i;
+          uint32_t r = table.recip[px[3]];
+          for (int c = 0; c < 3; ++c) {
+            uint32_t v = (px[c] * r + 32768) >> 16;
+            px[c] = uint8_t(std::min(v, 255u));
+          }
+        }
+      },
+      0, minPixelsPerThread);
+}
+
+void unpremultiplyAlpha(Image &img) {
+  unpremultiplyAlpha(img.mArray.data(), img.mArray.size() / 4);
+}
+
+void swapRedBlue(uint8_t *pixels, size_t count) {
+  parallelFor(
+      count,
+      [=](size_t begin, size_t end) { swapRedBlueRange(pixels, begin, end); },
+      0, minPixelsPerThread);
+}
+
+void swapRedBlue(Image &img) {
+  swapRedBlue(img.mArray.data(), img.mArray.size() / 4);
+}
+
+void rgbaToRGB(const uint8_t *src, uint8_t *dst, size_t count) {
+  if (src == dst) {
+    // in place, each write lands before reads still to come
+    rgbaToRGBRange(src, dst, 0, count);
+    return;
+  }
+  parallelFor(
+      count,
+      [=](size_t begin, size_t end) {
+        rgbaToRGBRange(src, dst, begin, end);
+      },
+      0, minPixelsPerThread);
+}
+
+void rgbToRGBA(const uint8_t *src, uint8_t *dst, size_t count,
+               uint8_t alpha) {
+  if (src == dst) {
+    // in place, back to front so pixels are read before being overwritten
+    for (size_t i = count; i-- > 0;) {
+      dst[4 * i + 3] = alpha;
+      dst[4 * i + 2] = src[3 * i + 2];
+      dst[4 * i + 1] = src[3 * i + 1];
+      dst[4 * i] = src[3 * i];
+    }
+    return;
+  }
+  parallelFor(
+      count,
+      [=](size_t begin, size_t end) {
+        rgbToRGBARange(src, dst, begin, end, alpha);
+      },
+      0, minPixelsPerThread);
+}
+
+void rgbaToRGB(std::vector<uint8_t> &pixels) {
+  size_t count = pixels.size() / 4;
+  rgbaToRGB(pixels.data(), pixels.data(), count);
+  pixels.resize(count * 3);
+}
+
+void rgbToRGBA(std::vector<uint8_t> &pixels, uint8_t alpha) {
+  size_t count = pixels.size() / 3;
+  pixels.resize(count * 4);
+  rgbToRGBA(pixels.data(), pixels.data(), count, alpha);
+}
+
+void downsample2x(const uint8_t *src, unsigned width, unsigned height,
+                  uint8_t *dst, unsigned channels) {
+  if (width == 0 || height == 0) return;
+  unsigned dh = std::max(1u, height / 2);
+  parallelFor(
+      dh,
+      [=](size_t begin, size_t end) {
+        downsampleRows(src, width, height, dst, channels, begin, end);
+      },
+      0, minRowsPerThread(width));
+}
+
+void resampleLanczos(const uint8_t *src, unsigned width, unsigned height,
+                     uint8_t *dst, unsigned dstWidth, unsigned dstHeight,
+                     unsigned channels) {
+  if (!width || !height || !dstWidth || !dstHeight) return;
+  LanczosTaps hTaps(width, dstWidth), vTaps(height, dstHeight);
+  size_t tmpRow = size_t(dstWidth) * channels;
+  std::vector<float> tmp(tmpRow * height);
+
+  // horizontal pass over every source row
+  parallelFor(
+      height,
+      [&](size_t begin, size_t end) {
+        std::vector<float> in(size_t(width) * channels);
+        for (size_t y = begin; y < end; ++y) {
+          const uint8_t *row = src + y * width * channels;
+          std::copy(row, row + in.size(), in.begin());
+          float *out = &tmp[y * tmpRow];
+          for (unsigned x = 0; x < dstWidth; ++x) {
+            const float *w = &hTaps.weights[size_t(x) * hTaps.maxTaps];
+            const float *s = &in[size_t(hTaps.first[x]) * channels];
+            unsigned taps = hTaps.count[x];
+#ifdef __SSE2__
+            if (channels == 4) {
+              __m128 acc = _mm_setzero_ps();
+              for (unsigned k = 0; k < taps; ++k) {
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[k]),
+                                                 _mm_loadu_ps(s + 4 * k)));
+              }
+              _mm_storeu_ps(out + 4 * x, acc);
+              continue;
+            }
+#endif
+            for (unsigned c = 0; c < channels; ++c) {
+              float acc = 0;
+              for (unsigned k = 0; k < taps; ++k) {
+                acc += w[k] * s[k * channels + c];
+              }
+              out[x * channels + c] = acc;
+            }
+          }
+        }
+      },
+      0, minRowsPerThread(width));
+
+  // vertical pass, accumulating whole rows
+  parallelFor(
+      dstHeight,
+      [&](size_t begin, size_t end) {
+        std::vector<float> acc(tmpRow);
+        for (size_t y = begin; y < end; ++y) {
+          std::fill(acc.begin(), acc.end(), 0.f);
+          const float *w = &vTaps.weights[y * vTaps.maxTaps];
+          for (unsigned k = 0; k < vTaps.count[y]; ++k) {
+            addScaled(acc.data(), &tmp[(vTaps.first[y] + k) * tmpRow], w[k],
+                      tmpRow);
+          }
+          uint8_t *out = dst + y * tmpRow;
+          for (size_t i = 0; i < tmpRow; ++i) {
+            float v = std::min(std::max(acc[i] + 0.5f, 0.f), 255.f);
+            out[i] = uint8_t(v);
+          }
+        }
+      },
+      0, minRowsPerThread(dstWidth));
+}
+
+void resampleLanczos(const Image &src, Image &dst, unsigned width,
+                     unsigned height) {
+  dst.mWidth = width;
+  dst.mHeight = height;
+  dst.mArray.resize(size_t(4) * width * height);
+  if (hasPixels(src)) {
+    resampleLanczos(src.mArray.data(), src.width(), src.height(),
+                    dst.mArray.data(), width, height);
+  }
+}
+
+void generateMipmaps(const Image &base, std::vector<Image> &levels,
+                     ImageFilter filter) {
+  levels.clear();
+  if (!hasPixels(base) || base.width() == 0 || base.height() == 0) return;
+  const Image *prev = &base;
+  unsigned w = base.width(), h = base.height();
+  // reserve up front: prev points into levels
+  levels.reserve(size_t(std::log2(double(std::max(w, h)))) + 1);
+  while (w > 1 || h > 1) {
+    unsigned nw = std::max(1u, w / 2), nh = std::max(1u, h / 2);
+    levels.emplace_back();
+    Image &level = levels.back();
+    if (filter == ImageFilter::BOX) {
+      level.mWidth = nw;
+      level.mHeight = nh;
+      level.mArray.resize(size_t(4) * nw * nh);
+      downsample2x(prev->mArray.data(), w, h, level.mArray.data());
+    } else {
+      resampleLanczos(*prev, level, nw, nh);
+    }
+    prev = &level;
+    w = nw;
+    h = nh;
+  }
+}
+
+}  // namespace al
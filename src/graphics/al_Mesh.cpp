@@ -1,5 +1,6 @@
-// #include <algorithm> // transform
+#include <algorithm>
 #include <cctype>  // tolower
+#include <cmath>
 #include <map>
 #include <set>
 // #include <string>
@@ -8,6 +9,7 @@
 #include <stdio.h>
 #include <cstring>
 #include "al/graphics/al_Mesh.hpp"
+#include "al/system/al_ParallelFor.hpp"
 #include "al/system/al_Printing.hpp"
 
 namespace al {
@@ -358,6 +360,136 @@ void Mesh::generateNormals(bool normalize, bool equalWeightPerFace) {
   }
 }
 
+void Mesh::generateNormalsParallel(NormalWeighting weighting, bool normalize,
+                                   unsigned numThreads) {
+  size_t Nv = vertices().size();
+  size_t Ni = indices().size();
+
+  if ((primitive() != TRIANGLES && primitive() != TRIANGLE_STRIP) || Nv < 3) {
+    generateNormals(normalize, weighting != AREA_WEIGHTED);
+    return;
+  }
+
+  // Strips and non-indexed meshes are turned into a list of triangle
+  // corners, so that every weighting goes through the same code.
+  const Index* inds = indices().data();
+  std::vector<Index> triangles;
+  if (primitive() == TRIANGLE_STRIP || Ni == 0) {
+    size_t n = Ni ? Ni : Nv;
+    if (primitive() == TRIANGLES) {
+      triangles.resize(n - n % 3);
+      for (size_t c = 0; c < triangles.size(); ++c) {
+        triangles[c] = Ni ? inds[c] : Index(c);
+      }
+    } else if (n >= 3) {
+      triangles.resize(3 * (n - 2));
+      for (size_t i = 0; i + 2 < n; ++i) {
+        // flip every other triangle, as the winding alternates
+        size_t odd = i & 1;
+        size_t k[3] = {i, i + 1 + odd, i + 2 - odd};
+        for (int j = 0; j < 3; ++j) {
+          triangles[3 * i + j] = Ni ? inds[k[j]] : Index(k[j]);
+        }
+      }
+    }
+    inds = triangles.data();
+    Ni = triangles.size();
+  }
+  if (Ni < 3) {
+    generateNormals(normalize, weighting != AREA_WEIGHTED);
+    return;
+  }
+
+  Ni = Ni - (Ni % 3);  // must be multiple of 3
+  size_t Nf = Ni / 3;
+  const Vertex* verts = vertices().data();
+  const bool byAngle = weighting == ANGLE_WEIGHTED;
+
+  // Face normals. Angle weighting also needs the interior angle at each
+  // corner, stored in corner (index buffer) order.
+  std::vector<Vertex> faceNormals(Nf);
+  std::vector<float> cornerAngles(byAngle ? Ni : 0);
+
+  parallelFor(Nf,
+              [&](size_t begin, size_t end) {
+                auto angleOf = [](const Vertex& a, const Vertex& b) {
+                  float m = a.magSqr() * b.magSqr();
+                  return m > 0.f ? angle(a, b) : 0.f;
+                };
+                for (size_t f = begin; f < end; ++f) {
+                  const Vertex& v1 = verts[inds[3 * f]];
+                  const Vertex& v2 = verts[inds[3 * f + 1]];
+                  const Vertex& v3 = verts[inds[3 * f + 2]];
+                  Vertex e12 = v2 - v1;
+                  Vertex e13 = v3 - v1;
+
+                  // same expression as generateNormals() for identical sums
+                  Vertex vn = cross(e12, e13);
+                  if (weighting != AREA_WEIGHTED) vn.normalize();
+                  faceNormals[f] = vn;
+
+                  if (byAngle) {
+                    Vertex e23 = v3 - v2;
+                    cornerAngles[3 * f] = angleOf(e12, e13);
+                    cornerAngles[3 * f + 1] = angleOf(-e12, e23);
+                    cornerAngles[3 * f + 2] = angleOf(e13, e23);
+                  }
+                }
+              },
+              numThreads);
+
+  normals().clear();
+  normals().resize(Nv);
+  Normal* nrms = normals().data();
+
+  // On a single thread, scatter face normals directly; the adjacency table
+  // below only pays off when vertices are processed concurrently.
+  if (parallelForChunks(Nv, numThreads) == 1) {
+    for (size_t c = 0; c < Ni; ++c) {
+      if (byAngle) {
+        nrms[inds[c]] += faceNormals[c / 3] * cornerAngles[c];
+      } else {
+        nrms[inds[c]] += faceNormals[c / 3];
+      }
+    }
+    if (normalize) {
+      for (size_t v = 0; v < Nv; ++v) nrms[v].normalize();
+    }
+    return;
+  }
+
+  // Vertex to corner adjacency in compressed sparse row form. Corners are
+  // inserted in index order so each vertex sums its faces in the same order
+  // as the sequential version.
+  std::vector<Index> offsets(Nv + 1, 0);
+  for (size_t c = 0; c < Ni; ++c) ++offsets[inds[c] + 1];
+  for (size_t v = 0; v < Nv; ++v) offsets[v + 1] += offsets[v];
+
+  std::vector<Index> corners(Ni);
+  {
+    std::vector<Index> next(offsets.begin(), offsets.end() - 1);
+    for (size_t c = 0; c < Ni; ++c) corners[next[inds[c]]++] = Index(c);
+  }
+
+  parallelFor(Nv,
+              [&](size_t begin, size_t end) {
+                for (size_t v = begin; v < end; ++v) {
+                  Normal n(0, 0, 0);
+                  for (Index k = offsets[v]; k < offsets[v + 1]; ++k) {
+                    Index c = corners[k];
+                    if (byAngle) {
+                      n += faceNormals[c / 3] * cornerAngles[c];
+                    } else {
+                      n += faceNormals[c / 3];
+                    }
+                  }
+                  if (normalize) n.normalize();
+                  nrms[v] = n;
+                }
+              },
+              numThreads);
+}
+
 Mesh& Mesh::repeatLast() {
   if (indices().size()) {
     index(indices().back());
@@ -690,6 +822,282 @@ void Mesh::toTriangles() {
   }
 }
 
+namespace {
+
+// Size of the LRU cache modelled by the Forsyth vertex scores
+const int kForsythCacheSize = 32;
+
+// Vertex score from Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"
+float forsythScore(int cachePos, unsigned remaining) {
+  if (remaining == 0) return -1.f;  // no triangles left to use this vertex
+  float score = 0.f;
+  if (cachePos >= 0) {
+    if (cachePos < 3) {
+      // used by the last triangle; fixed score so it is not favoured too much
+      score = 0.75f;
+    } else {
+      float x = 1.f - (cachePos - 3) * (1.f / (kForsythCacheSize - 3));
+      score = std::pow(x, 1.5f);
+    }
+  }
+  // boost vertices with few triangles left so they get finished off
+  return score + 2.f / std::sqrt(float(remaining));
+}
+
+// Reorder the triangles of an index buffer for vertex cache locality
+void forsythReorder(std::vector<Mesh::Index>& inds, size_t Nv) {
+  typedef Mesh::Index Index;
+  const size_t Nt = inds.size() / 3;
+  if (Nt < 2) return;
+
+  // Vertex to triangle adjacency; each list's first 'remaining' entries are
+  // the triangles that have not been emitted yet
+  std::vector<Index> offsets(Nv + 1, 0);
+  for (size_t i = 0; i < 3 * Nt; ++i) ++offsets[inds[i] + 1];
+  for (size_t v = 0; v < Nv; ++v) offsets[v + 1] += offsets[v];
+  std::vector<Index> adj(3 * Nt);
+  std::vector<Index> remaining(Nv, 0);
+  for (size_t i = 0; i < 3 * Nt; ++i) {
+    Index v = inds[i];
+    adj[offsets[v] + remaining[v]++] = Index(i / 3);
+  }
+
+  std::vector<int> cachePos(Nv, -1);
+  std::vector<float> vScore(Nv);
+  for (size_t v = 0; v < Nv; ++v) vScore[v] = forsythScore(-1, remaining[v]);
+  std::vector<float> tScore(Nt);
+  std::vector<char> emitted(Nt, 0);
+  for (size_t t = 0; t < Nt; ++t) {
+    tScore[t] =
+        vScore[inds[3 * t]] + vScore[inds[3 * t + 1]] + vScore[inds[3 * t + 2]];
+  }
+
+  std::vector<Index> out;
+  out.reserve(3 * Nt);
+  Index cache[kForsythCacheSize + 3];
+  int cacheCount = 0;
+  size_t scan = 0;  // first triangle that may not have been emitted
+
+  long best = long(std::max_element(tScore.begin(), tScore.end()) -
+                   tScore.begin());
+
+  while (best >= 0) {
+    const Index* tri = &inds[3 * best];
+    emitted[best] = 1;
+    out.insert(out.end(), tri, tri + 3);
+
+    for (int k = 0; k < 3; ++k) {
+      Index v = tri[k];
+      Index* list = &adj[offsets[v]];
+      for (Index j = 0; j < remaining[v]; ++j) {
+        if (list[j] == Index(best)) {
+          list[j] = list[--remaining[v]];
+          break;
+        }
+      }
+    }
+
+    // Move the triangle's vertices to the front of the LRU cache
+    Index newCache[kForsythCacheSize + 3];
+    int n = 0;
+    for (int k = 0; k < 3; ++k) {
+      if (std::find(newCache, newCache + n, tri[k]) == newCache + n) {
+        newCache[n++] = tri[k];
+      }
+    }
+    for (int i = 0; i < cacheCount; ++i) {
+      if (std::find(tri, tri + 3, cache[i]) == tri + 3) {
+        newCache[n++] = cache[i];
+      }
+    }
+
+    // Rescore cached and evicted vertices and their pending triangles
+    for (int i = 0; i < n; ++i) {
+      Index v = newCache[i];
+      cachePos[v] = i < kForsythCacheSize ? i : -1;
+      float score = forsythScore(cachePos[v], remaining[v]);
+      float delta = score - vScore[v];
+      vScore[v] = score;
+      for (Index j = 0; j < remaining[v]; ++j) {
+        tScore[adj[offsets[v] + j]] += delta;
+      }
+    }
+
+    best = -1;
+    float bestScore = -1.f;
+    for (int i = 0; i < n && i < kForsythCacheSize; ++i) {
+      Index v = newCache[i];
+      for (Index j = 0; j < remaining[v]; ++j) {
+        Index t = adj[offsets[v] + j];
+        if (tScore[t] > bestScore) {
+          bestScore = tScore[t];
+          best = long(t);
+        }
+      }
+    }
+
+    cacheCount = std::min(n, kForsythCacheSize);
+    std::copy(newCache, newCache + cacheCount, cache);
+
+    // Nothing in the cache can continue: start from the next pending triangle
+    if (best < 0) {
+      while (scan < Nt && emitted[scan]) ++scan;
+      if (scan < Nt) best = long(scan);
+    }
+  }
+
+  inds.swap(out);
+}
+
+// Reorder clusters of triangles so that those facing away from the center
+// are drawn first, after Sander, Nehab and Barczak, "Fast Triangle
+// Reordering for Vertex Locality and Reduced Overdraw". Clusters end where
+// a triangle misses the cache with all three vertices.
+void sortClustersForOverdraw(std::vector<Mesh::Index>& inds,
+                             const std::vector<Vec3f>& verts,
+                             unsigned cacheSize) {
+  typedef Mesh::Index Index;
+  const size_t Nt = inds.size() / 3;
+  if (Nt < 2) return;
+
+  std::vector<size_t> starts;
+  std::vector<unsigned> stamp(verts.size(), 0);
+  unsigned time = cacheSize + 1;
+  for (size_t t = 0; t < Nt; ++t) {
+    int misses = 0;
+    for (int k = 0; k < 3; ++k) {
+      Index v = inds[3 * t + k];
+      if (time - stamp[v] > cacheSize) {
+        stamp[v] = time++;
+        ++misses;
+      }
+    }
+    if (t == 0 || misses == 3) starts.push_back(t);
+  }
+  starts.push_back(Nt);
+
+  Vec3f center(0, 0, 0);
+  for (auto& v : verts) center += v;
+  center /= float(std::max(verts.size(), size_t(1)));
+
+  const size_t Nc = starts.size() - 1;
+  std::vector<float> key(Nc);
+  for (size_t c = 0; c < Nc; ++c) {
+    Vec3f centroid(0, 0, 0), normal(0, 0, 0);
+    float area = 0;
+    for (size_t t = starts[c]; t < starts[c + 1]; ++t) {
+      const Vec3f& a = verts[inds[3 * t]];
+      const Vec3f& b = verts[inds[3 * t + 1]];
+      const Vec3f& d = verts[inds[3 * t + 2]];
+      Vec3f n = cross(b - a, d - a);
+      float w = n.mag() * 0.5f;
+      centroid += (a + b + d) * (w / 3.f);
+      normal += n;
+      area += w;
+    }
+    if (area > 0) centroid /= area;
+    float nm = normal.mag();
+    key[c] = nm > 0 ? (centroid - center).dot(normal) / nm : 0.f;
+  }
+
+  std::vector<size_t> order(Nc);
+  for (size_t c = 0; c < Nc; ++c) order[c] = c;
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t a, size_t b) { return key[a] > key[b]; });
+
+  std::vector<Index> out;
+  out.reserve(inds.size());
+  for (size_t c : order) {
+    out.insert(out.end(), inds.begin() + 3 * starts[c],
+               inds.begin() + 3 * starts[c + 1]);
+  }
+  inds.swap(out);
+}
+
+// Whether an attribute buffer can follow a renumbering of n vertices
+template <class T>
+bool permutable(const std::vector<T>& buf, size_t n) {
+  return buf.empty() || buf.size() == n;
+}
+
+template <class T>
+void permuteBuffer(std::vector<T>& buf, const std::vector<Mesh::Index>& remap) {
+  if (buf.empty()) return;
+  std::vector<T> old(buf);
+  for (size_t i = 0; i < remap.size(); ++i) buf[remap[i]] = old[i];
+}
+
+}  // namespace
+
+float Mesh::vertexCacheMissRatio(unsigned cacheSize) const {
+  const size_t Nt = indices().size() / 3;
+  if (primitive() != TRIANGLES || Nt == 0) return 3.f;
+
+  // FIFO cache: a vertex is cached if fewer than cacheSize misses happened
+  // since it was last loaded
+  std::vector<unsigned> stamp(vertices().size(), 0);
+  unsigned time = cacheSize + 1;
+  size_t misses = 0;
+  for (size_t i = 0; i < 3 * Nt; ++i) {
+    Index v = indices()[i];
+    if (v >= stamp.size()) stamp.resize(v + 1, 0);
+    if (time - stamp[v] > cacheSize) {
+      stamp[v] = time++;
+      ++misses;
+    }
+  }
+  return float(misses) / Nt;
+}
+
+Mesh::CacheStats Mesh::optimizeForCache(bool sortOverdraw,
+                                        unsigned cacheSize) {
+  CacheStats stats;
+  if (primitive() == TRIANGLE_STRIP) toTriangles();
+  if (primitive() != TRIANGLES || vertices().size() < 3) return stats;
+  if (indices().empty()) compress();
+
+  const size_t Nv = vertices().size();
+  indices().resize(indices().size() - indices().size() % 3);
+  for (auto i : indices()) {
+    if (i >= Nv) {
+      AL_WARN("Mesh::optimizeForCache: index out of range");
+      return stats;
+    }
+  }
+  if (!permutable(normals(), Nv) || !permutable(colors(), Nv) ||
+      !permutable(texCoord1s(), Nv) || !permutable(texCoord2s(), Nv) ||
+      !permutable(texCoord3s(), Nv)) {
+    AL_WARN("Mesh::optimizeForCache: attribute count does not match vertices");
+    return stats;
+  }
+
+  stats.acmrBefore = vertexCacheMissRatio(cacheSize);
+
+  forsythReorder(indices(), Nv);
+  if (sortOverdraw) sortClustersForOverdraw(indices(), vertices(), cacheSize);
+
+  // Renumber vertices by first use; unreferenced vertices go last
+  const Index unused = Index(-1);
+  std::vector<Index> remap(Nv, unused);
+  Index next = 0;
+  for (auto& i : indices()) {
+    if (remap[i] == unused) remap[i] = next++;
+    i = remap[i];
+  }
+  for (auto& r : remap) {
+    if (r == unused) r = next++;
+  }
+  permuteBuffer(vertices(), remap);
+  permuteBuffer(normals(), remap);
+  permuteBuffer(colors(), remap);
+  permuteBuffer(texCoord1s(), remap);
+  permuteBuffer(texCoord2s(), remap);
+  permuteBuffer(texCoord3s(), remap);
+
+  stats.acmrAfter = vertexCacheMissRatio(cacheSize);
+  return stats;
+}
+
 bool Mesh::saveSTL(const char* filePath, const char* solidName) const {
   int prim = primitive();
 
@@ -0,0 +1,588 @@
+#include "al/graphics/al_MeshFile.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "al/io/al_MappedFile.hpp"
+#include "al/system/al_Printing.hpp"
+
+namespace al {
+
+namespace {
+
+const char kMagic[4] = {'A', 'L', 'M', 'F'};
+const uint32_t kVersion = 1;
+const uint64_t kAlignment = 16;
+
+// Files are little-endian; on big-endian hosts values are swapped on the way
+// in and out
+bool hostIsBigEndian() {
+  const uint16_t one = 1;
+  uint8_t first;
+  std::memcpy(&first, &one, 1);
+  return first == 0;
+}
+const bool kSwap = hostIsBigEndian();
+
+// Reverse the bytes of each of count words of wordBytes bytes
+void swapWords(void *data, size_t count, size_t wordBytes) {
+  uint8_t *p = (uint8_t *)data;
+  for (size_t i = 0; i < count; ++i, p += wordBytes) {
+    std::reverse(p, p + wordBytes);
+  }
+}
+
+void swapHeader(MeshFileHeader &h) {
+  swapWords(&h.version, 3, 4);
+}
+
+void swapArray(MeshFileArray &a) {
+  swapWords(&a.attribute, 4, 4);
+  swapWords(&a.offset, 2, 8);
+  swapWords(a.scale, 8, 4);
+}
+
+uint32_t componentsOf(uint32_t attribute) {
+  switch (attribute) {
+    case MeshFileArray::VERTICES: return 3;
+    case MeshFileArray::NORMALS: return 3;
+    case MeshFileArray::COLORS: return 4;
+    case MeshFileArray::TEXCOORD1S: return 1;
+    case MeshFileArray::TEXCOORD2S: return 2;
+    case MeshFileArray::TEXCOORD3S: return 3;
+    case MeshFileArray::INDICES: return 1;
+    default: return 0;
+  }
+}
+
+// Bytes per stored scalar, 0 for variable length encodings
+uint32_t scalarBytes(uint32_t encoding) {
+  switch (encoding) {
+    case MeshFileArray::RAW: return 4;
+    case MeshFileArray::UNORM16: return 2;
+    case MeshFileArray::SNORM16: return 2;
+    case MeshFileArray::UNORM8: return 1;
+    default: return 0;
+  }
+}
+
+bool validArray(const MeshFileArray &a, uint64_t fileSize) {
+  if (componentsOf(a.attribute) == 0 ||
+      a.components != componentsOf(a.attribute)) {
+    return false;
+  }
+  if (a.encoding > MeshFileArray::DELTA_VARINT) return false;
+  if (a.offset > fileSize || a.bytes > fileSize - a.offset) return false;
+  // indices are either raw or delta coded, and only indices are delta coded
+  bool isIndex = a.attribute == MeshFileArray::INDICES;
+  bool isDelta = a.encoding == MeshFileArray::DELTA_VARINT;
+  if (isIndex && !isDelta && a.encoding != MeshFileArray::RAW) return false;
+  if (!isIndex && isDelta) return false;
+  uint32_t sb = scalarBytes(a.encoding);
+  if (sb && a.bytes != uint64_t(a.count) * a.components * sb) return false;
+  // every varint takes at least one byte
+  if (isDelta && a.count > a.bytes) return false;
+  return true;
+}
+
+// Resize the mesh buffer for an attribute and return its first scalar
+void *resizeBuffer(Mesh &m, uint32_t attribute, size_t count) {
+  switch (attribute) {
+    case MeshFileArray::VERTICES:
+      m.vertices().resize(count);
+      return m.vertices().data();
+    case MeshFileArray::NORMALS:
+      m.normals().resize(count);
+      return m.normals().data();
+    case MeshFileArray::COLORS:
+      m.colors().resize(count);
+      return m.colors().data();
+    case MeshFileArray::TEXCOORD1S:
+      m.texCoord1s().resize(count);
+      return m.texCoord1s().data();
+    case MeshFileArray::TEXCOORD2S:
+      m.texCoord2s().resize(count);
+      return m.texCoord2s().data();
+    case MeshFileArray::TEXCOORD3S:
+      m.texCoord3s().resize(count);
+      return m.texCoord3s().data();
+    case MeshFileArray::INDICES:
+      m.indices().resize(count);
+      return m.indices().data();
+    default:
+      return nullptr;
+  }
+}
+
+void *bufferData(Mesh &m, uint32_t attribute) {
+  switch (attribute) {
+    case MeshFileArray::VERTICES: return m.vertices().data();
+    case MeshFileArray::NORMALS: return m.normals().data();
+    case MeshFileArray::COLORS: return m.colors().data();
+    case MeshFileArray::TEXCOORD1S: return m.texCoord1s().data();
+    case MeshFileArray::TEXCOORD2S: return m.texCoord2s().data();
+    case MeshFileArray::TEXCOORD3S: return m.texCoord3s().data();
+    case MeshFileArray::INDICES: return m.indices().data();
+    default: return nullptr;
+  }
+}
+
+// Decode n fixed-size scalars, the first being scalar number 'first' of the
+// array, from src into dst (which points at scalar 'first' of the buffer)
+void decodeScalars(const MeshFileArray &a, const uint8_t *src, size_t first,
+                   size_t n, void *dst) {
+  if (a.encoding == MeshFileArray::RAW) {
+    std::memcpy(dst, src, n * 4);
+    if (kSwap) swapWords(dst, n, 4);
+    return;
+  }
+  float *out = (float *)dst;
+  const uint32_t C = a.components;
+  for (size_t k = 0; k < n; ++k) {
+    uint32_t c = uint32_t((first + k) % C);
+    switch (a.encoding) {
+      case MeshFileArray::UNORM16: {
+        uint16_t q;
+        std::memcpy(&q, src + 2 * k, 2);
+        if (kSwap) swapWords(&q, 1, 2);
+        out[k] = a.bias[c] + a.scale[c] * (q * (1.f / 65535.f));
+      } break;
+      case MeshFileArray::SNORM16: {
+        int16_t q;
+        std::memcpy(&q, src + 2 * k, 2);
+        if (kSwap) swapWords(&q, 1, 2);
+        out[k] = std::max(q * (1.f / 32767.f), -1.f);
+      } break;
+      case MeshFileArray::UNORM8:
+        out[k] = src[k] * (1.f / 255.f);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+// Decode up to maxCount varint-coded deltas from src. Returns the number of
+// indices decoded; 'consumed' is set to the number of bytes used. Stops early
+// at a varint that is cut off by the end of src.
+size_t decodeDeltas(const uint8_t *src, size_t bytes, size_t maxCount,
+                    int64_t &prev, Mesh::Index *dst, size_t &consumed) {
+  size_t n = 0, pos = 0;
+  while (n < maxCount && pos < bytes) {
+    uint64_t v = 0;
+    int shift = 0;
+    size_t p = pos;
+    bool complete = false;
+    while (p < bytes && shift < 64) {
+      uint8_t b = src[p++];
+      v |= uint64_t(b & 0x7f) << shift;
+      shift += 7;
+      if (!(b & 0x80)) {
+        complete = true;
+        break;
+      }
+    }
+    if (!complete) break;
+    int64_t delta = int64_t(v >> 1) ^ -int64_t(v & 1);
+    prev += delta;
+    dst[n++] = Mesh::Index(prev);
+    pos = p;
+  }
+  consumed = pos;
+  return n;
+}
+
+void appendVarint(std::vector<uint8_t> &out, uint64_t v) {
+  while (v >= 0x80) {
+    out.push_back(uint8_t(v) | 0x80);
+    v >>= 7;
+  }
+  out.push_back(uint8_t(v));
+}
+
+// Append 32-bit words
+template <class T>
+void appendRaw(std::vector<uint8_t> &out, const T *src, size_t bytes) {
+  const uint8_t *p = (const uint8_t *)src;
+  size_t start = out.size();
+  out.insert(out.end(), p, p + bytes);
+  if (kSwap) swapWords(out.data() + start, bytes / 4, 4);
+}
+
+// Encode a float buffer of count elements with C components
+void encodeFloats(MeshFileArray &a, std::vector<uint8_t> &payload,
+                  const float *src, uint32_t encoding) {
+  const uint32_t C = a.components;
+  const size_t N = size_t(a.count) * C;
+  a.encoding = encoding;
+  for (uint32_t c = 0; c < 4; ++c) {
+    a.scale[c] = 1;
+    a.bias[c] = 0;
+  }
+
+  switch (encoding) {
+    case MeshFileArray::UNORM16: {
+      float lo[4] = {0, 0, 0, 0}, hi[4] = {0, 0, 0, 0};
+      if (N) {
+        for (uint32_t c = 0; c < C; ++c) lo[c] = hi[c] = src[c];
+      }
+      for (size_t i = 0; i < N; ++i) {
+        uint32_t c = i % C;
+        lo[c] = std::min(lo[c], src[i]);
+        hi[c] = std::max(hi[c], src[i]);
+      }
+      for (uint32_t c = 0; c < C; ++c) {
+        a.bias[c] = lo[c];
+        a.scale[c] = hi[c] - lo[c];
+      }
+      payload.resize(N * 2);
+      for (size_t i = 0; i < N; ++i) {
+        uint32_t c = i % C;
+        float t = a.scale[c] > 0 ? (src[i] - lo[c]) / a.scale[c] : 0;
+        uint16_t q = uint16_t(std::min(std::max(t, 0.f), 1.f) * 65535 + 0.5f);
+        std::memcpy(&payload[2 * i], &q, 2);
+      }
+      if (kSwap) swapWords(payload.data(), N, 2);
+    } break;
+    case MeshFileArray::SNORM16:
+      payload.resize(N * 2);
+      for (size_t i = 0; i < N; ++i) {
+        float t = std::min(std::max(src[i], -1.f), 1.f) * 32767;
+        int16_t q = int16_t(t < 0 ? t - 0.5f : t + 0.5f);
+        std::memcpy(&payload[2 * i], &q, 2);
+      }
+      if (kSwap) swapWords(payload.data(), N, 2);
+      break;
+    case MeshFileArray::UNORM8:
+      payload.resize(N);
+      for (size_t i = 0; i < N; ++i) {
+        float t = std::min(std::max(src[i], 0.f), 1.f);
+        payload[i] = uint8_t(t * 255 + 0.5f);
+      }
+      break;
+    default:
+      a.encoding = MeshFileArray::RAW;
+      appendRaw(payload, src, N * 4);
+      break;
+  }
+  a.bytes = payload.size();
+}
+
+bool readHeader(const MeshFileHeader &h) {
+  if (std::memcmp(h.magic, kMagic, 4) != 0) {
+    AL_WARN("Not a binary mesh file");
+    return false;
+  }
+  if (h.version != kVersion) {
+    AL_WARN("Unsupported binary mesh file version %u", h.version);
+    return false;
+  }
+  switch (h.primitive) {
+    case Mesh::POINTS:
+    case Mesh::LINES:
+    case Mesh::LINE_STRIP:
+    case Mesh::LINE_LOOP:
+    case Mesh::TRIANGLES:
+    case Mesh::TRIANGLE_STRIP:
+    case Mesh::TRIANGLE_FAN:
+    case Mesh::LINES_ADJACENCY:
+    case Mesh::LINE_STRIP_ADJACENCY:
+    case Mesh::TRIANGLES_ADJACENCY:
+    case Mesh::TRIANGLE_STRIP_ADJACENCY:
+      return true;
+    default:
+      AL_WARN("Unknown primitive %u in binary mesh file", h.primitive);
+      return false;
+  }
+}
+
+}  // namespace
+
+bool saveMeshFile(const Mesh &m, const std::string &filePath,
+                  const MeshFileOptions &opts) {
+  std::vector<MeshFileArray> arrays;
+  std::vector<std::vector<uint8_t>> payloads;
+
+  auto addFloats = [&](uint32_t attribute, size_t count, const void *data,
+                       uint32_t encoding) {
+    if (!count) return;
+    MeshFileArray a;
+    a.attribute = attribute;
+    a.count = uint32_t(count);
+    a.components = componentsOf(attribute);
+    payloads.emplace_back();
+    encodeFloats(a, payloads.back(), (const float *)data, encoding);
+    arrays.push_back(a);
+  };
+
+  using A = MeshFileArray;
+  addFloats(A::VERTICES, m.vertices().size(), m.vertices().data(),
+            opts.quantizeVertices ? A::UNORM16 : A::RAW);
+  addFloats(A::NORMALS, m.normals().size(), m.normals().data(),
+            opts.quantizeNormals ? A::SNORM16 : A::RAW);
+  addFloats(A::COLORS, m.colors().size(), m.colors().data(),
+            opts.quantizeColors ? A::UNORM8 : A::RAW);
+  addFloats(A::TEXCOORD1S, m.texCoord1s().size(), m.texCoord1s().data(),
+            opts.quantizeTexCoords ? A::UNORM16 : A::RAW);
+  addFloats(A::TEXCOORD2S, m.texCoord2s().size(), m.texCoord2s().data(),
+            opts.quantizeTexCoords ? A::UNORM16 : A::RAW);
+  addFloats(A::TEXCOORD3S, m.texCoord3s().size(), m.texCoord3s().data(),
+            opts.quantizeTexCoords ? A::UNORM16 : A::RAW);
+
+  if (m.indices().size()) {
+    MeshFileArray a;
+    a.attribute = A::INDICES;
+    a.count = uint32_t(m.indices().size());
+    a.components = 1;
+    for (int c = 0; c < 4; ++c) {
+      a.scale[c] = 1;
+      a.bias[c] = 0;
+    }
+    payloads.emplace_back();
+    auto &payload = payloads.back();
+    if (opts.compressIndices) {
+      a.encoding = A::DELTA_VARINT;
+      payload.reserve(m.indices().size() * 2);
+      int64_t prev = 0;
+      for (auto i : m.indices()) {
+        int64_t delta = int64_t(i) - prev;
+        prev = i;
+        appendVarint(payload, (uint64_t(delta) << 1) ^ uint64_t(delta >> 63));
+      }
+    } else {
+      a.encoding = A::RAW;
+      appendRaw(payload, m.indices().data(), m.indices().size() * 4);
+    }
+    a.bytes = payload.size();
+    arrays.push_back(a);
+  }
+
+  MeshFileHeader header;
+  std::memcpy(header.magic, kMagic, 4);
+  header.version = kVersion;
+  header.primitive = m.primitive();
+  header.arrayCount = uint32_t(arrays.size());
+
+  auto align = [](uint64_t x) {
+    return (x + kAlignment - 1) / kAlignment * kAlignment;
+  };
+  uint64_t offset =
+      align(sizeof(MeshFileHeader) + arrays.size() * sizeof(MeshFileArray));
+  for (auto &a : arrays) {
+    a.offset = offset;
+    offset = align(offset + a.bytes);
+  }
+
+  FILE *f = fopen(filePath.c_str(), "wb");
+  if (!f) {
+    AL_WARN("Could not open %s for writing", filePath.c_str());
+    return false;
+  }
+
+  // the table is written swapped, and the offsets used below unswapped
+  std::vector<MeshFileArray> table(arrays);
+  if (kSwap) {
+    swapHeader(header);
+    for (auto &a : table) swapArray(a);
+  }
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+  if (table.size()) {
+    ok = ok && fwrite(table.data(), sizeof(MeshFileArray), table.size(),
+                      f) == table.size();
+  }
+  const uint8_t zeros[kAlignment] = {0};
+  uint64_t pos = sizeof(header) + arrays.size() * sizeof(MeshFileArray);
+  for (size_t i = 0; i < arrays.size() && ok; ++i) {
+    ok = fwrite(zeros, 1, arrays[i].offset - pos, f) == arrays[i].offset - pos;
+    if (payloads[i].size()) {
+      ok = ok && fwrite(payloads[i].data(), 1, payloads[i].size(), f) ==
+                     payloads[i].size();
+    }
+    pos = arrays[i].offset + arrays[i].bytes;
+  }
+  ok = (fclose(f) == 0) && ok;
+  return ok;
+}
+
+bool loadMeshFile(Mesh &m, const std::string &filePath) {
+  MappedFile file;
+  if (!file.open(filePath)) {
+    AL_WARN("Could not open %s", filePath.c_str());
+    return false;
+  }
+  const uint8_t *base = file.data();
+  if (file.size() < sizeof(MeshFileHeader)) return false;
+
+  MeshFileHeader header;
+  std::memcpy(&header, base, sizeof(header));
+  if (kSwap) swapHeader(header);
+  if (!readHeader(header)) return false;
+
+  uint64_t tableEnd =
+      sizeof(header) + uint64_t(header.arrayCount) * sizeof(MeshFileArray);
+  if (tableEnd > file.size()) return false;
+
+  std::vector<MeshFileArray> arrays(header.arrayCount);
+  if (header.arrayCount) {
+    std::memcpy(arrays.data(), base + sizeof(header),
+                arrays.size() * sizeof(MeshFileArray));
+  }
+  for (auto &a : arrays) {
+    if (kSwap) swapArray(a);
+    if (!validArray(a, file.size())) {
+      AL_WARN("Corrupt binary mesh file %s", filePath.c_str());
+      return false;
+    }
+  }
+
+  m.reset();
+  m.primitive(Mesh::Primitive(header.primitive));
+
+  for (auto &a : arrays) {
+    void *dst = resizeBuffer(m, a.attribute, a.count);
+    const uint8_t *src = base + a.offset;
+    if (a.encoding == MeshFileArray::DELTA_VARINT) {
+      int64_t prev = 0;
+      size_t consumed;
+      size_t n = decodeDeltas(src, a.bytes, a.count, prev,
+                              (Mesh::Index *)dst, consumed);
+      if (n != a.count) {
+        AL_WARN("Truncated index data in %s", filePath.c_str());
+        m.reset();
+        return false;
+      }
+    } else {
+      decodeScalars(a, src, 0, size_t(a.count) * a.components, dst);
+    }
+  }
+  return true;
+}
+
+bool MeshFileReader::open(const std::string &filePath) {
+  close();
+  mFile = fopen(filePath.c_str(), "rb");
+  if (!mFile) {
+    AL_WARN("Could not open %s", filePath.c_str());
+    return false;
+  }
+  if (fread(&mHeader, sizeof(mHeader), 1, mFile) != 1) {
+    close();
+    return false;
+  }
+  if (kSwap) swapHeader(mHeader);
+  if (!readHeader(mHeader)) {
+    close();
+    return false;
+  }
+
+  fseek(mFile, 0, SEEK_END);
+  uint64_t fileSize = uint64_t(ftell(mFile));
+  fseek(mFile, sizeof(mHeader), SEEK_SET);
+
+  mArrays.resize(mHeader.arrayCount);
+  if (mHeader.arrayCount &&
+      fread(mArrays.data(), sizeof(MeshFileArray), mArrays.size(), mFile) !=
+          mArrays.size()) {
+    close();
+    return false;
+  }
+  for (auto &a : mArrays) {
+    if (kSwap) swapArray(a);
+    if (!validArray(a, fileSize)) {
+      AL_WARN("Corrupt binary mesh file %s", filePath.c_str());
+      close();
+      return false;
+    }
+  }
+  mArray = 0;
+  mArrayBytes = 0;
+  mElement = 0;
+  mPrevIndex = 0;
+  mFailed = false;
+  return true;
+}
+
+bool MeshFileReader::readChunk(Mesh &m, size_t maxBytes) {
+  if (!mFile || mFailed) return false;
+  maxBytes = std::max(maxBytes, size_t(64));
+
+  while (!done() && maxBytes > 0) {
+    const MeshFileArray &a = mArrays[mArray];
+
+    if (mArrayBytes == 0 && mElement == 0) {
+      if (mArray == 0) {
+        m.reset();
+        m.primitive(Mesh::Primitive(mHeader.primitive));
+      }
+      resizeBuffer(m, a.attribute, a.count);
+      mStaging.clear();
+      mPrevIndex = 0;
+      fseek(mFile, long(a.offset), SEEK_SET);
+    }
+
+    const size_t totalScalars = size_t(a.count) * a.components;
+    const uint32_t sb = scalarBytes(a.encoding);
+    uint8_t *dst = (uint8_t *)bufferData(m, a.attribute);
+
+    if (a.encoding == MeshFileArray::RAW) {
+      // read straight into the mesh buffer
+      size_t n = std::min<uint64_t>(maxBytes / 4, totalScalars - mElement);
+      if (n && fread(dst + mElement * 4, 4, n, mFile) != n) {
+        mFailed = true;
+        return false;
+      }
+      if (kSwap) swapWords(dst + mElement * 4, n, 4);
+      mElement += n;
+      mArrayBytes += n * 4;
+      maxBytes -= std::max(n * 4, size_t(1));
+    } else if (sb) {
+      size_t n = std::min<uint64_t>(maxBytes / sb, totalScalars - mElement);
+      mStaging.resize(n * sb);
+      if (n && fread(mStaging.data(), sb, n, mFile) != n) {
+        mFailed = true;
+        return false;
+      }
+      decodeScalars(a, mStaging.data(), mElement, n, dst + mElement * 4);
+      mElement += n;
+      mArrayBytes += n * sb;
+      maxBytes -= std::max(n * sb, size_t(1));
+    } else {
+      // variable length: keep any varint cut off at the end of the chunk
+      size_t carry = mStaging.size();
+      size_t n = std::min<uint64_t>(maxBytes, a.bytes - mArrayBytes);
+      mStaging.resize(carry + n);
+      if (n && fread(mStaging.data() + carry, 1, n, mFile) != n) {
+        mFailed = true;
+        return false;
+      }
+      mArrayBytes += n;
+      size_t consumed;
+      mElement += decodeDeltas(mStaging.data(), mStaging.size(),
+                               totalScalars - mElement, mPrevIndex,
+                               (Mesh::Index *)dst + mElement, consumed);
+      mStaging.erase(mStaging.begin(), mStaging.begin() + consumed);
+      if (mArrayBytes == a.bytes && mElement < totalScalars) {
+        mFailed = true;
+        return false;
+      }
+      maxBytes -= std::max(n, size_t(1));
+    }
+
+    if (mElement >= totalScalars) {
+      ++mArray;
+      mArrayBytes = 0;
+      mElement = 0;
+    }
+  }
+  return !done();
+}
+
+void MeshFileReader::close() {
+  if (mFile) fclose(mFile);
+  mFile = nullptr;
+  mArrays.clear();
+  mStaging.clear();
+  mArray = 0;
+}
+
+}  // namespace al
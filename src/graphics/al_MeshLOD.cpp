@@ -0,0 +1,495 @@
+#include "al/graphics/al_MeshLOD.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <queue>
+#include <unordered_set>
+
+#include "al/system/al_ParallelFor.hpp"
+
+namespace al {
+
+namespace {
+
+typedef Mesh::Index Index;
+
+// Symmetric 4x4 matrix of a sum of squared plane distances
+struct Quadric {
+  double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0,
+         cd = 0, d2 = 0;
+
+  // plane ax + by + cz + d = 0 with unit normal (a, b, c)
+  void addPlane(double a, double b, double c, double d, double w) {
+    a2 += w * a * a;
+    ab += w * a * b;
+    ac += w * a * c;
+    ad += w * a * d;
+    b2 += w * b * b;
+    bc += w * b * c;
+    bd += w * b * d;
+    c2 += w * c * c;
+    cd += w * c * d;
+    d2 += w * d * d;
+  }
+
+  Quadric &operator+=(const Quadric &q) {
+    a2 += q.a2;
+    ab += q.ab;
+    ac += q.ac;
+    ad += q.ad;
+    b2 += q.b2;
+    bc += q.bc;
+    bd += q.bd;
+    c2 += q.c2;
+    cd += q.cd;
+    d2 += q.d2;
+    return *this;
+  }
+
+  double eval(const Vec3f &p) const {
+    double x = p.x, y = p.y, z = p.z;
+    double e = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x +
+               b2 * y * y + 2 * bc * y * z + 2 * bd * y + c2 * z * z +
+               2 * cd * z + d2;
+    return std::max(e, 0.0);
+  }
+};
+
+enum VertexKind : uint8_t { INTERIOR, BORDER, LOCKED };
+
+struct Collapse {
+  double cost;
+  Index from, to;
+  unsigned stamp;
+  bool operator<(const Collapse &c) const { return cost > c.cost; }
+};
+
+uint64_t edgeKey(Index a, Index b) {
+  if (a > b) std::swap(a, b);
+  return (uint64_t(a) << 32) | b;
+}
+
+// Edge-collapse simplifier working on welded positions. Each position (pid)
+// owns one or more mesh vertices ("wedges") with distinct attributes.
+class Simplifier {
+public:
+  Simplifier(const std::vector<Vec3f> &verts, std::vector<Index> &inds)
+      : mVerts(verts), mInds(inds) {}
+
+  float run(size_t targetTriangles);
+
+private:
+  const std::vector<Vec3f> &mVerts;
+  std::vector<Index> &mInds;  // wedge indices, rewritten in place
+
+  std::vector<Index> mPid;          // wedge -> position id
+  std::vector<Vec3f> mPos;          // position id -> position
+  std::vector<Index> mTriPids;      // 3 pids per triangle
+  std::vector<char> mTriAlive;
+  std::vector<std::vector<Index>> mVertTris;  // pid -> triangles (may be dead)
+  std::vector<Quadric> mQuadrics;
+  std::vector<uint8_t> mKind;
+  std::vector<unsigned> mStamp;
+  std::vector<char> mRemoved;
+  std::unordered_set<uint64_t> mBorderEdges;
+  std::priority_queue<Collapse> mQueue;
+
+  void weld();
+  void classify();
+  void neighbours(Index v, std::vector<Index> &out) const;
+  bool allowed(Index from, Index to) const;
+  bool valid(Index from, Index to) const;
+  void pushBest(Index v);
+  size_t collapse(Index from, Index to);
+};
+
+void Simplifier::weld() {
+  const size_t Nw = mVerts.size();
+  std::vector<Index> order(Nw);
+  for (size_t i = 0; i < Nw; ++i) order[i] = Index(i);
+  std::sort(order.begin(), order.end(), [&](Index a, Index b) {
+    const Vec3f &p = mVerts[a], &q = mVerts[b];
+    if (p.x != q.x) return p.x < q.x;
+    if (p.y != q.y) return p.y < q.y;
+    return p.z < q.z;
+  });
+  mPid.assign(Nw, 0);
+  std::vector<unsigned> wedges;
+  for (size_t i = 0; i < Nw; ++i) {
+    if (i == 0 || mVerts[order[i]] != mVerts[order[i - 1]]) {
+      mPos.push_back(mVerts[order[i]]);
+      wedges.push_back(0);
+    }
+    mPid[order[i]] = Index(mPos.size() - 1);
+    ++wedges.back();
+  }
+
+  const size_t Np = mPos.size();
+  mKind.assign(Np, INTERIOR);
+  for (size_t p = 0; p < Np; ++p) {
+    if (wedges[p] > 1) mKind[p] = LOCKED;  // attribute seam
+  }
+}
+
+void Simplifier::classify() {
+  const size_t Nt = mInds.size() / 3;
+  mTriPids.resize(3 * Nt);
+  mTriAlive.assign(Nt, 1);
+  mVertTris.assign(mPos.size(), std::vector<Index>());
+  mQuadrics.assign(mPos.size(), Quadric());
+
+  std::vector<uint64_t> edges;
+  edges.reserve(3 * Nt);
+  for (size_t t = 0; t < Nt; ++t) {
+    Index p[3];
+    for (int k = 0; k < 3; ++k) {
+      p[k] = mTriPids[3 * t + k] = mPid[mInds[3 * t + k]];
+    }
+    if (p[0] == p[1] || p[1] == p[2] || p[0] == p[2]) {
+      mTriAlive[t] = 0;  // degenerate
+      continue;
+    }
+    for (int k = 0; k < 3; ++k) {
+      mVertTris[p[k]].push_back(Index(t));
+      edges.push_back(edgeKey(p[k], p[(k + 1) % 3]));
+    }
+
+    Vec3f n = cross(mPos[p[1]] - mPos[p[0]], mPos[p[2]] - mPos[p[0]]);
+    float len = n.mag();
+    if (len > 0) {
+      n /= len;
+      double d = -n.dot(mPos[p[0]]);
+      for (int k = 0; k < 3; ++k) mQuadrics[p[k]].addPlane(n.x, n.y, n.z, d, 1);
+    }
+  }
+
+  // Edges used once are borders, more than twice non-manifold
+  std::sort(edges.begin(), edges.end());
+  for (size_t i = 0; i < edges.size();) {
+    size_t j = i;
+    while (j < edges.size() && edges[j] == edges[i]) ++j;
+    Index a = Index(edges[i] >> 32), b = Index(edges[i] & 0xffffffff);
+    if (j - i == 1) {
+      mBorderEdges.insert(edges[i]);
+      if (mKind[a] == INTERIOR) mKind[a] = BORDER;
+      if (mKind[b] == INTERIOR) mKind[b] = BORDER;
+    } else if (j - i > 2) {
+      mKind[a] = mKind[b] = LOCKED;
+    }
+    i = j;
+  }
+
+  // Keep borders in place with planes perpendicular to the surface
+  for (size_t t = 0; t < Nt; ++t) {
+    if (!mTriAlive[t]) continue;
+    const Index *p = &mTriPids[3 * t];
+    Vec3f n = cross(mPos[p[1]] - mPos[p[0]], mPos[p[2]] - mPos[p[0]]);
+    for (int k = 0; k < 3; ++k) {
+      Index a = p[k], b = p[(k + 1) % 3];
+      if (!mBorderEdges.count(edgeKey(a, b))) continue;
+      Vec3f e = mPos[b] - mPos[a];
+      Vec3f bn = cross(e, n);
+      float len = bn.mag();
+      if (len <= 0) continue;
+      bn /= len;
+      double d = -bn.dot(mPos[a]);
+      double w = 10.0;  // favour keeping the silhouette of open borders
+      mQuadrics[a].addPlane(bn.x, bn.y, bn.z, d, w);
+      mQuadrics[b].addPlane(bn.x, bn.y, bn.z, d, w);
+    }
+  }
+}
+
+void Simplifier::neighbours(Index v, std::vector<Index> &out) const {
+  out.clear();
+  for (Index t : mVertTris[v]) {
+    if (!mTriAlive[t]) continue;
+    for (int k = 0; k < 3; ++k) {
+      Index u = mTriPids[3 * t + k];
+      if (u != v && std::find(out.begin(), out.end(), u) == out.end()) {
+        out.push_back(u);
+      }
+    }
+  }
+}
+
+bool Simplifier::allowed(Index from, Index to) const {
+  switch (mKind[from]) {
+    case INTERIOR:
+      return true;
+    case BORDER:
+      return mKind[to] != INTERIOR &&
+             mBorderEdges.count(edgeKey(from, to)) > 0;
+    default:
+      return false;
+  }
+}
+
+// Topology and orientation checks for moving 'from' onto 'to'
+bool Simplifier::valid(Index from, Index to) const {
+  // Link condition: shared neighbours must be the apexes of the triangles
+  // on the edge, otherwise the collapse pinches the surface
+  std::vector<Index> nf, nt;
+  neighbours(from, nf);
+  neighbours(to, nt);
+  int shared = 0;
+  for (Index u : nf) {
+    if (std::find(nt.begin(), nt.end(), u) != nt.end()) ++shared;
+  }
+  int edgeTris = 0;
+  for (Index t : mVertTris[from]) {
+    if (!mTriAlive[t]) continue;
+    const Index *p = &mTriPids[3 * t];
+    bool hasTo = p[0] == to || p[1] == to || p[2] == to;
+    if (hasTo) {
+      ++edgeTris;
+      continue;
+    }
+    // Reject triangles that would flip or collapse
+    Vec3f q[3];
+    for (int k = 0; k < 3; ++k) q[k] = mPos[p[k]];
+    Vec3f n0 = cross(q[1] - q[0], q[2] - q[0]);
+    for (int k = 0; k < 3; ++k) {
+      if (p[k] == from) q[k] = mPos[to];
+    }
+    Vec3f n1 = cross(q[1] - q[0], q[2] - q[0]);
+    if (n0.dot(n1) <= 0.25f * n0.mag() * n1.mag()) return false;
+  }
+  return edgeTris > 0 && shared == edgeTris;
+}
+
+void Simplifier::pushBest(Index v) {
+  if (mRemoved[v] || mKind[v] == LOCKED) return;
+  std::vector<Index> nb;
+  neighbours(v, nb);
+  double best = 0;
+  Index bestTo = v;
+  for (Index u : nb) {
+    if (!allowed(v, u)) continue;
+    Quadric q = mQuadrics[v];
+    q += mQuadrics[u];
+    double cost = q.eval(mPos[u]);
+    if (bestTo == v || cost < best) {
+      best = cost;
+      bestTo = u;
+    }
+  }
+  if (bestTo != v) mQueue.push(Collapse{best, v, bestTo, mStamp[v]});
+}
+
+size_t Simplifier::collapse(Index from, Index to) {
+  // wedge of 'to' on this side of any seam, taken from a removed triangle
+  Index toWedge = Index(-1);
+  for (Index t : mVertTris[from]) {
+    if (!mTriAlive[t]) continue;
+    Index *p = &mTriPids[3 * t];
+    for (int k = 0; k < 3; ++k) {
+      if (p[k] == to) toWedge = mInds[3 * t + k];
+    }
+  }
+
+  size_t removed = 0;
+  for (Index t : mVertTris[from]) {
+    if (!mTriAlive[t]) continue;
+    Index *p = &mTriPids[3 * t];
+    if (p[0] == to || p[1] == to || p[2] == to) {
+      mTriAlive[t] = 0;
+      ++removed;
+      continue;
+    }
+    for (int k = 0; k < 3; ++k) {
+      if (p[k] == from) {
+        p[k] = to;
+        mInds[3 * t + k] = toWedge;
+      }
+    }
+    mVertTris[to].push_back(t);
+  }
+
+  // Border edges of 'from' now end at 'to'
+  if (mKind[from] == BORDER) {
+    std::vector<Index> nb;
+    neighbours(to, nb);
+    for (Index u : nb) {
+      if (mBorderEdges.erase(edgeKey(from, u))) {
+        mBorderEdges.insert(edgeKey(to, u));
+      }
+    }
+  }
+
+  mQuadrics[to] += mQuadrics[from];
+  mRemoved[from] = 1;
+  mVertTris[from].clear();
+  ++mStamp[from];
+  return removed;
+}
+
+float Simplifier::run(size_t targetTriangles) {
+  weld();
+  classify();
+
+  size_t alive = 0;
+  for (char a : mTriAlive) alive += a;
+
+  mStamp.assign(mPos.size(), 0);
+  mRemoved.assign(mPos.size(), 0);
+  for (size_t v = 0; v < mPos.size(); ++v) pushBest(Index(v));
+
+  double maxCost = 0;
+  std::vector<Index> nb;
+  while (alive > targetTriangles && !mQueue.empty()) {
+    Collapse c = mQueue.top();
+    mQueue.pop();
+    if (mRemoved[c.from] || mRemoved[c.to] || c.stamp != mStamp[c.from]) {
+      continue;
+    }
+    if (!valid(c.from, c.to)) {
+      ++mStamp[c.from];  // re-evaluated when a neighbour changes
+      continue;
+    }
+
+    alive -= collapse(c.from, c.to);
+    maxCost = std::max(maxCost, c.cost);
+
+    ++mStamp[c.to];
+    pushBest(c.to);
+    neighbours(c.to, nb);
+    for (Index u : nb) {
+      ++mStamp[u];
+      pushBest(u);
+    }
+  }
+
+  // Write surviving triangles back
+  std::vector<Index> out;
+  out.reserve(3 * alive);
+  for (size_t t = 0; t < mTriAlive.size(); ++t) {
+    if (mTriAlive[t]) out.insert(out.end(), &mInds[3 * t], &mInds[3 * t] + 3);
+  }
+  mInds.swap(out);
+  return float(std::sqrt(maxCost));
+}
+
+template <class T>
+void compactBuffer(std::vector<T> &buf, const std::vector<Index> &remap,
+                   size_t count) {
+  if (buf.size() != remap.size()) return;
+  std::vector<T> out(count);
+  for (size_t i = 0; i < remap.size(); ++i) {
+    if (remap[i] != Index(-1)) out[remap[i]] = buf[i];
+  }
+  buf.swap(out);
+}
+
+// Drop vertices no longer referenced by the index buffer
+void removeUnused(Mesh &m) {
+  std::vector<Index> remap(m.vertices().size(), Index(-1));
+  Index next = 0;
+  for (auto &i : m.indices()) {
+    if (remap[i] == Index(-1)) remap[i] = next++;
+    i = remap[i];
+  }
+  compactBuffer(m.normals(), remap, next);
+  compactBuffer(m.colors(), remap, next);
+  compactBuffer(m.texCoord1s(), remap, next);
+  compactBuffer(m.texCoord2s(), remap, next);
+  compactBuffer(m.texCoord3s(), remap, next);
+  compactBuffer(m.vertices(), remap, next);
+}
+
+}  // namespace
+
+float simplifyMesh(Mesh &mesh, size_t targetTriangles) {
+  if (mesh.primitive() == Mesh::TRIANGLE_STRIP) mesh.toTriangles();
+  if (mesh.primitive() != Mesh::TRIANGLES || mesh.vertices().size() < 3) {
+    return 0;
+  }
+  if (mesh.indices().empty()) mesh.compress();
+  mesh.indices().resize(mesh.indices().size() - mesh.indices().size() % 3);
+  if (mesh.indices().size() / 3 <= targetTriangles) return 0;
+
+  Simplifier s(mesh.vertices(), mesh.indices());
+  float error = s.run(targetTriangles);
+  removeUnused(mesh);
+  return error;
+}
+
+void MeshLOD::generate(const Mesh &src, const std::vector<float> &ratios) {
+  mLevels.assign(1, src);
+  mErrors.assign(1, 0.f);
+
+  Mesh &base = mLevels[0];
+  if (base.primitive() == Mesh::TRIANGLE_STRIP) base.toTriangles();
+  if (base.primitive() == Mesh::TRIANGLES && base.indices().empty() &&
+      base.vertices().size()) {
+    base.compress();
+  }
+
+  Vec3f lo, hi;
+  base.getBounds(lo, hi);
+  mCenter = (lo + hi) * 0.5f;
+  mRadius = 0;
+  for (auto &v : base.vertices()) {
+    mRadius = std::max(mRadius, (v - mCenter).mag());
+  }
+
+  const size_t Nt = base.indices().size() / 3;
+  for (float r : ratios) {
+    size_t target = size_t(std::max(r, 0.f) * Nt);
+    Mesh next(mLevels.back());
+    float e = simplifyMesh(next, target);
+    // errors accumulate since each level starts from the previous one
+    mErrors.push_back(mErrors.back() + e);
+    mLevels.push_back(std::move(next));
+  }
+}
+
+void MeshLOD::generate(std::vector<MeshLOD> &lods,
+                       const std::vector<const Mesh *> &sources,
+                       const std::vector<float> &ratios, unsigned numThreads) {
+  lods.resize(sources.size());
+  parallelFor(sources.size(),
+              [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                  lods[i].generate(*sources[i], ratios);
+                }
+              },
+              numThreads, 1);
+}
+
+float MeshLOD::projectedSize(float length, const Vec3d &position,
+                             const Viewpoint &viewpoint,
+                             float viewportHeight) {
+  const Pose &eye = viewpoint.pose();
+  double depth = (position - eye.pos()).dot(-eye.uz());
+  depth = std::max(depth, viewpoint.lens().near());
+  return float(length * 0.5 * viewportHeight /
+               viewpoint.lens().heightAtDepth(depth));
+}
+
+size_t MeshLOD::select(const Viewpoint &viewpoint, float viewportHeight,
+                       const Pose &modelPose, float scale,
+                       float maxPixelError) const {
+  if (mLevels.empty()) return 0;
+  Vec3d center = modelPose.pos() + modelPose.quat().rotate(Vec3d(mCenter)) *
+                                       double(scale);
+  // nearest point of the bounding sphere decides the on-screen error
+  Vec3d toEye = viewpoint.pose().pos() - center;
+  double dist = toEye.mag();
+  Vec3d nearest = center;
+  if (dist > 0) {
+    nearest += toEye * (std::min(double(mRadius * scale), dist) / dist);
+  }
+
+  size_t best = 0;
+  for (size_t i = 1; i < mLevels.size(); ++i) {
+    float px = projectedSize(mErrors[i] * scale, nearest, viewpoint,
+                             viewportHeight);
+    if (px > maxPixelError) break;
+    best = i;
+  }
+  return best;
+}
+
+}  // namespace al
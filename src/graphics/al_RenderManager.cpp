@@ -119,19 +119,26 @@ void RenderManager::popFramebuffer() {
 
 void RenderManager::shader(ShaderProgram& s) {
   mShaderPtr = &s;
-  mShaderPtr->use();
-  mShaderChanged = true;
-
-  auto mv_search = modelviewLocs.find(mShaderPtr->id());
-  if (mv_search == modelviewLocs.end()) {
-    modelviewLocs[mShaderPtr->id()] =
-        mShaderPtr->getUniformLocation("al_ModelViewMatrix");
+  // Binds made through ShaderProgram elsewhere change the count, so only
+  // glUseProgram called directly goes unnoticed
+  if (mBoundProgram != s.id() || mBindCount != ShaderProgram::binds()) {
+    mShaderPtr->use();
+    mBoundProgram = s.id();
+    mBindCount = ShaderProgram::binds();
+    ++mStats.programBinds;
+  } else {
+    ++mStats.programBindsElided;
   }
+  mShaderChanged = true;
 
-  auto pr_search = projLocs.find(mShaderPtr->id());
-  if (pr_search == projLocs.end()) {
-    projLocs[mShaderPtr->id()] =
-        mShaderPtr->getUniformLocation("al_ProjectionMatrix");
+  mProgramState = &mProgramStates[s.id()];
+  if (!mProgramState->valid ||
+      mProgramState->generation != s.generation()) {
+    // new program or relinked one, locations and values are unknown
+    *mProgramState = ProgramState();
+    mProgramState->generation = s.generation();
+    mProgramState->modelViewLoc = s.getUniformLocation("al_ModelViewMatrix");
+    mProgramState->projLoc = s.getUniformLocation("al_ProjectionMatrix");
   }
 }
 
@@ -207,9 +214,15 @@ void RenderManager::popCamera() {
 
 void RenderManager::update() {
   if (mShaderChanged || mMatChanged) {
-    shader().uniform(modelviewLocs[mShaderPtr->id()],
-                     viewMatrix() * modelMatrix());
-    shader().uniform(projLocs[mShaderPtr->id()], projMatrix());
+    ProgramState& state = *mProgramState;
+    bool force = !state.valid;
+    if (uniformChanged(state.modelView, viewMatrix() * modelMatrix(), force)) {
+      shader().uniform(state.modelViewLoc, state.modelView);
+    }
+    if (uniformChanged(state.proj, projMatrix(), force)) {
+      shader().uniform(state.projLoc, state.proj);
+    }
+    state.valid = true;
   }
 
   mShaderChanged = false;
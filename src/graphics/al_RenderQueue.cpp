@@ -0,0 +1,229 @@
+#include "al/graphics/al_RenderQueue.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "al/math/al_Frustum.hpp"
+
+using namespace al;
+
+namespace {
+bool sameMatrix(const Matrix4f &a, const Matrix4f &b) {
+  return std::memcmp(a.elems(), b.elems(), 16 * sizeof(float)) == 0;
+}
+} // namespace
+
+void RenderQueue::clear() {
+  mCommands.clear();
+  mBounds.clear();
+  mOpenBounds = -1;
+  mMeshCount = 0;
+  mUploaded = false;
+}
+
+void RenderQueue::begin(const Graphics &g) {
+  clear();
+  mBaseView = g.viewMatrix();
+  mBaseProj = g.projMatrix();
+}
+
+RenderQueue::Command &RenderQueue::addDraw(const Graphics &g,
+                                           Command::Type type) {
+  mCommands.emplace_back();
+  Command &c = mCommands.back();
+  c.type = type;
+  c.model = g.modelMatrix();
+  c.view = g.viewMatrix();
+  c.proj = g.projMatrix();
+  c.ownView = !sameMatrix(c.view, mBaseView);
+  c.ownProj = !sameMatrix(c.proj, mBaseProj);
+  c.state = g.drawState();
+  c.bounds = mOpenBounds;
+  return c;
+}
+
+void RenderQueue::beginBounds(const Graphics &g, const Vec3f &center,
+                              float radius, bool sortable) {
+  endBounds();
+  // kept in world space, where replays build their frustums
+  const Matrix4f &m = g.modelMatrix();
+  Bounds b;
+  float scale = 0;
+  for (int i = 0; i < 3; ++i) {
+    b.center[i] = m(i, 0) * center.x + m(i, 1) * center.y +
+                  m(i, 2) * center.z + m(i, 3);
+    scale = std::max(scale, Vec3f(m(0, i), m(1, i), m(2, i)).mag());
+  }
+  b.radius = radius * scale;
+  b.sortable = sortable;
+  b.first = b.end = unsigned(mCommands.size());
+  mOpenBounds = int(mBounds.size());
+  mBounds.push_back(b);
+}
+
+void RenderQueue::endBounds() {
+  if (mOpenBounds < 0) {
+    return;
+  }
+  Bounds &b = mBounds[mOpenBounds];
+  b.end = unsigned(mCommands.size());
+  if (b.end == b.first) {
+    mBounds.pop_back();
+  }
+  mOpenBounds = -1;
+}
+
+void RenderQueue::add(const Graphics &g, VAOMesh &mesh) {
+  addDraw(g, Command::DRAW_VAO_MESH).vaoMesh = &mesh;
+}
+
+void RenderQueue::add(const Graphics &g, EasyVAO &vao) {
+  addDraw(g, Command::DRAW_EASY_VAO).easyVAO = &vao;
+}
+
+void RenderQueue::add(const Graphics &g, const Mesh &mesh) {
+  // meshes from earlier frames are reused to keep their GPU buffers
+  if (mMeshCount == mMeshes.size()) {
+    mMeshes.emplace_back(new VAOMesh());
+  }
+  mMeshes[mMeshCount]->copy(mesh);
+  addDraw(g, Command::DRAW_MESH).mesh = mMeshCount++;
+}
+
+void RenderQueue::addClearColor(const Color &c) {
+  mCommands.emplace_back();
+  mCommands.back().type = Command::CLEAR_COLOR;
+  mCommands.back().clearColor = c;
+}
+
+void RenderQueue::addClearDepth(float d) {
+  mCommands.emplace_back();
+  mCommands.back().type = Command::CLEAR_DEPTH;
+  mCommands.back().clearDepth = d;
+}
+
+void RenderQueue::cullAndSort(const Matrix4f &view, const Matrix4f &proj) {
+  mOrder.clear();
+  mCulledCount = 0;
+  Frustumd frustum;
+  frustum.fromMatrix(proj * view);
+  Matrix4f eyeToWorld = Matrix4f::inverse(view);
+  Vec3f eye(eyeToWorld(0, 3), eyeToWorld(1, 3), eyeToWorld(2, 3));
+  mDistances.resize(mBounds.size());
+
+  auto visible = [&](const Bounds &b) {
+    if (frustum.testSphere(Vec3d(b.center), b.radius) != Frustumd::OUTSIDE) {
+      return true;
+    }
+    mCulledCount += b.end - b.first;
+    return false;
+  };
+  auto emit = [&](const Bounds &b) {
+    for (unsigned i = b.first; i < b.end; ++i) {
+      mOrder.push_back(i);
+    }
+  };
+
+  unsigned next = 0;  // first command not placed yet
+  size_t b = 0;
+  while (b < mBounds.size()) {
+    for (; next < mBounds[b].first; ++next) {
+      mOrder.push_back(next);
+    }
+    if (!mBounds[b].sortable) {
+      if (visible(mBounds[b])) {
+        emit(mBounds[b]);
+      }
+      next = mBounds[b].end;
+      ++b;
+      continue;
+    }
+    // adjacent sortable groups are reordered among themselves only
+    mVisible.clear();
+    do {
+      if (visible(mBounds[b])) {
+        mVisible.push_back(unsigned(b));
+        mDistances[b] = (mBounds[b].center - eye).magSqr();
+      }
+      next = mBounds[b].end;
+      ++b;
+    } while (b < mBounds.size() && mBounds[b].sortable &&
+             mBounds[b].first == next);
+    std::stable_sort(mVisible.begin(), mVisible.end(),
+                     [this](unsigned x, unsigned y) {
+                       return mDistances[x] > mDistances[y];
+                     });
+    for (auto v : mVisible) {
+      emit(mBounds[v]);
+    }
+  }
+  for (; next < mCommands.size(); ++next) {
+    mOrder.push_back(next);
+  }
+}
+
+void RenderQueue::issue(Graphics &g, const Command &c, const Matrix4f &view,
+                        const Matrix4f &proj) {
+  switch (c.type) {
+  case Command::CLEAR_COLOR:
+    g.clearColor(c.clearColor);
+    return;
+  case Command::CLEAR_DEPTH:
+    g.clearDepth(c.clearDepth);
+    return;
+  default:
+    break;
+  }
+  g.drawState(c.state);
+  g.modelMatrix(c.model);
+  g.viewMatrix(c.ownView ? c.view : view);
+  g.projMatrix(c.ownProj ? c.proj : proj);
+  switch (c.type) {
+  case Command::DRAW_VAO_MESH:
+    g.draw(*c.vaoMesh);
+    break;
+  case Command::DRAW_EASY_VAO:
+    g.draw(*c.easyVAO);
+    break;
+  case Command::DRAW_MESH:
+    g.draw(*mMeshes[c.mesh]);
+    break;
+  default:
+    break;
+  }
+}
+
+void RenderQueue::replay(Graphics &g) {
+  if (g.recording()) {
+    return;
+  }
+  if (!mUploaded) {
+    for (unsigned i = 0; i < mMeshCount; ++i) {
+      mMeshes[i]->update();
+      ++mUploads;
+    }
+    mUploaded = true;
+  }
+
+  Graphics::DrawState state = g.drawState();
+  Matrix4f view = g.viewMatrix();
+  Matrix4f proj = g.projMatrix();
+  g.pushModelMatrix();
+  g.pushViewMatrix();
+  g.pushProjMatrix();
+  if (mBounds.empty()) {
+    mCulledCount = 0;
+    for (auto &c : mCommands) {
+      issue(g, c, view, proj);
+    }
+  } else {
+    cullAndSort(view, proj);
+    for (auto i : mOrder) {
+      issue(g, mCommands[i], view, proj);
+    }
+  }
+  g.popProjMatrix();
+  g.popViewMatrix();
+  g.popModelMatrix();
+  g.drawState(state);
+}
@@ -2,6 +2,7 @@
 #include "al/graphics/al_OpenGL.hpp"
 #include "al/system/al_Printing.hpp"
 
+#include <atomic>
 #include <cstring>
 #include <string>
 
@@ -153,8 +154,18 @@ const ShaderProgram& ShaderProgram::detach(const Shader& s) const {
   glDetachShader(id(), s.id());
   return *this;
 }
+namespace {
+// programs may be linked and bound from the threads of several contexts
+std::atomic<unsigned long> linkCount{0};
+std::atomic<unsigned long> bindCount{0};
+}  // namespace
+
 const ShaderProgram& ShaderProgram::link(bool doValidate) const {
   glLinkProgram(id());
+  // locations may change when relinked
+  mUniformLocs.clear();
+  mAttribLocs.clear();
+  mGeneration = ++linkCount;
   if (doValidate) validateProgram();
   return *this;
 }
@@ -214,7 +225,20 @@ bool ShaderProgram::compile(const std::string& vertSource,
 void ShaderProgram::onCreate() { mID = glCreateProgram(); }
 void ShaderProgram::onDestroy() { glDeleteProgram(id()); }
 
-void ShaderProgram::use(unsigned programID) { glUseProgram(programID); }
+void ShaderProgram::use(unsigned programID) {
+  glUseProgram(programID);
+  ++bindCount;
+}
+
+unsigned long ShaderProgram::binds() { return bindCount; }
+
+unsigned ShaderProgram::current() {
+  // asked of GL, as each context has its own and glUseProgram may be called
+  // directly
+  GLint programID = 0;
+  glGetIntegerv(GL_CURRENT_PROGRAM, &programID);
+  return unsigned(programID);
+}
 
 const ShaderProgram& ShaderProgram::use() {
   use(id());
@@ -223,7 +247,7 @@ const ShaderProgram& ShaderProgram::use() {
 
 void ShaderProgram::begin() { use(); }
 
-void ShaderProgram::end() const { glUseProgram(0); }
+void ShaderProgram::end() const { use(0); }
 
 bool ShaderProgram::linked() const {
   GLint v;
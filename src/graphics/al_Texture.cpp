@@ -268,7 +268,17 @@ void Texture::submit(const void *pixels, unsigned int format,
   if (!pixels) {
     return;
   }
+  submit_pixels(pixels, format, type);
+}
+
+void Texture::submitFromBuffer(size_t offset, unsigned int format,
+                               unsigned int type) {
+  // with a pixel unpack buffer bound, the pointer argument is an offset
+  submit_pixels(reinterpret_cast<const void *>(offset), format, type);
+}
 
+void Texture::submit_pixels(const void *pixels, unsigned int format,
+                            unsigned int type) {
   bind_temp();
   // AL_GRAPHICS_ERROR("before Texture::submit (glTexSubImage)", id());
   switch (target()) {
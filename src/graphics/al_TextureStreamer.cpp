@@ -0,0 +1,312 @@
+#include "al/graphics/al_TextureStreamer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "al/io/al_Window.hpp"
+#include "al/system/al_Printing.hpp"
+
+#include "al_stb_image.hpp"
+
+using namespace al;
+
+namespace {
+// a few spare buffers are kept so steady streaming doesn't allocate
+const size_t maxPooledBuffers = 4;
+
+size_t componentSize(unsigned type) {
+  switch (type) {
+  case GL_BYTE:
+  case GL_UNSIGNED_BYTE:
+    return 1;
+  case GL_SHORT:
+  case GL_UNSIGNED_SHORT:
+  case GL_HALF_FLOAT:
+    return 2;
+  default:
+    return 4;
+  }
+}
+} // namespace
+
+PBOUploader::PBOUploader(unsigned numBuffers)
+    : mSlots(std::max(numBuffers, 1u)) {}
+
+PBOUploader::~PBOUploader() {
+  bool created = false;
+  for (auto &s : mSlots) {
+    created = created || s.id || s.fence;
+  }
+  // buffers are left to the context if it's already gone
+  if (created && gl::loaded() && hasCurrentWindowContext()) {
+    destroy();
+  }
+}
+
+void PBOUploader::destroy() {
+  for (auto &s : mSlots) {
+    if (s.fence) {
+      glDeleteSync(s.fence);
+      s.fence = nullptr;
+    }
+    if (s.id) {
+      glDeleteBuffers(1, &s.id);
+      s.id = 0;
+      s.capacity = 0;
+    }
+  }
+}
+
+void PBOUploader::prepare(const TextureUpload &u) {
+  Texture &tex = *u.texture;
+  if (!tex.created() || tex.target() != GL_TEXTURE_2D ||
+      tex.width() != u.width || tex.height() != u.height ||
+      tex.format() != u.format || tex.type() != u.type) {
+    tex.create2D(u.width, u.height, tex.internalFormat(), u.format, u.type);
+  }
+}
+
+bool PBOUploader::upload(const TextureUpload &u) {
+  Slot &s = mSlots[mNext];
+  if (s.fence) {
+    // don't wait: the buffer is retried next frame
+    GLenum status = glClientWaitSync(s.fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+      return false;
+    }
+    glDeleteSync(s.fence);
+    s.fence = nullptr;
+  }
+
+  prepare(u);
+  if (!s.id) {
+    glGenBuffers(1, &s.id);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, s.id);
+  if (u.bytes > s.capacity) {
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, u.bytes, nullptr, GL_STREAM_DRAW);
+    s.capacity = u.bytes;
+  }
+  void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, u.bytes,
+                               GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                                   GL_MAP_UNSYNCHRONIZED_BIT);
+  if (!dst) {
+    // the slot stays next in the ring, as nothing is in flight in it
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    AL_WARN("PBOUploader: could not map pixel buffer");
+    u.texture->submit(u.pixels, u.format, u.type);
+    return true;
+  }
+  mNext = (mNext + 1) % mSlots.size();
+  std::memcpy(dst, u.pixels, u.bytes);
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  u.texture->submitFromBuffer(0, u.format, u.type);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  return true;
+}
+
+TextureStreamer::TextureStreamer(unsigned numThreads) {
+  for (unsigned i = 0; i < std::max(numThreads, 1u); ++i) {
+    mThreads.emplace_back(&TextureStreamer::work, this);
+  }
+}
+
+TextureStreamer::~TextureStreamer() {
+  {
+    std::lock_guard<std::mutex> lk(mMutex);
+    mStop = true;
+  }
+  mJobsChanged.notify_all();
+  for (auto &t : mThreads) {
+    t.join();
+  }
+}
+
+bool TextureStreamer::superseded(const Texture *tex, uint64_t seq) const {
+  auto it = mLatest.find(tex);
+  return it == mLatest.end() || seq < it->second;
+}
+
+std::vector<uint8_t> TextureStreamer::acquire(size_t bytes) {
+  std::vector<uint8_t> buffer;
+  // prefer a pooled buffer that fits without reallocating
+  auto it = std::find_if(mPool.begin(), mPool.end(),
+                         [bytes](const std::vector<uint8_t> &b) {
+                           return b.capacity() >= bytes;
+                         });
+  if (it == mPool.end() && !mPool.empty()) {
+    it = mPool.begin();
+  }
+  if (it != mPool.end()) {
+    buffer.swap(*it);
+    mPool.erase(it);
+  }
+  buffer.resize(bytes);
+  return buffer;
+}
+
+void TextureStreamer::release(std::vector<uint8_t> &buffer) {
+  if (mPool.size() < maxPooledBuffers) {
+    mPool.emplace_back(std::move(buffer));
+  }
+  buffer = std::vector<uint8_t>();
+}
+
+void TextureStreamer::load(Texture &tex, const std::string &path) {
+  {
+    std::lock_guard<std::mutex> lk(mMutex);
+    mLatest[&tex] = ++mSeq;
+    mJobs.push_back({&tex, path, mSeq});
+  }
+  mJobsChanged.notify_one();
+}
+
+void TextureStreamer::submit(Texture &tex, const void *pixels, unsigned width,
+                             unsigned height, unsigned format, unsigned type) {
+  if (!pixels) {
+    return;
+  }
+  size_t bytes = size_t(width) * height *
+                 Texture::numComponents(Texture::Format(format)) *
+                 componentSize(type);
+  Staged s{&tex, {}, width, height, format, type, 0};
+  {
+    std::lock_guard<std::mutex> lk(mMutex);
+    s.data = acquire(bytes);
+  }
+  std::memcpy(s.data.data(), pixels, bytes);
+  std::lock_guard<std::mutex> lk(mMutex);
+  s.seq = ++mSeq;
+  mLatest[&tex] = mSeq;
+  mStaged.push_back(std::move(s));
+}
+
+void TextureStreamer::cancel(Texture &tex) {
+  std::lock_guard<std::mutex> lk(mMutex);
+  mLatest.erase(&tex);
+  // queued jobs and staged images are dropped when they come up
+}
+
+void TextureStreamer::work() {
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lk(mMutex);
+      mJobsChanged.wait(lk, [this] { return mStop || !mJobs.empty(); });
+      if (mStop) {
+        return;
+      }
+      job = std::move(mJobs.front());
+      mJobs.pop_front();
+      if (superseded(job.texture, job.seq)) {
+        if (mJobs.empty() && !mDecoding) {
+          mDecodeDone.notify_all();
+        }
+        continue;
+      }
+      ++mDecoding;
+    }
+
+    al_stbImageData img = al_stbLoadImage(job.path.c_str());
+    Staged s{job.texture, {}, unsigned(img.width), unsigned(img.height),
+             GL_RGBA, GL_UNSIGNED_BYTE, job.seq};
+    if (img.data) {
+      // copy outside the lock, images can be large
+      size_t bytes = size_t(4) * img.width * img.height;
+      {
+        std::lock_guard<std::mutex> lk(mMutex);
+        s.data = acquire(bytes);
+      }
+      std::memcpy(s.data.data(), img.data, bytes);
+      al_stbFreeImage(&img);
+    }
+
+    std::lock_guard<std::mutex> lk(mMutex);
+    --mDecoding;
+    if (s.data.empty()) {
+      AL_WARN("TextureStreamer: could not load %s", job.path.c_str());
+      ++mFailed;
+      if (!superseded(job.texture, job.seq)) {
+        mLatest.erase(job.texture);
+      }
+    } else if (superseded(job.texture, job.seq)) {
+      release(s.data);
+    } else {
+      mStaged.push_back(std::move(s));
+    }
+    if (mJobs.empty() && !mDecoding) {
+      mDecodeDone.notify_all();
+    }
+  }
+}
+
+size_t TextureStreamer::update() {
+  if (!mUploader) {
+    mUploader = std::make_shared<PBOUploader>();
+  }
+  mUploader->beginFrame();
+
+  size_t sent = 0;
+  while (true) {
+    Staged s;
+    {
+      std::lock_guard<std::mutex> lk(mMutex);
+      if (mStaged.empty()) {
+        break;
+      }
+      if (superseded(mStaged.front().texture, mStaged.front().seq)) {
+        release(mStaged.front().data);
+        mStaged.pop_front();
+        continue;
+      }
+      size_t bytes = mStaged.front().data.size();
+      if (sent > 0 && sent + bytes > mBudget) {
+        break;
+      }
+      s = std::move(mStaged.front());
+      mStaged.pop_front();
+    }
+
+    // upload outside the lock so workers keep staging
+    TextureUpload u{s.texture, s.data.data(), s.data.size(),
+                    s.width, s.height, s.format, s.type};
+    bool uploaded = mUploader->upload(u);
+
+    std::lock_guard<std::mutex> lk(mMutex);
+    if (!uploaded) {
+      mStaged.push_front(std::move(s));
+      break;
+    }
+    sent += u.bytes;
+    mUploadedBytes += u.bytes;
+    auto it = mLatest.find(s.texture);
+    if (it != mLatest.end() && it->second == s.seq) {
+      mLatest.erase(it);
+    }
+    release(s.data);
+  }
+  return sent;
+}
+
+void TextureStreamer::waitDecoded() {
+  std::unique_lock<std::mutex> lk(mMutex);
+  mDecodeDone.wait(lk, [this] { return mJobs.empty() && !mDecoding; });
+}
+
+size_t TextureStreamer::pending() {
+  std::lock_guard<std::mutex> lk(mMutex);
+  size_t n = mDecoding;
+  for (auto &j : mJobs) {
+    n += !superseded(j.texture, j.seq);
+  }
+  for (auto &s : mStaged) {
+    n += !superseded(s.texture, s.seq);
+  }
+  return n;
+}
+
+unsigned TextureStreamer::failed() {
+  std::lock_guard<std::mutex> lk(mMutex);
+  return mFailed;
+}
@@ -2,6 +2,7 @@
 
 #include "al_stb_font.hpp"
 #include <cstddef>  // offsetof
+#include <cstdio>
 #include <iostream>
 
 #define STB_TRUETYPE_IMPLEMENTATION  // force following include to generate
@@ -70,3 +71,68 @@ al_stb::CharData al_stb::getCharData(FontData* fontData, int charIndex) {
                fontData->height, charIndex - ASCII_FIRST_CHAR, &charData);
   return charData;
 }
+
+static bool readFile(const char* filename, std::vector<uint8_t>& out) {
+  FILE* file = fopen(filename, "rb");
+  if (!file) {
+    return false;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  if (size > 0) {
+    out.resize(size);
+    out.resize(fread(out.data(), 1, out.size(), file));
+  }
+  fclose(file);
+  return !out.empty();
+}
+
+al_stb::FaceData al_stb::loadFace(const char* filename, float pixelHeight) {
+  FaceData face;
+  if (!readFile(filename, face.file)) {
+    std::cerr << "[al_stb::loadFace] could not read font file: " << filename
+              << '\n';
+    return face;
+  }
+  face.info.resize(sizeof(stbtt_fontinfo));
+  stbtt_fontinfo* info = (stbtt_fontinfo*)face.info.data();
+  int offset = stbtt_GetFontOffsetForIndex(face.file.data(), 0);
+  if (offset < 0 || !stbtt_InitFont(info, face.file.data(), offset)) {
+    std::cerr << "[al_stb::loadFace] invalid font file: " << filename << '\n';
+    face.file.clear();
+    face.info.clear();
+    return face;
+  }
+  face.pixelHeight = pixelHeight;
+  face.scale = stbtt_ScaleForPixelHeight(info, pixelHeight);
+  return face;
+}
+
+bool al_stb::rasterizeGlyph(const FaceData* face, int codepoint,
+                            GlyphData* out) {
+  if (face->file.empty()) {
+    return false;
+  }
+  const stbtt_fontinfo* info = (const stbtt_fontinfo*)face->info.data();
+  int glyph = stbtt_FindGlyphIndex(info, codepoint);
+  if (glyph == 0) {
+    return false;
+  }
+  int advance, bearing;
+  stbtt_GetGlyphHMetrics(info, glyph, &advance, &bearing);
+  int ix0, iy0, ix1, iy1;
+  stbtt_GetGlyphBitmapBox(info, glyph, face->scale, face->scale, &ix0, &iy0,
+                          &ix1, &iy1);
+  out->width = ix1 - ix0;
+  out->height = iy1 - iy0;
+  out->x0 = (float)ix0;
+  out->y0 = (float)iy0;
+  out->xAdvance = advance * face->scale;
+  out->bitmap.assign(out->width * out->height, 0);
+  if (out->width > 0 && out->height > 0) {
+    stbtt_MakeGlyphBitmap(info, out->bitmap.data(), out->width, out->height,
+                          out->width, face->scale, face->scale, glyph);
+  }
+  return true;
+}
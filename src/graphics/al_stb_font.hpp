@@ -35,6 +35,28 @@ FontData loadFont(const char* filename, float pixelHeight, int bitmapSize);
 // x0, y0, x1, y1, and xAdvance of returned CharData are in fontData.pixelHeight scale
 CharData getCharData(FontData* fontData, int charIndex);
 
+// Font file kept in memory to rasterize glyphs on demand
+struct FaceData {
+    std::vector<uint8_t> file;  // font file contents
+    std::vector<uint8_t> info;  // to be casted to stbtt_fontinfo
+    float pixelHeight = -1;
+    float scale = 0;            // font units to pixels
+};
+
+// A rasterized glyph, with metrics in pixels, y towards down
+struct GlyphData {
+    int width = 0, height = 0;   // of bitmap
+    float x0 = 0, y0 = 0;        // offset of bitmap from pen position
+    float xAdvance = 0;
+    std::vector<uint8_t> bitmap; // 1 channel, width * height
+};
+
+// returns FaceData with empty file if failed to load
+FaceData loadFace(const char* filename, float pixelHeight);
+
+// returns false if the face has no glyph for the codepoint
+bool rasterizeGlyph(const FaceData* face, int codepoint, GlyphData* out);
+
 }
 
 #endif
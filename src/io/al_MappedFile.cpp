@@ -0,0 +1,82 @@
+#include "al/io/al_MappedFile.hpp"
+
+#ifdef AL_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace al {
+
+bool MappedFile::open(const std::string &path) {
+  close();
+#ifdef AL_WINDOWS
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (file == INVALID_HANDLE_VALUE) return false;
+  mFile = file;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) return false;
+  mSize = size_t(size.QuadPart);
+  BY_HANDLE_FILE_INFORMATION info;
+  if (GetFileInformationByHandle(file, &info)) {
+    // 100 ns intervals since 1601 to nanoseconds since 1970
+    uint64_t t = (uint64_t(info.ftLastWriteTime.dwHighDateTime) << 32) |
+                 info.ftLastWriteTime.dwLowDateTime;
+    mModified = (int64_t(t) - 116444736000000000LL) * 100;
+    mFileId = (uint64_t(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+  }
+  mMapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (!mMapping) return false;
+  mData = (const uint8_t *)MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+  return mData != nullptr;
+#else
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+  mSize = size_t(st.st_size);
+#ifdef AL_OSX
+  int64_t nanoseconds = st.st_mtimespec.tv_nsec;
+#else
+  int64_t nanoseconds = st.st_mtim.tv_nsec;
+#endif
+  mModified = int64_t(st.st_mtime) * 1000000000LL + nanoseconds;
+  mFileId = uint64_t(st.st_ino);
+  void *p = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);  // the mapping keeps the file referenced
+  if (p == MAP_FAILED) {
+    mSize = 0;
+    return false;
+  }
+  madvise(p, mSize, MADV_SEQUENTIAL);
+  mData = (const uint8_t *)p;
+  return true;
+#endif
+}
+
+void MappedFile::close() {
+#ifdef AL_WINDOWS
+  if (mData) UnmapViewOfFile(mData);
+  if (mMapping) CloseHandle((HANDLE)mMapping);
+  if (mFile) CloseHandle((HANDLE)mFile);
+  mMapping = nullptr;
+  mFile = nullptr;
+#else
+  if (mData) munmap((void *)mData, mSize);
+#endif
+  mData = nullptr;
+  mSize = 0;
+  mModified = 0;
+  mFileId = 0;
+}
+
+}  // namespace al
@@ -40,6 +40,8 @@ does not perform any handshake for connection.)
 //#include "al/system/al_Config.h"
 #include "al/system/al_Printing.hpp"
 
+#include <cstdio> // sscanf
+
 using namespace al;
 
 #if defined(AL_SOCKET_DUMMY)
@@ -69,6 +71,14 @@ public:
   bool opened() const { return false; }
   int recv(char *buffer, int maxlen, char *from) { return 0; }
   int send(const char *buffer, int len) { return 0; }
+  void reuseAddress(bool v) {}
+  void broadcast(bool v) {}
+  void receiveBufferSize(int bytes) {}
+  int receiveBufferSize() const { return 0; }
+  void multicastInterface(const std::string &address) {}
+  void multicastTTL(int hops) {}
+  void multicastLoop(bool v) {}
+  bool joinMulticast(const std::string &group) { return false; }
 };
 
 /*static*/ std::string Socket::hostIP() { return "0.0.0.0"; }
@@ -112,6 +122,7 @@ const char *errorString() {
 
 #define INIT_SOCKET WsInit::get()
 typedef SOCKET SocketHandle;
+typedef DWORD MulticastOption;
 #define SHUT_RDWR SD_BOTH
 DWORD secToTimeout(float t) {
   return t >= 0. ? DWORD(t * 1000. + 0.5) : 4294967295; // msec
@@ -121,8 +132,9 @@ DWORD secToTimeout(float t) {
 
 #include <arpa/inet.h> // inet_ntoa
 #include <errno.h>
-#include <netdb.h>  // gethostbyname
-#include <string.h> // memset, strerror
+#include <netdb.h>      // gethostbyname
+#include <netinet/in.h> // ip_mreq
+#include <string.h>     // memset, strerror
 #include <sys/socket.h>
 #include <sys/time.h> // timeval
 #include <unistd.h>   // close, gethostname
@@ -133,6 +145,7 @@ const char *errorString() { return strerror(errno); }
 
 #define INIT_SOCKET
 typedef int SocketHandle;
+typedef unsigned char MulticastOption;
 timeval secToTimeout(float t) {
   if (t < 0)
     t = 2147483520.; // largest representable 32-bit int
@@ -364,9 +377,12 @@ public:
       close();
       return false;
     }
+    mFamily = mAddrInfo->ai_family;
+    mSockType = mAddrInfo->ai_socktype;
 
     // Set timeout
     timeout(timeoutSec);
+    applyOptions();
 
     return true;
   }
@@ -387,12 +403,17 @@ public:
 
   bool bind() { // for server-side
     if (opened()) {
+      // a new socket is made for the address bound
+      closesocket(mSocketHandle);
       struct addrinfo *p;
       for (p = mAddrInfo; p != nullptr; p = p->ai_next) {
         if ((mSocketHandle = socket(p->ai_family, p->ai_socktype,
                                     p->ai_protocol)) == SOCKET_ERROR) {
           continue;
         }
+        mFamily = p->ai_family;
+        mSockType = p->ai_socktype;
+        applyOptions();
         // int enable = 1;
         // // SO_REUSEADDR: "The rules used in validating addresses supplied to
         // // bind should allow reuse of local addresses."
@@ -521,8 +542,132 @@ public:
     return (int)::send(mSocketHandle, buffer, len, 0);
   }
 
+  // Options are kept to set them again on sockets created by bind()
+
+  void reuseAddress(bool v) {
+    mReuseAddress = v;
+    applyOptions();
+  }
+
+  void broadcast(bool v) {
+    mBroadcast = v;
+    applyOptions();
+  }
+
+  void receiveBufferSize(int bytes) {
+    mReceiveBufferSize = bytes;
+    applyOptions();
+  }
+
+  int receiveBufferSize() const {
+    int bytes = 0;
+    socklen_t len = sizeof(bytes);
+    if (!opened() || SOCKET_ERROR == ::getsockopt(mSocketHandle, SOL_SOCKET,
+                                                  SO_RCVBUF, (char *)&bytes,
+                                                  &len)) {
+      return 0;
+    }
+    return bytes;
+  }
+
+  void multicastInterface(const std::string &address) {
+    mMulticastInterface = address;
+    applyOptions();
+  }
+
+  void multicastTTL(int hops) {
+    mMulticastTTL = hops;
+    applyOptions();
+  }
+
+  void multicastLoop(bool v) {
+    mMulticastLoop = v;
+    applyOptions();
+  }
+
+  bool joinMulticast(const std::string &group) {
+    struct ip_mreq request;
+    memset(&request, 0, sizeof(request));
+    request.imr_interface.s_addr = htonl(INADDR_ANY);
+    if (!opened() || mFamily != AF_INET ||
+        1 != inet_pton(AF_INET, group.c_str(), &request.imr_multiaddr) ||
+        (!mMulticastInterface.empty() &&
+         1 != inet_pton(AF_INET, mMulticastInterface.c_str(),
+                        &request.imr_interface))) {
+      AL_WARN("unable to join multicast group %s on socket at %s:%i",
+              group.c_str(), mAddress.c_str(), mPort);
+      return false;
+    }
+    if (SOCKET_ERROR == ::setsockopt(mSocketHandle, IPPROTO_IP,
+                                     IP_ADD_MEMBERSHIP, (char *)&request,
+                                     sizeof(request))) {
+      AL_WARN("unable to join multicast group %s on socket at %s:%i: %s",
+              group.c_str(), mAddress.c_str(), mPort, errorString());
+      return false;
+    }
+    return true;
+  }
+
 private:
+  template <class T>
+  void setOption(int level, int name, const T &value, const char *optName) {
+    if (SOCKET_ERROR == ::setsockopt(mSocketHandle, level, name,
+                                     (char *)&value, sizeof(value))) {
+      AL_WARN("unable to set %s on socket at %s:%i: %s", optName,
+              mAddress.c_str(), mPort, errorString());
+    }
+  }
+
+  void applyOptions() {
+    if (!opened()) {
+      return;
+    }
+    if (mReuseAddress) {
+      setOption(SOL_SOCKET, SO_REUSEADDR, 1, "SO_REUSEADDR");
+#ifdef __APPLE__
+      // also needed for several listeners on one port on macOS
+      setOption(SOL_SOCKET, SO_REUSEPORT, 1, "SO_REUSEPORT");
+#endif
+    }
+    if (mBroadcast) {
+      setOption(SOL_SOCKET, SO_BROADCAST, 1, "SO_BROADCAST");
+    }
+    if (mReceiveBufferSize > 0) {
+      setOption(SOL_SOCKET, SO_RCVBUF, mReceiveBufferSize, "SO_RCVBUF");
+    }
+    if (mFamily != AF_INET || mSockType != SOCK_DGRAM) {
+      return;
+    }
+    if (!mMulticastInterface.empty()) {
+      struct in_addr interfaceAddress;
+      if (1 == inet_pton(AF_INET, mMulticastInterface.c_str(),
+                         &interfaceAddress)) {
+        setOption(IPPROTO_IP, IP_MULTICAST_IF, interfaceAddress,
+                  "IP_MULTICAST_IF");
+      } else {
+        AL_WARN("invalid multicast interface %s",
+                mMulticastInterface.c_str());
+      }
+    }
+    if (mMulticastTTL >= 0) {
+      setOption(IPPROTO_IP, IP_MULTICAST_TTL, MulticastOption(mMulticastTTL),
+                "IP_MULTICAST_TTL");
+    }
+    if (mMulticastLoop >= 0) {
+      setOption(IPPROTO_IP, IP_MULTICAST_LOOP, MulticastOption(mMulticastLoop),
+                "IP_MULTICAST_LOOP");
+    }
+  }
+
   int mType = 0;
+  int mFamily = 0;
+  int mSockType = 0;
+  bool mReuseAddress = false;
+  bool mBroadcast = false;
+  int mReceiveBufferSize = 0; // system default if not positive
+  std::string mMulticastInterface;
+  int mMulticastTTL = -1;  // system default if negative
+  int mMulticastLoop = -1; // system default if negative
   float mTimeout = -1;
   std::string mAddress;
   uint16_t mPort = 0;
@@ -619,6 +764,35 @@ size_t Socket::send(const char *buffer, size_t len) {
 
 bool Socket::listen() { return mImpl->listen(); }
 
+void Socket::reuseAddress(bool enable) { mImpl->reuseAddress(enable); }
+
+void Socket::broadcast(bool enable) { mImpl->broadcast(enable); }
+
+void Socket::receiveBufferSize(int bytes) { mImpl->receiveBufferSize(bytes); }
+
+int Socket::receiveBufferSize() const { return mImpl->receiveBufferSize(); }
+
+void Socket::multicastInterface(const std::string &address) {
+  mImpl->multicastInterface(address);
+}
+
+void Socket::multicastTTL(int hops) { mImpl->multicastTTL(hops); }
+
+void Socket::multicastLoop(bool enable) { mImpl->multicastLoop(enable); }
+
+bool Socket::joinMulticast(const std::string &group) {
+  return mImpl->joinMulticast(group);
+}
+
+/*static*/ bool Socket::isMulticast(const std::string &address) {
+  unsigned int a, b, c, d;
+  char more;
+  if (4 != sscanf(address.c_str(), "%u.%u.%u.%u%c", &a, &b, &c, &d, &more)) {
+    return false;
+  }
+  return a >= 224 && a <= 239 && b <= 255 && c <= 255 && d <= 255;
+}
+
 bool Socket::accept(Socket &sock) {
   bool accepted = mImpl->accept(sock.mImpl);
   if (accepted) {
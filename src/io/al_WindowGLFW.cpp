@@ -44,6 +44,8 @@ float getCurrentWindowPixelDensity() {
   return rpd;
 }
 
+bool hasCurrentWindowContext() { return glfwGetCurrentContext() != nullptr; }
+
 class WindowImpl {
  public:
   typedef std::map<GLFWwindow*, WindowImpl*> WindowsMap;
@@ -0,0 +1,351 @@
+#include "al/math/al_RandomBatch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace al {
+namespace rnd {
+
+namespace {
+// al_SIMD.hpp covers floating point only, so the generator steps use the
+// integer instructions directly. Each U32 type holds 'size' 32-bit lanes;
+// toUnit turns random bits into floats in [1, 2) and maps them from [0, 1)
+// to scale * u + offset.
+
+struct ScalarU32 {
+  typedef uint32_t V;
+  static const int size = 1;
+  static V load(const uint32_t *p) { return *p; }
+  static void store(uint32_t *p, V a) { *p = a; }
+  static V add(V a, V b) { return a + b; }
+  static V bxor(V a, V b) { return a ^ b; }
+  static V bor(V a, V b) { return a | b; }
+  template <int k>
+  static V shl(V a) {
+    return a << k;
+  }
+  template <int k>
+  static V shr(V a) {
+    return a >> k;
+  }
+  static void toUnit(const uint32_t *in, float *out, float scale,
+                     float offset) {
+    uint32_t b = (*in >> 9) | 0x3f800000;
+    float f;
+    std::memcpy(&f, &b, sizeof(f));
+    *out = (f - 1.f) * scale + offset;
+  }
+};
+
+#if defined(__AVX2__)
+struct AVX2U32 {
+  typedef __m256i V;
+  static const int size = 8;
+  static V load(const uint32_t *p) {
+    return _mm256_loadu_si256((const __m256i *)p);
+  }
+  static void store(uint32_t *p, V a) { _mm256_storeu_si256((__m256i *)p, a); }
+  static V add(V a, V b) { return _mm256_add_epi32(a, b); }
+  static V bxor(V a, V b) { return _mm256_xor_si256(a, b); }
+  static V bor(V a, V b) { return _mm256_or_si256(a, b); }
+  template <int k>
+  static V shl(V a) {
+    return _mm256_slli_epi32(a, k);
+  }
+  template <int k>
+  static V shr(V a) {
+    return _mm256_srli_epi32(a, k);
+  }
+  static void toUnit(const uint32_t *in, float *out, float scale,
+                     float offset) {
+    __m256 f = _mm256_castsi256_ps(
+        _mm256_or_si256(_mm256_srli_epi32(load(in), 9),
+                        _mm256_set1_epi32(0x3f800000)));
+    f = _mm256_sub_ps(f, _mm256_set1_ps(1.f));
+    _mm256_storeu_ps(out, _mm256_add_ps(_mm256_mul_ps(f, _mm256_set1_ps(scale)),
+                                        _mm256_set1_ps(offset)));
+  }
+};
+typedef AVX2U32 U32;
+#elif defined(__SSE2__)
+struct SSEU32 {
+  typedef __m128i V;
+  static const int size = 4;
+  static V load(const uint32_t *p) {
+    return _mm_loadu_si128((const __m128i *)p);
+  }
+  static void store(uint32_t *p, V a) { _mm_storeu_si128((__m128i *)p, a); }
+  static V add(V a, V b) { return _mm_add_epi32(a, b); }
+  static V bxor(V a, V b) { return _mm_xor_si128(a, b); }
+  static V bor(V a, V b) { return _mm_or_si128(a, b); }
+  template <int k>
+  static V shl(V a) {
+    return _mm_slli_epi32(a, k);
+  }
+  template <int k>
+  static V shr(V a) {
+    return _mm_srli_epi32(a, k);
+  }
+  static void toUnit(const uint32_t *in, float *out, float scale,
+                     float offset) {
+    __m128 f = _mm_castsi128_ps(
+        _mm_or_si128(_mm_srli_epi32(load(in), 9), _mm_set1_epi32(0x3f800000)));
+    f = _mm_sub_ps(f, _mm_set1_ps(1.f));
+    _mm_storeu_ps(out, _mm_add_ps(_mm_mul_ps(f, _mm_set1_ps(scale)),
+                                  _mm_set1_ps(offset)));
+  }
+};
+typedef SSEU32 U32;
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+struct NEONU32 {
+  typedef uint32x4_t V;
+  static const int size = 4;
+  static V load(const uint32_t *p) { return vld1q_u32(p); }
+  static void store(uint32_t *p, V a) { vst1q_u32(p, a); }
+  static V add(V a, V b) { return vaddq_u32(a, b); }
+  static V bxor(V a, V b) { return veorq_u32(a, b); }
+  static V bor(V a, V b) { return vorrq_u32(a, b); }
+  template <int k>
+  static V shl(V a) {
+    return vshlq_n_u32(a, k);
+  }
+  template <int k>
+  static V shr(V a) {
+    return vshrq_n_u32(a, k);
+  }
+  static void toUnit(const uint32_t *in, float *out, float scale,
+                     float offset) {
+    float32x4_t f = vreinterpretq_f32_u32(
+        vorrq_u32(vshrq_n_u32(load(in), 9), vdupq_n_u32(0x3f800000)));
+    f = vsubq_f32(f, vdupq_n_f32(1.f));
+    vst1q_f32(out, vaddq_f32(vmulq_f32(f, vdupq_n_f32(scale)),
+                             vdupq_n_f32(offset)));
+  }
+};
+typedef NEONU32 U32;
+#else
+typedef ScalarU32 U32;
+#endif
+
+template <typename U, int k>
+typename U::V rotl(typename U::V a) {
+  return U::bor(U::template shl<k>(a), U::template shr<32 - k>(a));
+}
+
+// Steps the lanes of a generator numSteps times, writing the output of
+// lane i at step j to out[j * lanes + i]
+template <typename U>
+void generateLanes(uint32_t (*state)[RandomBatch::lanes], uint32_t *out,
+                   size_t numSteps) {
+  typedef typename U::V V;
+  const int lanes = RandomBatch::lanes;
+  for (int g = 0; g < lanes; g += U::size) {
+    V s0 = U::load(state[0] + g), s1 = U::load(state[1] + g),
+      s2 = U::load(state[2] + g), s3 = U::load(state[3] + g);
+    for (size_t j = 0; j < numSteps; ++j) {
+      // rotl(s1 * 5, 7) * 9, multiplying with shifts as SSE2 has no
+      // 32-bit multiply
+      V m = U::add(U::template shl<2>(s1), s1);
+      m = rotl<U, 7>(m);
+      U::store(out + j * lanes + g, U::add(U::template shl<3>(m), m));
+      V t = U::template shl<9>(s1);
+      s2 = U::bxor(s2, s0);
+      s3 = U::bxor(s3, s1);
+      s1 = U::bxor(s1, s2);
+      s0 = U::bxor(s0, s3);
+      s2 = U::bxor(s2, t);
+      s3 = rotl<U, 11>(s3);
+    }
+    U::store(state[0] + g, s0);
+    U::store(state[1] + g, s1);
+    U::store(state[2] + g, s2);
+    U::store(state[3] + g, s3);
+  }
+}
+
+// Tables of the ziggurat method for the normal distribution, with 128
+// layers of equal area
+//    Marsaglia, G. and Tsang, W. W. The ziggurat method for generating
+//    random variables. Journal of Statistical Software, 5, 8 (2000).
+//
+// A number gives the layer in its low 7 bits and a signed position in
+// [-2^23, 2^23) in its high 24. The position scaled by w[layer] is the
+// variate if its magnitude is below k[layer], which is the case 99% of the
+// time; f[layer] is the density at the top of the layer.
+struct Ziggurat {
+  static const int layers = 128;
+  const double r = 3.442619855899;  // start of the tail
+  uint32_t k[layers];
+  float w[layers];
+  double f[layers];
+
+  Ziggurat() {
+    const double m = 8388608.;  // 2^23
+    const double v = 9.91256303526217e-3;  // area of each layer
+    double d = r, t = r;
+    double q = v / std::exp(-0.5 * d * d);
+    k[0] = uint32_t(d / q * m);
+    k[1] = 0;
+    w[0] = float(q / m);
+    w[layers - 1] = float(d / m);
+    f[0] = 1;
+    f[layers - 1] = std::exp(-0.5 * d * d);
+    for (int i = layers - 2; i >= 1; --i) {
+      d = std::sqrt(-2 * std::log(v / d + std::exp(-0.5 * d * d)));
+      k[i + 1] = uint32_t(d / t * m);
+      t = d;
+      f[i] = std::exp(-0.5 * d * d);
+      w[i] = float(d / m);
+    }
+  }
+};
+
+const Ziggurat &ziggurat() {
+  static const Ziggurat z;
+  return z;
+}
+
+int32_t position(uint32_t r) { return int32_t(r) >> 8; }
+uint32_t magnitude(int32_t p) { return uint32_t(p < 0 ? -p : p); }
+
+// uniform in (0, 1), for taking logarithms
+double openUnit(uint32_t r) { return ((r >> 8) + 0.5) / 16777216.; }
+
+// uniform in [-1, 1)
+float signedUnit(uint32_t r) { return position(r) * (1.f / 8388608); }
+}  // namespace
+
+RandomBatch &RandomBatch::seed(uint32_t seed, uint32_t stream) {
+  Xoshiro128 g(seed);
+  for (uint32_t i = 0; i < stream; ++i) {
+    g.longJump();
+  }
+  for (int i = 0; i < lanes; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      mState[j][i] = g.state()[j];
+    }
+    g.jump();
+  }
+  mPos = bufferSize;
+  return *this;
+}
+
+void RandomBatch::generate(uint32_t *out, size_t numSteps) {
+  generateLanes<U32>(mState, out, numSteps);
+}
+
+void RandomBatch::refill() {
+  generate(mBuffer, bufferSize / lanes);
+  mPos = 0;
+}
+
+void RandomBatch::bits(uint32_t *out, size_t count) {
+  // what is left of the buffer comes first, then whole steps straight into
+  // the output and the rest from a new buffer
+  size_t n = std::min(count, size_t(bufferSize - mPos));
+  std::memcpy(out, mBuffer + mPos, n * sizeof(uint32_t));
+  mPos += int(n);
+  out += n;
+  count -= n;
+  size_t numSteps = count / lanes;
+  generate(out, numSteps);
+  out += numSteps * lanes;
+  count -= numSteps * lanes;
+  if (count) {
+    refill();
+    std::memcpy(out, mBuffer, count * sizeof(uint32_t));
+    mPos = int(count);
+  }
+}
+
+void RandomBatch::uniform(float *out, size_t count, float lo, float hi) {
+  uint32_t b[bufferSize];
+  while (count) {
+    size_t n = std::min(count, size_t(bufferSize)), i = 0;
+    bits(b, n);
+    for (; i + U32::size <= n; i += U32::size) {
+      U32::toUnit(b + i, out + i, hi - lo, lo);
+    }
+    for (; i < n; ++i) {
+      ScalarU32::toUnit(b + i, out + i, hi - lo, lo);
+    }
+    out += n;
+    count -= n;
+  }
+}
+
+void RandomBatch::normal(float *out, size_t count, float mean,
+                         float stddev) {
+  const Ziggurat &z = ziggurat();
+  for (size_t i = 0; i < count; ++i) {
+    uint32_t r = next();
+    int32_t p = position(r);
+    uint32_t layer = r & (Ziggurat::layers - 1);
+    float x = magnitude(p) < z.k[layer] ? p * z.w[layer] : normalTail(r);
+    out[i] = x * stddev + mean;
+  }
+}
+
+float RandomBatch::normalTail(uint32_t r) {
+  const Ziggurat &z = ziggurat();
+  for (;;) {
+    int32_t p = position(r);
+    uint32_t layer = r & (Ziggurat::layers - 1);
+    if (magnitude(p) < z.k[layer]) return p * z.w[layer];
+    double x = p * double(z.w[layer]);
+    if (layer == 0) {
+      // beyond r, from the exponential tail
+      double y;
+      do {
+        x = -std::log(openUnit(next())) / z.r;
+        y = -std::log(openUnit(next()));
+      } while (y + y < x * x);
+      return float(p > 0 ? z.r + x : -z.r - x);
+    }
+    // the wedge between the layer and the curve
+    double u = openUnit(next());
+    if (z.f[layer] + u * (z.f[layer - 1] - z.f[layer]) <
+        std::exp(-0.5 * x * x)) {
+      return float(x);
+    }
+    r = next();
+  }
+}
+
+void RandomBatch::ball(Vec3f *out, size_t count, float radius) {
+  // Candidates are written in place and kept by advancing, which avoids a
+  // branch taken at random; they are inside with probability pi / 6
+  size_t i = 0;
+  while (i < count) {
+    float x = signedUnit(next()), y = signedUnit(next()),
+          z = signedUnit(next());
+    out[i].set(x * radius, y * radius, z * radius);
+    i += x * x + y * y + z * z < 1.f;
+  }
+}
+
+// Marsaglia, G. Choosing a point from the surface of a sphere. Annals of
+// Mathematical Statistics, 43, 2 (1972).
+void RandomBatch::sphere(Vec3f *out, size_t count, float radius) {
+  // from a point in the unit disc, kept as in ball()
+  size_t i = 0;
+  while (i < count) {
+    float x = signedUnit(next()), y = signedUnit(next());
+    float s = x * x + y * y;
+    float a = 2.f * std::sqrt(std::max(1.f - s, 0.f)) * radius;
+    out[i].set(x * a, y * a, (1.f - 2.f * s) * radius);
+    i += s < 1.f;
+  }
+}
+
+}  // namespace rnd
+}  // namespace al
@@ -0,0 +1,185 @@
+#include "al/math/al_VecBatch.hpp"
+
+#include "al/math/al_SIMD.hpp"
+#include "al/system/al_ParallelFor.hpp"
+
+namespace al {
+
+static_assert(sizeof(Vec3f) == 3 * sizeof(float), "Vec3f must be packed");
+static_assert(sizeof(Vec3d) == 3 * sizeof(double), "Vec3d must be packed");
+
+namespace {
+// smaller arrays stay on the calling thread
+const size_t minVectorsPerThread = 1 << 15;
+
+// Calls kernel(L(), i) for every index, where L is the Lanes type and i the
+// first of the L::size items to process
+template <typename T, typename Kernel>
+void forEachLane(size_t count, const Kernel &kernel) {
+  parallelFor(
+      count,
+      [&](size_t begin, size_t end) {
+        size_t i = begin;
+        for (; i + simd::Lanes<T>::size <= end; i += simd::Lanes<T>::size) {
+          kernel(simd::Lanes<T>(), i);
+        }
+        for (; i < end; ++i) {
+          kernel(simd::ScalarLanes<T>(), i);
+        }
+      },
+      0, minVectorsPerThread);
+}
+
+// w is 1 for points and 0 for directions
+template <typename T>
+void transformArray(const Matrix4<T> &mat, T w, const Vec<3, T> *in,
+                    Vec<3, T> *out, size_t count) {
+  T m[12];
+  for (int c = 0; c < 3; ++c) {
+    for (int r = 0; r < 3; ++r) {
+      m[3 * c + r] = mat[4 * c + r];
+    }
+    m[9 + c] = mat[12 + c] * w;
+  }
+  forEachLane<T>(count, [&](auto lanes, size_t i) {
+    typedef decltype(lanes) L;
+    typename L::V x, y, z;
+    L::load3(in[i].elems(), x, y, z);
+    typename L::V t[3];
+    for (int r = 0; r < 3; ++r) {
+      t[r] = L::add(L::add(L::mul(L::set1(m[r]), x),
+                           L::mul(L::set1(m[3 + r]), y)),
+                    L::add(L::mul(L::set1(m[6 + r]), z), L::set1(m[9 + r])));
+    }
+    L::store3(out[i].elems(), t[0], t[1], t[2]);
+  });
+}
+
+template <typename T>
+void rotateArray(const Quat<T> &q, const Vec<3, T> *in, Vec<3, T> *out,
+                 size_t count) {
+  const T qw = q.w, qx = q.x, qy = q.y, qz = q.z;
+  forEachLane<T>(count, [&](auto lanes, size_t i) {
+    typedef decltype(lanes) L;
+    typedef typename L::V V;
+    V x, y, z;
+    L::load3(in[i].elems(), x, y, z);
+    const V w = L::set1(qw), a = L::set1(qx), b = L::set1(qy),
+            c = L::set1(qz);
+    // as Quat::rotate, p = q * (0, v), then the vector part of p * q^-1
+    V pw = L::sub(L::sub(L::sub(L::set1(T(0)), L::mul(a, x)), L::mul(b, y)),
+                  L::mul(c, z));
+    V px = L::sub(L::add(L::mul(w, x), L::mul(b, z)), L::mul(c, y));
+    V py = L::add(L::sub(L::mul(w, y), L::mul(a, z)), L::mul(c, x));
+    V pz = L::sub(L::add(L::mul(w, z), L::mul(a, y)), L::mul(b, x));
+    V rx = L::sub(L::add(L::sub(L::mul(px, w), L::mul(pw, a)), L::mul(pz, b)),
+                  L::mul(py, c));
+    V ry = L::sub(L::add(L::sub(L::mul(py, w), L::mul(pw, b)), L::mul(px, c)),
+                  L::mul(pz, a));
+    V rz = L::sub(L::add(L::sub(L::mul(pz, w), L::mul(pw, c)), L::mul(py, a)),
+                  L::mul(px, b));
+    L::store3(out[i].elems(), rx, ry, rz);
+  });
+}
+
+template <typename T>
+void normalizeArray(const Vec<3, T> *in, Vec<3, T> *out, size_t count,
+                    T scale) {
+  forEachLane<T>(count, [&](auto lanes, size_t i) {
+    typedef decltype(lanes) L;
+    typedef typename L::V V;
+    V x, y, z;
+    L::load3(in[i].elems(), x, y, z);
+    V m = L::sqrt(L::add(L::add(L::mul(x, x), L::mul(y, y)), L::mul(z, z)));
+    // as Vec::mag(), vectors too short to have a direction become
+    // (scale, 0, 0)
+    typename L::Mask ok = L::greater(m, L::set1(T(1e-20)));
+    V s = L::div(L::set1(scale), m);
+    V zero = L::set1(T(0));
+    L::store3(out[i].elems(),
+              L::select(ok, L::mul(x, s), L::set1(scale)),
+              L::select(ok, L::mul(y, s), zero),
+              L::select(ok, L::mul(z, s), zero));
+  });
+}
+
+template <typename T>
+void dotArray(const Vec<3, T> *a, const Vec<3, T> *b, T *out, size_t count) {
+  forEachLane<T>(count, [&](auto lanes, size_t i) {
+    typedef decltype(lanes) L;
+    typename L::V ax, ay, az, bx, by, bz;
+    L::load3(a[i].elems(), ax, ay, az);
+    L::load3(b[i].elems(), bx, by, bz);
+    L::store(out + i, L::add(L::add(L::mul(ax, bx), L::mul(ay, by)),
+                             L::mul(az, bz)));
+  });
+}
+
+template <typename T>
+void crossArray(const Vec<3, T> *a, const Vec<3, T> *b, Vec<3, T> *out,
+                size_t count) {
+  forEachLane<T>(count, [&](auto lanes, size_t i) {
+    typedef decltype(lanes) L;
+    typename L::V ax, ay, az, bx, by, bz;
+    L::load3(a[i].elems(), ax, ay, az);
+    L::load3(b[i].elems(), bx, by, bz);
+    L::store3(out[i].elems(), L::sub(L::mul(ay, bz), L::mul(az, by)),
+              L::sub(L::mul(az, bx), L::mul(ax, bz)),
+              L::sub(L::mul(ax, by), L::mul(ay, bx)));
+  });
+}
+}  // namespace
+
+void transformPoints(const Matrix4f &m, const Vec3f *in, Vec3f *out,
+                     size_t count) {
+  transformArray(m, 1.f, in, out, count);
+}
+
+void transformPoints(const Matrix4d &m, const Vec3d *in, Vec3d *out,
+                     size_t count) {
+  transformArray(m, 1., in, out, count);
+}
+
+void transformVectors(const Matrix4f &m, const Vec3f *in, Vec3f *out,
+                      size_t count) {
+  transformArray(m, 0.f, in, out, count);
+}
+
+void transformVectors(const Matrix4d &m, const Vec3d *in, Vec3d *out,
+                      size_t count) {
+  transformArray(m, 0., in, out, count);
+}
+
+void rotate(const Quatf &q, const Vec3f *in, Vec3f *out, size_t count) {
+  rotateArray(q, in, out, count);
+}
+
+void rotate(const Quatd &q, const Vec3d *in, Vec3d *out, size_t count) {
+  rotateArray(q, in, out, count);
+}
+
+void normalize(const Vec3f *in, Vec3f *out, size_t count, float scale) {
+  normalizeArray(in, out, count, scale);
+}
+
+void normalize(const Vec3d *in, Vec3d *out, size_t count, double scale) {
+  normalizeArray(in, out, count, scale);
+}
+
+void dot(const Vec3f *a, const Vec3f *b, float *out, size_t count) {
+  dotArray(a, b, out, count);
+}
+
+void dot(const Vec3d *a, const Vec3d *b, double *out, size_t count) {
+  dotArray(a, b, out, count);
+}
+
+void cross(const Vec3f *a, const Vec3f *b, Vec3f *out, size_t count) {
+  crossArray(a, b, out, count);
+}
+
+void cross(const Vec3d *a, const Vec3d *b, Vec3d *out, size_t count) {
+  crossArray(a, b, out, count);
+}
+
+}  // namespace al
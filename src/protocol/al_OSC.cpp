@@ -418,6 +418,9 @@ void Recv::stop() {
 }
 
 void Recv::parse(const char *packet, int size, const char *senderAddr) {
+  if (size > int(mBuffer.size())) {
+    mBuffer.resize(size);
+  }
   std::memcpy(&mBuffer[0], packet, size);
   auto messages = parse(&mBuffer[0], size, 1, senderAddr);
   for (auto *handler : mHandlers) {
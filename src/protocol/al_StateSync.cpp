@@ -0,0 +1,444 @@
+#include "al/protocol/al_StateSync.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+
+using namespace al;
+
+static const char *chunkAddress = "/_statechunk";
+static const char *chunkTypeTags = "siiiiiiiib";
+
+enum Encoding { KEYFRAME = 0, DELTA = 1 };
+
+// bytes sent back to back before pausing to keep to the send rate
+static const size_t burstSize = 65536;
+
+// zero gaps shorter than this are cheaper to keep inside a literal run than
+// to end the run for
+static const size_t minZeroRun = 3;
+
+static size_t padded(size_t size) { return (size + 3) & ~size_t(3); }
+
+// number of leading bytes equal in a and b, up to end
+static size_t equalRun(const unsigned char *a, const unsigned char *b,
+                       size_t pos, size_t end) {
+  size_t start = pos;
+  while (pos + 8 <= end) {
+    uint64_t x, y;
+    std::memcpy(&x, a + pos, 8);
+    std::memcpy(&y, b + pos, 8);
+    if (x != y) {
+      break;
+    }
+    pos += 8;
+  }
+  while (pos < end && a[pos] == b[pos]) {
+    pos++;
+  }
+  return pos - start;
+}
+
+static void writeVarint(std::vector<unsigned char> &out, size_t v) {
+  while (v >= 0x80) {
+    out.push_back((unsigned char)(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back((unsigned char)v);
+}
+
+static bool readVarint(const unsigned char *&in, const unsigned char *end,
+                       size_t &v) {
+  v = 0;
+  for (int shift = 0; in < end && shift < 64; shift += 7) {
+    unsigned char byte = *in++;
+    v |= size_t(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Encodes state XOR keyframe as pairs of runs: the count of unchanged bytes,
+// then the count of changed bytes followed by their XORed values. Gives up
+// as soon as the encoding is as large as the state.
+static bool encodeDelta(const unsigned char *state,
+                        const unsigned char *keyframe, size_t size,
+                        std::vector<unsigned char> &out) {
+  out.clear();
+  size_t pos = 0;
+  while (pos < size) {
+    size_t zeros = equalRun(state, keyframe, pos, size);
+    size_t start = pos + zeros;
+    size_t end = start;
+    while (end < size) {
+      if (state[end] != keyframe[end]) {
+        end++;
+        continue;
+      }
+      size_t gap =
+          equalRun(state, keyframe, end, std::min(end + minZeroRun, size));
+      if (gap >= minZeroRun || end + gap == size) {
+        break;
+      }
+      end += gap;
+    }
+    writeVarint(out, zeros);
+    writeVarint(out, end - start);
+    for (size_t i = start; i < end; i++) {
+      out.push_back(state[i] ^ keyframe[i]);
+    }
+    if (out.size() >= size) {
+      return false;
+    }
+    pos = end;
+  }
+  return true;
+}
+
+static bool decodeDelta(const unsigned char *in, size_t inSize,
+                        const unsigned char *keyframe, unsigned char *state,
+                        size_t size) {
+  const unsigned char *inEnd = in + inSize;
+  std::memcpy(state, keyframe, size);
+  size_t pos = 0;
+  while (pos < size) {
+    size_t zeros, literals;
+    if (!readVarint(in, inEnd, zeros) || !readVarint(in, inEnd, literals) ||
+        zeros > size - pos || literals > size - pos - zeros ||
+        literals > size_t(inEnd - in)) {
+      return false;
+    }
+    pos += zeros;
+    for (size_t i = 0; i < literals; i++) {
+      state[pos + i] ^= in[i];
+    }
+    in += literals;
+    pos += literals;
+  }
+  return in == inEnd;
+}
+
+// whether frame a comes after frame b, allowing the numbers to wrap around
+static bool newer(uint32_t a, uint32_t b) { return int32_t(a - b) > 0; }
+
+// StateSyncSender -------------------------------------------------------------
+
+const uint16_t StateSyncSender::maxPacketSize;
+
+StateSyncSender::StateSyncSender() {
+  // the clock tells apart restarts where random_device is deterministic
+  std::random_device device;
+  mSession = uint32_t(device()) ^
+             uint32_t(std::chrono::high_resolution_clock::now()
+                          .time_since_epoch()
+                          .count());
+}
+
+bool StateSyncSender::open(uint16_t port, const char *address,
+                           uint16_t packetSize) {
+  this->packetSize(packetSize);
+  mSocket.broadcast(true);
+  if (Socket::isMulticast(address)) {
+    mSocket.multicastInterface(mMulticastInterface);
+    mSocket.multicastTTL(mMulticastTTL);
+    // for receivers on this host
+    mSocket.multicastLoop(true);
+  }
+  if (!mSocket.open(port, address, 0, Socket::UDP | Socket::DGRAM)) {
+    std::cerr << "StateSyncSender: could not open " << address << ":" << port
+              << std::endl;
+    mSocket.close();
+    return false;
+  }
+  // receivers at a new address have none of the keyframes sent so far
+  mForceKeyframe = true;
+  return true;
+}
+
+void StateSyncSender::packetSize(uint16_t size) {
+  size = std::min(size, maxPacketSize);
+  if (size != mPacketSize) {
+    mPacketSize = size;
+    mPacket = nullptr;
+  }
+}
+
+size_t StateSyncSender::chunkSize() const {
+  // address, type tags, id, 8 ints and the blob size
+  size_t header = padded(std::strlen(chunkAddress) + 1) +
+                  padded(std::strlen(chunkTypeTags) + 2) +
+                  padded(mId.size() + 1) + 9 * 4;
+  if (header + 4 > mPacketSize) {
+    return 0;
+  }
+  return (mPacketSize - header) & ~size_t(3);
+}
+
+size_t StateSyncSender::send(const void *state, size_t size) {
+  size_t chunk = chunkSize();
+  if (size == 0 || size > size_t(INT32_MAX) || chunk == 0) {
+    return 0;
+  }
+  auto data = static_cast<const unsigned char *>(state);
+  mFrame++;
+
+  bool keyframe = mForceKeyframe || mKeyframe.size() != size ||
+                  mFramesSinceKeyframe + 1 >= mKeyframeInterval ||
+                  !encodeDelta(data, mKeyframe.data(), size, mEncoded);
+  const unsigned char *encoded = mEncoded.data();
+  size_t encodedSize = mEncoded.size();
+  if (keyframe) {
+    mKeyframe.assign(data, data + size);
+    mKeyframeFrame = mFrame;
+    mFramesSinceKeyframe = 0;
+    mForceKeyframe = false;
+    encoded = mKeyframe.data();
+    encodedSize = size;
+    mStats.keyframes++;
+  } else {
+    mFramesSinceKeyframe++;
+  }
+
+  if (!mPacket) {
+    mPacket = std::make_unique<osc::Packet>(mPacketSize);
+  }
+  size_t chunks = (encodedSize + chunk - 1) / chunk;
+  size_t sent = 0;
+  size_t paced = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < chunks; i++) {
+    size_t offset = i * chunk;
+    size_t n = std::min(chunk, encodedSize - offset);
+    mPacket->clear();
+    mPacket->beginMessage(chunkAddress);
+    *mPacket << mId << int(mSession) << int(mFrame) << int(mKeyframeFrame)
+             << int(keyframe ? KEYFRAME : DELTA) << int(size)
+             << int(encodedSize) << int(chunk) << int(i)
+             << osc::Blob(encoded + offset, n);
+    mPacket->endMessage();
+    size_t s = transmit(*mPacket);
+    if (s == 0) {
+      // the receiver cannot decode anything until the next keyframe
+      mForceKeyframe = true;
+      return 0;
+    }
+    sent += s;
+    if (mSendRate > 0 && sent - paced >= burstSize && i + 1 < chunks) {
+      // wait until the bytes sent so far took as long as they should have
+      paced = sent;
+      std::chrono::duration<double> due(sent / mSendRate);
+      std::this_thread::sleep_until(
+          start + std::chrono::duration_cast<std::chrono::nanoseconds>(due));
+    }
+  }
+  mStats.frames++;
+  mStats.chunks += chunks;
+  mStats.bytes += sent;
+  mStats.lastEncodedSize = encodedSize;
+  return sent;
+}
+
+size_t StateSyncSender::transmit(const osc::Packet &packet) {
+  if (!mSocket.opened()) {
+    return 0;
+  }
+  size_t sent = mSocket.send(packet.data(), packet.size());
+  return sent == packet.size() ? sent : 0;
+}
+
+// StateSyncReceiver -----------------------------------------------------------
+
+bool StateSyncReceiver::handle(osc::Message &m) {
+  if (m.addressPattern() != chunkAddress || m.typeTags() != chunkTypeTags) {
+    return false;
+  }
+  std::string id;
+  m >> id;
+  if (id != mId) {
+    return false;
+  }
+  int sessionArg, frameArg, base, encoding, stateSize, encodedSize, chunkSize,
+      index;
+  osc::Blob blob;
+  m >> sessionArg >> frameArg >> base >> encoding >> stateSize >> encodedSize >>
+      chunkSize >> index >> blob;
+  uint32_t session = uint32_t(sessionArg);
+  uint32_t frame = uint32_t(frameArg);
+
+  // check the header before trusting the sizes in it
+  bool valid = stateSize > 0 && encodedSize > 0 && chunkSize > 0 &&
+               index >= 0 && (encoding == KEYFRAME || encoding == DELTA) &&
+               (mExpectedSize == 0 || size_t(stateSize) == mExpectedSize) &&
+               (encoding == DELTA ? encodedSize < stateSize
+                                  : encodedSize == stateSize);
+  size_t chunks = valid ? (size_t(encodedSize) + chunkSize - 1) / chunkSize : 0;
+  if (!valid || size_t(index) >= chunks ||
+      blob.size != std::min(size_t(chunkSize),
+                            size_t(encodedSize) - size_t(index) * chunkSize)) {
+    mStats.invalid++;
+    return false;
+  }
+
+  // a restarted sender numbers its frames from the start again
+  if ((mHasFrame || mAssembling) && session != mSession) {
+    if (mAssembling) {
+      mStats.dropped++;
+    }
+    mAssembling = false;
+    mHasFrame = false;
+    mHasKeyframe = false;
+    mStats.restarts++;
+  }
+  mSession = session;
+
+  if (mHasFrame && !newer(frame, mFrame)) {
+    mStats.stale++;
+    return false;
+  }
+  if (mAssembling && frame != mPartFrame) {
+    if (!newer(frame, mPartFrame)) {
+      mStats.stale++;
+      return false;
+    }
+    mAssembling = false;
+    mStats.dropped++;
+  }
+  if (!mAssembling) {
+    mAssembling = true;
+    mPartFrame = frame;
+    mPartBase = uint32_t(base);
+    mPartEncoding = encoding;
+    mPartStateSize = stateSize;
+    mPartChunkSize = chunkSize;
+    mPart.resize(encodedSize);
+    mChunkReceived.assign(chunks, false);
+    mChunksLeft = chunks;
+  } else if (uint32_t(base) != mPartBase || encoding != mPartEncoding ||
+             size_t(stateSize) != mPartStateSize ||
+             size_t(encodedSize) != mPart.size() ||
+             size_t(chunkSize) != mPartChunkSize) {
+    mStats.invalid++;
+    return false;
+  }
+  if (mChunkReceived[index]) {
+    return false;
+  }
+  std::memcpy(mPart.data() + size_t(index) * chunkSize, blob.data, blob.size);
+  mChunkReceived[index] = true;
+  if (--mChunksLeft > 0) {
+    return false;
+  }
+
+  mAssembling = false;
+  if (!decode()) {
+    mStats.dropped++;
+    return false;
+  }
+  if (mHasFrame) {
+    mStats.lost += uint32_t(frame - mFrame - 1);
+  }
+  mHasState = true;
+  mHasFrame = true;
+  mFrame = frame;
+  mStats.frames++;
+  return true;
+}
+
+bool StateSyncReceiver::decode() {
+  if (mPartEncoding == KEYFRAME) {
+    mKeyframe = mPart;
+    mKeyframeFrame = mPartFrame;
+    mHasKeyframe = true;
+    mState = mPart;
+    return true;
+  }
+  if (!mHasKeyframe || mKeyframeFrame != mPartBase ||
+      mKeyframe.size() != mPartStateSize) {
+    return false;
+  }
+  // decode aside so the state is left whole on errors
+  mDecoded.resize(mPartStateSize);
+  if (!decodeDelta(mPart.data(), mPart.size(), mKeyframe.data(),
+                   mDecoded.data(), mDecoded.size())) {
+    return false;
+  }
+  mState.swap(mDecoded);
+  return true;
+}
+
+void StateSyncReceiver::reset() {
+  mAssembling = false;
+  mHasState = false;
+  mHasFrame = false;
+  mHasKeyframe = false;
+  mState.clear();
+  mKeyframe.clear();
+  mPart.clear();
+  mChunkReceived.clear();
+  mStats = Stats();
+}
+
+// StateSyncListener -----------------------------------------------------------
+
+bool StateSyncListener::open(uint16_t port, const char *address) {
+  stop();
+  mSocket.reuseAddress(true);
+  mSocket.receiveBufferSize(mReceiveBufferSize);
+  if (!mSocket.open(port, address, 0, Socket::UDP | Socket::DGRAM)) {
+    std::cerr << "StateSyncListener: could not bind " << address << ":"
+              << port << std::endl;
+    mSocket.close();
+    return false;
+  }
+  int granted = mSocket.receiveBufferSize();
+  if (granted < mReceiveBufferSize) {
+    std::cerr << "StateSyncListener: receive buffer of " << granted
+              << " bytes instead of " << mReceiveBufferSize
+              << ", large keyframes may lose chunks" << std::endl;
+  }
+  // wake up now and then to see if stopped
+  mSocket.timeout(0.1);
+  return true;
+}
+
+bool StateSyncListener::joinMulticast(const std::string &group,
+                                      const std::string &interfaceAddress) {
+  mSocket.multicastInterface(interfaceAddress);
+  return mSocket.joinMulticast(group);
+}
+
+bool StateSyncListener::start() {
+  if (!mSocket.opened() || !mHandler || mRunning) {
+    return false;
+  }
+  mRunning = true;
+  mThread = std::thread(&StateSyncListener::loop, this);
+  return true;
+}
+
+void StateSyncListener::stop() {
+  mRunning = false;
+  if (mThread.joinable()) {
+    mThread.join();
+  }
+}
+
+void StateSyncListener::loop() {
+  // large enough for any datagram
+  std::vector<char> buffer(65536);
+  while (mRunning) {
+    size_t size = mSocket.recv(buffer.data(), buffer.size());
+    // zero, or an error cast to size_t on timeouts
+    if (size == 0 || size > buffer.size()) {
+      continue;
+    }
+    for (auto &m : osc::Recv::parse(buffer.data(), int(size))) {
+      mHandler->onMessage(*m);
+    }
+  }
+}
@@ -1,8 +1,10 @@
 #include "al/scene/al_DynamicScene.hpp"
 
+#include "al/graphics/al_RenderQueue.hpp"
 #include "al/graphics/al_Shapes.hpp"
 
 #include <algorithm>
+#include <cstring>
 
 using namespace std;
 using namespace al;
@@ -131,38 +133,83 @@ void DynamicScene::render(Graphics &g) {
     processVoiceTurnOff();
   }
   std::unique_lock<std::mutex> lk(mGraphicsLock);
-  std::vector<PositionedVoice *> voices;
-  voices.reserve(128);
-  auto voice = mActiveVoices;
-  while (voice) {
-    voices.push_back((PositionedVoice *)voice);
-    voice = voice->next;
+  updateDrawList();
+  // A recording is replayed for several views, so voices are bounded in it
+  // and culled and sorted per view at replay instead
+  RenderQueue *queue = g.recordingQueue();
+  bool sortAtReplay = queue && mSortDrawingByDistance && mSortPerView;
+  bool boundVoices = queue && (mCullDrawingByFrustum || sortAtReplay);
+  mDrawOrder.clear();
+  if (mCullDrawingByFrustum && !queue) {
+    Frustumd frustum;
+    frustum.fromMatrix(g.projMatrix() * g.viewMatrix() * g.modelMatrix());
+    mVoiceTree.query(frustum, mDrawOrder);
+    // Keep the order of the active voice list
+    std::sort(mDrawOrder.begin(), mDrawOrder.end());
+  } else {
+    for (unsigned i = 0; i < mDrawVoices.size(); i++) {
+      mDrawOrder.push_back(i);
+    }
   }
-  if (mSortDrawingByDistance) {
-    // FIXME this is crashing in some undetermined cases.
-    // For now a working but inefficient way of sorting
-    auto viewPos = mListenerPose.pos();
-    std::sort(voices.begin(), voices.end(),
-              [&](PositionedVoice *a, PositionedVoice *b) -> bool {
-                auto distA = (a->pose().pos() - viewPos).mag();
-                auto distB = (b->pose().pos() - viewPos).mag();
-                return distA >= distB;
-              });
-  }
-  for (auto voice : voices) {
-    // TODO implement offset?
+  mCulledCount = mDrawVoices.size() - mDrawOrder.size();
+  if (mSortDrawingByDistance && !sortAtReplay) {
+    if (mSortPerView) {
+      Matrix4f eyeToModel =
+          Matrix4f::inverse(g.viewMatrix() * g.modelMatrix());
+      sortDrawOrder(Vec3f(eyeToModel(0, 3), eyeToModel(1, 3),
+                          eyeToModel(2, 3)));
+    } else {
+      sortDrawOrder(Vec3f(mListenerPose.pos()));
+    }
+  }
+  mDrawnCount = 0;
+  for (auto voice : mUnboundedVoices) {
     if (voice->active()) {
       g.pushMatrix();
-      if (dynamic_cast<PositionedVoice *>(voice)) {
-        PositionedVoice *posVoice = static_cast<PositionedVoice *>(voice);
-        posVoice->preProcess(g);
-        Pose pose = posVoice->pose();
-        g.translate(pose.x(), pose.y(), pose.z());
-        g.rotate(pose.quat());
-        g.scale(posVoice->size());
-      }
       voice->onProcess(g);
       g.popMatrix();
+      mDrawnCount++;
+    }
+  }
+  for (auto &renderer : mInstanceRenderers) {
+    renderer.second->instances().clear();
+  }
+  for (auto i : mDrawOrder) {
+    PositionedVoice *posVoice = mDrawVoices[i];
+    if (!posVoice->active()) {
+      continue;
+    }
+    if (mDrawRenderers[i]) {
+      Pose pose = posVoice->pose();
+      VoiceInstance instance{Vec3f(pose.pos()), Quatf(pose.quat()),
+                             posVoice->size(), Color(1.0f)};
+      posVoice->onInstance(instance);
+      mDrawRenderers[i]->instances().push_back(instance);
+      mDrawnCount++;
+      continue;
+    }
+    if (boundVoices) {
+      queue->beginBounds(g, mVoiceCenters[i], mVoiceRadii[i], sortAtReplay);
+    }
+    // TODO implement offset?
+    g.pushMatrix();
+    posVoice->preProcess(g);
+    Pose pose = posVoice->pose();
+    g.translate(pose.x(), pose.y(), pose.z());
+    g.rotate(pose.quat());
+    g.scale(posVoice->size());
+    posVoice->onProcess(g);
+    g.popMatrix();
+    if (boundVoices) {
+      queue->endBounds();
+    }
+    mDrawnCount++;
+  }
+  mBatchCount = 0;
+  for (auto &renderer : mInstanceRenderers) {
+    if (renderer.second->instances().size() > 0) {
+      renderer.second->draw(g, renderer.second->instances());
+      mBatchCount++;
     }
   }
   if (mMasterMode == TimeMasterMode::TIME_MASTER_GRAPHICS) {
@@ -170,6 +217,110 @@ void DynamicScene::render(Graphics &g) {
   }
 }
 
+void DynamicScene::updateDrawList() {
+  unsigned version = mActiveVoicesVersion;
+  if (version == mDrawListVersion) {
+    // Bounds are read once per frame and shared by all views of it
+    if (mDrawBoundsStale.exchange(false)) {
+      updateDrawBounds(false);
+    }
+    return;
+  }
+  mDrawListVersion = version;
+  mDrawBoundsStale = false;
+
+  mDrawVoices.clear();
+  mDrawRenderers.clear();
+  mUnboundedVoices.clear();
+  auto voice = mActiveVoices;
+  while (voice) {
+    PositionedVoice *posVoice = dynamic_cast<PositionedVoice *>(voice);
+    if (posVoice) {
+      mDrawVoices.push_back(posVoice);
+      InstanceRenderer *renderer = nullptr;
+      if (mInstanceRenderers.size() > 0) {
+        auto it = mInstanceRenderers.find(std::type_index(typeid(*posVoice)));
+        if (it != mInstanceRenderers.end()) {
+          renderer = it->second.get();
+        }
+      }
+      mDrawRenderers.push_back(renderer);
+    } else {
+      mUnboundedVoices.push_back(voice);
+    }
+    voice = voice->next;
+  }
+  updateDrawBounds(true);
+}
+
+void DynamicScene::updateDrawBounds(bool listChanged) {
+  if (!mCullDrawingByFrustum && !mSortDrawingByDistance) {
+    mVoiceCenters.clear();
+    mVoiceRadii.clear();
+    mVoiceTree.clear();
+    return;
+  }
+  // Voices can be moved from anywhere (setPose(), parameters, the network),
+  // so poses are read again every frame and the tree is only rebuilt when
+  // one of them has changed
+  bool changed = listChanged || mVoiceCenters.size() != mDrawVoices.size();
+  mVoiceCenters.resize(mDrawVoices.size());
+  mVoiceRadii.resize(mDrawVoices.size());
+  for (size_t i = 0; i < mDrawVoices.size(); i++) {
+    Vec3f center(mDrawVoices[i]->pose().pos());
+    float radius = mDrawVoices[i]->size() * mCullingRadius;
+    if (center != mVoiceCenters[i] || radius != mVoiceRadii[i]) {
+      mVoiceCenters[i] = center;
+      mVoiceRadii[i] = radius;
+      changed = true;
+    }
+  }
+  if (!mCullDrawingByFrustum) {
+    mVoiceTree.clear();
+  } else if (changed || mVoiceTree.size() != mDrawVoices.size()) {
+    mVoiceTree.build(mVoiceCenters, mVoiceRadii);
+  }
+}
+
+void DynamicScene::sortDrawOrder(const Vec3f &eye) {
+  // Squared distances are non-negative, so their float bits sort as unsigned
+  // integers. Inverting them puts the farthest voice first.
+  const size_t n = mDrawOrder.size();
+  if (n < 2) {
+    return;
+  }
+  mSortKeys.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    float dist = (mVoiceCenters[mDrawOrder[i]] - eye).magSqr();
+    uint32_t bits;
+    std::memcpy(&bits, &dist, sizeof(bits));
+    mSortKeys[i] = ~bits;
+  }
+
+  // Stable LSD radix sort, one byte per pass
+  mSortKeysTmp.resize(n);
+  mSortOrderTmp.resize(n);
+  for (int shift = 0; shift < 32; shift += 8) {
+    size_t counts[257] = {0};
+    for (size_t i = 0; i < n; i++) {
+      counts[((mSortKeys[i] >> shift) & 0xff) + 1]++;
+    }
+    if (counts[((mSortKeys[0] >> shift) & 0xff) + 1] == n) {
+      continue; // all keys share this byte
+    }
+    for (int b = 0; b < 256; b++) {
+      counts[b + 1] += counts[b];
+    }
+    for (size_t i = 0; i < n; i++) {
+      size_t dst = counts[(mSortKeys[i] >> shift) & 0xff]++;
+      mSortKeysTmp[dst] = mSortKeys[i];
+      mSortOrderTmp[dst] = mDrawOrder[i];
+    }
+    mSortKeys.swap(mSortKeysTmp);
+    mDrawOrder.swap(mSortOrderTmp);
+  }
+}
+
 void DynamicScene::render(AudioIOData &io) {
   if (!m_internalAudioConfigured) {
     prepare(io);
@@ -323,6 +474,7 @@ void DynamicScene::update(double dt) {
   if (mMasterMode == TimeMasterMode::TIME_MASTER_UPDATE) {
     processInactiveVoices();
   }
+  mDrawBoundsStale = true;
 }
 
 void DynamicScene::print(ostream &stream) {
@@ -349,8 +501,21 @@ void DynamicScene::print(ostream &stream) {
   PolySynth::print(stream);
 }
 
-void DynamicScene::sortDrawingByDistance(bool sort) {
+void DynamicScene::setInstanceRenderer(
+    std::type_index voiceType, std::shared_ptr<InstanceRenderer> renderer) {
+  std::unique_lock<std::mutex> lk(mGraphicsLock);
+  if (renderer) {
+    mInstanceRenderers[voiceType] = renderer;
+  } else {
+    mInstanceRenderers.erase(voiceType);
+  }
+  mDrawListVersion = ~0u;
+}
+
+void DynamicScene::sortDrawingByDistance(bool sort, bool perView) {
   mSortDrawingByDistance = sort;
+  mSortPerView = perView;
+  mDrawListVersion = ~0u;
 }
 
 void DynamicScene::updateThreadFunc(UpdateThreadFuncData data) {
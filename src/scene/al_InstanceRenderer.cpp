@@ -0,0 +1,119 @@
+#include "al/scene/al_InstanceRenderer.hpp"
+
+using namespace al;
+
+namespace {
+
+const char *defaultInstanceVert = R"(
+#version 330
+uniform mat4 al_ModelViewMatrix;
+uniform mat4 al_ProjectionMatrix;
+
+layout (location = 0) in vec3 position;
+layout (location = 5) in vec3 instancePosition;
+layout (location = 6) in vec4 instanceOrientation; // w, x, y, z
+layout (location = 7) in float instanceSize;
+layout (location = 8) in vec4 instanceColor;
+
+out vec4 color;
+
+vec3 rotate(vec4 q, vec3 v) {
+  vec3 u = q.yzw;
+  float s = q.x;
+  return 2.0 * dot(u, v) * u + (s * s - dot(u, u)) * v + 2.0 * s * cross(u, v);
+}
+
+void main() {
+  vec3 p = rotate(instanceOrientation, position * instanceSize);
+  gl_Position = al_ProjectionMatrix * al_ModelViewMatrix *
+                vec4(p + instancePosition, 1.0);
+  color = instanceColor;
+}
+)";
+
+const char *defaultInstanceFrag = R"(
+#version 330
+in vec4 color;
+layout (location = 0) out vec4 frag_out0;
+void main() { frag_out0 = color; }
+)";
+
+} // namespace
+
+void InstancedMeshRenderer::mesh(const Mesh &m) {
+  mMesh.copy(m);
+  if (mCreated) {
+    mMesh.update();
+  }
+}
+
+void InstancedMeshRenderer::shaderSources(const std::string &vert,
+                                          const std::string &frag) {
+  mVertSource = vert;
+  mFragSource = frag;
+  if (mCreated) {
+    mShader.compile(mVertSource, mFragSource);
+  }
+}
+
+void InstancedMeshRenderer::create() {
+  if (mVertSource.empty()) {
+    mVertSource = defaultInstanceVert;
+    mFragSource = defaultInstanceFrag;
+  }
+  mShader.compile(mVertSource, mFragSource);
+  mMesh.update();
+
+  mInstanceBuffer.bufferType(GL_ARRAY_BUFFER);
+  mInstanceBuffer.usage(GL_STREAM_DRAW);
+  mInstanceBuffer.create();
+
+  auto &vao = mMesh.vao();
+  vao.bind();
+  const int stride = sizeof(VoiceInstance);
+  const unsigned int locations[] = {INSTANCE_POSITION, INSTANCE_ORIENTATION,
+                                    INSTANCE_SIZE, INSTANCE_COLOR};
+  const int sizes[] = {3, 4, 1, 4};
+  size_t offset = 0;
+  for (int i = 0; i < 4; i++) {
+    vao.enableAttrib(locations[i]);
+    vao.attribPointer(locations[i], mInstanceBuffer, sizes[i], GL_FLOAT,
+                      GL_FALSE, stride, (void const *)offset);
+    glVertexAttribDivisor(locations[i], 1);
+    offset += sizes[i] * sizeof(float);
+  }
+  mCreated = true;
+}
+
+void InstancedMeshRenderer::draw(Graphics &g,
+                                 const std::vector<VoiceInstance> &instances) {
+  if (instances.empty() || mMesh.vertices().empty()) {
+    return;
+  }
+  if (!mCreated) {
+    create();
+  }
+
+  // Orphan the previous storage so the driver does not wait for the last
+  // frame's draw to finish before accepting new data
+  size_t bytes = instances.size() * sizeof(VoiceInstance);
+  mInstanceBuffer.bind();
+  if (bytes > mBufferCapacity) {
+    mBufferCapacity = bytes + bytes / 2;
+  }
+  mInstanceBuffer.data(mBufferCapacity, nullptr);
+  mInstanceBuffer.subdata(0, int(bytes), instances.data());
+
+  g.shader(mShader);
+  g.update();
+  mMesh.vao().bind();
+  GLsizei count = GLsizei(instances.size());
+  if (mMesh.indices().size()) {
+    mMesh.indexBuffer().bind();
+    glDrawElementsInstanced(mMesh.primitive(), GLsizei(mMesh.indices().size()),
+                            GL_UNSIGNED_INT, nullptr, count);
+  } else {
+    glDrawArraysInstanced(mMesh.primitive(), 0,
+                          GLsizei(mMesh.vertices().size()), count);
+  }
+}
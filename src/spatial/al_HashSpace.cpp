@@ -1,5 +1,9 @@
 #include "al/spatial/al_HashSpace.hpp"
+
+#include <cmath>
+
 #include "al/math/al_Functions.hpp"
+#include "al/system/al_ParallelFor.hpp"
 
 using namespace al;
 
@@ -96,3 +100,269 @@ HashSpace ::HashSpace(uint32_t resolution, uint32_t numObjects)
 }
 
 HashSpace ::~HashSpace() {}
+
+void HashSpace ::rebuild(const Vec3f *positions, uint32_t count,
+                         unsigned numThreads) {
+  uint32_t oldCount = mObjects.size();
+  mObjects.resize(count);
+  for (uint32_t i = oldCount; i < count; i++) {
+    mObjects[i].id = i;
+  }
+  mSortedIds.resize(count);
+  mSortedX.resize(count);
+  mSortedY.resize(count);
+  mSortedZ.resize(count);
+  mCellStart.assign(mDim3 + 1, 0);
+
+  // each chunk counts its objects per voxel, so that the objects can then
+  // be scattered in parallel; with many voxels and few objects, fewer
+  // chunks keep the counts from outgrowing the objects
+  const size_t minChunk = 4096;
+  unsigned chunks = parallelForChunks(count, numThreads, minChunk);
+  chunks = std::max(1u, std::min(chunks, unsigned(4 * size_t(count) / mDim3)));
+  std::vector<uint32_t> &counts = mChunkCounts;
+  counts.assign(size_t(chunks) * mDim3, 0);
+  auto chunkIndex = [=](size_t begin) {
+    return unsigned((begin * chunks + count - 1) / count);
+  };
+
+  parallelFor(
+      count,
+      [&](size_t begin, size_t end) {
+        uint32_t *c = &counts[size_t(chunkIndex(begin)) * mDim3];
+        for (size_t i = begin; i < end; i++) {
+          Object &o = mObjects[i];
+          o.pos.set(wrap(Vec3d(positions[i])));
+          o.hash = hash(o.pos);
+          c[o.hash]++;
+        }
+      },
+      chunks, minChunk);
+
+  // offsets per voxel and chunk, keeping objects in id order within voxels
+  uint32_t offset = 0;
+  for (uint32_t h = 0; h < mDim3; h++) {
+    mCellStart[h] = offset;
+    for (unsigned k = 0; k < chunks; k++) {
+      uint32_t &c = counts[size_t(k) * mDim3 + h];
+      uint32_t n = c;
+      c = offset;
+      offset += n;
+    }
+  }
+  mCellStart[mDim3] = offset;
+
+  parallelFor(
+      count,
+      [&](size_t begin, size_t end) {
+        uint32_t *next = &counts[size_t(chunkIndex(begin)) * mDim3];
+        for (size_t i = begin; i < end; i++) {
+          const Object &o = mObjects[i];
+          uint32_t j = next[o.hash]++;
+          mSortedIds[j] = uint32_t(i);
+          mSortedX[j] = float(o.pos.x);
+          mSortedY[j] = float(o.pos.y);
+          mSortedZ[j] = float(o.pos.z);
+        }
+      },
+      chunks, minChunk);
+
+  // relink the voxel lists in sorted order, voxels don't share objects
+  parallelFor(
+      mDim3,
+      [&](size_t begin, size_t end) {
+        for (size_t h = begin; h < end; h++) {
+          uint32_t first = mCellStart[h], last = mCellStart[h + 1];
+          if (first == last) {
+            mVoxels[h].mObjects = nullptr;
+            continue;
+          }
+          for (uint32_t j = first; j < last; j++) {
+            Object &o = mObjects[mSortedIds[j]];
+            o.next = &mObjects[mSortedIds[j + 1 < last ? j + 1 : first]];
+            o.prev = &mObjects[mSortedIds[j > first ? j - 1 : last - 1]];
+          }
+          mVoxels[h].mObjects = &mObjects[mSortedIds[first]];
+        }
+      },
+      numThreads, 1 << 14);
+  mSorted = true;
+}
+
+namespace {
+// squared distance across the torus; offsets are less than one period
+inline float wrappedDistanceSquared(float dx, float dy, float dz, float dim,
+                                    float half) {
+  dx += dx > half ? -dim : (dx < -half ? dim : 0.f);
+  dy += dy > half ? -dim : (dy < -half ? dim : 0.f);
+  dz += dz > half ? -dim : (dz < -half ? dim : 0.f);
+  return dx * dx + dy * dy + dz * dz;
+}
+}  // namespace
+
+template <typename Search>
+void HashSpace ::batchQuery(Neighbors &out, unsigned numThreads,
+                            const Search &search) const {
+  uint32_t n = mSortedIds.size();
+  out.offsets.assign(n + 1, 0);
+  out.mStart.resize(n);
+  out.mChunkOf.resize(n);
+
+  const size_t minChunk = 256;
+  unsigned chunks = parallelForChunks(n, numThreads, minChunk);
+  if (out.mChunks.size() < chunks) {
+    out.mChunks.resize(chunks);
+  }
+  parallelFor(
+      n,
+      [&](size_t begin, size_t end) {
+        unsigned c = unsigned((begin * chunks + n - 1) / n);
+        Neighbors::Chunk &chunk = out.mChunks[c];
+        chunk.ids.clear();
+        chunk.distancesSquared.clear();
+        for (size_t j = begin; j < end; j++) {
+          uint32_t id = mSortedIds[j];
+          uint32_t first = chunk.ids.size();
+          search(uint32_t(j), chunk);
+          out.mStart[id] = first;
+          out.mChunkOf[id] = c;
+          out.offsets[id + 1] = chunk.ids.size() - first;
+        }
+      },
+      chunks, minChunk);
+
+  for (uint32_t i = 0; i < n; i++) {
+    out.offsets[i + 1] += out.offsets[i];
+  }
+  out.ids.resize(out.offsets[n]);
+  out.distancesSquared.resize(out.offsets[n]);
+  parallelFor(
+      n,
+      [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+          const Neighbors::Chunk &chunk = out.mChunks[out.mChunkOf[i]];
+          uint32_t from = out.mStart[i], to = out.offsets[i];
+          uint32_t count = out.offsets[i + 1] - to;
+          std::copy_n(chunk.ids.data() + from, count, out.ids.data() + to);
+          std::copy_n(chunk.distancesSquared.data() + from, count,
+                      out.distancesSquared.data() + to);
+        }
+      },
+      numThreads, 4096);
+}
+
+template <typename Visit>
+void HashSpace ::visitBox(float x, float y, float z, float r,
+                          const Visit &visit) const {
+  // voxels overlapping the bounding box of the sphere, as ranges per axis
+  // which wrap around at most once
+  const int dim = int(mDim);
+  const float c[3] = {x, y, z};
+  int lo[3], hi[3];
+  for (int a = 0; a < 3; a++) {
+    lo[a] = int(std::floor(c[a] - r));
+    hi[a] = int(std::floor(c[a] + r));
+    if (hi[a] - lo[a] + 1 >= dim) {
+      lo[a] = 0;
+      hi[a] = dim - 1;
+    }
+  }
+  // voxels along x are consecutive, so each row of the box is one or two
+  // contiguous runs of the sorted arrays
+  int x0 = (lo[0] + dim) % dim, x1 = x0 + hi[0] - lo[0];
+  for (int zi = lo[2]; zi <= hi[2]; zi++) {
+    for (int yi = lo[1]; yi <= hi[1]; yi++) {
+      uint32_t row = hashy(uint32_t(yi + dim)) + hashz(uint32_t(zi + dim));
+      uint32_t end = row + std::min(x1, dim - 1);
+      for (uint32_t m = mCellStart[row + x0]; m < mCellStart[end + 1]; m++) {
+        if (!visit(m)) return;
+      }
+      if (x1 >= dim) {
+        end = row + x1 - dim;
+        for (uint32_t m = mCellStart[row]; m < mCellStart[end + 1]; m++) {
+          if (!visit(m)) return;
+        }
+      }
+    }
+  }
+}
+
+bool HashSpace ::neighborsWithin(Neighbors &out, double radius,
+                                 uint32_t maxNeighbors,
+                                 unsigned numThreads) const {
+  if (!mSorted) {
+    return false;
+  }
+  const float r = float(radius), r2 = r * r;
+  const float dim = float(mDim), half = float(mDimHalf);
+  batchQuery(out, numThreads, [&](uint32_t j, Neighbors::Chunk &chunk) {
+    if (maxNeighbors == 0) {
+      return;
+    }
+    float x = mSortedX[j], y = mSortedY[j], z = mSortedZ[j];
+    uint32_t found = 0;
+    visitBox(x, y, z, r, [&](uint32_t m) {
+      float d2 = wrappedDistanceSquared(mSortedX[m] - x, mSortedY[m] - y,
+                                        mSortedZ[m] - z, dim, half);
+      if (d2 <= r2 && m != j) {
+        chunk.ids.push_back(mSortedIds[m]);
+        chunk.distancesSquared.push_back(d2);
+        return ++found < maxNeighbors;
+      }
+      return true;
+    });
+  });
+  return true;
+}
+
+bool HashSpace ::nearestNeighbors(Neighbors &out, uint32_t k,
+                                  double maxRadius,
+                                  unsigned numThreads) const {
+  if (!mSorted) {
+    return false;
+  }
+  const float maxR = float(maxRadius);
+  const float dim = float(mDim), half = float(mDimHalf);
+  // start with a box expected to hold about 2k objects
+  const float density = mSortedIds.size() / (dim * dim * dim);
+  const float guess =
+      std::cbrt(1.5f * k / (3.14159265f * std::max(density, 1e-9f)));
+  batchQuery(out, numThreads, [&](uint32_t j, Neighbors::Chunk &chunk) {
+    // max heap of the k nearest so far
+    auto &heap = chunk.heap;
+    heap.clear();
+    float x = mSortedX[j], y = mSortedY[j], z = mSortedZ[j];
+    float r = std::min(guess, maxR);
+    while (k > 0) {
+      heap.clear();
+      float limit = r * r;
+      visitBox(x, y, z, r, [&](uint32_t m) {
+        float d2 = wrappedDistanceSquared(mSortedX[m] - x, mSortedY[m] - y,
+                                          mSortedZ[m] - z, dim, half);
+        if (d2 <= limit && m != j) {
+          if (heap.size() == k) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.pop_back();
+          }
+          heap.emplace_back(d2, mSortedIds[m]);
+          std::push_heap(heap.begin(), heap.end());
+          if (heap.size() == k) {
+            limit = heap.front().first;
+          }
+        }
+        return true;
+      });
+      // anything nearer than the k-th found lies within the box
+      if (heap.size() == k || r >= maxR || 2 * r + 1 >= dim) {
+        break;
+      }
+      r = std::min(2 * r, maxR);
+    }
+    std::sort_heap(heap.begin(), heap.end());
+    for (auto &e : heap) {
+      chunk.ids.push_back(e.second);
+      chunk.distancesSquared.push_back(e.first);
+    }
+  });
+  return true;
+}
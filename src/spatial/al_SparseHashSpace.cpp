@@ -0,0 +1,269 @@
+#include "al/spatial/al_SparseHashSpace.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace al {
+
+SparseHashSpace::SparseHashSpace(double cellSize, const Vec3d &period,
+                                 uint32_t numObjects)
+    : mCellSize(cellSize > 0 ? cellSize : 1.), mPeriod(period) {
+  for (int a = 0; a < 3; a++) {
+    if (mPeriod[a] > 0) {
+      mCellsPerPeriod[a] = std::max(1, int(std::ceil(mPeriod[a] / mCellSize)));
+    } else {
+      mPeriod[a] = 0;
+      mCellsPerPeriod[a] = 0;
+    }
+  }
+  this->numObjects(numObjects);
+}
+
+double SparseHashSpace::maxRadius() const {
+  double r = std::numeric_limits<double>::max();
+  for (int a = 0; a < 3; a++) {
+    if (mPeriod[a] > 0) {
+      r = std::min(r, mPeriod[a] / 2);
+    }
+  }
+  return r;
+}
+
+void SparseHashSpace::numObjects(uint32_t numObjects) {
+  mCells.clear();
+  mObjects.clear();
+  mObjects.resize(numObjects);
+  for (uint32_t i = 0; i < numObjects; i++) {
+    mObjects[i].id = i;
+  }
+}
+
+Vec3d SparseHashSpace::wrap(const Vec3d &v) const {
+  Vec3d w(v);
+  for (int a = 0; a < 3; a++) {
+    double p = mPeriod[a];
+    if (p > 0) {
+      w[a] -= p * std::floor(w[a] / p);
+      // rounding can land exactly on the period
+      if (w[a] >= p) w[a] = 0;
+    }
+  }
+  return w;
+}
+
+Vec3d SparseHashSpace::wrapRelative(const Vec3d &v) const {
+  Vec3d w(v);
+  for (int a = 0; a < 3; a++) {
+    double p = mPeriod[a];
+    if (p > 0) {
+      w[a] -= p * std::floor(w[a] / p + 0.5);
+    }
+  }
+  return w;
+}
+
+int SparseHashSpace::cellIndex(double x, int axis) const {
+  double c = std::floor(x / mCellSize);
+  int n = mCellsPerPeriod[axis];
+  if (n) {
+    return std::min(int(c), n - 1);
+  }
+  // beyond the key range cells alias, which is harmless
+  const double limit = 1 << 30;
+  return int(std::max(-limit, std::min(c, limit)));
+}
+
+SparseHashSpace &SparseHashSpace::moveTo(uint32_t objectId, const Vec3d &pos) {
+  Object &o = mObjects[objectId];
+  o.pos = wrap(pos);
+  uint64_t k = key(cellIndex(o.pos.x, 0), cellIndex(o.pos.y, 1),
+                   cellIndex(o.pos.z, 2));
+  if (o.next && o.cell == k) {
+    return *this;
+  }
+  remove(objectId);
+  o.cell = k;
+  Object *&head = mCells[k];
+  if (head) {
+    // add to tail:
+    Object *last = head->prev;
+    last->next = &o;
+    o.prev = last;
+    o.next = head;
+    head->prev = &o;
+  } else {
+    head = o.prev = o.next = &o;
+  }
+  return *this;
+}
+
+SparseHashSpace &SparseHashSpace::remove(uint32_t objectId) {
+  Object &o = mObjects[objectId];
+  if (!o.next) {
+    return *this;
+  }
+  if (o.next == &o) {
+    // last one out frees the cell
+    mCells.erase(o.cell);
+  } else {
+    o.prev->next = o.next;
+    o.next->prev = o.prev;
+    auto it = mCells.find(o.cell);
+    if (it->second == &o) {
+      it->second = o.next;
+    }
+  }
+  o.prev = o.next = nullptr;
+  return *this;
+}
+
+template <typename Visit>
+void SparseHashSpace::visitCells(const Vec3d &center, double radius,
+                                 const Visit &visit) const {
+  // cell ranges covering [center - radius, center + radius] along each
+  // axis, split in two where they wrap around
+  int ranges[3][2][2];
+  int numRanges[3];
+  double boxCells = 1;
+  for (int a = 0; a < 3; a++) {
+    double lo = center[a] - radius, hi = center[a] + radius;
+    int n = mCellsPerPeriod[a];
+    double p = mPeriod[a];
+    if (n && hi - lo >= p) {
+      ranges[a][0][0] = 0;
+      ranges[a][0][1] = n - 1;
+      numRanges[a] = 1;
+    } else if (n && lo < 0) {
+      ranges[a][0][0] = cellIndex(lo + p, a);
+      ranges[a][0][1] = n - 1;
+      ranges[a][1][0] = 0;
+      ranges[a][1][1] = cellIndex(hi, a);
+      numRanges[a] = 2;
+    } else if (n && hi >= p) {
+      ranges[a][0][0] = cellIndex(lo, a);
+      ranges[a][0][1] = n - 1;
+      ranges[a][1][0] = 0;
+      ranges[a][1][1] = cellIndex(hi - p, a);
+      numRanges[a] = 2;
+    } else {
+      ranges[a][0][0] = cellIndex(lo, a);
+      ranges[a][0][1] = cellIndex(hi, a);
+      numRanges[a] = 1;
+    }
+    // a range nearly a period wide can wrap back into the cells it started
+    // in; they would be visited twice, so visit the whole period once
+    if (numRanges[a] == 2 && ranges[a][1][1] >= ranges[a][0][0] - 1) {
+      ranges[a][0][0] = 0;
+      ranges[a][0][1] = n - 1;
+      numRanges[a] = 1;
+    }
+    double count = 0;
+    for (int r = 0; r < numRanges[a]; r++) {
+      count += double(ranges[a][r][1]) - ranges[a][r][0] + 1;
+    }
+    boxCells *= count;
+  }
+
+  // looking up more cells than are occupied is slower than visiting them all
+  if (boxCells > double(mCells.size())) {
+    for (auto &cell : mCells) {
+      visit(cell.second);
+    }
+    return;
+  }
+  for (int rx = 0; rx < numRanges[0]; rx++) {
+    for (int x = ranges[0][rx][0]; x <= ranges[0][rx][1]; x++) {
+      for (int ry = 0; ry < numRanges[1]; ry++) {
+        for (int y = ranges[1][ry][0]; y <= ranges[1][ry][1]; y++) {
+          for (int rz = 0; rz < numRanges[2]; rz++) {
+            for (int z = ranges[2][rz][0]; z <= ranges[2][rz][1]; z++) {
+              auto it = mCells.find(key(x, y, z));
+              if (it != mCells.end()) {
+                visit(it->second);
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+int SparseHashSpace::Query::find(const SparseHashSpace &space,
+                                 const Vec3d &center, const Object *skip,
+                                 double maxRadius, double minRadius) {
+  const size_t first = mObjects.size();
+  const double minr2 = minRadius * minRadius;
+  const double maxr2 = maxRadius * maxRadius;
+  const Vec3d c = space.wrap(center);
+  space.visitCells(c, maxRadius, [&](Object *head) {
+    Object *o = head;
+    do {
+      if (o != skip) {
+        double d2 = space.wrapRelative(o->pos - c).magSqr();
+        if (d2 >= minr2 && d2 <= maxr2) {
+          Result r;
+          r.object = o;
+          r.distanceSquared = d2;
+          mObjects.push_back(r);
+        }
+      }
+      o = o->next;
+    } while (o != head);
+  });
+
+  // keep the nearest
+  size_t found = mObjects.size() - first;
+  if (found > mMaxResults) {
+    auto begin = mObjects.begin() + first;
+    std::nth_element(begin, begin + mMaxResults, mObjects.end(),
+                     [](const Result &x, const Result &y) {
+                       return x.distanceSquared < y.distanceSquared;
+                     });
+    mObjects.resize(first + mMaxResults);
+    found = mMaxResults;
+  }
+  return int(found);
+}
+
+int SparseHashSpace::Query::operator()(const SparseHashSpace &space,
+                                       Vec3d center, double maxRadius,
+                                       double minRadius) {
+  return find(space, center, nullptr, maxRadius, minRadius);
+}
+
+int SparseHashSpace::Query::operator()(const SparseHashSpace &space,
+                                       const Object *obj, double maxRadius,
+                                       double minRadius) {
+  return find(space, obj->pos, obj, maxRadius, minRadius);
+}
+
+SparseHashSpace::Object *SparseHashSpace::Query::nearest(
+    const SparseHashSpace &space, const Object *obj) {
+  // grow the radius until something is found; once the search box holds
+  // more cells than are occupied, all objects are looked at anyway
+  const double limit = space.maxRadius();
+  double r = space.cellSize();
+  while (space.numCells() > 0) {
+    double side = 2 * r / space.cellSize() + 1;
+    if (r >= limit || side * side * side > double(space.numCells())) {
+      r = limit;
+    }
+    clear();
+    if (find(space, obj->pos, obj, r, 0)) {
+      auto best = std::min_element(mObjects.begin(), mObjects.end(),
+                                   [](const Result &x, const Result &y) {
+                                     return x.distanceSquared <
+                                            y.distanceSquared;
+                                   });
+      return best->object;
+    }
+    if (r >= limit) {
+      break;
+    }
+    r *= 2;
+  }
+  return nullptr;
+}
+
+}  // namespace al
@@ -0,0 +1,111 @@
+#include "al/spatial/al_SphereTree.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace al;
+
+void SphereTree::build(const std::vector<Vec3f> &centers,
+                       const std::vector<float> &radii, unsigned leafSize) {
+  clear();
+  if (centers.empty() || radii.size() != centers.size()) {
+    return;
+  }
+  mCenters = centers;
+  mRadii.resize(radii.size());
+  for (size_t i = 0; i < radii.size(); ++i) {
+    mRadii[i] = std::abs(radii[i]);
+  }
+  mItems.resize(centers.size());
+  for (size_t i = 0; i < mItems.size(); ++i) {
+    mItems[i] = unsigned(i);
+  }
+  mNodes.reserve(2 * mItems.size() / std::max(leafSize, 1u) + 1);
+  buildNode(0, unsigned(mItems.size()), std::max(leafSize, 1u));
+}
+
+void SphereTree::clear() {
+  mNodes.clear();
+  mItems.clear();
+  mCenters.clear();
+  mRadii.clear();
+}
+
+unsigned SphereTree::buildNode(unsigned first, unsigned count,
+                               unsigned leafSize) {
+  unsigned index = unsigned(mNodes.size());
+  mNodes.push_back(Node());
+
+  Vec3f lo(INFINITY), hi(-INFINITY);  // box of spheres
+  Vec3f clo(INFINITY), chi(-INFINITY); // box of centers
+  for (unsigned i = first; i < first + count; ++i) {
+    const Vec3f &c = mCenters[mItems[i]];
+    float r = mRadii[mItems[i]];
+    for (int k = 0; k < 3; ++k) {
+      lo[k] = std::min(lo[k], c[k] - r);
+      hi[k] = std::max(hi[k], c[k] + r);
+      clo[k] = std::min(clo[k], c[k]);
+      chi[k] = std::max(chi[k], c[k]);
+    }
+  }
+
+  unsigned right = 0;
+  if (count > leafSize) {
+    Vec3f extent = chi - clo;
+    int axis = 0;
+    if (extent[1] > extent[axis]) axis = 1;
+    if (extent[2] > extent[axis]) axis = 2;
+    unsigned half = count / 2;
+    auto begin = mItems.begin() + first;
+    std::nth_element(begin, begin + half, begin + count,
+                     [&](unsigned a, unsigned b) {
+                       return mCenters[a][axis] < mCenters[b][axis];
+                     });
+    buildNode(first, half, leafSize);
+    right = buildNode(first + half, count - half, leafSize);
+  }
+
+  Node &node = mNodes[index];
+  node.min = lo;
+  node.max = hi;
+  node.first = first;
+  node.count = count;
+  node.right = right;
+  return index;
+}
+
+void SphereTree::query(const Frustumd &frustum,
+                       std::vector<unsigned> &result) const {
+  if (mNodes.empty()) {
+    return;
+  }
+  unsigned stack[64];
+  int top = 0;
+  stack[top++] = 0;
+  while (top) {
+    const Node &node = mNodes[stack[--top]];
+    Vec3d xyz(node.min), dim(node.max - node.min);
+    int test = frustum.testBox(xyz, dim);
+    if (test == Frustumd::OUTSIDE) {
+      continue;
+    }
+    if (test == Frustumd::INSIDE) {
+      result.insert(result.end(), mItems.begin() + node.first,
+                    mItems.begin() + node.first + node.count);
+      continue;
+    }
+    if (node.right) {
+      // push the second child first so the first child is visited first
+      stack[top++] = node.right;
+      stack[top++] = unsigned(&node - &mNodes[0]) + 1;
+      continue;
+    }
+    for (unsigned i = node.first; i < node.first + node.count; ++i) {
+      unsigned item = mItems[i];
+      if (frustum.testSphere(Vec3d(mCenters[item]), mRadii[item]) !=
+          Frustumd::OUTSIDE) {
+        result.push_back(item);
+      }
+    }
+  }
+}
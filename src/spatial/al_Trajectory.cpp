@@ -0,0 +1,448 @@
+#include "al/spatial/al_Trajectory.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "al/math/al_SIMD.hpp"
+#include "al/system/al_ParallelFor.hpp"
+
+namespace al {
+
+namespace {
+// objects interpolated together, a multiple of any Lanes size
+const uint32_t blockSize = 64;
+
+// smaller work stays on the calling thread
+const size_t minSamplesPerThread = 1 << 15;
+
+// Segments gathered for a block of objects, one array per component
+struct Block {
+  float u[blockSize];  // fraction of the way through the segment
+  float h[blockSize];  // duration of the segment
+  float p0[3][blockSize], p1[3][blockSize];
+  float v0[3][blockSize], v1[3][blockSize];
+  float q0[4][blockSize], q1[4][blockSize];
+  float s0[4][blockSize], s1[4][blockSize];
+  float angle[blockSize];
+  float pos[3][blockSize];
+  float quat[4][blockSize];
+
+  // a still object at the origin, with no rotation
+  void identity(uint32_t j) {
+    u[j] = 0;
+    h[j] = 1;
+    for (int c = 0; c < 3; ++c) {
+      p0[c][j] = p1[c][j] = v0[c][j] = v1[c][j] = 0;
+    }
+    for (int c = 0; c < 4; ++c) {
+      q0[c][j] = q1[c][j] = s0[c][j] = s1[c][j] = c ? 0.f : 1.f;
+    }
+    angle[j] = 0;
+  }
+};
+
+// sin(x) for x in [0, pi/2], Taylor series to x^11
+template <class L>
+typename L::V sinQuarter(typename L::V x) {
+  typename L::V x2 = L::mul(x, x);
+  typename L::V p = L::set1(-2.5052108e-8f);
+  p = L::add(L::mul(p, x2), L::set1(2.7557319e-6f));
+  p = L::add(L::mul(p, x2), L::set1(-1.9841270e-4f));
+  p = L::add(L::mul(p, x2), L::set1(8.3333333e-3f));
+  p = L::add(L::mul(p, x2), L::set1(-1.6666667e-1f));
+  p = L::add(L::mul(p, x2), L::set1(1.f));
+  return L::mul(p, x);
+}
+
+// acos(x) for x in [0, 1], Abramowitz & Stegun 4.4.46
+template <class L>
+typename L::V acosUnit(typename L::V x) {
+  const float a[] = {-0.0012624911f, 0.0066700901f, -0.0170881256f,
+                     0.0308918810f,  -0.0501743046f, 0.0889789874f,
+                     -0.2145988016f, 1.5707963050f};
+  x = L::max(L::min(x, L::set1(1.f)), L::set1(0.f));
+  typename L::V p = L::set1(a[0]);
+  for (int i = 1; i < 8; ++i) {
+    p = L::add(L::mul(p, x), L::set1(a[i]));
+  }
+  return L::mul(L::sqrt(L::sub(L::set1(1.f), x)), p);
+}
+
+// slerp from a to b, which are the angle apart, as Quat::slerp
+template <class L>
+void slerpLanes(const typename L::V *a, const typename L::V *b,
+                typename L::V u, typename L::V angle, typename L::V *out) {
+  typedef typename L::V V;
+  const V one = L::set1(1.f);
+  V ru = L::sub(one, u);
+  // nearly the same orientations interpolate linearly
+  typename L::Mask apart = L::greater(angle, L::set1(1e-3f));
+  V inv = L::div(one, L::select(apart, sinQuarter<L>(angle), one));
+  V wa = L::select(apart, L::mul(sinQuarter<L>(L::mul(ru, angle)), inv), ru);
+  V wb = L::select(apart, L::mul(sinQuarter<L>(L::mul(u, angle)), inv), u);
+  V mag = L::set1(0.f);
+  for (int c = 0; c < 4; ++c) {
+    out[c] = L::add(L::mul(wa, a[c]), L::mul(wb, b[c]));
+    mag = L::add(mag, L::mul(out[c], out[c]));
+  }
+  V norm = L::div(one, L::sqrt(mag));
+  for (int c = 0; c < 4; ++c) {
+    out[c] = L::mul(out[c], norm);
+  }
+}
+
+// slerp from a to b, taking the shorter way
+template <class L>
+void slerpLanes(const typename L::V *a, const typename L::V *b,
+                typename L::V u, typename L::V *out) {
+  typedef typename L::V V;
+  V d = L::set1(0.f);
+  for (int c = 0; c < 4; ++c) {
+    d = L::add(d, L::mul(a[c], b[c]));
+  }
+  V sign = L::select(L::greater(L::set1(0.f), d), L::set1(-1.f),
+                     L::set1(1.f));
+  V nearB[4];
+  for (int c = 0; c < 4; ++c) {
+    nearB[c] = L::mul(b[c], sign);
+  }
+  slerpLanes<L>(a, nearB, u, acosUnit<L>(L::mul(d, sign)), out);
+}
+
+// interpolates the objects [j, j + L::size) of a block
+template <class L>
+void interpolate(Block &blk, uint32_t j, bool squad) {
+  typedef typename L::V V;
+  V u = L::load(blk.u + j);
+  V h = L::load(blk.h + j);
+  V u2 = L::mul(u, u);
+  V u3 = L::mul(u2, u);
+  // cubic Hermite basis, with the tangents scaled by the duration
+  V h01 = L::sub(L::mul(L::set1(3.f), u2), L::mul(L::set1(2.f), u3));
+  V h00 = L::sub(L::set1(1.f), h01);
+  V h10 = L::mul(L::add(L::sub(u3, L::mul(L::set1(2.f), u2)), u), h);
+  V h11 = L::mul(L::sub(u3, u2), h);
+  for (int c = 0; c < 3; ++c) {
+    V p = L::add(L::mul(h00, L::load(blk.p0[c] + j)),
+                 L::mul(h01, L::load(blk.p1[c] + j)));
+    p = L::add(p, L::add(L::mul(h10, L::load(blk.v0[c] + j)),
+                         L::mul(h11, L::load(blk.v1[c] + j))));
+    L::store(blk.pos[c] + j, p);
+  }
+
+  V q0[4], q1[4], q[4];
+  for (int c = 0; c < 4; ++c) {
+    q0[c] = L::load(blk.q0[c] + j);
+    q1[c] = L::load(blk.q1[c] + j);
+  }
+  slerpLanes<L>(q0, q1, u, L::load(blk.angle + j), q);
+  if (squad) {
+    // squad(u) = slerp(slerp(q0, q1, u), slerp(s0, s1, u), 2u(1 - u))
+    V s0[4], s1[4], s[4], r[4];
+    for (int c = 0; c < 4; ++c) {
+      s0[c] = L::load(blk.s0[c] + j);
+      s1[c] = L::load(blk.s1[c] + j);
+    }
+    slerpLanes<L>(s0, s1, u, s);
+    slerpLanes<L>(q, s, L::mul(L::set1(2.f), L::sub(u, u2)), r);
+    std::copy(r, r + 4, q);
+  }
+  for (int c = 0; c < 4; ++c) {
+    L::store(blk.quat[c] + j, q[c]);
+  }
+}
+
+Vec3d logUnit(const Quatd &q) {
+  Vec3d v(q.x, q.y, q.z);
+  double m = v.mag();
+  return m > 1e-12 ? v * (std::atan2(m, q.w) / m) : Vec3d(0);
+}
+
+Quatd expPure(const Vec3d &v) {
+  double m = v.mag();
+  double s = m > 1e-12 ? std::sin(m) / m : 1.;
+  return Quatd(std::cos(m), v.x * s, v.y * s, v.z * s);
+}
+}  // namespace
+
+Trajectories::Trajectories(uint32_t numObjects) {
+  this->numObjects(numObjects);
+}
+
+void Trajectories::numObjects(uint32_t n) {
+  mKeyStart.assign(n + 1, 0);
+  mTime.clear();
+  for (int c = 0; c < 3; ++c) {
+    mPos[c].clear();
+    mVel[c].clear();
+    mSplineVel[c].clear();
+  }
+  for (int c = 0; c < 4; ++c) {
+    mQuat[c].clear();
+    mCtrl[c].clear();
+  }
+  mAngle.clear();
+}
+
+double Trajectories::startTime(uint32_t object) const {
+  return numKeys(object) ? mTime[mKeyStart[object]] : 0.;
+}
+
+double Trajectories::endTime(uint32_t object) const {
+  return numKeys(object) ? mTime[mKeyStart[object + 1] - 1] : 0.;
+}
+
+void Trajectories::resizeKeys(uint32_t object, uint32_t count) {
+  const uint32_t first = mKeyStart[object];
+  const uint32_t old = numKeys(object);
+  auto resize = [&](auto &v) {
+    if (count > old) {
+      v.insert(v.begin() + first + old, count - old, 0);
+    } else {
+      v.erase(v.begin() + first + count, v.begin() + first + old);
+    }
+  };
+  resize(mTime);
+  for (int c = 0; c < 3; ++c) {
+    resize(mPos[c]);
+    resize(mVel[c]);
+    resize(mSplineVel[c]);
+  }
+  for (int c = 0; c < 4; ++c) {
+    resize(mQuat[c]);
+    resize(mCtrl[c]);
+  }
+  resize(mAngle);
+  for (size_t i = object + 1; i < mKeyStart.size(); ++i) {
+    mKeyStart[i] = mKeyStart[i] + count - old;
+  }
+}
+
+void Trajectories::storeKey(uint32_t k, double time, const Pose &pose,
+                            const Vec3d &velocity, bool first) {
+  mTime[k] = time;
+  for (int c = 0; c < 3; ++c) {
+    mPos[c][k] = float(pose.pos()[c]);
+    mVel[c][k] = float(velocity[c]);
+  }
+  Quatd q(pose.quat());
+  q.normalize();
+  // q and -q are the same rotation; keep the one nearer the previous key
+  // so that interpolation takes the shorter way
+  if (!first) {
+    double d = 0;
+    for (int c = 0; c < 4; ++c) {
+      d += q.components[c] * mQuat[c][k - 1];
+    }
+    if (d < 0) {
+      q = -q;
+    }
+  }
+  for (int c = 0; c < 4; ++c) {
+    mQuat[c][k] = float(q.components[c]);
+  }
+}
+
+void Trajectories::prepare(uint32_t object) {
+  const uint32_t first = mKeyStart[object], end = mKeyStart[object + 1];
+  auto quatAt = [&](uint32_t k) {
+    return Quatd(mQuat[0][k], mQuat[1][k], mQuat[2][k], mQuat[3][k]);
+  };
+  for (uint32_t k = first; k < end; ++k) {
+    const uint32_t prev = k > first ? k - 1 : k;
+    const uint32_t next = k + 1 < end ? k + 1 : k;
+
+    // Catmull-Rom velocities from the neighbours, one-sided at the ends
+    double dt = mTime[next] - mTime[prev];
+    for (int c = 0; c < 3; ++c) {
+      mSplineVel[c][k] =
+          dt > 0 ? float((mPos[c][next] - mPos[c][prev]) / dt) : 0.f;
+    }
+
+    Quatd q = quatAt(k);
+    mAngle[k] = float(std::acos(std::min(1., q.dot(quatAt(next)))));
+
+    // squad control point, q exp(-(log(q^-1 next) + log(q^-1 prev)) / 4)
+    Quatd s = q;
+    if (prev != k && next != k) {
+      Quatd inv = Quatd(q).conj();
+      Vec3d l = logUnit(inv * quatAt(next)) + logUnit(inv * quatAt(prev));
+      s = q * expPure(l * -0.25);
+    }
+    for (int c = 0; c < 4; ++c) {
+      mCtrl[c][k] = float(s.components[c]);
+    }
+  }
+}
+
+bool Trajectories::setKeys(uint32_t object, const double *times,
+                           const Pose *poses, uint32_t count,
+                           const Vec3d *velocities) {
+  for (uint32_t i = 1; i < count; ++i) {
+    if (!(times[i] > times[i - 1])) {
+      return false;
+    }
+  }
+  resizeKeys(object, count);
+  const uint32_t first = mKeyStart[object];
+  for (uint32_t i = 0; i < count; ++i) {
+    storeKey(first + i, times[i], poses[i],
+             velocities ? velocities[i] : Vec3d(0), i == 0);
+  }
+  prepare(object);
+  return true;
+}
+
+bool Trajectories::addKey(uint32_t object, double time, const Pose &pose,
+                          const Vec3d &velocity) {
+  const uint32_t n = numKeys(object);
+  if (n && !(time > endTime(object))) {
+    return false;
+  }
+  resizeKeys(object, n + 1);
+  storeKey(mKeyStart[object] + n, time, pose, velocity, n == 0);
+  prepare(object);
+  return true;
+}
+
+void Trajectories::evaluateRange(uint32_t begin, uint32_t end, double start,
+                                 double step, uint32_t numFrames,
+                                 Vec3f *positions, Quatf *orientations,
+                                 size_t stride) const {
+  typedef simd::Lanes<float> L;
+  const bool squad = mOrientationMode == SQUAD;
+  Block blk;
+  uint32_t segment[blockSize];
+
+  // gathers the segment of an object at time t into slot j; without
+  // search, the segment found for the previous time is moved forward and
+  // only re-gathered if it changes
+  auto gather = [&](uint32_t object, uint32_t j, double t, bool search) {
+    const uint32_t first = mKeyStart[object], last = mKeyStart[object + 1];
+    if (last - first < 2) {
+      // still, so nothing changes after the first time
+      if (!search) {
+        return;
+      }
+      if (first == last) {
+        blk.identity(j);
+        return;
+      }
+    }
+    uint32_t k0 = first, k1 = first;
+    if (last - first > 1) {
+      // the last key at or before t that has one after it
+      uint32_t &k = segment[j];
+      if (search) {
+        k = uint32_t(std::upper_bound(mTime.begin() + first + 1,
+                                      mTime.begin() + last - 1, t) -
+                     mTime.begin()) -
+            1;
+      } else {
+        const uint32_t prev = k;
+        while (k + 2 < last && mTime[k + 1] <= t) {
+          ++k;
+        }
+        if (k == prev) {
+          double u = (t - mTime[k]) / (mTime[k + 1] - mTime[k]);
+          blk.u[j] = float(std::max(0., std::min(1., u)));
+          return;
+        }
+      }
+      k0 = k;
+      k1 = k + 1;
+    }
+    double h = k1 != k0 ? mTime[k1] - mTime[k0] : 1.;
+    double u = (t - mTime[k0]) / h;
+    blk.u[j] = float(std::max(0., std::min(1., u)));
+    blk.h[j] = float(h);
+    const std::vector<float> *vel =
+        mPositionMode == HERMITE ? mVel : mSplineVel;
+    for (int c = 0; c < 3; ++c) {
+      blk.p0[c][j] = mPos[c][k0];
+      blk.p1[c][j] = mPos[c][k1];
+      if (mPositionMode == LINEAR) {
+        blk.v0[c][j] = blk.v1[c][j] = float((mPos[c][k1] - mPos[c][k0]) / h);
+      } else {
+        blk.v0[c][j] = vel[c][k0];
+        blk.v1[c][j] = vel[c][k1];
+      }
+    }
+    for (int c = 0; c < 4; ++c) {
+      blk.q0[c][j] = mQuat[c][k0];
+      blk.q1[c][j] = mQuat[c][k1];
+      blk.s0[c][j] = mCtrl[c][k0];
+      blk.s1[c][j] = mCtrl[c][k1];
+    }
+    blk.angle[j] = mAngle[k0];
+  };
+
+  for (uint32_t first = begin; first < end; first += blockSize) {
+    const uint32_t count = std::min(blockSize, end - first);
+    const uint32_t padded = (count + L::size - 1) / L::size * L::size;
+    for (uint32_t j = count; j < padded; ++j) {
+      blk.identity(j);
+    }
+    for (uint32_t frame = 0; frame < numFrames; ++frame) {
+      const double t = start + frame * step;
+      // times only move forward within a block when step is positive
+      const bool search = frame == 0 || step < 0;
+      for (uint32_t j = 0; j < count; ++j) {
+        gather(first + j, j, t, search);
+      }
+      for (uint32_t j = 0; j < padded; j += L::size) {
+        interpolate<L>(blk, j, squad);
+      }
+      for (uint32_t j = 0; j < count; ++j) {
+        size_t i = (first + j - begin) * stride + frame;
+        if (positions) {
+          positions[i].set(blk.pos[0][j], blk.pos[1][j], blk.pos[2][j]);
+        }
+        if (orientations) {
+          orientations[i].set(blk.quat[0][j], blk.quat[1][j], blk.quat[2][j],
+                              blk.quat[3][j]);
+        }
+      }
+    }
+  }
+}
+
+void Trajectories::sample(double start, double step, uint32_t numFrames,
+                          Vec3f *positions, Quatf *orientations) const {
+  if (!numFrames) {
+    return;
+  }
+  size_t minObjects = std::max(size_t(blockSize),
+                               minSamplesPerThread / numFrames);
+  parallelFor(
+      numObjects(),
+      [&](size_t begin, size_t end) {
+        size_t offset = begin * numFrames;
+        evaluateRange(uint32_t(begin), uint32_t(end), start, step, numFrames,
+                      positions ? positions + offset : nullptr,
+                      orientations ? orientations + offset : nullptr,
+                      numFrames);
+      },
+      0, minObjects);
+}
+
+void Trajectories::evaluate(double time, Vec3f *positions,
+                            Quatf *orientations) const {
+  sample(time, 0, 1, positions, orientations);
+}
+
+void Trajectories::evaluate(double time, Pose *poses) const {
+  Vec3f pos[blockSize];
+  Quatf quat[blockSize];
+  const uint32_t n = numObjects();
+  for (uint32_t first = 0; first < n; first += blockSize) {
+    const uint32_t end = std::min(n, first + blockSize);
+    evaluateRange(first, end, time, 0, 1, pos, quat, 1);
+    for (uint32_t i = first; i < end; ++i) {
+      poses[i].pos(pos[i - first]);
+      poses[i].quat(quat[i - first]);
+    }
+  }
+}
+
+}  // namespace al
@@ -1,5 +1,29 @@
 #include "al/sphere/al_PerProjection.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+#include "al/io/al_MappedFile.hpp"
+#include "al/system/al_ParallelFor.hpp"
+
+namespace {
+const char kCacheMagic[4] = {'A', 'L', 'W', 'B'};
+const uint32_t kCacheVersion = 2;
+// texels per thread when deriving viewport data
+const size_t kTexelsPerChunk = 1 << 14;
+
+// derived data of one viewport, stored after its file path
+struct CacheEntry {
+  uint64_t file_size;
+  int64_t file_modified;
+  uint64_t file_id;
+  int32_t width, height;
+  float direction[3];
+  float fov;
+};
+} // namespace
+
 al::Mat4f al::get_cube_mat(int face) {
   switch (face) {
   // GL_TEXTURE_CUBE_MAP_POSITIVE_X
@@ -112,25 +136,187 @@ void al::WarpBlendData::load_allosphere_calibration(const char *path,
   // std::cout << "loaded " << viewports.size() << " viewports from " << path
   // << "/" << hostname << ".txt" << std::endl;
 
-  // Load warp data
+  // Load warp data, one viewport per thread
+  std::vector<char> opened(viewports.size(), 0);
+  parallelFor(
+      viewports.size(),
+      [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+          ProjectionViewport &vp = viewports[i];
+          MappedFile file;
+          if (!file.open(vp.filepath)) {
+            continue;
+          }
+          size_t count = size_t(vp.width) * vp.height;
+          vp.warp_and_blend_data.resize(count);
+          auto *data = reinterpret_cast<char *>(vp.warp_and_blend_data.data());
+          std::memcpy(data, file.data(),
+                      std::min(sizeof(Vec4f) * count, file.size()));
+          vp.file_size = file.size();
+          vp.file_modified = file.modified();
+          vp.file_id = file.fileId();
+          opened[i] = 1;
+        }
+      },
+      0, 1);
+
+  int num_opened = 0;
   for (size_t i = 0; i < viewports.size(); i++) {
-    ProjectionViewport &vp = viewports[i];
+    if (!opened[i]) {
+      std::cout << "could not open file: " << viewports[i].filepath
+                << std::endl;
+    } else {
+      num_opened++;
+    }
+  }
+
+  // Derived data only changes with the warp files, so it is cached
+  std::string cache_file =
+      std::string(path) + "/" + std::string(hostname) + ".cache";
+  if (load_cache(cache_file) < num_opened) {
+    for (size_t i = 0; i < viewports.size(); i++) {
+      if (opened[i] && !viewports[i].derived_from_cache) {
+        compute_derived_data(viewports[i]);
+      }
+    }
+    save_cache(cache_file);
+  }
+}
+
+void al::WarpBlendData::compute_derived_data(ProjectionViewport &vp) {
+  const Vec4f *data = vp.warp_and_blend_data.data();
+  size_t n = std::min(size_t(vp.width) * vp.height,
+                      vp.warp_and_blend_data.size());
+  unsigned chunks = parallelForChunks(n, 0, kTexelsPerChunk);
+  // index of the chunk starting at begin, see parallelFor
+  auto chunk = [&](size_t begin) { return (begin * chunks + n - 1) / n; };
+
+  // Central direction: sum of all warp directions. Partial sums are kept per
+  // chunk so the result doesn't depend on thread timing.
+  std::vector<Vec3d> sums(chunks, Vec3d(0, 0, 0));
+  parallelFor(
+      n,
+      [&](size_t begin, size_t end) {
+        Vec3d sum(0, 0, 0);
+        for (size_t i = begin; i < end; i++) {
+          sum.x += data[i].x;
+          sum.y += data[i].y;
+          sum.z += data[i].z;
+        }
+        sums[chunk(begin)] = sum;
+      },
+      0, kTexelsPerChunk);
+  Vec3d sum(0, 0, 0);
+  for (auto &s : sums) {
+    sum += s;
+  }
+  vp.direction = sum.mag() > 0 ? Vec3f(sum.normalize()) : Vec3f(0, 0, -1);
+  vp.derived_from_cache = false;
+
+  // Field of view: twice the widest angle between the central direction and
+  // the warp direction of a texel that is blended in
+  Vec3f direction = vp.direction;
+  std::vector<float> min_dots(chunks, 1.0f);
+  parallelFor(
+      n,
+      [&](size_t begin, size_t end) {
+        float min_dot = 1;
+        for (size_t i = begin; i < end; i++) {
+          Vec3f d(data[i].x, data[i].y, data[i].z);
+          float len = d.mag();
+          if (data[i].w > 0 && len > 0) {
+            min_dot = std::min(min_dot, d.dot(direction) / len);
+          }
+        }
+        min_dots[chunk(begin)] = min_dot;
+      },
+      0, kTexelsPerChunk);
+  float min_dot = 1;
+  for (float d : min_dots) {
+    min_dot = std::min(min_dot, d);
+  }
+  vp.fov = 2.0f * std::acos(std::max(-1.0f, min_dot));
+}
 
-    std::ifstream file(vp.filepath, std::ios::in | std::ios::binary);
+int al::WarpBlendData::load_cache(const std::string &cache_file) {
+  std::ifstream file(cache_file, std::ios::in | std::ios::binary);
+  char magic[4];
+  uint32_t version = 0, count = 0;
+  file.read(magic, 4);
+  file.read(reinterpret_cast<char *>(&version), sizeof(version));
+  file.read(reinterpret_cast<char *>(&count), sizeof(count));
+  if (!file || std::memcmp(magic, kCacheMagic, 4) != 0 ||
+      version != kCacheVersion) {
+    return 0;
+  }
+
+  std::map<std::string, CacheEntry> entries;
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t length = 0;
+    file.read(reinterpret_cast<char *>(&length), sizeof(length));
+    if (!file || length > 4096) {
+      return 0;
+    }
+    std::string filepath(length, '\0');
+    CacheEntry entry;
+    file.read(&filepath[0], length);
+    file.read(reinterpret_cast<char *>(&entry), sizeof(entry));
     if (!file) {
-      std::cout << "could not open file: " << vp.filepath << std::endl;
+      return 0;
+    }
+    entries[filepath] = entry;
+  }
+
+  int found = 0;
+  for (auto &vp : viewports) {
+    auto it = entries.find(vp.filepath);
+    if (it == entries.end()) {
+      continue;
+    }
+    const CacheEntry &e = it->second;
+    // a changed warp file invalidates its entry
+    if (e.file_size != vp.file_size || e.file_modified != vp.file_modified ||
+        e.file_id != vp.file_id || e.width != vp.width ||
+        e.height != vp.height) {
       continue;
     }
+    vp.direction.set(e.direction[0], e.direction[1], e.direction[2]);
+    vp.fov = e.fov;
+    vp.derived_from_cache = true;
+    found++;
+  }
+  return found;
+}
 
-    vp.warp_and_blend_data.resize(vp.width * vp.height);
-    {
-      auto *data = reinterpret_cast<char *>(vp.warp_and_blend_data.data());
-      file.read(data, sizeof(Vec4f) * vp.width * vp.height);
+bool al::WarpBlendData::save_cache(const std::string &cache_file) const {
+  std::vector<const ProjectionViewport *> loaded;
+  for (auto &vp : viewports) {
+    if (vp.file_size > 0) {
+      loaded.push_back(&vp);
     }
-    file.close();
-    // std::cout << "loaded warp/blend data from " << vp.filepath <<
-    // std::endl;
   }
+
+  std::ofstream file(cache_file, std::ios::out | std::ios::binary);
+  uint32_t count = uint32_t(loaded.size());
+  file.write(kCacheMagic, 4);
+  file.write(reinterpret_cast<const char *>(&kCacheVersion),
+             sizeof(kCacheVersion));
+  file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+  for (auto *vp : loaded) {
+    uint32_t length = uint32_t(vp->filepath.size());
+    CacheEntry entry{vp->file_size,
+                     vp->file_modified,
+                     vp->file_id,
+                     vp->width,
+                     vp->height,
+                     {vp->direction.x, vp->direction.y, vp->direction.z},
+                     vp->fov};
+    file.write(reinterpret_cast<const char *>(&length), sizeof(length));
+    file.write(vp->filepath.data(), length);
+    file.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+  }
+  // a read-only calibration directory just means no cache
+  return bool(file);
 }
 
 void al::WarpBlendData::load_desktop_mode_calibration() {
@@ -210,37 +396,11 @@ void al::PerProjectionRender::init(const al::Lens &lens) {
     info.texture[0]->create2D(res_, res_, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
     info.texture[1]->create2D(res_, res_, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
     // Determine projection dimensions.
-    // First determine the central direction.
-    Vec3f direction(0, 0, 0);
-    for (int i = 0; i < vp.width * vp.height; i++) {
-      direction.x += vp.warp_and_blend_data[i].x;
-      direction.y += vp.warp_and_blend_data[i].y;
-      direction.z += vp.warp_and_blend_data[i].z;
-    }
-    direction = direction.normalize();
-#if 0
-        // use warp and belnd data to calculate min fov for the projection area
-        // Determine the radius.
-        float dot_max = 1;
-        for(int i = 0; i < vp.width * vp.height; i++) {
-            auto d = Vec3f{
-                    vp.warp_and_blend_data[i].x,
-                    vp.warp_and_blend_data[i].y,
-                    vp.warp_and_blend_data[i].z
-        }.normalize();
-            float dot = d.dot(direction);
-            if(dot_max > dot) dot_max = dot;
-        }
-        if(dot_max < 0.1) {
-            // The angle is too wide, throw an error.
-            std::cout << "unable to use per-projection mode, viewport angle too large." << std::endl;
-        }
-        float fov = std::acos(dot_max) * 2.0f;
-        // std::cout << "fov: " <<fov << std::endl;
-#endif
+    // The central direction was derived when loading the calibration.
+    Vec3f direction = vp.direction;
 
     // value 2/3 * PI is the smallest value that is bigger than fov of
-    // any projector in AlloSphere
+    // any projector in AlloSphere (measured per viewport in vp.fov)
     // setting same sampling fov for all projectors has advantage that
     // pixels density in terms of OpenGL space dimension remains constant
     // throughout projectors
@@ -0,0 +1,39 @@
+#include "al/system/al_ParallelFor.hpp"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace al {
+
+unsigned parallelForChunks(size_t count, unsigned numThreads,
+                           size_t minChunk) {
+  if (numThreads == 0) {
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  size_t maxChunks = count / std::max(minChunk, size_t(1));
+  return unsigned(std::max(size_t(1), std::min(size_t(numThreads), maxChunks)));
+}
+
+void parallelFor(size_t count,
+                 const std::function<void(size_t begin, size_t end)> &func,
+                 unsigned numThreads, size_t minChunk) {
+  if (count == 0) return;
+  unsigned chunks = parallelForChunks(count, numThreads, minChunk);
+  if (chunks == 1) {
+    func(0, count);
+    return;
+  }
+
+  // Chunk i covers [count * i / chunks, count * (i + 1) / chunks) so that
+  // callers can recompute the boundaries with parallelForChunks
+  std::vector<std::thread> threads;
+  threads.reserve(chunks - 1);
+  for (unsigned i = 0; i < chunks - 1; ++i) {
+    threads.emplace_back(func, count * i / chunks, count * (i + 1) / chunks);
+  }
+  func(count * (chunks - 1) / chunks, count);
+  for (auto &t : threads) t.join();
+}
+
+}  // namespace al
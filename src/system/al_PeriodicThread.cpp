@@ -5,7 +5,7 @@
 namespace al {
 
 PeriodicThread::PeriodicThread(double periodSec)
-    : mAutocorrect(0.1), mUserData(nullptr) {
+    : mAutocorrect(0.1), mUserFunc(nullptr), mUserData(nullptr), mRun(false) {
   period(periodSec);
 }
 
@@ -19,7 +19,7 @@ PeriodicThread::PeriodicThread(const PeriodicThread& o)
       mAutocorrect(o.mAutocorrect),
       mUserFunc(o.mUserFunc),
       mUserData(nullptr),
-      mRun(o.mRun) {}
+      mRun(o.mRun.load()) {}
 
 void* PeriodicThread::sPeriodicFunc(void* threadData) {
   static_cast<PeriodicThread*>(threadData)->go();
@@ -80,8 +80,10 @@ void swap(PeriodicThread& a, PeriodicThread& b) {
   SWAP_(mTimePrev);
   SWAP_(mWait);
   SWAP_(mUserFunc);
-  SWAP_(mRun);
 #undef SWAP_
+  bool run = a.mRun;
+  a.mRun = b.mRun.load();
+  b.mRun = run;
 }
 
 PeriodicThread& PeriodicThread::operator=(PeriodicThread other) {
@@ -0,0 +1,190 @@
+#include "al/types/al_Array.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace al {
+
+size_t allo_type_size(AlloTy ty) {
+  switch (ty) {
+  case AlloFloat32Ty:
+    return sizeof(float);
+  case AlloFloat64Ty:
+    return sizeof(double);
+  case AlloSInt8Ty:
+  case AlloUInt8Ty:
+    return 1;
+  case AlloSInt16Ty:
+  case AlloUInt16Ty:
+    return 2;
+  case AlloSInt32Ty:
+  case AlloUInt32Ty:
+    return 4;
+  case AlloSInt64Ty:
+  case AlloUInt64Ty:
+    return 8;
+  default:
+    return 0;
+  }
+}
+
+Array::Array(const Array &other)
+    : header(other.header), mStorage(other.mStorage) {
+  data.ptr = mStorage.empty() ? nullptr : mStorage.data();
+}
+
+Array &Array::operator=(const Array &other) {
+  if (this != &other) {
+    header = other.header;
+    mStorage = other.mStorage;
+    data.ptr = mStorage.empty() ? nullptr : mStorage.data();
+  }
+  return *this;
+}
+
+void Array::format(const AlloArrayHeader &h) {
+  header = h;
+  size_t bytes = 0;
+  if (h.dimcount > 0 && h.dimcount <= ALLO_ARRAY_MAX_DIMS) {
+    bytes = h.stride[h.dimcount - 1] * h.dim[h.dimcount - 1];
+  } else {
+    header.dimcount = 0;
+  }
+  mStorage.assign(bytes, 0);
+  data.ptr = mStorage.empty() ? nullptr : mStorage.data();
+}
+
+void Array::formatAligned(int components, AlloTy ty, uint32_t dimx,
+                          uint32_t dimy, uint32_t dimz, size_t align) {
+  AlloArrayHeader h;
+  h.type = ty;
+  h.components = uint8_t(components);
+  uint32_t dims[3] = {dimx, dimy, dimz};
+  while (h.dimcount < 3 && dims[h.dimcount] > 0) {
+    h.dim[h.dimcount] = dims[h.dimcount];
+    h.dimcount++;
+  }
+  size_t stride = allo_type_size(ty) * components;
+  for (int i = 0; i < h.dimcount; i++) {
+    h.stride[i] = stride;
+    stride *= h.dim[i];
+    // only rows are padded
+    if (i == 0 && align > 1) {
+      stride = (stride + align - 1) / align * align;
+    }
+  }
+  format(h);
+}
+
+size_t Array::cells() const {
+  if (header.dimcount == 0) return 0;
+  size_t n = 1;
+  for (int i = 0; i < header.dimcount; i++) n *= header.dim[i];
+  return n;
+}
+
+double Array::get(const char *p, int c) const {
+  switch (header.type) {
+  case AlloFloat32Ty:
+    return reinterpret_cast<const float *>(p)[c];
+  case AlloFloat64Ty:
+    return reinterpret_cast<const double *>(p)[c];
+  case AlloSInt8Ty:
+    return reinterpret_cast<const int8_t *>(p)[c];
+  case AlloSInt16Ty:
+    return reinterpret_cast<const int16_t *>(p)[c];
+  case AlloSInt32Ty:
+    return reinterpret_cast<const int32_t *>(p)[c];
+  case AlloSInt64Ty:
+    return double(reinterpret_cast<const int64_t *>(p)[c]);
+  case AlloUInt8Ty:
+    return reinterpret_cast<const uint8_t *>(p)[c];
+  case AlloUInt16Ty:
+    return reinterpret_cast<const uint16_t *>(p)[c];
+  case AlloUInt32Ty:
+    return reinterpret_cast<const uint32_t *>(p)[c];
+  case AlloUInt64Ty:
+    return double(reinterpret_cast<const uint64_t *>(p)[c]);
+  default:
+    return 0;
+  }
+}
+
+void Array::set(char *p, int c, double v) {
+  switch (header.type) {
+  case AlloFloat32Ty:
+    reinterpret_cast<float *>(p)[c] = float(v);
+    break;
+  case AlloFloat64Ty:
+    reinterpret_cast<double *>(p)[c] = v;
+    break;
+  case AlloSInt8Ty:
+    reinterpret_cast<int8_t *>(p)[c] = int8_t(v);
+    break;
+  case AlloSInt16Ty:
+    reinterpret_cast<int16_t *>(p)[c] = int16_t(v);
+    break;
+  case AlloSInt32Ty:
+    reinterpret_cast<int32_t *>(p)[c] = int32_t(v);
+    break;
+  case AlloSInt64Ty:
+    reinterpret_cast<int64_t *>(p)[c] = int64_t(v);
+    break;
+  case AlloUInt8Ty:
+    reinterpret_cast<uint8_t *>(p)[c] = uint8_t(v);
+    break;
+  case AlloUInt16Ty:
+    reinterpret_cast<uint16_t *>(p)[c] = uint16_t(v);
+    break;
+  case AlloUInt32Ty:
+    reinterpret_cast<uint32_t *>(p)[c] = uint32_t(v);
+    break;
+  case AlloUInt64Ty:
+    reinterpret_cast<uint64_t *>(p)[c] = uint64_t(v);
+    break;
+  default:
+    break;
+  }
+}
+
+void Array::readInterp(double *vals, const Vec3f &pos) const {
+  int n = components();
+  std::fill(vals, vals + n, 0.0);
+  if (cells() == 0) return;
+
+  // unused dimensions have a single cell
+  int i0[3], i1[3];
+  float f[3];
+  for (int d = 0; d < 3; d++) {
+    int size = d < header.dimcount ? int(header.dim[d]) : 1;
+    float x = std::min(std::max(pos[d], 0.f), float(size - 1));
+    i0[d] = int(x);
+    i1[d] = std::min(i0[d] + 1, size - 1);
+    f[d] = x - i0[d];
+  }
+  for (int corner = 0; corner < 8; corner++) {
+    float w = 1;
+    int idx[3];
+    for (int d = 0; d < 3; d++) {
+      bool hi = (corner >> d) & 1;
+      idx[d] = hi ? i1[d] : i0[d];
+      w *= hi ? f[d] : 1 - f[d];
+    }
+    if (w == 0) continue;
+    const char *p = cell(idx[0], idx[1], idx[2]);
+    for (int c = 0; c < n; c++) {
+      vals[c] += w * get(p, c);
+    }
+  }
+}
+
+void Array::print(FILE *fp) const {
+  fprintf(fp, "Array %p type %d components %d dims", (void *)data.ptr,
+          int(header.type), int(header.components));
+  for (int i = 0; i < header.dimcount; i++) {
+    fprintf(fp, " %u", header.dim[i]);
+  }
+  fprintf(fp, " (%zu bytes)\n", size());
+}
+
+} // namespace al
@@ -1,10 +1,12 @@
-#include "al/util/al_Voxels.hpp"
-#include "al/core/io/al_File.hpp"
-#include "al/core/system/al_Printing.hpp"
-#include "al/util/al_Image.hpp"
+#include "al/types/al_Voxels.hpp"
+#include "al/graphics/al_Image.hpp"
+#include "al/io/al_File.hpp"
+#include "al/system/al_ParallelFor.hpp"
+#include "al/system/al_Printing.hpp"
 
 #include <algorithm>  // min,max
 #include <cmath>
+#include <cstring>
 //#include <cassert>
 
 namespace al {
@@ -42,7 +44,7 @@ MRCHeader &Voxels::parseMRC(const char *mrcData) {
   printf("NX %d NY %d NZ %d\n", mrcHeader.nx, mrcHeader.ny, mrcHeader.nz);
   printf("mode ");
 
-  AlloTy ty;
+  AlloTy ty = AlloVoidTy;
 
   // set type:
   switch (mrcHeader.mode) {
@@ -255,21 +257,19 @@ void Voxels::print(FILE *fp) {
 }
 
 bool Voxels::getdir(std::string path, std::vector<std::string> &files) {
-  al::Dir dir;
-  if (dir.open(path)) {
-    while (dir.read()) {
-      auto &file = dir.entry();
-      if (file.type() == al::FileInfo::REG) {
-        auto &name = file.name();
-        if (name != "info.txt" && name != ".DS_Store") {
-          std::cout << name << "\n";
-          files.push_back(path + "/" + name);
-        }
-      }
+  if (!File::isDirectory(path)) {
+    return false;
+  }
+  for (auto &item : itemListInDir(path)) {
+    auto &name = item.file();
+    if (!File::isDirectory(item.filepath()) && name != "info.txt" &&
+        name != ".DS_Store") {
+      files.push_back(item.filepath());
     }
-    return true;
   }
-  return false;
+  // read the slices in order of their names
+  std::sort(files.begin(), files.end());
+  return true;
 }
 
 bool Voxels::parseInfo(std::string dir, std::vector<std::string> &data) {
@@ -406,20 +406,12 @@ bool Voxels::loadFromDirectory(std::string dir) {
       return false;
     }
 
-    // Access the read-in image data
-    Array &array(RGBImage.array());
-
-    // For now assume 8-bit RGBA
-    Image::RGBAPix<uint8_t> pixel;
-
     // Copy it out pixel-by-pixel:
-    for (size_t row = 0; row < array.height(); ++row) {
-      for (size_t col = 0; col < array.width(); ++col) {
-        array.read(&pixel, col, row);
-
+    for (int row = 0; row < ny; ++row) {
+      for (int col = 0; col < nx; ++col) {
         // For now we'll take only the red and put it in the single component;
         // that's lame.
-        elem<char>(0, col, row, slice) = (char)pixel.r;
+        elem<uint8_t>(0, col, row, slice) = RGBImage.at(col, row).r;
       }
     }
   }
@@ -484,7 +476,6 @@ bool Voxels::linePlaneIntersection(const Vec3f &P0, const Vec3f &P1,
                                    Vec3f *intersection) {
   Vec3f P10 = P1 - P0;
   Vec3f P20 = planeCenter - P0;
-  Vec3f P02 = P0 - planeCenter;
   float nDot10 = planeNormal.dot(P10);
   float nDot20 = planeNormal.dot(P20);
 
@@ -534,8 +525,6 @@ bool Voxels::parallelLinespace(Vec3f p0, Vec3f p1, Vec3f p2, Vec3f p3,
   if ((p0 - p1).mag() / (p0 - p2).mag() == aDirection / oDirection) {
     n = oDirection;
   }
-  std::cout.flush();
-  std::cout << "t = " << t << "\n";
   if (t == -1.0) {
     list = linspace(p0, p1, n);
     list2 = linspace(p3, p2, n);
@@ -568,8 +557,6 @@ Array Voxels::slice(Vec3f planeCenter, Vec3f planeNormal,
   float yMax = height() * m_voxWidth[1];
   float zMax = depth() * m_voxWidth[2];
 
-  std::cout << "values " << xMax << " " << yMax << " " << zMax << "\n";
-  //
   // calculate intersections
   std::vector<Vec3f> P;
   Vec3f intersection;
@@ -613,11 +600,9 @@ Array Voxels::slice(Vec3f planeCenter, Vec3f planeNormal,
   Array result = Array();  // XXX
 
   if (P.size() > 1) {
-    Vec2f *p2D = new Vec2f[P.size()];
+    std::vector<Vec2f> p2D(P.size());
     p2D[0] = Vec2f(0, 0);
-    float x = sqrt(pow(P[1].x - P[0].x, 2.0) + pow(P[1].y - P[0].y, 2.0) +
-                   pow(P[1].z - P[0].z, 2.0));
-    std::cout << x << "\n";
+    float x = (P[1] - P[0]).mag();
     p2D[1] = Vec2f(x, 0);
     if (P.size() == 2) {
       // super easy, it's just a line :)
@@ -663,10 +648,6 @@ Array Voxels::slice(Vec3f planeCenter, Vec3f planeNormal,
       Vec3f p1 = point2Dto3D(planeCenter, y_axis, z_axis, minA2D, maxO2D);
       Vec3f p2 = point2Dto3D(planeCenter, y_axis, z_axis, maxA2D, maxO2D);
       Vec3f p3 = point2Dto3D(planeCenter, y_axis, z_axis, maxA2D, minO2D);
-      std::cout << "p0 :" << p0.x << " " << p0.y << " " << p0.z << "\n";
-      std::cout << "p1 :" << p1.x << " " << p1.y << " " << p1.z << "\n";
-      std::cout << "p2 :" << p2.x << " " << p2.y << " " << p2.z << "\n";
-      std::cout << "p3 :" << p3.x << " " << p3.y << " " << p3.z << "\n";
       // Check to see if two lines intersect
       std::vector<Vec3f> list;
       std::vector<Vec3f> list2;
@@ -678,7 +659,6 @@ Array Voxels::slice(Vec3f planeCenter, Vec3f planeNormal,
                             maxO2D - minO2D, finalPointList);
         }
       }
-      std::cout << "finalPointList Length:" << finalPointList.size() << "\n";
       // now lets fill the results
       for (unsigned i = 0; i < list.size(); i++) {
         std::vector<Vec3f> space = linspace(
@@ -699,7 +679,6 @@ Array Voxels::slice(Vec3f planeCenter, Vec3f planeNormal,
         }
       }
     }
-    delete[] p2D;
   } else if (P.size() == 1) {
     // Intersects at one point, this is super easy!
     // calculate point and return array with single point
@@ -723,4 +702,196 @@ Array Voxels::slice(Vec3f planeCenter, Vec3f planeNormal,
   return result;
 }
 
+namespace {
+
+typedef void (*SliceRowSampler)(const char *base, const size_t *stride,
+                                const int *maxIndex, const Vec3f &start,
+                                const Vec3f &step, int count, float *out);
+
+// Trilinear resampling of one row of a slice. start is the voxel-space
+// position of the first sample and step the increment between samples.
+// Positions are clamped to the volume so the inner loop has no bounds
+// branches; the caller only passes spans that lie inside the volume.
+template <typename T>
+void sliceRow(const char *base, const size_t *stride, const int *maxIndex,
+              const Vec3f &start, const Vec3f &step, int count, float *out) {
+  const float mx = float(maxIndex[0]);
+  const float my = float(maxIndex[1]);
+  const float mz = float(maxIndex[2]);
+
+  for (int i = 0; i < count; ++i) {
+    float x = std::min(std::max(start.x + step.x * i, 0.f), mx);
+    float y = std::min(std::max(start.y + step.y * i, 0.f), my);
+    float z = std::min(std::max(start.z + step.z * i, 0.f), mz);
+    int x0 = int(x), y0 = int(y), z0 = int(z);
+    float fx = x - x0, fy = y - y0, fz = z - z0;
+
+    size_t ox0 = x0 * stride[0];
+    size_t ox1 = std::min(x0 + 1, maxIndex[0]) * stride[0];
+    size_t oy0 = y0 * stride[1];
+    size_t oy1 = std::min(y0 + 1, maxIndex[1]) * stride[1];
+    const char *p0 = base + z0 * stride[2];
+    const char *p1 = base + std::min(z0 + 1, maxIndex[2]) * stride[2];
+
+    auto lerpX = [&](const char *p) {
+      float a = float(*(const T *)(p + ox0));
+      float b = float(*(const T *)(p + ox1));
+      return a + (b - a) * fx;
+    };
+
+    float c00 = lerpX(p0 + oy0);
+    float c10 = lerpX(p0 + oy1);
+    float c01 = lerpX(p1 + oy0);
+    float c11 = lerpX(p1 + oy1);
+    float c0 = c00 + (c10 - c00) * fy;
+    float c1 = c01 + (c11 - c01) * fy;
+    out[i] = c0 + (c1 - c0) * fz;
+  }
+}
+
+}  // namespace
+
+bool Voxels::sliceInto(const Vec3f &planeCenter, const Vec3f &planeNormal,
+                       float *out, int outWidth, int outHeight,
+                       Vec3f *corners, unsigned numThreads) {
+  if (!out || outWidth <= 0 || outHeight <= 0) return false;
+
+  SliceRowSampler sampler = nullptr;
+  if (type() == Array::type<uint8_t>()) {
+    sampler = sliceRow<uint8_t>;
+  } else if (type() == Array::type<int8_t>()) {
+    sampler = sliceRow<int8_t>;
+  } else if (type() == Array::type<uint16_t>()) {
+    sampler = sliceRow<uint16_t>;
+  } else if (type() == Array::type<int16_t>()) {
+    sampler = sliceRow<int16_t>;
+  } else if (type() == Array::type<float>()) {
+    sampler = sliceRow<float>;
+  } else {
+    AL_WARN("Voxels::sliceInto: unsupported voxel type");
+    return false;
+  }
+
+  float nmag = planeNormal.mag();
+  if (nmag == 0) return false;
+  Vec3f n = planeNormal / nmag;
+
+  Vec3f boxMax(width() * m_voxWidth[0], height() * m_voxWidth[1],
+               depth() * m_voxWidth[2]);
+
+  // Clip the 12 box edges against the plane. Corner i has its x, y, z at the
+  // max side when bit 0, 1, 2 is set; edges join corners one bit apart.
+  Vec3f poly[24];
+  int count = 0;
+  for (int c = 0; c < 8; ++c) {
+    Vec3f ca((c & 1) ? boxMax.x : 0, (c & 2) ? boxMax.y : 0,
+             (c & 4) ? boxMax.z : 0);
+    float da = n.dot(ca - planeCenter);
+    for (int bit = 1; bit < 8; bit <<= 1) {
+      if (c & bit) continue;
+      int d = c | bit;
+      Vec3f cb((d & 1) ? boxMax.x : 0, (d & 2) ? boxMax.y : 0,
+               (d & 4) ? boxMax.z : 0);
+      float db = n.dot(cb - planeCenter);
+      if (da == 0 && db == 0) {
+        poly[count++] = ca;
+        poly[count++] = cb;
+      } else if ((da <= 0 && db >= 0) || (da >= 0 && db <= 0)) {
+        poly[count++] = ca + (cb - ca) * (da / (da - db));
+      }
+    }
+  }
+  if (count < 3) return false;
+
+  // Orthonormal basis on the plane
+  Vec3f u = std::abs(n.x) < 0.9f ? Vec3f(1, 0, 0) : Vec3f(0, 1, 0);
+  u = (u - n * n.dot(u)).normalize();
+  Vec3f v = n.cross(u);
+
+  // Project to plane coordinates and order the convex polygon by angle
+  Vec2f poly2D[24];
+  Vec2f centroid(0, 0);
+  for (int i = 0; i < count; ++i) {
+    Vec3f d = poly[i] - planeCenter;
+    poly2D[i] = Vec2f(u.dot(d), v.dot(d));
+    centroid += poly2D[i];
+  }
+  centroid /= float(count);
+  std::sort(poly2D, poly2D + count, [&](const Vec2f &a, const Vec2f &b) {
+    return std::atan2(a.y - centroid.y, a.x - centroid.x) <
+           std::atan2(b.y - centroid.y, b.x - centroid.x);
+  });
+
+  float minA = poly2D[0].x, maxA = poly2D[0].x;
+  float minO = poly2D[0].y, maxO = poly2D[0].y;
+  for (int i = 1; i < count; ++i) {
+    minA = std::min(minA, poly2D[i].x);
+    maxA = std::max(maxA, poly2D[i].x);
+    minO = std::min(minO, poly2D[i].y);
+    maxO = std::max(maxO, poly2D[i].y);
+  }
+  if (maxA <= minA || maxO <= minO) return false;
+
+  const float stepA = (maxA - minA) / outWidth;
+  const float stepO = (maxO - minO) / outHeight;
+  Vec3f origin = planeCenter + u * minA + v * minO;
+
+  if (corners) {
+    corners[0] = origin;
+    corners[1] = origin + u * (maxA - minA);
+    corners[2] = corners[1] + v * (maxO - minO);
+    corners[3] = origin + v * (maxO - minO);
+  }
+
+  // Walk in voxel index space, where voxel centers sit on integers
+  Vec3f toVoxel(1.f / m_voxWidth[0], 1.f / m_voxWidth[1], 1.f / m_voxWidth[2]);
+  Vec3f originVox = origin * toVoxel;
+  Vec3f colStep = u * stepA * toVoxel;
+  Vec3f rowStep = v * stepO * toVoxel;
+
+  const char *base = data.ptr;
+  const size_t stride[3] = {header.stride[0], header.stride[1],
+                            header.stride[2]};
+  const int maxIndex[3] = {int(width()) - 1, int(height()) - 1,
+                           int(depth()) - 1};
+
+  auto sliceRows = [&](int rowBegin, int rowEnd) {
+    for (int j = rowBegin; j < rowEnd; ++j) {
+      float *row = out + size_t(j) * outWidth;
+      float o = minO + (j + 0.5f) * stepO;
+
+      // Span of the polygon along this row
+      float lo = maxA, hi = minA;
+      for (int k = 0; k < count; ++k) {
+        const Vec2f &p = poly2D[k];
+        const Vec2f &q = poly2D[(k + 1) % count];
+        if ((p.y <= o && q.y > o) || (q.y <= o && p.y > o)) {
+          float a = p.x + (o - p.y) / (q.y - p.y) * (q.x - p.x);
+          lo = std::min(lo, a);
+          hi = std::max(hi, a);
+        }
+      }
+
+      int c0 = std::max(0, int(std::ceil((lo - minA) / stepA - 0.5f)));
+      int c1 = std::min(outWidth,
+                        int(std::floor((hi - minA) / stepA - 0.5f)) + 1);
+      if (c1 <= c0) {
+        std::fill(row, row + outWidth, 0.f);
+        continue;
+      }
+      std::fill(row, row + c0, 0.f);
+      std::fill(row + c1, row + outWidth, 0.f);
+      Vec3f start = originVox + colStep * (c0 + 0.5f) + rowStep * (j + 0.5f);
+      sampler(base, stride, maxIndex, start, colStep, c1 - c0, row + c0);
+    }
+  };
+
+  // a row is hundreds of samples, so a few make a chunk worth a thread
+  parallelFor(
+      outHeight,
+      [&](size_t begin, size_t end) { sliceRows(int(begin), int(end)); },
+      numThreads, 8);
+  return true;
+}
+
 }  // namespace al
@@ -0,0 +1,85 @@
+
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "al/app/al_DomainScheduler.hpp"
+#include "al/app/al_SimulationDomain.hpp"
+
+using namespace al;
+
+TEST_CASE( "DomainScheduler rates" ) {
+    DomainScheduler scheduler;
+    std::vector<std::string> order;
+    std::vector<double> simDt;
+
+    auto sim = scheduler.newScheduledDomain<SimulationDomain>(240);
+    auto net = scheduler.newScheduledDomain<SimulationDomain>(60, 1);
+    auto stats = scheduler.newScheduledDomain<SimulationDomain>(1);
+    REQUIRE(sim);
+    REQUIRE(scheduler.newScheduledDomain<SimulationDomain>(0) == nullptr);
+    REQUIRE_FALSE(scheduler.schedule(sim, 30));
+    sim->simulationFunction = [&](double dt) {
+        order.push_back("sim");
+        simDt.push_back(dt);
+    };
+    net->simulationFunction = [&](double) { order.push_back("net"); };
+    stats->simulationFunction = [&](double) { order.push_back("stats"); };
+    REQUIRE(scheduler.init());
+
+    // One second of frames at 60 Hz
+    for (int frame = 0; frame < 60; frame++) {
+        scheduler.setTimeDelta(1. / 60);
+        REQUIRE(scheduler.tick());
+    }
+    REQUIRE(scheduler.steps(sim) == 240);
+    REQUIRE(scheduler.steps(net) == 60);
+    REQUIRE(scheduler.steps(stats) == 1);
+    REQUIRE(scheduler.droppedSteps(sim) == 0);
+    REQUIRE(simDt.front() == 1. / 240);
+    REQUIRE(simDt.back() == 1. / 240);
+
+    // Steps run in time order, the higher priority first at equal times
+    std::vector<std::string> firstFrame(order.begin(), order.begin() + 5);
+    REQUIRE(firstFrame == std::vector<std::string>(
+                              {"sim", "sim", "sim", "net", "sim"}));
+    REQUIRE(order.back() == "stats");
+
+    // Interpolation between steps
+    scheduler.advance(1. / 480);
+    REQUIRE(scheduler.alpha(sim) == Approx(0.5));
+    REQUIRE(scheduler.alpha(net) == Approx(0.125));
+    REQUIRE(scheduler.steps(sim) == 240);
+    REQUIRE(scheduler.cleanup());
+}
+
+TEST_CASE( "DomainScheduler catch-up" ) {
+    DomainScheduler scheduler;
+    scheduler.maxCatchUp(4);
+    int simSteps = 0, slowSteps = 0;
+    auto sim = scheduler.newScheduledDomain<SimulationDomain>(100);
+    auto slow = scheduler.newScheduledDomain<SimulationDomain>(2);
+    sim->simulationFunction = [&](double) { simSteps++; };
+    slow->simulationFunction = [&](double) { slowSteps++; };
+    REQUIRE(scheduler.init());
+
+    // A stall of a second runs a few steps and drops the rest
+    scheduler.advance(1.0);
+    REQUIRE(simSteps == 4);
+    REQUIRE(slowSteps == 2);
+    REQUIRE(scheduler.droppedSteps(sim) == 96);
+    REQUIRE(scheduler.droppedSteps(slow) == 0);
+    REQUIRE(scheduler.alpha(sim) <= 1);
+
+    // then the rate holds again
+    for (int frame = 0; frame < 10; frame++) scheduler.advance(0.01);
+    REQUIRE(simSteps == 14);
+    REQUIRE(scheduler.droppedSteps(sim) == 96);
+
+    scheduler.unschedule(sim);
+    for (int frame = 0; frame < 10; frame++) scheduler.advance(0.01);
+    REQUIRE(simSteps == 14);
+    REQUIRE(scheduler.steps(sim) == 0);
+    REQUIRE(scheduler.time() == Approx(1.2));
+}
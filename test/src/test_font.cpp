@@ -0,0 +1,273 @@
+
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "al/graphics/al_Font.hpp"
+#include "al/io/al_File.hpp"
+
+using namespace al;
+
+// Texture calls made by Font::load, without a context
+namespace {
+void APIENTRY fakeGenTextures(GLsizei n, GLuint* names) {
+    for (int i = 0; i < n; i++) names[i] = i + 1;
+}
+void APIENTRY fakeDeleteTextures(GLsizei, const GLuint*) {}
+void APIENTRY fakeBindTexture(GLenum, GLuint) {}
+void APIENTRY fakeActiveTexture(GLenum) {}
+void APIENTRY fakeTexImage2D(GLenum, GLint, GLint, GLsizei, GLsizei, GLint,
+                             GLenum, GLenum, const void*) {}
+void APIENTRY fakeTexSubImage2D(GLenum, GLint, GLint, GLint, GLsizei,
+                                GLsizei, GLenum, GLenum, const void*) {}
+void APIENTRY fakeTexParameteri(GLenum, GLenum, GLint) {}
+void APIENTRY fakeTexParameteriv(GLenum, GLenum, const GLint*) {}
+void APIENTRY fakeGenerateMipmap(GLenum) {}
+void APIENTRY fakePixelStorei(GLenum, GLint) {}
+
+struct FakeTextureGL {
+    FakeTextureGL() {
+        glad_glGenTextures = fakeGenTextures;
+        glad_glDeleteTextures = fakeDeleteTextures;
+        glad_glBindTexture = fakeBindTexture;
+        glad_glActiveTexture = fakeActiveTexture;
+        glad_glTexImage2D = fakeTexImage2D;
+        glad_glTexSubImage2D = fakeTexSubImage2D;
+        glad_glTexParameteri = fakeTexParameteri;
+        glad_glTexParameteriv = fakeTexParameteriv;
+        glad_glGenerateMipmap = fakeGenerateMipmap;
+        glad_glPixelStorei = fakePixelStorei;
+    }
+    ~FakeTextureGL() {
+        glad_glGenTextures = nullptr;
+        glad_glDeleteTextures = nullptr;
+        glad_glBindTexture = nullptr;
+        glad_glActiveTexture = nullptr;
+        glad_glTexImage2D = nullptr;
+        glad_glTexSubImage2D = nullptr;
+        glad_glTexParameteri = nullptr;
+        glad_glTexParameteriv = nullptr;
+        glad_glGenerateMipmap = nullptr;
+        glad_glPixelStorei = nullptr;
+    }
+};
+}  // namespace
+
+TEST_CASE( "Font UTF-8 decoding" ) {
+    const char* text = "a\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80";
+    REQUIRE(Font::decodeUTF8(text) == 'a');
+    REQUIRE(Font::decodeUTF8(text) == 0xE9);
+    REQUIRE(Font::decodeUTF8(text) == 0x20AC);
+    REQUIRE(Font::decodeUTF8(text) == 0x1F600);
+    REQUIRE(*text == 0);
+
+    // Malformed input consumes one byte at a time
+    const char* truncated = "\xE2\x82";
+    REQUIRE(Font::decodeUTF8(truncated) == 0xFFFD);
+    REQUIRE(Font::decodeUTF8(truncated) == 0xFFFD);
+    REQUIRE(*truncated == 0);
+    const char* overlong = "\xC0\xAF";
+    REQUIRE(Font::decodeUTF8(overlong) == 0xFFFD);
+    const char* surrogate = "\xED\xA0\x80";
+    REQUIRE(Font::decodeUTF8(surrogate) == 0xFFFD);
+}
+
+TEST_CASE( "Font layout and text batches" ) {
+    std::string path = Font::defaultFont();
+    if (!File::exists(path)) {
+        WARN("Skipping, no font at " << path);
+        return;
+    }
+    FakeTextureGL fake;
+    Font font;
+    REQUIRE(font.load(path.c_str(), 32, 512));
+
+    // Indexed quads: 4 vertices and 6 indices per glyph
+    Mesh mesh;
+    font.write(mesh, "abc", 1.0f);
+    REQUIRE(mesh.vertices().size() == 12);
+    REQUIRE(mesh.texCoord2s().size() == 12);
+    REQUIRE(mesh.indices().size() == 18);
+    REQUIRE(mesh.indices()[17] == 11);
+
+    // Characters without a glyph are drawn as '?'
+    TextLayout q, e;
+    font.layout(q, "?", 1.0f);
+    font.layout(e, "\xC3\xA9", 1.0f);
+    REQUIRE(e.glyphs() == 1);
+    REQUIRE(e.texCoords[0].x == q.texCoords[0].x);
+    REQUIRE(e.width == q.width);
+
+    // Lines stack downwards
+    TextLayout two;
+    font.layout(two, "ab\nab", 2.0f);
+    REQUIRE(two.glyphs() == 4);
+    REQUIRE(two.vertices[8].x == two.vertices[0].x);
+    REQUIRE(two.vertices[8].y == Approx(two.vertices[0].y - 2.0f));
+
+    font.alignCenter();
+    font.write(mesh, "ab", 1.0f);
+    TextLayout ab;
+    font.layout(ab, "ab", 1.0f);
+    REQUIRE(mesh.vertices()[0].x == Approx(ab.vertices[0].x - ab.width / 2));
+
+    TextBatch batch(font);
+    const int numLabels = 2000;
+    for (int i = 0; i < numLabels; i++) {
+        batch.add("label " + std::to_string(i % 10), Vec3f(0, i, 0), 0.1f);
+    }
+    REQUIRE(batch.layouts() == numLabels);
+    REQUIRE(batch.update());
+    auto& vertices = batch.mesh().vertices();
+    REQUIRE(vertices.size() == numLabels * 7 * 4);
+    REQUIRE(batch.mesh().indices().size() == numLabels * 7 * 6);
+
+    // Unchanged labels cost nothing
+    batch.text(5, "label 5");
+    REQUIRE_FALSE(batch.update());
+    REQUIRE(batch.layouts() == numLabels);
+
+    // Same glyph count patches in place
+    Vec3f before = vertices[10 * 28];
+    batch.text(10, "LABEL 0");
+    batch.position(11, Vec3f(3, 11, 0));
+    REQUIRE(batch.update());
+    REQUIRE(batch.layouts() == numLabels + 1);
+    REQUIRE(vertices.size() == numLabels * 7 * 4);
+    REQUIRE(vertices[11 * 28].x > 2.0f);
+    REQUIRE(vertices[10 * 28].y == Approx(before.y).margin(0.1));
+
+    // Different glyph count rebuilds, keeping order
+    batch.text(0, "x");
+    REQUIRE(batch.update());
+    REQUIRE(vertices.size() == (numLabels * 7 - 6) * 4);
+    REQUIRE(batch.mesh().indices().back() == vertices.size() - 1);
+    REQUIRE(vertices.back().y > numLabels - 2);
+}
+
+// Square glyphs filled with their codepoint, no glyphs past 'z'
+static bool squareGlyph(uint32_t c, GlyphAtlas::Bitmap& b) {
+    if (c > 'z') return false;
+    b.width = b.height = 8 + c % 8;
+    b.xAdvance = float(b.width);
+    b.pixels.assign(b.width * b.height, uint8_t(c));
+    return true;
+}
+
+static bool overlaps(const GlyphAtlas::Rect& a, const GlyphAtlas::Rect& b) {
+    return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h &&
+           b.y < a.y + a.h;
+}
+
+TEST_CASE( "Glyph atlas packing and eviction" ) {
+    GlyphAtlas atlas(64, 64);
+    atlas.rasterizer(squareGlyph);
+    REQUIRE(atlas.dirtyRects().size() == 1);
+    atlas.clearDirty();
+
+    // Glyphs are rasterized once and packed without overlap
+    std::vector<GlyphAtlas::Rect> rects;
+    for (uint32_t c = 'A'; c < 'A' + 16; c++) {
+        const GlyphAtlas::Glyph* g = atlas.glyph(c);
+        REQUIRE(g != nullptr);
+        for (auto& r : rects) {
+            REQUIRE_FALSE(overlaps(r, g->rect));
+        }
+        rects.push_back(g->rect);
+        REQUIRE(g->rect.x + g->rect.w <= 64);
+        REQUIRE(g->rect.y + g->rect.h <= 64);
+        REQUIRE(atlas.pixels()[g->rect.y * 64 + g->rect.x] == c);
+        REQUIRE(g->s1 == float(g->rect.x + g->rect.w) / 64);
+    }
+    REQUIRE(atlas.rasterized() == 16);
+    REQUIRE(atlas.dirtyRects().size() == 16);
+    unsigned long generation = atlas.generation();
+    atlas.clearDirty();
+    REQUIRE(atlas.glyph('A') != nullptr);
+    REQUIRE(atlas.rasterized() == 16);
+    REQUIRE(atlas.dirtyRects().empty());
+
+    // Missing glyphs are not rasterized again
+    REQUIRE(atlas.glyph(0x4E2D) == nullptr);
+    REQUIRE(atlas.glyph(0x4E2D) == nullptr);
+    REQUIRE(atlas.evicted() == 0);
+
+    // Filling the atlas evicts the least recently used glyphs
+    for (uint32_t c = 'a'; c <= 'z'; c++) {
+        atlas.glyph('A');
+        REQUIRE(atlas.glyph(c) != nullptr);
+    }
+    REQUIRE(atlas.evicted() > 0);
+    REQUIRE(atlas.generation() > generation);
+    REQUIRE(atlas.size() < 16 + 26);
+    REQUIRE(atlas.dirtyRects()[0].w == 64);
+    // Recently used glyphs survive with their pixels
+    unsigned long rasterized = atlas.rasterized();
+    const GlyphAtlas::Glyph* a = atlas.glyph('A');
+    REQUIRE(atlas.rasterized() == rasterized);
+    REQUIRE(atlas.pixels()[a->rect.y * 64 + a->rect.x] == 'A');
+    REQUIRE(atlas.pixels()[(a->rect.y + a->rect.h - 1) * 64 + a->rect.x +
+                           a->rect.w - 1] == 'A');
+
+    // Glyphs larger than the atlas are rejected, once
+    GlyphAtlas tiny(8, 8);
+    tiny.rasterizer(squareGlyph);
+    REQUIRE(tiny.glyph('A') == nullptr);
+    REQUIRE(tiny.glyph('A') == nullptr);
+    REQUIRE(tiny.rasterized() == 1);
+
+    // and so are glyphs that fit the atlas but not the room compacting
+    // leaves beside recently used ones
+    GlyphAtlas narrow(24, 16);
+    narrow.rasterizer(squareGlyph);
+    REQUIRE(narrow.glyph('A') != nullptr);
+    REQUIRE(narrow.glyph('G') == nullptr);
+    REQUIRE(narrow.glyph('G') == nullptr);
+    REQUIRE(narrow.rasterized() == 2);
+    REQUIRE(narrow.glyph('A') != nullptr);
+}
+
+TEST_CASE( "Font with glyphs rasterized on demand" ) {
+    std::string path = Font::defaultFont();
+    if (!File::exists(path)) {
+        WARN("Skipping, no font at " << path);
+        return;
+    }
+    FakeTextureGL fake;
+    Font font;
+    REQUIRE(font.loadDynamic(path.c_str(), 32, 256));
+    REQUIRE(font.atlas() != nullptr);
+    font.uploadGlyphs();
+    REQUIRE(font.atlas()->dirtyRects().empty());
+
+    // Glyphs outside ASCII have their own shapes
+    TextLayout q, e;
+    font.layout(q, "?", 1.0f);
+    font.layout(e, "\xC3\xA9", 1.0f);
+    REQUIRE(e.glyphs() == 1);
+    REQUIRE(e.texCoords[0].x != q.texCoords[0].x);
+    REQUIRE(font.atlas()->size() == 2);
+    REQUIRE_FALSE(font.atlas()->dirtyRects().empty());
+    font.uploadGlyphs();
+    REQUIRE(font.atlas()->dirtyRects().empty());
+
+    // Labels follow glyphs that move when the atlas fills up
+    TextBatch batch(font);
+    batch.add("abc", Vec3f(0, 0, 0), 0.1f);
+    batch.update();
+    unsigned long layouts = batch.layouts();
+    for (uint32_t c = 0x400; c < 0x4FF; c++) {
+        TextLayout l;
+        std::string s;
+        s += char(0xC0 | (c >> 6));
+        s += char(0x80 | (c & 0x3F));
+        font.layout(l, s.c_str(), 1.0f);
+    }
+    REQUIRE(font.atlas()->evicted() > 0);
+    REQUIRE(batch.update());
+    REQUIRE(batch.layouts() == layouts + 1);
+    TextLayout abc;
+    font.layout(abc, "abc", 0.1f);
+    REQUIRE(batch.mesh().texCoord2s()[0].x == abc.texCoords[0].x);
+}
@@ -0,0 +1,262 @@
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "al/math/al_Random.hpp"
+#include "al/spatial/al_HashSpace.hpp"
+#include "al/spatial/al_SparseHashSpace.hpp"
+
+using namespace al;
+
+static std::vector<uint32_t> queryIds(HashSpace& space, HashSpace::Query& q,
+                                      uint32_t id, double radius) {
+    q.clear();
+    q(space, &space.object(id), radius);
+    std::vector<uint32_t> ids;
+    for (unsigned i = 0; i < q.size(); i++) ids.push_back(q[i]->id);
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+TEST_CASE( "HashSpace bulk rebuild" ) {
+    const uint32_t n = 20000;
+    rnd::Random<> rng(17);
+    std::vector<Vec3f> positions(n);
+    for (auto& p : positions) {
+        // some outside the space to exercise wrapping
+        p = Vec3f(rng.uniform(-8.f, 40.f), rng.uniform(0.f, 32.f),
+                  rng.uniform(0.f, 32.f));
+    }
+
+    HashSpace listed(5, n), sorted(5);
+    for (uint32_t i = 0; i < n; i++) listed.move(i, positions[i]);
+    sorted.rebuild(positions, 2);
+    REQUIRE(sorted.sorted());
+    REQUIRE_FALSE(listed.sorted());
+    REQUIRE(sorted.numObjects() == n);
+    REQUIRE(sorted.cellStart().size() == 32 * 32 * 32 + 1);
+    REQUIRE(sorted.cellStart().back() == n);
+
+    // Sorted by voxel, ids ascending within a voxel
+    const auto& starts = sorted.cellStart();
+    const auto& ids = sorted.sortedIds();
+    bool ordered = true;
+    for (uint32_t h = 0; h < 32 * 32 * 32; h++) {
+        for (uint32_t j = starts[h]; j < starts[h + 1]; j++) {
+            ordered = ordered && sorted.object(ids[j]).hash == h;
+            ordered = ordered && (j == starts[h] || ids[j - 1] < ids[j]);
+        }
+    }
+    REQUIRE(ordered);
+    REQUIRE(sorted.object(123).pos.x == listed.object(123).pos.x);
+
+    // Queries find the same neighbours with either storage
+    HashSpace::Query q(n);
+    for (uint32_t id = 0; id < n; id += 997) {
+        auto a = queryIds(listed, q, id, 3.5);
+        auto b = queryIds(sorted, q, id, 3.5);
+        REQUIRE(a == b);
+    }
+    q.clear();
+    REQUIRE(q(sorted, Vec3d(1, 2, 3), 4) == q(listed, Vec3d(1, 2, 3), 4));
+
+    // Centres outside the space are wrapped, however many periods away
+    std::vector<Vec3f> one{Vec3f(1, 1, 1)};
+    HashSpace small(4), smallListed(4, 1);
+    small.rebuild(one);
+    smallListed.move(0, one[0]);
+    Vec3d centers[2] = {Vec3d(33, 1, 1), Vec3d(1, 49, 1.5)};
+    double expected[2] = {0, 0.25};
+    for (int i = 0; i < 2; i++) {
+        q.clear();
+        REQUIRE(q(small, centers[i], 2) == 1);
+        REQUIRE(q.distanceSquared(0) == Approx(expected[i]));
+        q.clear();
+        REQUIRE(q(smallListed, centers[i], 2) == 1);
+        REQUIRE(q.distanceSquared(0) == Approx(expected[i]));
+    }
+
+    // Moving goes back to the voxel lists, which rebuild kept intact
+    sorted.move(5, Vec3d(16, 16, 16));
+    listed.move(5, Vec3d(16, 16, 16));
+    REQUIRE_FALSE(sorted.sorted());
+    REQUIRE(queryIds(sorted, q, 5, 2.5) == queryIds(listed, q, 5, 2.5));
+
+    // Single threaded rebuild gives the same order
+    HashSpace serial(5);
+    serial.rebuild(positions, 1);
+    REQUIRE(serial.sortedIds() == ids);
+    sorted.rebuild(positions.data(), 100);
+    REQUIRE(sorted.numObjects() == 100);
+    REQUIRE(sorted.cellStart().back() == 100);
+}
+
+TEST_CASE( "HashSpace batched neighbour queries" ) {
+    const uint32_t n = 5000;
+    rnd::Random<> rng(3);
+    std::vector<Vec3f> positions(n);
+    for (auto& p : positions) {
+        p = Vec3f(rng.uniform(0.f, 16.f), rng.uniform(0.f, 16.f),
+                  rng.uniform(0.f, 16.f));
+    }
+    HashSpace space(4);
+    HashSpace::Neighbors neighbors;
+    REQUIRE_FALSE(space.neighborsWithin(neighbors, 2.0));
+    space.rebuild(positions, 3);
+
+    // Brute force squared distances across the torus
+    auto d2 = [&](uint32_t a, uint32_t b) {
+        return space.wrapRelative(space.object(b).pos - space.object(a).pos)
+            .magSqr();
+    };
+
+    const double radius = 2.5;
+    REQUIRE(space.neighborsWithin(neighbors, radius, n, 2));
+    REQUIRE(neighbors.offsets.size() == n + 1);
+    REQUIRE(neighbors.ids.size() == neighbors.offsets[n]);
+    bool exact = true;
+    for (uint32_t i = 0; i < n; i += 7) {
+        std::vector<uint32_t> found(neighbors.begin(i), neighbors.end(i));
+        std::sort(found.begin(), found.end());
+        std::vector<uint32_t> expected;
+        for (uint32_t j = 0; j < n; j++) {
+            if (j != i && d2(i, j) <= radius * radius) expected.push_back(j);
+        }
+        exact = exact && found == expected;
+        for (uint32_t k = neighbors.offsets[i]; k < neighbors.offsets[i + 1];
+             k++) {
+            exact = exact && std::abs(neighbors.distancesSquared[k] -
+                                      d2(i, neighbors.ids[k])) < 1e-3;
+        }
+    }
+    REQUIRE(exact);
+
+    // Results are capped per object
+    REQUIRE(space.neighborsWithin(neighbors, radius, 4));
+    for (uint32_t i = 0; i < n; i++) REQUIRE(neighbors.count(i) <= 4);
+
+    // k nearest, sorted by distance
+    const uint32_t k = 6;
+    REQUIRE(space.nearestNeighbors(neighbors, k, space.maxRadius(), 2));
+    bool nearest = true;
+    for (uint32_t i = 0; i < n; i += 7) {
+        std::vector<double> all;
+        for (uint32_t j = 0; j < n; j++) {
+            if (j != i) all.push_back(d2(i, j));
+        }
+        std::sort(all.begin(), all.end());
+        nearest = nearest && neighbors.count(i) == k;
+        for (uint32_t m = 0; m < neighbors.count(i); m++) {
+            float got = neighbors.distancesSquared[neighbors.offsets[i] + m];
+            nearest = nearest && std::abs(got - all[m]) < 1e-3;
+        }
+    }
+    REQUIRE(nearest);
+
+    // Too small a radius leaves fewer neighbours
+    REQUIRE(space.nearestNeighbors(neighbors, k, 0.1));
+    REQUIRE(neighbors.offsets[n] < n * k);
+}
+
+TEST_CASE( "SparseHashSpace queries" ) {
+    const uint32_t n = 4000;
+    rnd::Random<> rng(5);
+
+    // Unbounded over 10 km, with objects in a few clusters
+    SparseHashSpace open(0.5);
+    open.numObjects(n);
+    for (uint32_t i = 0; i < n; i++) {
+        Vec3d cluster(1000.0 * (i % 10), -5000.0 + 1000.0 * (i % 7), 0);
+        open.move(i, cluster + Vec3d(rng.uniform(-6.f, 6.f),
+                                     rng.uniform(-6.f, 6.f),
+                                     rng.uniform(-6.f, 6.f)));
+    }
+    // Memory follows the objects, not the world
+    REQUIRE(open.numCells() <= n);
+    REQUIRE(open.numCells() > 100);
+
+    // Toroidal along x and z only, with a period that isn't whole cells
+    SparseHashSpace wrapped(0.75, Vec3d(20, 0, 10.1));
+    wrapped.numObjects(n);
+    for (uint32_t i = 0; i < n; i++) {
+        wrapped.move(i, Vec3d(rng.uniform(-20.f, 40.f), rng.uniform(0.f, 8.f),
+                              rng.uniform(0.f, 10.1f)));
+    }
+    REQUIRE(wrapped.object(3).pos.x >= 0);
+    REQUIRE(wrapped.object(3).pos.x < 20);
+    REQUIRE(wrapped.maxRadius() == Approx(5.05));
+
+    SparseHashSpace* spaces[] = {&open, &wrapped};
+    SparseHashSpace::Query q(n);
+    for (SparseHashSpace* space : spaces) {
+        bool same = true;
+        for (uint32_t i = 0; i < n; i += 37) {
+            const SparseHashSpace::Object& o = space->object(i);
+            q.clear();
+            q(*space, &o, 2.0, 0.5);
+            std::vector<uint32_t> found;
+            for (unsigned k = 0; k < q.size(); k++) found.push_back(q[k]->id);
+            std::sort(found.begin(), found.end());
+            std::vector<uint32_t> expected;
+            uint32_t nearestId = n;
+            double nearestD2 = 1e30;
+            for (uint32_t j = 0; j < n; j++) {
+                if (j == i) continue;
+                double d2 = space->wrapRelative(space->object(j).pos - o.pos)
+                                .magSqr();
+                if (d2 >= 0.25 && d2 <= 4.0) expected.push_back(j);
+                if (d2 < nearestD2) {
+                    nearestD2 = d2;
+                    nearestId = j;
+                }
+            }
+            same = same && found == expected;
+            same = same && q.nearest(*space, &o)->id == nearestId;
+        }
+        REQUIRE(same);
+    }
+
+    // The nearest results are kept
+    q.maxResults(3).clear();
+    REQUIRE(q(wrapped, Vec3d(10, 4, 5), 3.0) == 3);
+    SparseHashSpace::Query all(n);
+    all(wrapped, Vec3d(10, 4, 5), 3.0);
+    std::sort(all.begin(), all.end(),
+              [](const SparseHashSpace::Query::Result& a,
+                 const SparseHashSpace::Query::Result& b) {
+                  return a.distanceSquared < b.distanceSquared;
+              });
+    double farthest = 0;
+    for (unsigned k = 0; k < 3; k++) {
+        farthest = std::max(farthest, q.distanceSquared(k));
+    }
+    REQUIRE(farthest == all.distanceSquared(2));
+
+    // Both wrapped ends of a range meeting in one cell visit it once
+    SparseHashSpace ring(1.0, Vec3d(10, 0, 0));
+    ring.numObjects(2002);
+    ring.move(0, Vec3d(5.3, 0.5, 0.5));
+    ring.move(1, Vec3d(0.5, 0.5, 0.5));
+    // enough occupied cells elsewhere that the cells are looked up
+    for (uint32_t i = 2; i < 2002; i++) ring.move(i, Vec3d(0.5, 100 + i, 0.5));
+    SparseHashSpace::Query ringQuery(16);
+    REQUIRE(ringQuery(ring, Vec3d(0.5, 0.5, 0.5), 4.85) == 2);
+
+    // Removing the last object of a cell frees it
+    SparseHashSpace single(1.0);
+    single.numObjects(2);
+    single.move(0, 1e6, 0, 0);
+    single.move(1, 1e6, 0, 0.5);
+    REQUIRE(single.numCells() == 1);
+    single.move(1, -1e6, 0, 0);
+    REQUIRE(single.numCells() == 2);
+    REQUIRE(single.object(0).next == &single.object(0));
+    SparseHashSpace::Query nq;
+    REQUIRE(nq.nearest(single, &single.object(0)) == &single.object(1));
+    single.remove(0);
+    REQUIRE(single.numCells() == 1);
+    REQUIRE(nq.nearest(single, &single.object(1)) == nullptr);
+}
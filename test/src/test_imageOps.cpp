@@ -0,0 +1,160 @@
+
+#include <cstdlib>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "al/graphics/al_ImageOps.hpp"
+
+using namespace al;
+
+static Image randomImage(unsigned w, unsigned h) {
+    Image img;
+    img.mWidth = w;
+    img.mHeight = h;
+    img.mArray.resize(4 * w * h);
+    srand(w * 7919 + h);
+    for (auto& v : img.mArray) v = uint8_t(rand());
+    return img;
+}
+
+TEST_CASE( "Image flips and channel conversions" ) {
+    // Odd sizes leave remainders after the SIMD loops
+    Image ref = randomImage(301, 257);
+    unsigned w = ref.width(), h = ref.height();
+
+    Image img = ref;
+    flipVertical(img);
+    REQUIRE(img.at(5, 0).r == ref.at(5, h - 1).r);
+    REQUIRE(img.at(7, h / 2).a == ref.at(7, h - 1 - h / 2).a);
+    flipVertical(img);
+    REQUIRE(img.mArray == ref.mArray);
+
+    flipHorizontal(img);
+    REQUIRE(img.at(0, 3).g == ref.at(w - 1, 3).g);
+    REQUIRE(img.at(w / 2, 9).b == ref.at(w - 1 - w / 2, 9).b);
+    flipHorizontal(img);
+    REQUIRE(img.mArray == ref.mArray);
+
+    swapRedBlue(img);
+    for (unsigned i = 0; i < w * h; i++) {
+        REQUIRE(img.mArray[4 * i] == ref.mArray[4 * i + 2]);
+        REQUIRE(img.mArray[4 * i + 2] == ref.mArray[4 * i]);
+        REQUIRE(img.mArray[4 * i + 1] == ref.mArray[4 * i + 1]);
+    }
+    swapRedBlue(img);
+    REQUIRE(img.mArray == ref.mArray);
+
+    // Premultiplied color is rounded c * a / 255
+    premultiplyAlpha(img);
+    bool exact = true;
+    for (unsigned i = 0; i < w * h; i++) {
+        unsigned a = ref.mArray[4 * i + 3];
+        for (int c = 0; c < 3; c++) {
+            unsigned expected = (ref.mArray[4 * i + c] * a + 127) / 255;
+            exact = exact && img.mArray[4 * i + c] == expected;
+        }
+        exact = exact && img.mArray[4 * i + 3] == a;
+    }
+    REQUIRE(exact);
+    unpremultiplyAlpha(img);
+    bool close = true;
+    for (unsigned i = 0; i < w * h; i++) {
+        unsigned a = ref.mArray[4 * i + 3];
+        for (int c = 0; c < 3; c++) {
+            int diff = int(img.mArray[4 * i + c]) - ref.mArray[4 * i + c];
+            // precision lost in premultiplying is about 255 / a
+            close = close && (a == 0 || std::abs(diff) <= int(256 / a) + 1);
+        }
+    }
+    REQUIRE(close);
+
+    // RGB round trip in place
+    std::vector<uint8_t> pixels = ref.mArray;
+    rgbaToRGB(pixels);
+    REQUIRE(pixels.size() == 3 * w * h);
+    REQUIRE(pixels[3 * 100 + 2] == ref.mArray[4 * 100 + 2]);
+    rgbToRGBA(pixels, 9);
+    REQUIRE(pixels.size() == 4 * w * h);
+    for (unsigned i = 0; i < w * h; i++) {
+        REQUIRE(pixels[4 * i] == ref.mArray[4 * i]);
+        REQUIRE(pixels[4 * i + 2] == ref.mArray[4 * i + 2]);
+        REQUIRE(pixels[4 * i + 3] == 9);
+    }
+
+    // Out of place matches in place
+    std::vector<uint8_t> rgb(3 * w * h);
+    rgbaToRGB(ref.mArray.data(), rgb.data(), w * h);
+    img = ref;
+    rgbaToRGB(img.mArray);
+    REQUIRE(rgb == img.mArray);
+}
+
+TEST_CASE( "Image downsampling and mipmaps" ) {
+    Image ref = randomImage(37, 22);
+    std::vector<uint8_t> half(4 * 18 * 11);
+    downsample2x(ref.mArray.data(), 37, 22, half.data());
+    // Scalar 2x2 average, the last column also taking the 37th
+    for (unsigned y = 0; y < 11; y++) {
+        for (unsigned x = 0; x < 18; x++) {
+            unsigned cols = x == 17 ? 3 : 2;
+            for (unsigned c = 0; c < 4; c++) {
+                unsigned sum = 0;
+                for (unsigned j = 0; j < 2; j++) {
+                    for (unsigned i = 0; i < cols; i++) {
+                        sum += ref.mArray[4 * ((2 * y + j) * 37 + 2 * x + i) + c];
+                    }
+                }
+                unsigned n = 2 * cols;
+                REQUIRE(half[4 * (y * 18 + x) + c] == (sum + n / 2) / n);
+            }
+        }
+    }
+
+    // Same result for other channel counts
+    std::vector<uint8_t> rgb = ref.mArray, rgbHalf(3 * 18 * 11);
+    rgbaToRGB(rgb);
+    downsample2x(rgb.data(), 37, 22, rgbHalf.data(), 3);
+    rgbaToRGB(half);
+    REQUIRE(rgbHalf == half);
+
+    std::vector<Image> levels;
+    generateMipmaps(ref, levels);
+    REQUIRE(levels.size() == 5);
+    REQUIRE(levels[0].width() == 18);
+    REQUIRE(levels[0].height() == 11);
+    REQUIRE(levels[1].height() == 5);
+    REQUIRE(levels[4].width() == 1);
+    REQUIRE(levels[4].height() == 1);
+    REQUIRE(levels[4].mArray.size() == 4);
+
+    // A flat image stays flat with either filter
+    Image flat = randomImage(64, 48);
+    for (unsigned i = 0; i < flat.mArray.size(); i++) {
+        flat.mArray[i] = uint8_t(i % 4 * 60 + 10);
+    }
+    generateMipmaps(flat, levels, ImageFilter::LANCZOS);
+    REQUIRE(levels.size() == 6);
+    for (auto& level : levels) {
+        REQUIRE(level.mArray.size() == 4 * level.width() * level.height());
+        for (unsigned i = 0; i < level.mArray.size(); i++) {
+            REQUIRE(level.mArray[i] == flat.mArray[i % 4]);
+        }
+    }
+
+    // Lanczos at the same size reproduces the image
+    Image same;
+    resampleLanczos(ref, same, 37, 22);
+    REQUIRE(same.mArray == ref.mArray);
+
+    // Shrinking a linear ramp keeps it close to linear
+    Image ramp = randomImage(200, 1);
+    for (unsigned x = 0; x < 200; x++) {
+        for (unsigned c = 0; c < 4; c++) ramp.mArray[4 * x + c] = uint8_t(x);
+    }
+    Image small;
+    resampleLanczos(ramp, small, 50, 1);
+    for (unsigned x = 5; x < 45; x++) {
+        REQUIRE(std::abs(int(small.mArray[4 * x]) - int(4 * x + 1.5f)) <= 1);
+    }
+}
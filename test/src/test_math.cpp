@@ -11,6 +11,9 @@
 #include "al/math/al_Frustum.hpp"
 #include "al/math/al_Complex.hpp"
 #include "al/math/al_Interval.hpp"
+#include "al/math/al_Matrix4.hpp"
+#include "al/math/al_Random.hpp"
+#include "al/spatial/al_SphereTree.hpp"
 
 using namespace al;
 
@@ -888,4 +891,47 @@ TEST_CASE("Math"){
 	}
 }
 
-
+TEST_CASE("Frustum from matrix and sphere tree"){
+	// Camera at (0,0,5) looking down -z
+	Matrix4d proj = Matrix4d::perspective(60, 1.5, 0.1, 100);
+	Matrix4d view = Matrix4d::lookAt(Vec3d(0,0,5), Vec3d(0,0,0), Vec3d(0,1,0));
+	Frustumd f;
+	f.fromMatrix(proj * view);
+
+	REQUIRE(f.testPoint(Vec3d(0,0,0)) == Frustumd::INSIDE);
+	REQUIRE(f.testPoint(Vec3d(0,0,6)) == Frustumd::OUTSIDE);
+	REQUIRE(f.testPoint(Vec3d(0,0,-96)) == Frustumd::OUTSIDE);
+	REQUIRE(f.testPoint(Vec3d(20,0,0)) == Frustumd::OUTSIDE);
+	REQUIRE(f.testSphere(Vec3d(0,0,5.5), 1) == Frustumd::INTERSECT);
+	REQUIRE(eqVal(f.ntl.z, 4.9, 1e-6));
+	REQUIRE(eqVal(f.fbr.z, -95., 1e-6));
+
+	rnd::Random<> rng(7);
+	std::vector<Vec3f> centers;
+	std::vector<float> radii;
+	for(int i=0; i<2000; ++i){
+		centers.push_back(Vec3f(rng.uniformS()*150, rng.uniformS()*150, rng.uniformS()*150));
+		radii.push_back(rng.uniform()*3);
+	}
+	SphereTree tree;
+	tree.build(centers, radii);
+	REQUIRE(tree.size() == centers.size());
+
+	std::vector<unsigned> visible;
+	tree.query(f, visible);
+	std::sort(visible.begin(), visible.end());
+	std::vector<unsigned> expected;
+	for(unsigned i=0; i<centers.size(); ++i){
+		if(f.testSphere(Vec3d(centers[i]), radii[i]) != Frustumd::OUTSIDE){
+			expected.push_back(i);
+		}
+	}
+	REQUIRE(expected.size() > 0);
+	REQUIRE(expected.size() < centers.size() / 4);
+	REQUIRE(visible == expected);
+
+	tree.clear();
+	visible.clear();
+	tree.query(f, visible);
+	REQUIRE(visible.empty());
+}
@@ -0,0 +1,294 @@
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "al/graphics/al_Mesh.hpp"
+#include "al/graphics/al_MeshFile.hpp"
+#include "al/graphics/al_MeshLOD.hpp"
+#include "al/graphics/al_Shapes.hpp"
+
+using namespace al;
+
+static bool sameNormals(const Mesh& a, const Mesh& b, float eps) {
+    if (a.normals().size() != b.normals().size()) return false;
+    for (size_t i = 0; i < a.normals().size(); ++i) {
+        Vec3f d = a.normals()[i] - b.normals()[i];
+        if (d.mag() > eps) return false;
+    }
+    return true;
+}
+
+TEST_CASE( "Mesh parallel normals match generateNormals" ) {
+    Mesh ref;
+    addSphere(ref, 1, 64, 48);
+    REQUIRE(ref.indices().size() > 0);
+
+    Mesh par(ref);
+
+    ref.generateNormals(true, false);
+    par.generateNormalsParallel(Mesh::AREA_WEIGHTED, true, 4);
+    REQUIRE(sameNormals(ref, par, 0));
+
+    ref.generateNormals(true, true);
+    par.generateNormalsParallel(Mesh::EQUAL_WEIGHTED, true, 3);
+    REQUIRE(sameNormals(ref, par, 0));
+
+    // Angle weighting on a sphere still points outward
+    par.generateNormalsParallel(Mesh::ANGLE_WEIGHTED, true, 2);
+    for (size_t i = 0; i < par.vertices().size(); ++i) {
+        const Vec3f& v = par.vertices()[i];
+        REQUIRE(par.normals()[i].dot(v.normalized()) > 0.99f);
+    }
+}
+
+TEST_CASE( "Mesh parallel normals of non-indexed strips" ) {
+    // Two triangles sharing vertices 1 and 2, with the angles at vertex 1
+    // 45 and 60 degrees
+    Mesh strip(Mesh::TRIANGLE_STRIP);
+    strip.vertex(0, 0, 0);
+    strip.vertex(1, 0, 0);
+    strip.vertex(0, 1, 0);
+    strip.vertex(1, 1, 1);
+
+    Mesh ref(strip);
+    ref.generateNormals(true, true);
+    strip.generateNormalsParallel(Mesh::EQUAL_WEIGHTED, true, 2);
+    REQUIRE(sameNormals(ref, strip, 1e-6f));
+
+    Mesh byAngle(strip);
+    byAngle.generateNormalsParallel(Mesh::ANGLE_WEIGHTED, true, 2);
+    REQUIRE_FALSE(sameNormals(strip, byAngle, 1e-3f));
+
+    Vec3f n0(0, 0, 1);
+    Vec3f n1 = Vec3f(-1, -1, 1).normalized();
+    Vec3f expected = (n0 * float(M_PI / 4) + n1 * float(M_PI / 3)).normalized();
+    REQUIRE((byAngle.normals()[1] - expected).mag() < 1e-5f);
+    // vertices of a single triangle keep its normal
+    REQUIRE((byAngle.normals()[0] - n0).mag() < 1e-6f);
+    REQUIRE((byAngle.normals()[3] - n1).mag() < 1e-6f);
+}
+
+TEST_CASE( "Binary mesh file round trip" ) {
+    Mesh m;
+    addSphere(m, 2, 32, 24);
+    m.generateNormals();
+    for (size_t i = 0; i < m.vertices().size(); ++i) {
+        m.color(i / float(m.vertices().size()), 0.5, 1, 1);
+        m.texCoord(m.vertices()[i].x, m.vertices()[i].y);
+    }
+
+    const char* path = "test_mesh_roundtrip.alm";
+
+    SECTION( "raw" ) {
+        REQUIRE(saveMeshFile(m, path));
+        Mesh in;
+        REQUIRE(loadMeshFile(in, path));
+        REQUIRE(in.primitive() == m.primitive());
+        REQUIRE(in.vertices() == m.vertices());
+        REQUIRE(in.normals() == m.normals());
+        REQUIRE(in.texCoord2s() == m.texCoord2s());
+        REQUIRE(in.indices() == m.indices());
+    }
+
+    SECTION( "quantized and compressed, streamed" ) {
+        MeshFileOptions opts;
+        opts.quantizeVertices = true;
+        opts.quantizeNormals = true;
+        opts.quantizeColors = true;
+        opts.quantizeTexCoords = true;
+        opts.compressIndices = true;
+        REQUIRE(saveMeshFile(m, path, opts));
+
+        Mesh in;
+        MeshFileReader reader;
+        REQUIRE(reader.open(path));
+        int chunks = 0;
+        while (reader.readChunk(in, 257)) ++chunks;
+        REQUIRE(!reader.failed());
+        REQUIRE(chunks > 10);
+
+        REQUIRE(in.indices() == m.indices());
+        REQUIRE(in.vertices().size() == m.vertices().size());
+        for (size_t i = 0; i < m.vertices().size(); ++i) {
+            REQUIRE((in.vertices()[i] - m.vertices()[i]).mag() < 1e-3);
+            REQUIRE((in.normals()[i] - m.normals()[i]).mag() < 1e-3);
+            REQUIRE(std::abs(in.colors()[i].r - m.colors()[i].r) < 0.003);
+        }
+
+        Mesh mapped;
+        REQUIRE(loadMeshFile(mapped, path));
+        REQUIRE(mapped.vertices() == in.vertices());
+        REQUIRE(mapped.indices() == in.indices());
+    }
+
+    SECTION( "corrupt array tables are rejected" ) {
+        MeshFileOptions opts;
+        opts.compressIndices = true;
+        REQUIRE(saveMeshFile(m, path, opts));
+
+        std::vector<char> bytes;
+        FILE* f = fopen(path, "rb");
+        REQUIRE(f);
+        char c[4096];
+        size_t n;
+        while ((n = fread(c, 1, sizeof(c), f)) > 0) {
+            bytes.insert(bytes.end(), c, c + n);
+        }
+        fclose(f);
+
+        MeshFileHeader header;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        size_t indexEntry = 0;
+        for (uint32_t i = 0; i < header.arrayCount; ++i) {
+            size_t at = sizeof(header) + i * sizeof(MeshFileArray);
+            MeshFileArray a;
+            std::memcpy(&a, &bytes[at], sizeof(a));
+            if (a.attribute == MeshFileArray::INDICES) indexEntry = at;
+        }
+        REQUIRE(indexEntry > 0);
+
+        auto patched = [&](void (*patch)(MeshFileArray&)) {
+            std::vector<char> out(bytes);
+            MeshFileArray a;
+            std::memcpy(&a, &out[indexEntry], sizeof(a));
+            patch(a);
+            std::memcpy(&out[indexEntry], &a, sizeof(a));
+            FILE* f = fopen(path, "wb");
+            fwrite(out.data(), 1, out.size(), f);
+            fclose(f);
+        };
+
+        // more deltas than there are bytes to hold them
+        patched([](MeshFileArray& a) { a.count = 0xffffffff; });
+        Mesh in;
+        REQUIRE_FALSE(loadMeshFile(in, path));
+        MeshFileReader reader;
+        REQUIRE_FALSE(reader.open(path));
+
+        // offset + bytes wrapping around past the end of the file
+        patched([](MeshFileArray& a) { a.offset = ~uint64_t(0) - 8; });
+        REQUIRE_FALSE(loadMeshFile(in, path));
+        REQUIRE_FALSE(reader.open(path));
+
+        // primitive that is not a Mesh::Primitive
+        std::vector<char> out(bytes);
+        header.primitive = 0x1234;
+        std::memcpy(out.data(), &header, sizeof(header));
+        f = fopen(path, "wb");
+        fwrite(out.data(), 1, out.size(), f);
+        fclose(f);
+        REQUIRE_FALSE(loadMeshFile(in, path));
+        REQUIRE_FALSE(reader.open(path));
+    }
+
+    std::remove(path);
+}
+
+TEST_CASE( "Mesh cache optimization" ) {
+    Mesh m;
+    addSphere(m, 1, 96, 64);
+    m.toTriangles();
+    m.generateNormals();
+    Mesh orig(m);
+
+    Mesh::CacheStats stats = m.optimizeForCache();
+    REQUIRE(stats.acmrBefore == Approx(orig.vertexCacheMissRatio()));
+    REQUIRE(stats.acmrAfter < stats.acmrBefore);
+    REQUIRE(stats.acmrAfter < 0.8f);
+
+    // Same set of triangles, with attributes following their vertices
+    REQUIRE(m.indices().size() == orig.indices().size());
+    REQUIRE(m.normals().size() == m.vertices().size());
+    std::multiset<std::vector<float>> a, b;
+    auto key = [](const Mesh& mesh, size_t t) {
+        std::vector<float> k;
+        for (int i = 0; i < 3; ++i) {
+            auto idx = mesh.indices()[3 * t + i];
+            for (int c = 0; c < 3; ++c) k.push_back(mesh.vertices()[idx][c]);
+            for (int c = 0; c < 3; ++c) k.push_back(mesh.normals()[idx][c]);
+        }
+        return k;
+    };
+    for (size_t t = 0; t < m.indices().size() / 3; ++t) {
+        a.insert(key(orig, t));
+        b.insert(key(m, t));
+    }
+    REQUIRE(a == b);
+
+    Mesh sorted(orig);
+    Mesh::CacheStats sortedStats = sorted.optimizeForCache(true);
+    REQUIRE(sortedStats.acmrAfter < sortedStats.acmrBefore);
+    REQUIRE(sorted.indices().size() == orig.indices().size());
+
+    // An attribute that cannot follow its vertices leaves the mesh alone
+    Mesh partial(orig);
+    partial.color(1, 0, 0);
+    Mesh::CacheStats partialStats = partial.optimizeForCache();
+    REQUIRE(partialStats.acmrAfter == partialStats.acmrBefore);
+    REQUIRE(partial.indices() == orig.indices());
+    REQUIRE(partial.vertices() == orig.vertices());
+    REQUIRE(partial.normals() == orig.normals());
+}
+
+TEST_CASE( "Mesh simplification and LOD selection" ) {
+    Mesh m;
+    addSphere(m, 1, 64, 48);
+    m.toTriangles();
+    m.generateNormals();
+    const size_t Nt = m.indices().size() / 3;
+
+    Mesh s(m);
+    float err = simplifyMesh(s, Nt / 4);
+    REQUIRE(s.indices().size() / 3 <= Nt / 4);
+    REQUIRE(s.indices().size() / 3 > Nt / 8);
+    REQUIRE(s.vertices().size() < m.vertices().size());
+    REQUIRE(s.normals().size() == s.vertices().size());
+    REQUIRE(err > 0);
+    REQUIRE(err < 0.1);
+
+    // Remaining vertices are original vertices with their own attributes
+    std::set<std::vector<float>> orig;
+    for (size_t i = 0; i < m.vertices().size(); ++i) {
+        auto &v = m.vertices()[i];
+        auto &n = m.normals()[i];
+        orig.insert({v.x, v.y, v.z, n.x, n.y, n.z});
+    }
+    for (size_t i = 0; i < s.vertices().size(); ++i) {
+        auto &v = s.vertices()[i];
+        auto &n = s.normals()[i];
+        REQUIRE(orig.count({v.x, v.y, v.z, n.x, n.y, n.z}) == 1);
+        REQUIRE(std::abs(v.mag() - 1) < 1e-4);
+    }
+    for (auto i : s.indices()) REQUIRE(i < s.vertices().size());
+
+    std::vector<const Mesh*> sources{&m, &m};
+    std::vector<MeshLOD> lods;
+    MeshLOD::generate(lods, sources, {0.5f, 0.25f, 0.125f}, 2);
+    REQUIRE(lods.size() == 2);
+    MeshLOD& lod = lods[0];
+    REQUIRE(lod.levels() == 4);
+    REQUIRE(lod.radius() == Approx(1).epsilon(0.01));
+    for (size_t i = 1; i < lod.levels(); ++i) {
+        REQUIRE(lod.level(i).indices().size() <
+                lod.level(i - 1).indices().size());
+        REQUIRE(lod.error(i) >= lod.error(i - 1));
+        REQUIRE(lod.level(i).indices() == lods[1].level(i).indices());
+    }
+
+    Pose eye;
+    Viewpoint vp(eye);
+    Pose model;
+    size_t prev = 0;
+    for (double d : {2.0, 10.0, 50.0, 400.0, 5000.0}) {
+        model.pos(0, 0, -d);
+        size_t level = lod.select(vp, 1080, model);
+        REQUIRE(level >= prev);
+        prev = level;
+    }
+    REQUIRE(prev == lod.levels() - 1);
+    model.pos(0, 0, -2);
+    REQUIRE(lod.select(vp, 1080, model) == 0);
+}
@@ -0,0 +1,143 @@
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "al/math/al_RandomBatch.hpp"
+
+using namespace al;
+
+TEST_CASE( "Xoshiro128 sequence and jumps" ) {
+    // Reference values of xoshiro128** from state (1, 2, 3, 4)
+    rnd::Xoshiro128 g;
+    g.seed(1, 2, 3, 4);
+    REQUIRE(g() == 0x2d00);
+    REQUIRE(g() == 0);
+    REQUIRE(g() == 0x5a7080);
+    REQUIRE(g() == 0x4389d80);
+
+    g.seed(1, 2, 3, 4);
+    g.jump();
+    REQUIRE(g() == 0x472fa5a7);
+    REQUIRE(g() == 0x2c705cbc);
+
+    g.seed(1, 2, 3, 4);
+    g.longJump();
+    REQUIRE(g() == 0xf74b371c);
+    REQUIRE(g() == 0x398bbf2);
+
+    // Works with the distributions of Random
+    rnd::Random<rnd::Xoshiro128> rng(5);
+    float u = rng.uniform();
+    REQUIRE(u >= 0);
+    REQUIRE(u < 1);
+}
+
+TEST_CASE( "RandomBatch streams" ) {
+    const int lanes = rnd::RandomBatch::lanes;
+    const size_t n = 1103;
+    std::vector<uint32_t> a(n), b(n);
+
+    // Lane i follows a Xoshiro128 jumped i times, whichever SIMD is used
+    rnd::RandomBatch rng(17);
+    rng.bits(a.data(), n);
+    bool same = true;
+    for (int i = 0; i < lanes; i++) {
+        rnd::Xoshiro128 g(17);
+        for (int j = 0; j < i; j++) g.jump();
+        for (size_t k = i; k < n; k += lanes) same = same && a[k] == g();
+    }
+    REQUIRE(same);
+
+    // One sequence, however it is split
+    rng.seed(17);
+    rng.bits(b.data(), 3);
+    rng.bits(b.data() + 3, 100);
+    rng.bits(b.data() + 103, 1000);
+    REQUIRE(a == b);
+
+    // Streams are reproducible and differ from each other
+    rnd::RandomBatch s1(17, 1), s1b(17, 1), s2(17, 2);
+    std::vector<uint32_t> c(n);
+    s1.bits(a.data(), n);
+    s1b.bits(b.data(), n);
+    s2.bits(c.data(), n);
+    REQUIRE(a == b);
+    REQUIRE(a != c);
+
+    // Shuffling gives a permutation
+    std::vector<int> perm(1000);
+    for (int i = 0; i < 1000; i++) perm[i] = i;
+    rng.shuffle(perm.data(), 1000);
+    REQUIRE(perm[0] + perm[1] + perm[2] != 3);
+    std::sort(perm.begin(), perm.end());
+    for (int i = 0; i < 1000; i++) same = same && perm[i] == i;
+    REQUIRE(same);
+}
+
+TEST_CASE( "RandomBatch distributions" ) {
+    const size_t n = 200001;
+    rnd::RandomBatch rng(3);
+    std::vector<float> x(n);
+
+    rng.uniform(x.data(), n, -2.f, 6.f);
+    double sum = 0;
+    bool inRange = true;
+    for (float v : x) {
+        inRange = inRange && v >= -2 && v < 6;
+        sum += v;
+    }
+    REQUIRE(inRange);
+    REQUIRE(std::abs(sum / n - 2) < 0.02);
+
+    // Matches the conversion of Random::uniform
+    rnd::RandomBatch r1(8), r2(8);
+    uint32_t bits[37];
+    float u[37];
+    r1.bits(bits, 37);
+    r2.uniform(u, 37);
+    for (int i = 0; i < 37; i++) {
+        inRange = inRange && u[i] == al::uintToUnit<float>(bits[i]);
+    }
+    REQUIRE(inRange);
+
+    // Moments of the normal distribution, and the share within one and
+    // beyond three deviations, which checks the ziggurat tail
+    rng.normal(x.data(), n, 1.f, 2.f);
+    double m1 = 0, m2 = 0;
+    size_t within = 0, beyond = 0;
+    for (float v : x) {
+        double z = (v - 1.) / 2.;
+        m1 += z;
+        m2 += z * z;
+        within += std::abs(z) < 1;
+        beyond += std::abs(z) > 3;
+    }
+    REQUIRE(std::abs(m1 / n) < 0.01);
+    REQUIRE(std::abs(m2 / n - 1) < 0.02);
+    REQUIRE(std::abs(double(within) / n - 0.6827) < 0.005);
+    REQUIRE(std::abs(double(beyond) / n - 0.0027) < 0.0005);
+
+    // Ball points are inside, with mean square radius 3/5 r^2
+    std::vector<Vec3f> p(n);
+    rng.ball(p.data(), n, 2.f);
+    double r2sum = 0;
+    for (const auto& v : p) {
+        inRange = inRange && v.magSqr() < 4;
+        r2sum += v.magSqr();
+    }
+    REQUIRE(inRange);
+    REQUIRE(std::abs(r2sum / n - 2.4) < 0.02);
+
+    // Sphere points are on the surface, centered
+    rng.sphere(p.data(), n, 3.f);
+    Vec3d mean(0);
+    for (const auto& v : p) {
+        inRange = inRange && std::abs(v.mag() - 3) < 1e-5;
+        mean += v;
+    }
+    REQUIRE(inRange);
+    REQUIRE((mean / n).mag() < 0.03);
+}
@@ -0,0 +1,487 @@
+
+#include <cstring>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "al/graphics/al_DefaultShaders.hpp"
+#include "al/graphics/al_Graphics.hpp"
+#include "al/graphics/al_RenderQueue.hpp"
+#include "al/scene/al_DynamicScene.hpp"
+
+using namespace al;
+
+// Fake GL entry points that count calls instead of needing a context
+namespace {
+int useProgramCalls = 0;
+int getIntegerCalls = 0;
+int matrixUploads = 0;
+int bufferUploads = 0;
+int drawCalls = 0;
+int clearCalls = 0;
+int blockUploads = 0;
+GLuint nextName = 1;
+GLuint boundProgram = 0;
+GLuint blockBuffer = 0;
+GLuint blockBinding = 0;
+lighting_block lastBlock;
+std::vector<float> blockLightZ;
+std::vector<Matrix4f> modelViewUploads;
+Matrix4f lastProjection;
+
+void APIENTRY fakeUseProgram(GLuint p) {
+    useProgramCalls++;
+    boundProgram = p;
+}
+void APIENTRY fakeGetIntegerv(GLenum pname, GLint* v) {
+    getIntegerCalls++;
+    *v = pname == GL_CURRENT_PROGRAM ? GLint(boundProgram) : 0;
+}
+void APIENTRY fakeDeleteProgram(GLuint) {}
+void APIENTRY fakeLinkProgram(GLuint) {}
+GLuint APIENTRY fakeCreateName() { return nextName++; }
+GLuint APIENTRY fakeCreateShader(GLenum) { return nextName++; }
+void APIENTRY fakeShaderSource(GLuint, GLsizei, const GLchar* const*,
+                               const GLint*) {}
+void APIENTRY fakeCompileShader(GLuint) {}
+void APIENTRY fakeDeleteShader(GLuint) {}
+void APIENTRY fakeAttachShader(GLuint, GLuint) {}
+void APIENTRY fakeGetStatus(GLuint, GLenum, GLint* v) { *v = GL_TRUE; }
+void APIENTRY fakeGetInfoLog(GLuint, GLsizei, GLsizei*, GLchar* log) {
+    log[0] = 0;
+}
+GLuint APIENTRY fakeGetUniformBlockIndex(GLuint, const GLchar*) { return 0; }
+void APIENTRY fakeUniformBlockBinding(GLuint, GLuint, GLuint) {}
+void APIENTRY fakeUniform1i(GLint, GLint) {}
+void APIENTRY fakeUniform1f(GLint, GLfloat) {}
+void APIENTRY fakeUniform4fv(GLint, GLsizei, const GLfloat*) {}
+void APIENTRY fakeBindBufferBase(GLenum, GLuint index, GLuint buffer) {
+    blockBinding = index;
+    blockBuffer = buffer;
+}
+void APIENTRY fakeBufferSubData(GLenum, GLintptr, GLsizeiptr size,
+                                const void* data) {
+    blockUploads++;
+    if (size == sizeof(lastBlock)) std::memcpy(&lastBlock, data, size);
+    blockLightZ.push_back(lastBlock.lights[0].eye[2]);
+}
+GLint APIENTRY fakeGetUniformLocation(GLuint, const GLchar* name) {
+    if (std::strcmp(name, "al_ModelViewMatrix") == 0) return 1;
+    if (std::strcmp(name, "al_ProjectionMatrix") == 0) return 2;
+    if (std::strcmp(name, "tex0") == 0) return 3;
+    return -1;
+}
+void APIENTRY fakeUniformMatrix4fv(GLint loc, GLsizei, GLboolean,
+                                   const GLfloat* v) {
+    matrixUploads++;
+    if (loc == 1) modelViewUploads.push_back(Matrix4f(v));
+    if (loc == 2) lastProjection = Matrix4f(v);
+}
+void APIENTRY fakeGenNames(GLsizei n, GLuint* names) {
+    for (int i = 0; i < n; i++) names[i] = nextName++;
+}
+void APIENTRY fakeDeleteNames(GLsizei, const GLuint*) {}
+void APIENTRY fakeBind(GLuint) {}
+void APIENTRY fakeBindBuffer(GLenum, GLuint) {}
+void APIENTRY fakeBufferData(GLenum, GLsizeiptr, const void*, GLenum) {
+    bufferUploads++;
+}
+void APIENTRY fakeVertexAttribPointer(GLuint, GLint, GLenum, GLboolean,
+                                      GLsizei, const void*) {}
+void APIENTRY fakeDrawArrays(GLenum, GLint, GLsizei) { drawCalls++; }
+void APIENTRY fakeDrawElements(GLenum, GLsizei, GLenum, const void*) {
+    drawCalls++;
+}
+void APIENTRY fakeClearBufferfv(GLenum, GLint, const GLfloat*) {
+    clearCalls++;
+}
+
+bool sameMatrix(const Matrix4f& a, const Matrix4f& b) {
+    return std::memcmp(a.elems(), b.elems(), sizeof(float) * 16) == 0;
+}
+
+struct FakeGL {
+    FakeGL() {
+        glad_glUseProgram = fakeUseProgram;
+        glad_glGetIntegerv = fakeGetIntegerv;
+        glad_glDeleteProgram = fakeDeleteProgram;
+        glad_glLinkProgram = fakeLinkProgram;
+        glad_glGetUniformLocation = fakeGetUniformLocation;
+        glad_glUniformMatrix4fv = fakeUniformMatrix4fv;
+        glad_glGenVertexArrays = fakeGenNames;
+        glad_glGenBuffers = fakeGenNames;
+        glad_glDeleteVertexArrays = fakeDeleteNames;
+        glad_glDeleteBuffers = fakeDeleteNames;
+        glad_glBindVertexArray = fakeBind;
+        glad_glEnableVertexAttribArray = fakeBind;
+        glad_glDisableVertexAttribArray = fakeBind;
+        glad_glBindBuffer = fakeBindBuffer;
+        glad_glBufferData = fakeBufferData;
+        glad_glVertexAttribPointer = fakeVertexAttribPointer;
+        glad_glDrawArrays = fakeDrawArrays;
+        glad_glDrawElements = fakeDrawElements;
+        glad_glClearBufferfv = fakeClearBufferfv;
+        glad_glCreateProgram = fakeCreateName;
+        glad_glCreateShader = fakeCreateShader;
+        glad_glShaderSource = fakeShaderSource;
+        glad_glCompileShader = fakeCompileShader;
+        glad_glDeleteShader = fakeDeleteShader;
+        glad_glAttachShader = fakeAttachShader;
+        glad_glDetachShader = fakeAttachShader;
+        glad_glGetShaderiv = fakeGetStatus;
+        glad_glGetProgramiv = fakeGetStatus;
+        glad_glGetShaderInfoLog = fakeGetInfoLog;
+        glad_glGetProgramInfoLog = fakeGetInfoLog;
+        glad_glGetUniformBlockIndex = fakeGetUniformBlockIndex;
+        glad_glUniformBlockBinding = fakeUniformBlockBinding;
+        glad_glUniform1i = fakeUniform1i;
+        glad_glUniform1f = fakeUniform1f;
+        glad_glUniform4fv = fakeUniform4fv;
+        glad_glBindBufferBase = fakeBindBufferBase;
+        glad_glBufferSubData = fakeBufferSubData;
+        useProgramCalls = 0;
+        getIntegerCalls = 0;
+        matrixUploads = 0;
+        bufferUploads = 0;
+        drawCalls = 0;
+        clearCalls = 0;
+        blockUploads = 0;
+        boundProgram = 0;
+        blockLightZ.clear();
+        modelViewUploads.clear();
+    }
+    ~FakeGL() {
+        glad_glUseProgram = nullptr;
+        glad_glGetIntegerv = nullptr;
+        glad_glDeleteProgram = nullptr;
+        glad_glLinkProgram = nullptr;
+        glad_glGetUniformLocation = nullptr;
+        glad_glUniformMatrix4fv = nullptr;
+        glad_glGenVertexArrays = nullptr;
+        glad_glGenBuffers = nullptr;
+        glad_glDeleteVertexArrays = nullptr;
+        glad_glDeleteBuffers = nullptr;
+        glad_glBindVertexArray = nullptr;
+        glad_glEnableVertexAttribArray = nullptr;
+        glad_glDisableVertexAttribArray = nullptr;
+        glad_glBindBuffer = nullptr;
+        glad_glBufferData = nullptr;
+        glad_glVertexAttribPointer = nullptr;
+        glad_glDrawArrays = nullptr;
+        glad_glDrawElements = nullptr;
+        glad_glClearBufferfv = nullptr;
+        glad_glCreateProgram = nullptr;
+        glad_glCreateShader = nullptr;
+        glad_glShaderSource = nullptr;
+        glad_glCompileShader = nullptr;
+        glad_glDeleteShader = nullptr;
+        glad_glAttachShader = nullptr;
+        glad_glDetachShader = nullptr;
+        glad_glGetShaderiv = nullptr;
+        glad_glGetProgramiv = nullptr;
+        glad_glGetShaderInfoLog = nullptr;
+        glad_glGetProgramInfoLog = nullptr;
+        glad_glGetUniformBlockIndex = nullptr;
+        glad_glUniformBlockBinding = nullptr;
+        glad_glUniform1i = nullptr;
+        glad_glUniform1f = nullptr;
+        glad_glUniform4fv = nullptr;
+        glad_glBindBufferBase = nullptr;
+        glad_glBufferSubData = nullptr;
+    }
+};
+}  // namespace
+
+TEST_CASE( "Render state elides redundant program binds and uniforms" ) {
+    FakeGL fake;
+    ShaderProgram a, b;
+    a.id(1);
+    b.id(2);
+    Graphics g;
+
+    g.shader(a);
+    g.update();
+    REQUIRE(useProgramCalls == 1);
+    REQUIRE(matrixUploads == 2);
+    REQUIRE(g.stats().programBinds == 1);
+    REQUIRE(g.stats().uniformUploads == 2);
+
+    // Same program and matrices: nothing reaches GL
+    g.shader(a);
+    g.update();
+    REQUIRE(useProgramCalls == 1);
+    REQUIRE(matrixUploads == 2);
+    REQUIRE(g.stats().programBindsElided == 1);
+    REQUIRE(g.stats().uniformUploadsElided == 2);
+
+    // Only the modelview matrix changed
+    g.translate(1, 0, 0);
+    g.update();
+    REQUIRE(matrixUploads == 3);
+    REQUIRE(g.stats().uniformUploadsElided == 3);
+
+    // Each program remembers what it was sent
+    g.shader(b);
+    g.update();
+    REQUIRE(useProgramCalls == 2);
+    REQUIRE(matrixUploads == 5);
+    g.shader(a);
+    g.update();
+    REQUIRE(useProgramCalls == 3);
+    REQUIRE(matrixUploads == 5);
+
+    // Relinking resets uniforms, so values are sent again
+    a.link(false);
+    g.shader(a);
+    g.update();
+    REQUIRE(useProgramCalls == 3);
+    REQUIRE(matrixUploads == 7);
+
+    // Unbinding through ShaderProgram is noticed
+    a.end();
+    g.shader(a);
+    REQUIRE(useProgramCalls == 5);
+
+    // and so is binding another program, without asking GL
+    b.use();
+    g.shader(a);
+    REQUIRE(useProgramCalls == 7);
+    REQUIRE(getIntegerCalls == 0);
+
+    REQUIRE(g.stats().programBinds + g.stats().programBindsElided == 7);
+    REQUIRE(g.stats().uniformUploads == 7);
+    g.resetStats();
+    REQUIRE(g.stats().uniformUploads == 0);
+}
+
+TEST_CASE( "Lighting block uploads only when lights change" ) {
+    FakeGL fake;
+    Graphics g;
+    g.init();
+    g.lighting(true);
+    g.light(Light().pos(0, 0, 5));
+    g.color(1, 0, 0);
+    g.update();
+    REQUIRE(blockUploads == 1);
+    REQUIRE(g.stats().blockUploads == 1);
+    REQUIRE(blockBinding == GLuint(al_lighting_block_binding()));
+    REQUIRE(blockBuffer != 0);
+    REQUIRE(lastBlock.lights[0].eye[2] == 5);
+    REQUIRE(lastBlock.lights[0].enabled == 1);
+
+    // Neither a new color nor a new model matrix changes the block
+    g.color(0, 1, 0);
+    g.update();
+    g.translate(1, 0, 0);
+    g.update();
+    REQUIRE(blockUploads == 1);
+    REQUIRE(g.stats().blockUploadsElided == 2);
+
+    // Light positions are sent in eye space, so a new view does
+    g.viewMatrix(Matrix4f::translation(Vec3f(0, 0, -2)));
+    g.update();
+    REQUIRE(blockUploads == 2);
+    REQUIRE(lastBlock.lights[0].eye[2] == 3);
+
+    g.disableLight(0);
+    g.update();
+    REQUIRE(blockUploads == 3);
+    REQUIRE(lastBlock.lights[0].enabled == 0);
+
+    Material m;
+    m.shininess(20);
+    g.material(m);
+    g.update();
+    REQUIRE(blockUploads == 4);
+    REQUIRE(lastBlock.material_shininess == 20);
+    REQUIRE(g.stats().blockUploads == 4);
+    REQUIRE(g.stats().blockUploadsElided == 2);
+
+    // Without lighting the block is left alone
+    g.lighting(false);
+    g.light(Light().pos(1, 1, 1));
+    g.update();
+    REQUIRE(blockUploads == 4);
+}
+
+TEST_CASE( "Render queue records once and replays per view" ) {
+    FakeGL fake;
+    ShaderProgram p;
+    p.id(1);
+    Graphics g;
+    RenderQueue q;
+
+    VAOMesh box;
+    box.vertex(0, 0, 0);
+    box.vertex(1, 0, 0);
+    box.vertex(0, 1, 0);
+    box.index(0);
+    box.index(1);
+    box.index(2);
+    box.update();
+    Mesh tri;
+    tri.vertex(0, 0, 0);
+    tri.vertex(1, 0, 0);
+    tri.vertex(0, 1, 0);
+    Matrix4f ortho = Matrix4f::ortho(-1, 1, -1, 1, 0, 1);
+
+    g.shader(p);
+    g.beginRecording(q);
+    REQUIRE(g.recording());
+    g.clear(0);
+    for (int i = 0; i < 10; i++) {
+        g.pushMatrix();
+        g.translate(i, 0, 0);
+        g.draw(tri);
+        g.popMatrix();
+    }
+    g.draw(box);
+    g.pushProjMatrix(ortho);
+    g.draw(tri);
+    g.popProjMatrix();
+    g.endRecording();
+
+    // Nothing reached GL while recording
+    REQUIRE(drawCalls == 0);
+    REQUIRE(clearCalls == 0);
+    REQUIRE(q.size() == 14);
+    REQUIRE(q.commands()[13].ownProj);
+    REQUIRE_FALSE(q.commands()[2].ownProj);
+
+    int uploadsBeforeReplay = bufferUploads;
+    for (int face = 0; face < 6; face++) {
+        Matrix4f proj = Matrix4f::perspective(90, 1, 0.1, 100) *
+                        Matrix4f::rotate(face * M_PI / 3, 0, 1, 0);
+        g.projMatrix(proj);
+        modelViewUploads.clear();
+        q.replay(g);
+        if (face == 0) {
+            REQUIRE(bufferUploads > uploadsBeforeReplay);
+            uploadsBeforeReplay = bufferUploads;
+        }
+        // Meshes are uploaded once per recording
+        REQUIRE(bufferUploads == uploadsBeforeReplay);
+        REQUIRE(sameMatrix(g.projMatrix(), proj));
+
+        // Recorded model matrices, in order. The identity of the first draw
+        // is elided when the previous replay ended with it.
+        int skipped = modelViewUploads[0][12] == 0 ? 0 : 1;
+        REQUIRE(skipped == (face == 0 ? 0 : 1));
+        for (int i = skipped; i < 10; i++) {
+            REQUIRE(modelViewUploads[i - skipped][12] == float(i));
+        }
+        // The last draw keeps the projection it was recorded with
+        REQUIRE(sameMatrix(lastProjection, ortho));
+    }
+    REQUIRE(drawCalls == 6 * 12);
+    REQUIRE(clearCalls == 6 * 2);
+    REQUIRE(q.uploads() == 11);
+
+    // Recording again reuses the copied meshes
+    g.beginRecording(q);
+    g.draw(tri);
+    g.endRecording();
+    REQUIRE(q.size() == 1);
+    q.replay(g);
+    REQUIRE(q.uploads() == 12);
+}
+
+TEST_CASE( "Render queue records the lights of each draw" ) {
+    FakeGL fake;
+    Graphics g;
+    g.init();
+    RenderQueue q;
+    Mesh tri;
+    tri.vertex(0, 0, 0);
+    tri.vertex(1, 0, 0);
+    tri.vertex(0, 1, 0);
+
+    g.lighting(true);
+    g.material(Material());
+    g.beginRecording(q);
+    g.light(Light().pos(0, 0, 5));
+    g.draw(tri);
+    g.draw(tri);
+    g.light(Light().pos(0, 0, 7));
+    g.disableLight(0);
+    g.draw(tri);
+    g.endRecording();
+    REQUIRE(q.commands()[0].state.lights[0].pos()[2] == 5);
+    REQUIRE(q.commands()[2].state.lights[0].pos()[2] == 7);
+    REQUIRE_FALSE(q.commands()[2].state.lightOn[0]);
+
+    // Replays use the recorded lights, not the current ones, and send the
+    // block once per change
+    g.light(Light().pos(0, 0, 100));
+    g.enableLight(0);
+    g.update();
+    blockLightZ.clear();
+    q.replay(g);
+    REQUIRE(blockLightZ == std::vector<float>({5, 7}));
+    REQUIRE(lastBlock.lights[0].enabled == 0);
+
+    // and leave them as they were
+    Graphics::DrawState after = g.drawState();
+    REQUIRE(after.lights[0].pos()[2] == 100);
+    REQUIRE(after.lightOn[0]);
+}
+
+class QueuedVoice : public PositionedVoice {
+public:
+    virtual void onProcess(Graphics& g) override {
+        Mesh m;
+        m.vertex(0, 0, 0);
+        m.vertex(1, 0, 0);
+        m.vertex(0, 1, 0);
+        g.draw(m);
+    }
+};
+
+TEST_CASE( "Render queue culls and sorts scene voices per view" ) {
+    FakeGL fake;
+    ShaderProgram p;
+    p.id(1);
+    Graphics g;
+    g.shader(p);
+    DynamicScene scene(0, TimeMasterMode::TIME_MASTER_GRAPHICS);
+    for (Vec3d pos : {Vec3d(0, 0, -5), Vec3d(5, 0, 0), Vec3d(0, 0, 4),
+                      Vec3d(0, 0, 8)}) {
+        auto* voice = scene.getVoice<QueuedVoice>();
+        voice->setPose(Pose(pos));
+        scene.triggerOn(voice);
+    }
+    scene.cullDrawingByFrustum();
+    scene.sortDrawingByDistance(true, true);
+
+    // Recorded looking down -z, where only the first voice is visible
+    RenderQueue q;
+    g.projMatrix(Matrix4f::perspective(90, 1, 0.1, 100));
+    g.beginRecording(q);
+    scene.render(g);
+    g.endRecording();
+    REQUIRE(scene.culledCount() == 0);
+    REQUIRE(q.size() == 4);
+
+    // Four faces of a cube map around the origin
+    Vec3f targets[4] = {Vec3f(0, 0, -1), Vec3f(1, 0, 0), Vec3f(0, 0, 1),
+                        Vec3f(-1, 0, 0)};
+    int expected[4] = {1, 1, 2, 0};
+    for (int face = 0; face < 4; face++) {
+        g.viewMatrix(Matrix4f::lookAt(Vec3f(0, 0, 0), targets[face],
+                                      Vec3f(0, 1, 0)));
+        drawCalls = 0;
+        modelViewUploads.clear();
+        q.replay(g);
+        REQUIRE(drawCalls == expected[face]);
+        REQUIRE(q.culledCount() == size_t(4 - expected[face]));
+    }
+
+    // Behind the recording view, farthest first
+    g.viewMatrix(Matrix4f::lookAt(Vec3f(0, 0, 0), targets[2],
+                                  Vec3f(0, 1, 0)));
+    modelViewUploads.clear();
+    q.replay(g);
+    REQUIRE(modelViewUploads.size() == 2);
+    REQUIRE(modelViewUploads[0][14] == Approx(-8));
+    REQUIRE(modelViewUploads[1][14] == Approx(-4));
+}
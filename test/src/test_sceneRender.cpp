@@ -0,0 +1,263 @@
+
+#include <algorithm>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "al/scene/al_DynamicScene.hpp"
+#include "al/scene/al_InstanceRenderer.hpp"
+
+using namespace al;
+
+// Records the order in which voices are drawn. No GL calls are made, so
+// DynamicScene::render(Graphics&) can run without a window.
+class DrawOrderVoice : public PositionedVoice {
+public:
+    virtual void onProcess(Graphics& /*g*/) override {
+        drawn->push_back(this);
+    }
+
+    std::vector<DrawOrderVoice*>* drawn;
+};
+
+static DrawOrderVoice* addVoice(DynamicScene& scene,
+                                std::vector<DrawOrderVoice*>& drawn,
+                                Vec3d pos) {
+    auto* voice = scene.getVoice<DrawOrderVoice>();
+    voice->drawn = &drawn;
+    voice->setPose(Pose(pos));
+    scene.triggerOn(voice);
+    return voice;
+}
+
+TEST_CASE( "Dynamic Scene frustum culling" ) {
+    DynamicScene scene(0, TimeMasterMode::TIME_MASTER_GRAPHICS);
+    std::vector<DrawOrderVoice*> drawn;
+    for (int i = 0; i < 100; i++) {
+        // Half in front of the camera, half behind it
+        addVoice(scene, drawn, Vec3d(0, 0, i % 2 ? -5 - i : 5 + i));
+    }
+    Graphics g;
+    g.projMatrix(Matrix4f::perspective(60, 1, 0.1, 1000));
+
+    scene.render(g);
+    REQUIRE(drawn.size() == 100);
+    REQUIRE(scene.drawnCount() == 100);
+    REQUIRE(scene.culledCount() == 0);
+
+    scene.cullDrawingByFrustum();
+    drawn.clear();
+    scene.render(g);
+    REQUIRE(drawn.size() == 50);
+    REQUIRE(scene.drawnCount() == 50);
+    REQUIRE(scene.culledCount() == 50);
+    for (auto* voice : drawn) {
+        REQUIRE(voice->pose().pos().z < 0);
+    }
+
+    // Turning the camera around shows the other half
+    g.viewMatrix(Matrix4f::lookAt(Vec3f(0, 0, 0), Vec3f(0, 0, 1),
+                                  Vec3f(0, 1, 0)));
+    drawn.clear();
+    scene.render(g);
+    REQUIRE(drawn.size() == 50);
+    for (auto* voice : drawn) {
+        REQUIRE(voice->pose().pos().z > 0);
+    }
+}
+
+TEST_CASE( "Dynamic Scene culling follows moved voices" ) {
+    DynamicScene scene(0, TimeMasterMode::TIME_MASTER_GRAPHICS);
+    std::vector<DrawOrderVoice*> drawn;
+    auto* front = addVoice(scene, drawn, Vec3d(0, 0, -5));
+    auto* back = addVoice(scene, drawn, Vec3d(0, 0, 5));
+    scene.cullDrawingByFrustum();
+    Graphics g;
+    g.projMatrix(Matrix4f::perspective(60, 1, 0.1, 1000));
+
+    scene.update(0.01);
+    scene.render(g);
+    REQUIRE(drawn.size() == 1);
+    REQUIRE(drawn[0] == front);
+
+    // Moved with setPose(), not in update(). Other views of the same frame
+    // keep the bounds read by the first one.
+    front->setPose(Pose(Vec3d(0, 0, 5)));
+    back->setPose(Pose(Vec3d(0, 0, -5)));
+    drawn.clear();
+    scene.render(g);
+    REQUIRE(drawn.size() == 1);
+    REQUIRE(drawn[0] == front);
+
+    // Seen from the next frame
+    scene.update(0);
+    drawn.clear();
+    scene.render(g);
+    REQUIRE(drawn.size() == 1);
+    REQUIRE(drawn[0] == back);
+    REQUIRE(scene.culledCount() == 1);
+
+    back->setPose(Pose(Vec3d(0, 0, -50)));
+    scene.update(0);
+    drawn.clear();
+    scene.render(g);
+    REQUIRE(drawn.size() == 1);
+    REQUIRE(drawn[0] == back);
+}
+
+TEST_CASE( "Dynamic Scene depth sorting" ) {
+    DynamicScene scene(0, TimeMasterMode::TIME_MASTER_GRAPHICS);
+    std::vector<DrawOrderVoice*> drawn;
+    for (int i = 0; i < 300; i++) {
+        addVoice(scene, drawn, Vec3d(0, 0, -(i % 37)));
+    }
+    Graphics g;
+
+    scene.render(g);
+    std::vector<DrawOrderVoice*> listOrder = drawn;
+    REQUIRE(listOrder.size() == 300);
+    auto listIndex = [&](DrawOrderVoice* v) {
+        return std::find(listOrder.begin(), listOrder.end(), v) -
+               listOrder.begin();
+    };
+
+    // Farthest first, equal distances keep list order
+    scene.sortDrawingByDistance();
+    drawn.clear();
+    scene.render(g);
+    REQUIRE(drawn.size() == 300);
+    for (size_t i = 1; i < drawn.size(); i++) {
+        double z0 = drawn[i - 1]->pose().pos().z;
+        double z1 = drawn[i]->pose().pos().z;
+        REQUIRE(z0 <= z1);
+        if (z0 == z1) {
+            REQUIRE(listIndex(drawn[i - 1]) < listIndex(drawn[i]));
+        }
+    }
+
+    // Per view sorting measures from the eye of the view matrix
+    scene.sortDrawingByDistance(true, true);
+    g.viewMatrix(Matrix4f::lookAt(Vec3f(0, 0, -100), Vec3f(0, 0, 0),
+                                  Vec3f(0, 1, 0)));
+    drawn.clear();
+    scene.render(g);
+    REQUIRE(drawn.size() == 300);
+    for (size_t i = 1; i < drawn.size(); i++) {
+        REQUIRE(drawn[i - 1]->pose().pos().z >= drawn[i]->pose().pos().z);
+    }
+}
+
+TEST_CASE( "Dynamic Scene depth sorting follows moved voices" ) {
+    DynamicScene scene(0, TimeMasterMode::TIME_MASTER_GRAPHICS);
+    std::vector<DrawOrderVoice*> drawn;
+    auto* near = addVoice(scene, drawn, Vec3d(0, 0, -1));
+    auto* middle = addVoice(scene, drawn, Vec3d(0, 0, -5));
+    auto* far = addVoice(scene, drawn, Vec3d(0, 0, -10));
+    scene.sortDrawingByDistance();
+    Graphics g;
+
+    scene.update(0.01);
+    scene.render(g);
+    REQUIRE(drawn == std::vector<DrawOrderVoice*>({far, middle, near}));
+
+    // Back to front with the nearest voice moved farthest
+    near->setPose(Pose(Vec3d(0, 0, -20)));
+    scene.update(0.01);
+    drawn.clear();
+    scene.render(g);
+    REQUIRE(drawn == std::vector<DrawOrderVoice*>({near, far, middle}));
+
+    // Measured from the eye of the view, behind the moved voice
+    scene.sortDrawingByDistance(true, true);
+    g.viewMatrix(Matrix4f::lookAt(Vec3f(0, 0, -30), Vec3f(0, 0, 0),
+                                  Vec3f(0, 1, 0)));
+    middle->setPose(Pose(Vec3d(0, 0, -55)));
+    scene.update(0.01);
+    drawn.clear();
+    scene.render(g);
+    REQUIRE(drawn == std::vector<DrawOrderVoice*>({middle, far, near}));
+}
+
+class Agent : public PositionedVoice {
+public:
+    virtual void onProcess(Graphics& /*g*/) override { drawCalls++; }
+
+    virtual void onInstance(VoiceInstance& instance) override {
+        instance.color = Color(0.5f, 0.25f, 1.0f);
+    }
+
+    static int drawCalls;
+};
+
+int Agent::drawCalls = 0;
+
+class Obstacle : public PositionedVoice {
+public:
+    virtual void onProcess(Graphics& /*g*/) override { Agent::drawCalls++; }
+};
+
+// Counts draw calls instead of issuing them
+class CountingRenderer : public InstanceRenderer {
+public:
+    virtual void draw(Graphics& /*g*/,
+                      const std::vector<VoiceInstance>& instances) override {
+        drawCalls++;
+        lastInstances = instances;
+    }
+
+    int drawCalls = 0;
+    std::vector<VoiceInstance> lastInstances;
+};
+
+TEST_CASE( "Dynamic Scene instanced batches" ) {
+    DynamicScene scene(0, TimeMasterMode::TIME_MASTER_GRAPHICS);
+    const int numAgents = 2000;
+    for (int i = 0; i < numAgents; i++) {
+        auto* voice = scene.getVoice<Agent>();
+        voice->setPose(Pose(Vec3d(i, 0, -10)));
+        voice->setSize(0.5);
+        scene.triggerOn(voice);
+    }
+    for (int i = 0; i < 5; i++) {
+        scene.triggerOn(scene.getVoice<Obstacle>());
+    }
+    Graphics g;
+
+    // One draw call per voice without batching
+    Agent::drawCalls = 0;
+    scene.render(g);
+    REQUIRE(Agent::drawCalls == numAgents + 5);
+    REQUIRE(scene.batchCount() == 0);
+
+    auto renderer = std::make_shared<CountingRenderer>();
+    scene.setInstanceRenderer<Agent>(renderer);
+    Agent::drawCalls = 0;
+    scene.render(g);
+    REQUIRE(Agent::drawCalls == 5);
+    REQUIRE(renderer->drawCalls == 1);
+    REQUIRE(scene.batchCount() == 1);
+    REQUIRE(scene.drawnCount() == numAgents + 5);
+    REQUIRE(renderer->lastInstances.size() == numAgents);
+    std::vector<float> xs;
+    for (auto& instance : renderer->lastInstances) {
+        REQUIRE(instance.size == 0.5f);
+        REQUIRE(instance.position.z == -10.0f);
+        REQUIRE(instance.color.g == 0.25f);
+        xs.push_back(instance.position.x);
+    }
+    std::sort(xs.begin(), xs.end());
+    for (int i = 0; i < numAgents; i++) {
+        REQUIRE(xs[i] == float(i));
+    }
+
+    // Rendering again reuses the batch
+    scene.render(g);
+    REQUIRE(renderer->drawCalls == 2);
+    REQUIRE(renderer->lastInstances.size() == numAgents);
+
+    scene.setInstanceRenderer<Agent>(nullptr);
+    Agent::drawCalls = 0;
+    scene.render(g);
+    REQUIRE(Agent::drawCalls == numAgents + 5);
+    REQUIRE(renderer->drawCalls == 2);
+}
@@ -0,0 +1,121 @@
+
+#include <chrono>
+#include <thread>
+
+#include "catch.hpp"
+
+#include "al/app/al_SimulationDomain.hpp"
+#include "al/types/al_TripleBuffer.hpp"
+
+using namespace al;
+
+struct CounterState {
+    int counter = 0;
+    int copies[256];
+    CounterState() {
+        for (auto& c : copies) c = 0;
+    }
+};
+
+TEST_CASE( "TripleBuffer" ) {
+    TripleBuffer<int> buffer(7);
+    REQUIRE_FALSE(buffer.update());
+    REQUIRE(buffer.read() == 7);
+
+    buffer.write() = 1;
+    buffer.publish();
+    buffer.write() = 2;
+    buffer.publish();
+    REQUIRE(buffer.hasNew());
+    REQUIRE(buffer.update());
+    REQUIRE(buffer.read() == 2);
+    REQUIRE_FALSE(buffer.update());
+    REQUIRE(buffer.read() == 2);
+}
+
+TEST_CASE( "ThreadedStateSimulationDomain" ) {
+    ThreadedStateSimulationDomain<CounterState> sim;
+    sim.setStep(0.001);
+    double dtSeen = 0;
+    sim.simulationFunction = [&](double dt) {
+        dtSeen = dt;
+        CounterState& s = sim.state();
+        s.counter++;
+        for (auto& c : s.copies) c = s.counter;
+    };
+    // Readers see the initial state before the first step
+    sim.state().counter = 100;
+    for (auto& c : sim.state().copies) c = 100;
+    REQUIRE(sim.init());
+    REQUIRE(sim.start());
+    REQUIRE(sim.running());
+    REQUIRE_FALSE(sim.start());
+
+    // Read as graphics would, never seeing a partly written state
+    bool consistent = true, ordered = true;
+    int last = 0;
+    auto end = std::chrono::steady_clock::now() +
+               std::chrono::milliseconds(200);
+    while (std::chrono::steady_clock::now() < end) {
+        const CounterState& s = sim.latestState();
+        for (int c : s.copies) consistent = consistent && c == s.counter;
+        consistent = consistent && uint64_t(s.counter - 100) ==
+                                   sim.latestStep();
+        ordered = ordered && s.counter >= last;
+        last = s.counter;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    REQUIRE(sim.stop());
+    REQUIRE_FALSE(sim.running());
+    REQUIRE(consistent);
+    REQUIRE(ordered);
+    REQUIRE(dtSeen == 0.001);
+
+    auto stats = sim.stats();
+    REQUIRE(stats.steps > 20);
+    REQUIRE(stats.steps <= 210);
+    REQUIRE(sim.latestState().counter == int(100 + stats.steps));
+    REQUIRE(stats.meanStepTime <= stats.maxStepTime);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    REQUIRE(sim.stats().steps == stats.steps);
+    REQUIRE(sim.cleanup());
+}
+
+TEST_CASE( "ThreadedSimulationDomain overruns" ) {
+    ThreadedSimulationDomain sim;
+    sim.setStep(0.001);
+    sim.simulationFunction = [](double) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(3));
+    };
+    REQUIRE(sim.init());
+    REQUIRE(sim.start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    REQUIRE(sim.stop());
+    auto stats = sim.stats();
+    REQUIRE(stats.steps > 0);
+    REQUIRE(stats.overruns == stats.steps);
+    REQUIRE(stats.lastStepTime >= 0.003);
+}
+
+TEST_CASE( "ThreadedStateSimulationDomain destroyed while running" ) {
+    double dtSeen = 0;
+    {
+        ThreadedStateSimulationDomain<CounterState> sim;
+        sim.setStep(0.001);
+        sim.simulationFunction = [&](double dt) {
+            dtSeen = dt;
+            sim.state().counter++;
+        };
+        REQUIRE(sim.init());
+        REQUIRE(sim.start());
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        // Takes effect on the next start(), the running steps keep theirs
+        sim.setStep(0.5);
+        REQUIRE(sim.step() == 0.5);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        REQUIRE(sim.running());
+        REQUIRE(sim.latestState().counter > 0);
+        // no stop(): the destructor stops the thread before the state goes
+    }
+    REQUIRE(dtSeen == 0.001);
+}
@@ -0,0 +1,415 @@
+
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "al/app/al_StateDistributionDomain.hpp"
+#include "al/protocol/al_StateSync.hpp"
+
+using namespace al;
+
+// Keeps the packets sent instead of sending them
+class CapturingSender : public StateSyncSender {
+public:
+    std::vector<std::string> packets;
+
+    size_t transmit(const osc::Packet& p) override {
+        packets.push_back(std::string(p.data(), p.size()));
+        return p.size();
+    }
+
+    std::vector<std::string> take() {
+        std::vector<std::string> out;
+        out.swap(packets);
+        return out;
+    }
+};
+
+static int deliver(StateSyncReceiver& receiver,
+                   const std::vector<std::string>& packets) {
+    int completed = 0;
+    for (auto& p : packets) {
+        osc::Message m(p.data(), int(p.size()));
+        if (receiver.handle(m)) completed++;
+    }
+    return completed;
+}
+
+static bool sameState(const StateSyncReceiver& receiver,
+                      const std::vector<unsigned char>& state) {
+    return receiver.size() == state.size() &&
+           std::memcmp(receiver.state(), state.data(), state.size()) == 0;
+}
+
+TEST_CASE( "StateSync chunks and deltas" ) {
+    CapturingSender sender;
+    sender.id("state");
+    sender.packetSize(1400);
+    StateSyncReceiver receiver;
+    receiver.id("state");
+    receiver.stateSize(100000);
+
+    std::vector<unsigned char> state(100000);
+    for (size_t i = 0; i < state.size(); i++) state[i] = (i * 7919) >> 5;
+
+    // The first frame is a keyframe split into chunks under the packet size
+    REQUIRE(sender.send(state.data(), state.size()) > state.size());
+    REQUIRE(sender.lastWasKeyframe());
+    auto packets = sender.take();
+    REQUIRE(packets.size() == (state.size() + sender.chunkSize() - 1) /
+                              sender.chunkSize());
+    for (auto& p : packets) REQUIRE(p.size() <= 1400);
+    // chunks may arrive in any order
+    std::vector<std::string> reversed(packets.rbegin(), packets.rend());
+    REQUIRE(deliver(receiver, reversed) == 1);
+    REQUIRE(sameState(receiver, state));
+    REQUIRE(receiver.frame() == 1);
+
+    // Small changes go as a delta in a single packet
+    state[10] ^= 0xff;
+    state[50000] = 3;
+    state[50001] = 4;
+    sender.send(state.data(), state.size());
+    REQUIRE_FALSE(sender.lastWasKeyframe());
+    REQUIRE(sender.stats().lastEncodedSize < 16);
+    packets = sender.take();
+    REQUIRE(packets.size() == 1);
+    REQUIRE(deliver(receiver, packets) == 1);
+    REQUIRE(sameState(receiver, state));
+
+    // An unchanged state still makes a frame
+    sender.send(state.data(), state.size());
+    REQUIRE(deliver(receiver, sender.take()) == 1);
+    REQUIRE(receiver.frame() == 3);
+
+    // Replayed packets are stale
+    REQUIRE(deliver(receiver, packets) == 0);
+    REQUIRE(receiver.stats().stale == 1);
+
+    // A lost frame is counted and the next delta still decodes
+    state[20] = 1;
+    sender.send(state.data(), state.size());
+    sender.take();
+    state[30] = 1;
+    sender.send(state.data(), state.size());
+    REQUIRE(deliver(receiver, sender.take()) == 1);
+    REQUIRE(sameState(receiver, state));
+    REQUIRE(receiver.stats().lost == 1);
+
+    // Changes too large for a delta make a keyframe
+    for (auto& b : state) b++;
+    sender.send(state.data(), state.size());
+    REQUIRE(sender.lastWasKeyframe());
+    REQUIRE(sender.stats().keyframes == 2);
+
+    // Losing a chunk of the keyframe drops it and the deltas against it,
+    // keeping the last state decoded
+    packets = sender.take();
+    packets.erase(packets.begin() + 3);
+    std::vector<unsigned char> lastState(receiver.state(),
+                                         receiver.state() + receiver.size());
+    REQUIRE(deliver(receiver, packets) == 0);
+    state[0] = 0;
+    sender.send(state.data(), state.size());
+    REQUIRE(deliver(receiver, sender.take()) == 0);
+    REQUIRE(receiver.stats().dropped == 2);
+    REQUIRE(sameState(receiver, lastState));
+
+    // until the next keyframe
+    sender.forceKeyframe();
+    sender.send(state.data(), state.size());
+    REQUIRE(deliver(receiver, sender.take()) == 1);
+    REQUIRE(sameState(receiver, state));
+    REQUIRE(receiver.frame() == sender.frame());
+
+    // Keyframes are sent at the interval set
+    sender.keyframeInterval(4);
+    int keyframes = 0;
+    for (int i = 0; i < 8; i++) {
+        state[i] = i;
+        sender.send(state.data(), state.size());
+        keyframes += sender.lastWasKeyframe();
+        REQUIRE(deliver(receiver, sender.take()) == 1);
+    }
+    REQUIRE(keyframes == 2);
+    REQUIRE(sameState(receiver, state));
+
+    // Other ids and sizes are ignored
+    StateSyncReceiver other;
+    other.id("other");
+    sender.forceKeyframe();
+    sender.send(state.data(), state.size());
+    packets = sender.take();
+    REQUIRE(deliver(other, packets) == 0);
+    other.id("state");
+    other.stateSize(10);
+    REQUIRE(deliver(other, packets) == 0);
+    REQUIRE(other.stats().invalid == packets.size());
+    REQUIRE_FALSE(other.hasState());
+}
+
+TEST_CASE( "StateSync sender restart" ) {
+    StateSyncReceiver receiver;
+    receiver.id("state");
+    std::vector<unsigned char> state(5000, 1);
+    {
+        CapturingSender sender;
+        sender.id("state");
+        for (int i = 0; i < 10; i++) {
+            state[i] = 2;
+            sender.send(state.data(), state.size());
+            REQUIRE(deliver(receiver, sender.take()) == 1);
+        }
+        REQUIRE(receiver.frame() == 10);
+    }
+
+    // A new sender with the same id numbers its frames from 1 again
+    CapturingSender restarted;
+    restarted.id("state");
+    state[100] = 3;
+    restarted.send(state.data(), state.size());
+    REQUIRE(restarted.frame() == 1);
+    auto packets = restarted.take();
+    REQUIRE(deliver(receiver, packets) == 1);
+    REQUIRE(receiver.frame() == 1);
+    REQUIRE(sameState(receiver, state));
+    REQUIRE(receiver.stats().restarts == 1);
+    REQUIRE(receiver.stats().stale == 0);
+
+    // and its frames go on being decoded, replays of them still stale
+    state[200] = 4;
+    restarted.send(state.data(), state.size());
+    REQUIRE_FALSE(restarted.lastWasKeyframe());
+    REQUIRE(deliver(receiver, restarted.take()) == 1);
+    REQUIRE(sameState(receiver, state));
+    REQUIRE(receiver.frame() == 2);
+    REQUIRE(deliver(receiver, packets) == 0);
+    REQUIRE(receiver.stats().stale == packets.size());
+    REQUIRE(receiver.stats().restarts == 1);
+}
+
+class StateSyncHandler : public osc::PacketHandler {
+public:
+    StateSyncReceiver receiver;
+    std::mutex lock;
+
+    void onMessage(osc::Message& m) override {
+        std::lock_guard<std::mutex> guard(lock);
+        receiver.handle(m);
+    }
+};
+
+TEST_CASE( "StateSync loopback" ) {
+    StateSyncHandler handler;
+    handler.receiver.id("state");
+    osc::Recv server;
+    REQUIRE(server.open(10830, "localhost", 0.0));
+    server.handler(handler);
+    REQUIRE(server.start());
+
+    StateSyncSender sender;
+    sender.id("state");
+    REQUIRE(sender.open(10830, "localhost", 4096));
+
+    std::vector<unsigned char> state(64000);
+    for (size_t i = 0; i < state.size(); i++) state[i] = i % 251;
+    for (int frame = 0; frame < 10; frame++) {
+        state[frame * 1000] = frame;
+        REQUIRE(sender.send(state.data(), state.size()) > 0);
+        al_sleep(0.02);
+    }
+    al_sleep(0.1);
+    server.stop();
+
+    std::lock_guard<std::mutex> guard(handler.lock);
+    REQUIRE(handler.receiver.frame() == 10);
+    REQUIRE(sameState(handler.receiver, state));
+    REQUIRE(sender.stats().keyframes == 1);
+}
+
+TEST_CASE( "StateSync multicast and broadcast fan-out" ) {
+    REQUIRE(Socket::isMulticast("239.255.10.83"));
+    REQUIRE(Socket::isMulticast("224.0.0.1"));
+    REQUIRE_FALSE(Socket::isMulticast("192.168.10.255"));
+    REQUIRE_FALSE(Socket::isMulticast("localhost"));
+
+    // Listeners sharing one port, as render processes on one host would
+    StateSyncHandler handlers[3];
+    StateSyncListener listeners[3];
+    for (int i = 0; i < 3; i++) {
+        handlers[i].receiver.id("fanout");
+        REQUIRE(listeners[i].open(10832));
+        REQUIRE(listeners[i].joinMulticast("239.255.10.83", "127.0.0.1"));
+        listeners[i].handler(handlers[i]);
+        REQUIRE(listeners[i].start());
+    }
+
+    StateSyncSender sender;
+    sender.id("fanout");
+    sender.multicastInterface("127.0.0.1");
+    REQUIRE(sender.open(10832, "239.255.10.83"));
+
+    std::vector<unsigned char> state(20000);
+    for (int frame = 0; frame < 5; frame++) {
+        state[frame * 100] = frame + 1;
+        REQUIRE(sender.send(state.data(), state.size()) > 0);
+        al_sleep(0.02);
+    }
+    al_sleep(0.1);
+    for (auto& h : handlers) {
+        std::lock_guard<std::mutex> guard(h.lock);
+        REQUIRE(h.receiver.frame() == 5);
+        REQUIRE(sameState(h.receiver, state));
+        REQUIRE(h.receiver.stats().lost == 0);
+    }
+
+    // The same listeners receive broadcast, with the frame numbers going on
+    REQUIRE(sender.open(10832, "127.255.255.255"));
+    for (int frame = 5; frame < 8; frame++) {
+        state[frame * 100] = frame + 1;
+        REQUIRE(sender.send(state.data(), state.size()) > 0);
+        al_sleep(0.02);
+    }
+    al_sleep(0.1);
+    for (auto& l : listeners) l.close();
+    for (auto& h : handlers) {
+        std::lock_guard<std::mutex> guard(h.lock);
+        REQUIRE(h.receiver.frame() == 8);
+        REQUIRE(sameState(h.receiver, state));
+    }
+    REQUIRE(sender.stats().keyframes == 2);
+}
+
+TEST_CASE( "StateSync multi-megabyte keyframe over loopback" ) {
+    StateSyncHandler handler;
+    handler.receiver.id("big");
+    StateSyncListener listener;
+    REQUIRE(listener.open(10834, "127.0.0.1"));
+    listener.handler(handler);
+    REQUIRE(listener.start());
+
+    StateSyncSender sender;
+    sender.id("big");
+    REQUIRE(sender.open(10834, "127.0.0.1"));
+
+    // thousands of chunks, far more than a default socket buffer holds
+    std::vector<unsigned char> state(4 << 20);
+    for (size_t i = 0; i < state.size(); i++) state[i] = (i * 7) % 253;
+    REQUIRE(sender.send(state.data(), state.size()) > 0);
+    REQUIRE(sender.lastWasKeyframe());
+    REQUIRE(sender.stats().chunks > 2000);
+
+    for (int i = 0; i < 100; i++) {
+        {
+            std::lock_guard<std::mutex> guard(handler.lock);
+            if (handler.receiver.hasState()) break;
+        }
+        al_sleep(0.02);
+    }
+    listener.stop();
+
+    std::lock_guard<std::mutex> guard(handler.lock);
+    REQUIRE(handler.receiver.frame() == 1);
+    REQUIRE(sameState(handler.receiver, state));
+    REQUIRE(handler.receiver.stats().dropped == 0);
+}
+
+struct LargeState {
+    float values[20000];
+    int frame;
+};
+
+TEST_CASE( "StateSendDomain to StateReceiveDomain" ) {
+    SynchronousDomain root;
+    StateReceiveDomain<LargeState> receiveDomain;
+    auto received = std::make_shared<LargeState>();
+    std::memset(received.get(), 0, sizeof(LargeState));
+    receiveDomain.configure(10831, "big", "localhost");
+    receiveDomain.setStatePointer(received);
+    REQUIRE(receiveDomain.init(&root));
+
+    StateSendDomain<LargeState> sendDomain;
+    auto sent = std::make_shared<LargeState>();
+    for (int i = 0; i < 20000; i++) sent->values[i] = i * 0.5f;
+    sendDomain.configure(10831, "big", "localhost");
+    sendDomain.setStatePointer(sent);
+    REQUIRE(sendDomain.init(&root));
+
+    for (int frame = 1; frame <= 5; frame++) {
+        sent->frame = frame;
+        sent->values[frame] = -1;
+        REQUIRE(sendDomain.tick());
+        al_sleep(0.02);
+    }
+    al_sleep(0.1);
+    REQUIRE(receiveDomain.tick());
+    REQUIRE(std::memcmp(received.get(), sent.get(), sizeof(LargeState)) == 0);
+    REQUIRE(sendDomain.sender().stats().keyframes == 1);
+    REQUIRE(sendDomain.sender().stats().bytes < 2 * sizeof(LargeState));
+
+    REQUIRE(sendDomain.cleanup());
+    REQUIRE(receiveDomain.cleanup());
+}
+
+// Fails every packet sent to a multicast group, as a network without
+// multicast routes would
+class GroupFailingSender : public StateSyncSender {
+public:
+    size_t transmit(const osc::Packet& p) override {
+        if (Socket::isMulticast(mSocket.address())) return 0;
+        return StateSyncSender::transmit(p);
+    }
+};
+
+TEST_CASE( "StateSendDomain falls back when the group fails" ) {
+    SynchronousDomain root;
+    StateReceiveDomain<LargeState> receiveDomain;
+    auto received = std::make_shared<LargeState>();
+    std::memset(received.get(), 0, sizeof(LargeState));
+    receiveDomain.configure(10833, "fallback", "localhost");
+    receiveDomain.setStatePointer(received);
+    REQUIRE(receiveDomain.init(&root));
+
+    StateSendDomain<LargeState, GroupFailingSender> sendDomain;
+    auto sent = std::make_shared<LargeState>();
+    std::memset(sent.get(), 0, sizeof(LargeState));
+    sendDomain.configure(10833, "fallback", "localhost");
+    sendDomain.setMulticastGroup("239.255.10.83", "127.0.0.1");
+    sendDomain.setStatePointer(sent);
+    REQUIRE(sendDomain.init(&root));
+
+    // The group opens, but every frame sent to it fails
+    const int failures = StateSendDomain<LargeState>::maxGroupFailures;
+    for (int frame = 1; frame < failures; frame++) {
+        sent->frame = frame;
+        REQUIRE(sendDomain.tick());
+        REQUIRE(sendDomain.sendingToGroup());
+    }
+    sent->frame = failures;
+    REQUIRE(sendDomain.tick());
+    REQUIRE_FALSE(sendDomain.sendingToGroup());
+    REQUIRE(sendDomain.sender().stats().frames == 0);
+
+    // then states go to the address set instead
+    for (int frame = failures + 1; frame <= failures + 3; frame++) {
+        sent->frame = frame;
+        sent->values[frame] = 1;
+        REQUIRE(sendDomain.tick());
+        al_sleep(0.02);
+    }
+    al_sleep(0.1);
+    REQUIRE(sendDomain.sender().stats().frames == 3);
+    REQUIRE(receiveDomain.tick());
+    REQUIRE(std::memcmp(received.get(), sent.get(), sizeof(LargeState)) == 0);
+
+    // Setting the group again tries it again
+    sendDomain.setMulticastGroup("239.255.10.83", "127.0.0.1");
+    REQUIRE(sendDomain.tick());
+    REQUIRE(sendDomain.sendingToGroup());
+
+    REQUIRE(sendDomain.cleanup());
+    REQUIRE(receiveDomain.cleanup());
+}
@@ -0,0 +1,263 @@
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "al/graphics/al_Image.hpp"
+#include "al/graphics/al_TextureStreamer.hpp"
+
+using namespace al;
+
+// Records uploads instead of sending them to GL
+class MockUploader : public TextureUploader {
+public:
+    virtual void beginFrame() override { frames.push_back(0); }
+
+    virtual bool upload(const TextureUpload& u) override {
+        if (busy) return false;
+        frames.back()++;
+        uploads.push_back(u);
+        firstBytes.push_back(static_cast<const uint8_t*>(u.pixels)[0]);
+        return true;
+    }
+
+    bool busy = false;
+    std::vector<int> frames;  // uploads per frame
+    std::vector<TextureUpload> uploads;
+    std::vector<uint8_t> firstBytes;
+};
+
+TEST_CASE( "Texture streamer upload budget" ) {
+    TextureStreamer streamer;
+    auto mock = std::make_shared<MockUploader>();
+    streamer.uploader(mock);
+    const size_t mb = 1024 * 1024;
+    streamer.budget(3 * mb);
+
+    // 1 MB each: 512 x 512 RGBA bytes
+    std::vector<Texture> textures(10);
+    std::vector<uint8_t> pixels(mb);
+    for (int i = 0; i < 10; i++) {
+        pixels[0] = uint8_t(i);
+        streamer.submit(textures[i], pixels.data(), 512, 512);
+    }
+    REQUIRE(streamer.pending() == 10);
+
+    REQUIRE(streamer.update() == 3 * mb);
+    REQUIRE(streamer.update() == 3 * mb);
+    REQUIRE(streamer.update() == 3 * mb);
+    REQUIRE(streamer.update() == mb);
+    REQUIRE(streamer.update() == 0);
+    REQUIRE(mock->frames == std::vector<int>({3, 3, 3, 1, 0}));
+    REQUIRE(streamer.uploadedBytes() == 10 * mb);
+    REQUIRE(streamer.pending() == 0);
+    // In submission order
+    for (int i = 0; i < 10; i++) {
+        REQUIRE(mock->uploads[i].texture == &textures[i]);
+        REQUIRE(mock->firstBytes[i] == i);
+        REQUIRE(mock->uploads[i].width == 512);
+        REQUIRE(mock->uploads[i].bytes == mb);
+    }
+
+    // An image larger than the budget goes alone
+    std::vector<uint8_t> large(4 * mb);
+    streamer.submit(textures[0], large.data(), 1024, 1024);
+    streamer.submit(textures[1], pixels.data(), 512, 512);
+    REQUIRE(streamer.update() == 4 * mb);
+    REQUIRE(streamer.update() == mb);
+
+    // A busy uploader defers to the next frame
+    streamer.submit(textures[0], pixels.data(), 512, 512);
+    mock->busy = true;
+    REQUIRE(streamer.update() == 0);
+    REQUIRE(streamer.pending() == 1);
+    mock->busy = false;
+    REQUIRE(streamer.update() == mb);
+}
+
+TEST_CASE( "Texture streamer uploads only the latest image" ) {
+    TextureStreamer streamer;
+    auto mock = std::make_shared<MockUploader>();
+    streamer.uploader(mock);
+
+    Texture a, b;
+    std::vector<uint8_t> pixels(16 * 16 * 4);
+    for (int i = 0; i < 3; i++) {
+        pixels[0] = uint8_t(i);
+        streamer.submit(a, pixels.data(), 16, 16);
+    }
+    streamer.submit(b, pixels.data(), 16, 16);
+    REQUIRE(streamer.pending() == 2);
+    streamer.update();
+    REQUIRE(mock->uploads.size() == 2);
+    REQUIRE(mock->uploads[0].texture == &a);
+    REQUIRE(mock->firstBytes[0] == 2);
+
+    // Cancelled textures receive nothing
+    streamer.submit(a, pixels.data(), 16, 16);
+    streamer.submit(b, pixels.data(), 16, 16);
+    streamer.cancel(a);
+    REQUIRE(streamer.pending() == 1);
+    streamer.update();
+    REQUIRE(mock->uploads.size() == 3);
+    REQUIRE(mock->uploads[2].texture == &b);
+}
+
+TEST_CASE( "Texture streamer decodes files on worker threads" ) {
+    const char* path = "al_test_texture_streamer.png";
+    std::vector<unsigned char> rgb(20 * 10 * 3, 0);
+    rgb[0] = 255;
+    Image::saveImage(path, rgb.data(), 20, 10);
+
+    TextureStreamer streamer(2);
+    auto mock = std::make_shared<MockUploader>();
+    streamer.uploader(mock);
+    std::vector<Texture> textures(8);
+    for (auto& tex : textures) {
+        streamer.load(tex, path);
+    }
+    Texture missing;
+    streamer.load(missing, "al_test_texture_streamer_missing.png");
+    streamer.waitDecoded();
+    std::remove(path);
+
+    REQUIRE(streamer.failed() == 1);
+    REQUIRE(streamer.pending() == 8);
+    streamer.update();
+    REQUIRE(mock->uploads.size() == 8);
+    for (auto& u : mock->uploads) {
+        REQUIRE(u.width == 20);
+        REQUIRE(u.height == 10);
+        REQUIRE(u.format == Texture::RGBA);
+        REQUIRE(u.type == Texture::UBYTE);
+        REQUIRE(u.bytes == 20 * 10 * 4);
+    }
+    REQUIRE(streamer.pending() == 0);
+}
+
+// Fake GL entry points for PBOUploader, recording which buffer each map and
+// each texture transfer used
+namespace {
+GLuint pboNextName = 1;
+GLuint pboBound = 0;
+bool pboFailMap = false;
+int pboDeletedBuffers = 0;
+int pboDeletedFences = 0;
+int pboDirectSubmits = 0;
+std::vector<GLuint> pboMapped;
+std::vector<uint8_t> pboMemory(64 * 64 * 4);
+
+void APIENTRY fakeGenNames(GLsizei n, GLuint* names) {
+    for (int i = 0; i < n; i++) names[i] = pboNextName++;
+}
+void APIENTRY fakeDeleteBuffers(GLsizei n, const GLuint*) {
+    pboDeletedBuffers += n;
+}
+void APIENTRY fakeDeleteTextures(GLsizei, const GLuint*) {}
+void APIENTRY fakeBindBuffer(GLenum, GLuint id) { pboBound = id; }
+void APIENTRY fakeBindTexture(GLenum, GLuint) {}
+void APIENTRY fakeActiveTexture(GLenum) {}
+void APIENTRY fakeBufferData(GLenum, GLsizeiptr, const void*, GLenum) {}
+void* APIENTRY fakeMapBufferRange(GLenum, GLintptr, GLsizeiptr, GLbitfield) {
+    pboMapped.push_back(pboBound);
+    return pboFailMap ? nullptr : pboMemory.data();
+}
+GLboolean APIENTRY fakeUnmapBuffer(GLenum) { return GL_TRUE; }
+GLsync APIENTRY fakeFenceSync(GLenum, GLbitfield) {
+    return reinterpret_cast<GLsync>(uintptr_t(1));
+}
+void APIENTRY fakeDeleteSync(GLsync) { pboDeletedFences++; }
+GLenum APIENTRY fakeClientWaitSync(GLsync, GLbitfield, GLuint64) {
+    return GL_ALREADY_SIGNALED;
+}
+void APIENTRY fakeTexImage2D(GLenum, GLint, GLint, GLsizei, GLsizei, GLint,
+                             GLenum, GLenum, const void*) {}
+void APIENTRY fakeTexParameteri(GLenum, GLenum, GLint) {}
+void APIENTRY fakeGenerateMipmap(GLenum) {}
+void APIENTRY fakeTexSubImage2D(GLenum, GLint, GLint, GLint, GLsizei,
+                                GLsizei, GLenum, GLenum, const void*) {
+    if (!pboBound) pboDirectSubmits++;
+}
+
+struct FakePBO {
+    FakePBO() {
+        glad_glGenBuffers = fakeGenNames;
+        glad_glGenTextures = fakeGenNames;
+        glad_glDeleteBuffers = fakeDeleteBuffers;
+        glad_glDeleteTextures = fakeDeleteTextures;
+        glad_glBindBuffer = fakeBindBuffer;
+        glad_glBindTexture = fakeBindTexture;
+        glad_glActiveTexture = fakeActiveTexture;
+        glad_glBufferData = fakeBufferData;
+        glad_glMapBufferRange = fakeMapBufferRange;
+        glad_glUnmapBuffer = fakeUnmapBuffer;
+        glad_glFenceSync = fakeFenceSync;
+        glad_glDeleteSync = fakeDeleteSync;
+        glad_glClientWaitSync = fakeClientWaitSync;
+        glad_glTexImage2D = fakeTexImage2D;
+        glad_glTexParameteri = fakeTexParameteri;
+        glad_glGenerateMipmap = fakeGenerateMipmap;
+        glad_glTexSubImage2D = fakeTexSubImage2D;
+    }
+    ~FakePBO() {
+        glad_glGenBuffers = nullptr;
+        glad_glGenTextures = nullptr;
+        glad_glDeleteBuffers = nullptr;
+        glad_glDeleteTextures = nullptr;
+        glad_glBindBuffer = nullptr;
+        glad_glBindTexture = nullptr;
+        glad_glActiveTexture = nullptr;
+        glad_glBufferData = nullptr;
+        glad_glMapBufferRange = nullptr;
+        glad_glUnmapBuffer = nullptr;
+        glad_glFenceSync = nullptr;
+        glad_glDeleteSync = nullptr;
+        glad_glClientWaitSync = nullptr;
+        glad_glTexImage2D = nullptr;
+        glad_glTexParameteri = nullptr;
+        glad_glGenerateMipmap = nullptr;
+        glad_glTexSubImage2D = nullptr;
+    }
+};
+}  // namespace
+
+TEST_CASE( "PBO uploader ring and cleanup" ) {
+    // Without a graphics context nothing is released, and an unused
+    // uploader makes no GL calls at all
+    { PBOUploader unused; }
+
+    FakePBO fake;
+    Texture tex;
+    std::vector<uint8_t> pixels(64 * 64 * 4, 7);
+    TextureUpload u{&tex, pixels.data(), pixels.size(), 64, 64,
+                    Texture::RGBA, Texture::UBYTE};
+    {
+        PBOUploader pbo(2);
+        REQUIRE(pbo.upload(u));
+        REQUIRE(pboMemory[0] == 7);
+
+        // A failed map falls back to a direct upload and keeps its slot
+        pboFailMap = true;
+        REQUIRE(pbo.upload(u));
+        REQUIRE(pboDirectSubmits == 1);
+        pboFailMap = false;
+        REQUIRE(pbo.upload(u));
+        REQUIRE(pbo.upload(u));
+        REQUIRE(pboMapped.size() == 4);
+        REQUIRE(pboMapped[0] != pboMapped[1]);
+        REQUIRE(pboMapped[2] == pboMapped[1]);
+        REQUIRE(pboMapped[3] == pboMapped[0]);
+        REQUIRE(pboDirectSubmits == 1);
+    }
+    REQUIRE(pboDeletedBuffers == 0);
+
+    PBOUploader pbo(2);
+    REQUIRE(pbo.upload(u));
+    REQUIRE(pbo.upload(u));
+    pboDeletedFences = 0;
+    pbo.destroy();
+    REQUIRE(pboDeletedBuffers == 2);
+    REQUIRE(pboDeletedFences == 2);
+}
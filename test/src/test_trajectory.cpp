@@ -0,0 +1,154 @@
+
+#include <cmath>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "al/math/al_Interpolation.hpp"
+#include "al/math/al_Random.hpp"
+#include "al/spatial/al_Trajectory.hpp"
+
+using namespace al;
+
+static bool sameRotation(const Quatf& a, const Quatd& b, double eps = 1e-5) {
+    return std::abs(Quatd(a).dot(b)) > 1 - eps;
+}
+
+static bool near(const Vec3f& a, const Vec3d& b, double eps = 1e-4) {
+    return (Vec3d(a) - b).mag() < eps;
+}
+
+TEST_CASE( "Trajectories interpolation" ) {
+    // Odd count leaves remainders after the SIMD loops
+    const uint32_t n = 203, numKeys = 5;
+    rnd::Random<> rng(9);
+    Trajectories paths(n);
+    std::vector<std::vector<Pose>> keys(n);
+    const double times[] = {0, 1, 2, 3, 4};
+    for (uint32_t i = 0; i < n; i++) {
+        for (uint32_t k = 0; k < numKeys; k++) {
+            Quatd q = Quatd().fromEuler(rng.uniformS() * 3, rng.uniformS(),
+                                        rng.uniformS());
+            keys[i].push_back(Pose(Vec3d(rng.uniformS(), rng.uniformS(),
+                                         rng.uniformS()) * 10,
+                                   q));
+        }
+        REQUIRE(paths.setKeys(i, times, keys[i].data(), numKeys));
+    }
+    REQUIRE(paths.numKeys() == n * numKeys);
+    REQUIRE(paths.endTime(7) == 4);
+
+    std::vector<Vec3f> pos(n);
+    std::vector<Quatf> quat(n);
+
+    // Catmull-Rom on uniform keys is ipl::hermite without tension or bias
+    paths.evaluate(1.3, pos.data(), quat.data());
+    bool ok = true;
+    for (uint32_t i = 0; i < n; i++) {
+        const auto& p = keys[i];
+        Vec3d expect = ipl::hermite(0.3, p[0].pos(), p[1].pos(), p[2].pos(),
+                                    p[3].pos(), 0., 0.);
+        ok = ok && near(pos[i], expect);
+        ok = ok && sameRotation(quat[i],
+                                Quatd::slerp(p[1].quat(), p[2].quat(), 0.3));
+    }
+    REQUIRE(ok);
+
+    paths.positionMode(Trajectories::LINEAR);
+    paths.evaluate(2.75, pos.data(), quat.data());
+    for (uint32_t i = 0; i < n; i++) {
+        const auto& p = keys[i];
+        ok = ok && near(pos[i], Vec3d(p[2].pos()).lerp(p[3].pos(), 0.75));
+        ok = ok && sameRotation(quat[i],
+                                Quatd::slerp(p[2].quat(), p[3].quat(), 0.75));
+    }
+    REQUIRE(ok);
+
+    // Keys are met exactly, and held outside of them
+    paths.orientationMode(Trajectories::SQUAD);
+    paths.positionMode(Trajectories::CATMULL_ROM);
+    const double at[] = {-1, 0, 2, 4, 9};
+    const uint32_t atKey[] = {0, 0, 2, 4, 4};
+    for (int t = 0; t < 5; t++) {
+        paths.evaluate(at[t], pos.data(), quat.data());
+        for (uint32_t i = 0; i < n; i++) {
+            ok = ok && near(pos[i], keys[i][atKey[t]].pos());
+            ok = ok && sameRotation(quat[i], keys[i][atKey[t]].quat());
+        }
+    }
+    REQUIRE(ok);
+
+    // Squad keeps angular velocity continuous across keys, while slerp
+    // changes it abruptly
+    auto angle = [](const Quatf& a, const Quatf& b) {
+        return 2 * std::acos(std::min(1.0, std::abs(Quatd(a).dot(b))));
+    };
+    const double e = 1e-2;
+    std::vector<Quatf> before(n), after(n);
+    double squadJump = 0, slerpJump = 0;
+    for (int mode = 0; mode < 2; mode++) {
+        paths.orientationMode(mode ? Trajectories::SLERP
+                                   : Trajectories::SQUAD);
+        paths.evaluate(2 - e, nullptr, before.data());
+        paths.evaluate(2, nullptr, quat.data());
+        paths.evaluate(2 + e, nullptr, after.data());
+        double jump = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            jump += std::abs(angle(before[i], quat[i]) -
+                             angle(quat[i], after[i])) / e;
+        }
+        (mode ? slerpJump : squadJump) = jump / n;
+    }
+    REQUIRE(squadJump < slerpJump / 10);
+
+    // Hermite goes through the velocities given
+    Trajectories hermite(2);
+    hermite.positionMode(Trajectories::HERMITE);
+    REQUIRE(hermite.addKey(1, 1, Pose(Vec3d(0)), Vec3d(1, 0, 0)));
+    REQUIRE(hermite.addKey(1, 3, Pose(Vec3d(2, 0, 0)), Vec3d(0, 4, 0)));
+    REQUIRE_FALSE(hermite.addKey(1, 3, Pose(Vec3d(0))));
+    REQUIRE(hermite.numKeys(1) == 2);
+    hermite.evaluate(2, pos.data(), quat.data());
+    REQUIRE(pos[0] == Vec3f(0));
+    REQUIRE(quat[0] == Quatf::identity());
+    // h (v0 - v1) / 8 off the midpoint
+    REQUIRE(near(pos[1], Vec3d(1.25, -1, 0)));
+}
+
+TEST_CASE( "Trajectories block sampling" ) {
+    const uint32_t n = 37, frames = 300;
+    rnd::Random<> rng(4);
+    Trajectories paths(n);
+    paths.orientationMode(Trajectories::SQUAD);
+    for (uint32_t i = 0; i < n; i++) {
+        double t = rng.uniform(-0.01, 0.);
+        for (int k = 0; k < 6; k++) {
+            Pose p(Vec3d(rng.uniformS(), rng.uniformS(), rng.uniformS()),
+                   Quatd().fromEuler(rng.uniformS(), rng.uniformS(), 0.));
+            REQUIRE(paths.addKey(i, t, p));
+            t += rng.uniform(0.001, 0.004);
+        }
+    }
+    paths.clearKeys(5);
+    REQUIRE(paths.numKeys(5) == 0);
+
+    // One block of audio crosses several keys
+    const double start = 0.001, step = 1. / 44100;
+    std::vector<Vec3f> pos(n * frames), one(n);
+    std::vector<Quatf> quat(n * frames), oneQuat(n);
+    paths.sample(start, step, frames, pos.data(), quat.data());
+    bool same = true;
+    for (uint32_t f = 0; f < frames; f += 13) {
+        paths.evaluate(start + f * step, one.data(), oneQuat.data());
+        for (uint32_t i = 0; i < n; i++) {
+            same = same && pos[i * frames + f] == one[i];
+            same = same && quat[i * frames + f] == oneQuat[i];
+        }
+    }
+    REQUIRE(same);
+    REQUIRE(pos[5 * frames + 7] == Vec3f(0));
+
+    std::vector<Pose> poses(n);
+    paths.evaluate(start, poses.data());
+    REQUIRE(near(pos[3 * frames], poses[3].pos(), 1e-6));
+}
@@ -0,0 +1,99 @@
+
+#include <cmath>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "al/math/al_Random.hpp"
+#include "al/math/al_VecBatch.hpp"
+
+using namespace al;
+
+template <class T>
+static std::vector<Vec<3, T>> randomVecs(size_t n, unsigned seed) {
+    rnd::Random<> rng(seed);
+    std::vector<Vec<3, T>> v(n);
+    for (auto& x : v) {
+        x = Vec<3, T>(rng.uniformS(), rng.uniformS(), rng.uniformS()) * 10;
+    }
+    return v;
+}
+
+template <class T>
+static bool near(const std::vector<Vec<3, T>>& a,
+                 const std::vector<Vec<3, T>>& b, double eps) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        for (int c = 0; c < 3; c++) {
+            if (std::abs(a[i][c] - b[i][c]) > eps) return false;
+        }
+    }
+    return true;
+}
+
+template <class T>
+static void checkKernels(double eps) {
+    typedef Vec<3, T> V;
+    // Odd count leaves remainders after the SIMD loops, and enough to be
+    // split across threads
+    const size_t n = 70001;
+    std::vector<V> a = randomVecs<T>(n, 1), b = randomVecs<T>(n, 2);
+    std::vector<V> out(n), expect(n);
+
+    Matrix4<T> m = Matrix4<T>::translation(Vec<3, T>(1, -2, 3)) *
+                   Matrix4<T>::rotate(0.7, Vec<3, T>(1, 2, 3).normalize()) *
+                   Matrix4<T>::scaling(Vec<3, T>(2, 0.5, 1.5));
+    for (size_t i = 0; i < n; i++) {
+        Vec<4, T> p = m * Vec<4, T>(a[i], 1);
+        expect[i] = V(p.x, p.y, p.z);
+    }
+    transformPoints(m, a.data(), out.data(), n);
+    REQUIRE(near(out, expect, eps));
+
+    for (size_t i = 0; i < n; i++) {
+        Vec<4, T> p = m * Vec<4, T>(a[i], 0);
+        expect[i] = V(p.x, p.y, p.z);
+    }
+    transformVectors(m, a.data(), out.data(), n);
+    REQUIRE(near(out, expect, eps));
+
+    Quat<T> q = Quat<T>().fromAxisAngle(1.1, V(-1, 0.5, 2).normalize());
+    for (size_t i = 0; i < n; i++) expect[i] = q.rotate(a[i]);
+    rotate(q, a.data(), out.data(), n);
+    REQUIRE(near(out, expect, eps));
+
+    for (size_t i = 0; i < n; i++) expect[i] = a[i].cross(b[i]);
+    cross(a.data(), b.data(), out.data(), n);
+    REQUIRE(near(out, expect, eps * 10));
+
+    std::vector<T> dots(n);
+    dot(a.data(), b.data(), dots.data(), n);
+    bool same = true;
+    for (size_t i = 0; i < n; i++) {
+        same = same && std::abs(dots[i] - a[i].dot(b[i])) <= eps * 10;
+    }
+    REQUIRE(same);
+
+    // Zero length vectors normalize like Vec::normalize
+    a[3] = V(0);
+    a[n - 1] = V(0);
+    for (size_t i = 0; i < n; i++) expect[i] = a[i].normalized(2);
+    normalize(a.data(), out.data(), n, 2);
+    REQUIRE(near(out, expect, eps));
+    REQUIRE(out[3] == V(2, 0, 0));
+
+    // In place
+    out = a;
+    normalize(out.data(), out.data(), n, 2);
+    REQUIRE(near(out, expect, eps));
+    out = a;
+    transformPoints(m, out.data(), out.data(), 5);
+    REQUIRE(out[5] == a[5]);
+    transformPoints(m, a.data(), a.data(), 5);
+    REQUIRE(near(out, a, 0));
+}
+
+TEST_CASE( "Batch vector kernels" ) {
+    checkKernels<float>(1e-4);
+    checkKernels<double>(1e-10);
+}
@@ -0,0 +1,141 @@
+
+#include <cmath>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "al/types/al_Voxels.hpp"
+
+using namespace al;
+
+// Value of the slice pixel (i, j) sampled with read_interp. side is 1 if
+// the pixel centre is inside the volume, -1 if outside and 0 if too near a
+// face to tell.
+static float sliceReference(const Voxels& vox, const Vec3f* corners,
+                            int width, int height, int i, int j, int& side) {
+    Vec3f pos = corners[0] + (corners[1] - corners[0]) * ((i + 0.5f) / width) +
+                (corners[3] - corners[0]) * ((j + 0.5f) / height);
+    Vec3f extent(vox.width() * vox.getVoxWidth(0),
+                 vox.height() * vox.getVoxWidth(1),
+                 vox.depth() * vox.getVoxWidth(2));
+    const float margin = 0.01f;
+    side = 1;
+    for (int a = 0; a < 3; a++) {
+        if (pos[a] < -margin || pos[a] > extent[a] + margin) side = -1;
+        if (side == 1 && (pos[a] < margin || pos[a] > extent[a] - margin)) {
+            side = 0;
+        }
+    }
+    if (side < 0) return 0;
+    Vec3f p(pos.x / vox.getVoxWidth(0), pos.y / vox.getVoxWidth(1),
+            pos.z / vox.getVoxWidth(2));
+    float v = 0;
+    vox.read_interp(&v, p);
+    return v;
+}
+
+TEST_CASE( "Array format and interpolation" ) {
+    Array a(2, Array::type<float>(), 4, 3, 2);
+    REQUIRE(a.dimcount() == 3);
+    REQUIRE(a.cells() == 24);
+    REQUIRE(a.size() == 24 * 2 * sizeof(float));
+    float v[2] = {1, -1};
+    a.write(v, 3, 2, 1);
+    REQUIRE(a.elem<float>(0, 3, 2, 1) == 1);
+    REQUIRE(a.elem<float>(1, 3, 2, 1) == -1);
+
+    // halfway between a cell and its zero neighbours
+    float r[2];
+    a.read_interp(r, Vec3f(2.5f, 2, 1));
+    REQUIRE(r[0] == Approx(0.5f));
+    REQUIRE(r[1] == Approx(-0.5f));
+    // clamped past the edge
+    a.read_interp(r, Vec3f(10, 10, 10));
+    REQUIRE(r[0] == 1);
+
+    Array copy = a;
+    REQUIRE(copy.elem<float>(0, 3, 2, 1) == 1);
+    REQUIRE(copy.data.ptr != a.data.ptr);
+
+    // Rows padded to an alignment
+    Array aligned;
+    aligned.formatAligned(1, Array::type<uint8_t>(), 5, 3, 0, 8);
+    REQUIRE(aligned.header.stride[1] == 8);
+    REQUIRE(aligned.size() == 24);
+}
+
+TEST_CASE( "Voxels sliceInto" ) {
+    Voxels vox(Array::type<uint8_t>(), 24, 20, 16, 0.5f, 1.0f, 0.75f);
+    for (uint32_t z = 0; z < vox.depth(); z++) {
+        for (uint32_t y = 0; y < vox.height(); y++) {
+            for (uint32_t x = 0; x < vox.width(); x++) {
+                vox.elem<uint8_t>(0, x, y, z) =
+                    (x * 7 + y * 13 + z * 29) % 251;
+            }
+        }
+    }
+    Vec3f center(6, 10, 6);
+    const int w = 64, h = 48;
+
+    SECTION( "oblique plane matches read_interp inside the volume" ) {
+        Vec3f normal(0.3f, -0.5f, 0.8f);
+        std::vector<float> out(w * h, -1.f);
+        Vec3f corners[4];
+        REQUIRE(vox.sliceInto(center, normal, out.data(), w, h, corners, 4));
+
+        int insideCount = 0, outsideCount = 0;
+        for (int j = 0; j < h; j++) {
+            for (int i = 0; i < w; i++) {
+                int side;
+                float ref = sliceReference(vox, corners, w, h, i, j, side);
+                float got = out[j * w + i];
+                if (side > 0) {
+                    REQUIRE(got == Approx(ref).margin(1e-2));
+                    insideCount++;
+                } else if (side < 0) {
+                    REQUIRE(got == 0);
+                    outsideCount++;
+                }
+            }
+        }
+        // the polygon does not fill its bounding rectangle
+        REQUIRE(insideCount > w * h / 4);
+        REQUIRE(outsideCount > 0);
+
+        // Corners lie on the plane
+        for (auto& c : corners) {
+            REQUIRE(normal.normalized().dot(c - center) ==
+                    Approx(0).margin(1e-4));
+        }
+
+        // Threads split the rows without changing the result
+        std::vector<float> single(w * h);
+        REQUIRE(vox.sliceInto(center, normal, single.data(), w, h, nullptr,
+                              1));
+        REQUIRE(single == out);
+    }
+
+    SECTION( "axis aligned plane covers the whole rectangle" ) {
+        std::vector<float> out(w * h);
+        Vec3f corners[4];
+        REQUIRE(vox.sliceInto(center, Vec3f(0, 0, 1), out.data(), w, h,
+                              corners));
+        for (int j = 0; j < h; j++) {
+            for (int i = 0; i < w; i++) {
+                int side;
+                float ref = sliceReference(vox, corners, w, h, i, j, side);
+                REQUIRE(side > 0);
+                REQUIRE(out[j * w + i] == Approx(ref).margin(1e-2));
+            }
+        }
+    }
+
+    SECTION( "planes missing the volume" ) {
+        std::vector<float> out(w * h);
+        REQUIRE_FALSE(vox.sliceInto(Vec3f(0, 0, 100), Vec3f(0, 0, 1),
+                                    out.data(), w, h));
+        REQUIRE_FALSE(vox.sliceInto(center, Vec3f(0, 0, 0), out.data(), w,
+                                    h));
+        REQUIRE_FALSE(vox.sliceInto(center, Vec3f(0, 0, 1), nullptr, w, h));
+    }
+}
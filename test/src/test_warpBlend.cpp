@@ -0,0 +1,101 @@
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "al/sphere/al_PerProjection.hpp"
+#include "al/system/al_Time.hpp"
+
+using namespace al;
+
+// Writes a warp file whose directions fan out from dir by up to halfAngle
+// around the y axis. The last column is not blended in.
+static void writeWarp(const std::string& path, int w, int h, float halfAngle) {
+    std::vector<Vec4f> texels(w * h);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            float a = halfAngle * (2.0f * x / (w - 2) - 1);
+            float blend = x < w - 1 ? 1.0f : 0.0f;
+            texels[y * w + x] = Vec4f(std::sin(a), 0, -std::cos(a), blend);
+        }
+    }
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(texels.data()),
+               texels.size() * sizeof(Vec4f));
+}
+
+TEST_CASE( "Warp blend calibration loading and cache" ) {
+    const std::string host = "al_test_warpblend";
+    const std::string files[2] = {"al_test_warpblend_0.bin",
+                                  "al_test_warpblend_1.bin"};
+    {
+        std::ofstream config(host + ".txt");
+        for (int i = 0; i < 2; i++) {
+            config << "id " << i << "\n"
+                   << "width 66\nheight 32\n"
+                   << "b 0\nh 1\nl " << 0.5 * i << "\nw 0.5\n"
+                   << "active 1\nfilepath " << files[i] << "\n";
+        }
+    }
+    writeWarp(files[0], 66, 32, 0.5f);
+    writeWarp(files[1], 66, 32, 0.25f);
+    std::remove((host + ".cache").c_str());
+
+    WarpBlendData first;
+    first.load_allosphere_calibration(".", host.c_str());
+    REQUIRE(first.viewports.size() == 2);
+    for (int i = 0; i < 2; i++) {
+        auto& vp = first.viewports[i];
+        REQUIRE(vp.warp_and_blend_data.size() == 66 * 32);
+        REQUIRE_FALSE(vp.derived_from_cache);
+        // The unblended column doesn't widen the fov but still counts
+        // towards the direction, as before
+        REQUIRE(vp.direction.z < -0.99f);
+        REQUIRE(vp.direction.x > 0);
+        REQUIRE(vp.fov == Approx(i == 0 ? 1.0f : 0.5f).epsilon(0.02));
+    }
+
+    // Loading again reuses the derived data
+    WarpBlendData second;
+    second.load_allosphere_calibration(".", host.c_str());
+    for (int i = 0; i < 2; i++) {
+        auto& a = first.viewports[i];
+        auto& b = second.viewports[i];
+        REQUIRE(b.derived_from_cache);
+        REQUIRE(b.direction.x == a.direction.x);
+        REQUIRE(b.direction.z == a.direction.z);
+        REQUIRE(b.fov == a.fov);
+        REQUIRE(b.warp_and_blend_data.size() == a.warp_and_blend_data.size());
+    }
+
+    // A changed warp file is derived again
+    writeWarp(files[1], 66, 16, 0.25f);
+    WarpBlendData third;
+    third.load_allosphere_calibration(".", host.c_str());
+    REQUIRE(third.viewports[0].derived_from_cache);
+    REQUIRE_FALSE(third.viewports[1].derived_from_cache);
+
+    // as is one rewritten in place with the same size within a second
+    al_sleep(0.05);
+    writeWarp(files[0], 66, 32, 0.75f);
+    WarpBlendData fourth;
+    fourth.load_allosphere_calibration(".", host.c_str());
+    REQUIRE_FALSE(fourth.viewports[0].derived_from_cache);
+    REQUIRE(fourth.viewports[0].fov == Approx(1.5f).epsilon(0.02));
+
+    // or replaced by renaming another file over it
+    writeWarp(files[0] + ".tmp", 66, 32, 0.5f);
+    std::rename((files[0] + ".tmp").c_str(), files[0].c_str());
+    WarpBlendData fifth;
+    fifth.load_allosphere_calibration(".", host.c_str());
+    REQUIRE_FALSE(fifth.viewports[0].derived_from_cache);
+    REQUIRE(fifth.viewports[0].fov == Approx(1.0f).epsilon(0.02));
+
+    std::remove((host + ".txt").c_str());
+    std::remove((host + ".cache").c_str());
+    std::remove(files[0].c_str());
+    std::remove(files[1].c_str());
+}